@@ -0,0 +1,178 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#define _POSIX_C_SOURCE 200112L // posix_memalign
+
+#include "alloc.h"
+#include "utils.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Memory returned by haplo_alloc is preceded by this header. Its size
+// keeps the memory after it aligned to 16 bytes.
+typedef struct {
+  HaploAllocator *allocator;
+  size_t size;
+} HaploAllocHeader;
+
+_Static_assert(sizeof(HaploAllocHeader) == 16,
+               "HaploAllocHeader must preserve a 16 bytes alignment");
+
+static void *haplo_default_alloc(void *ctx, size_t size, size_t alignment)
+{
+  if (alignment <= 16) return malloc(size);
+
+  void *ptr = NULL;
+  if (posix_memalign(&ptr, alignment, size) != 0) return NULL;
+  return ptr;
+}
+
+static void haplo_default_free(void *ctx, void *ptr, size_t size)
+{
+  free(ptr);
+}
+
+HaploAllocator haplo_default_allocator = {
+  .alloc = haplo_default_alloc,
+  .free = haplo_default_free,
+  .ctx = NULL,
+  .quota = 0,
+  .used = 0,
+  .exhausted = false,
+};
+
+static __thread HaploAllocator *haplo_allocator_bound = NULL;
+
+HaploAllocator *haplo_allocator_bind(HaploAllocator *allocator)
+{
+  HaploAllocator *prev = haplo_allocator_current();
+  haplo_allocator_bound = allocator;
+  return prev;
+}
+
+HaploAllocator *haplo_allocator_current(void)
+{
+  if (LIKELY(haplo_allocator_bound != NULL))
+    return haplo_allocator_bound;
+  return &haplo_default_allocator;
+}
+
+void *haplo_allocator_alloc(HaploAllocator *allocator, size_t size,
+                            size_t alignment)
+{
+  if (!allocator) allocator = &haplo_default_allocator;
+
+  if (allocator->quota != 0 &&
+      (size > allocator->quota || allocator->used > allocator->quota - size))
+  {
+    allocator->exhausted = true;
+    return NULL;
+  }
+
+  void *ptr = allocator->alloc(allocator->ctx, size, alignment);
+  if (UNLIKELY(!ptr))
+  {
+    allocator->exhausted = true;
+    return NULL;
+  }
+
+  if (allocator->quota != 0) allocator->used += size;
+  return ptr;
+}
+
+void haplo_allocator_free(HaploAllocator *allocator, void *ptr, size_t size)
+{
+  if (!ptr) return;
+  if (!allocator) allocator = &haplo_default_allocator;
+
+  if (allocator->quota != 0)
+    allocator->used = (allocator->used > size) ? allocator->used - size : 0;
+  allocator->free(allocator->ctx, ptr, size);
+  return;
+}
+
+static void *haplo_alloc_from(HaploAllocator *allocator, size_t size)
+{
+  if (size > SIZE_MAX - sizeof(HaploAllocHeader))
+  {
+    allocator->exhausted = true;
+    return NULL;
+  }
+
+  HaploAllocHeader *header =
+    haplo_allocator_alloc(allocator, sizeof(HaploAllocHeader) + size, 16);
+  if (!header) return NULL;
+
+  header->allocator = allocator;
+  header->size = size;
+  return header + 1;
+}
+
+void *haplo_alloc(size_t size)
+{
+  return haplo_alloc_from(haplo_allocator_current(), size);
+}
+
+void *haplo_calloc(size_t count, size_t size)
+{
+  if (size != 0 && count > SIZE_MAX / size)
+  {
+    haplo_allocator_current()->exhausted = true;
+    return NULL;
+  }
+
+  void *ptr = haplo_alloc(count * size);
+  if (ptr) memset(ptr, 0, count * size);
+  return ptr;
+}
+
+void *haplo_realloc(void *ptr, size_t size)
+{
+  if (!ptr) return haplo_alloc(size);
+
+  HaploAllocHeader *header = (HaploAllocHeader*) ptr - 1;
+  if (size <= header->size)
+  {
+    // Shrinking keeps the block, the quota is not updated
+    return ptr;
+  }
+
+  void *new_ptr = haplo_alloc_from(header->allocator, size);
+  if (!new_ptr) return NULL;
+
+  memcpy(new_ptr, ptr, header->size);
+  haplo_free(ptr);
+  return new_ptr;
+}
+
+void haplo_free(void *ptr)
+{
+  if (!ptr) return;
+
+  HaploAllocHeader *header = (HaploAllocHeader*) ptr - 1;
+  haplo_allocator_free(header->allocator, header,
+                       sizeof(HaploAllocHeader) + header->size);
+  return;
+}
+
+char *haplo_strdup(const char *str)
+{
+  if (!str) return NULL;
+  return haplo_strndup(str, strlen(str));
+}
+
+char *haplo_strndup(const char *str, size_t len)
+{
+  if (!str) return NULL;
+
+  char *out = haplo_alloc(len + 1);
+  if (!out) return NULL;
+
+  memcpy(out, str, len);
+  out[len] = '\0';
+  return out;
+}
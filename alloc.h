@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#ifndef HAPLO_ALLOC_H
+#define HAPLO_ALLOC_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+//
+// Macros
+//
+
+#ifdef HAPLO_NO_PREFIX
+  #define Allocator HaploAllocator
+  #define default_allocator haplo_default_allocator
+  #define allocator_bind haplo_allocator_bind
+  #define allocator_current haplo_allocator_current
+  #define allocator_alloc haplo_allocator_alloc
+  #define allocator_free haplo_allocator_free
+#endif // HAPLO_NO_PREFIX
+
+//
+// Types
+//
+
+// An allocator is a vtable with an opaque context. Every allocation
+// of the library goes through the allocator bound to the calling
+// thread, see haplo_allocator_bind.
+typedef struct {
+  // Returns a block of at least size bytes aligned to alignment, or
+  // NULL on failure
+  void *(*alloc)(void *ctx, size_t size, size_t alignment);
+  // Releases a block returned by alloc, size is the size that was
+  // requested
+  void (*free)(void *ctx, void *ptr, size_t size);
+  void *ctx;
+  // Maximum number of bytes in use at the same time, 0 means no
+  // limit. Must be set before the first allocation.
+  size_t quota;
+  // Number of bytes in use, tracked only if quota is not 0
+  size_t used;
+  // Set when an allocation failed or exceeded the quota
+  bool exhausted;
+} HaploAllocator;
+
+// Allocator based on malloc and free, without a quota
+extern HaploAllocator haplo_default_allocator;
+
+//
+// Functions
+//
+
+// Binds allocator to the calling thread and returns the previously
+// bound one. A NULL allocator selects haplo_default_allocator.
+HaploAllocator *haplo_allocator_bind(HaploAllocator *allocator);
+// Returns the allocator bound to the calling thread
+HaploAllocator *haplo_allocator_current(void);
+// Allocates from allocator directly, respecting its quota. Blocks
+// must be released with haplo_allocator_free with the same size.
+void *haplo_allocator_alloc(HaploAllocator *allocator, size_t size,
+                            size_t alignment);
+void haplo_allocator_free(HaploAllocator *allocator, void *ptr, size_t size);
+
+// Allocate from the allocator bound to the calling thread. The
+// returned memory remembers its allocator, so it can be released
+// with haplo_free even if another allocator is bound. They return
+// NULL if the allocation failed or exceeded the quota.
+void *haplo_alloc(size_t size);
+void *haplo_calloc(size_t count, size_t size);
+// Resizes memory returned by haplo_alloc, keeping its allocator
+void *haplo_realloc(void *ptr, size_t size);
+void haplo_free(void *ptr);
+char *haplo_strdup(const char *str);
+// Copies len bytes of str into a new NUL terminated string
+char *haplo_strndup(const char *str, size_t len);
+
+#endif // HAPLO_ALLOC_H
@@ -0,0 +1,198 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "arith.h"
+#include "bigint.h"
+#include "errors.h"
+#include "utils.h"
+
+#include <limits.h>
+
+#define HAPLO_ARITH_ERROR(err)         \
+  (HaploValue) {                       \
+    .type = HAPLO_VAL_ERROR,           \
+    .value.error = (err),              \
+  }
+
+// The operand types that have a kernel, any other type is OTHER
+typedef enum {
+  HAPLO_ARITH_KIND_OTHER = 0,
+  HAPLO_ARITH_KIND_INT,
+  HAPLO_ARITH_KIND_FLOAT,
+  HAPLO_ARITH_KIND_BIG,
+  _HAPLO_ARITH_KIND_MAX,
+} HaploArithKind;
+
+static const unsigned char haplo_arith_kind[_HAPLO_VAL_MAX] = {
+  [HAPLO_VAL_INTEGER] = HAPLO_ARITH_KIND_INT,
+  [HAPLO_VAL_FLOAT] = HAPLO_ARITH_KIND_FLOAT,
+  [HAPLO_VAL_BIGINT] = HAPLO_ARITH_KIND_BIG,
+};
+
+typedef HaploValue (*HaploArithKernel)(HaploValue a, HaploValue b);
+
+// Division by zero and LONG_MIN / -1 go to the bigint division, which
+// reports the first and promotes the second
+static inline bool haplo_arith_div_overflow(long a, long b, long *result)
+{
+  if (b == 0 || (a == LONG_MIN && b == -1)) return true;
+  *result = a / b;
+  return false;
+}
+
+static inline double haplo_arith_to_double(HaploValue value)
+{
+  if (LIKELY(value.type == HAPLO_VAL_FLOAT)) return value.value.floating_point;
+  if (value.type == HAPLO_VAL_INTEGER) return (double) value.value.integer;
+  return haplo_bigint_to_double(value.value.bigint);
+}
+
+//
+// Kernels
+//
+// Each operation has a kernel for two INTEGER values, one for a FLOAT
+// and a number, and one for a BIGINT and an integer
+//
+
+#define HAPLO_ARITH_NUM_KERNELS(name, symbol, op, overflow, bigint_fn)  \
+  static HaploValue haplo_arith_##name##_int(HaploValue a, HaploValue b) \
+  {                                                                     \
+    long result;                                                        \
+    if (UNLIKELY(overflow(a.value.integer, b.value.integer, &result)))  \
+      return bigint_fn(a, b);                                           \
+    return (HaploValue) {                                               \
+      .type = HAPLO_VAL_INTEGER,                                        \
+      .value.integer = result,                                          \
+    };                                                                  \
+  }                                                                     \
+  static HaploValue haplo_arith_##name##_float(HaploValue a, HaploValue b) \
+  {                                                                     \
+    return (HaploValue) {                                               \
+      .type = HAPLO_VAL_FLOAT,                                          \
+      .value.floating_point = haplo_arith_to_double(a) op haplo_arith_to_double(b), \
+    };                                                                  \
+  }                                                                     \
+  static HaploValue haplo_arith_##name##_big(HaploValue a, HaploValue b) \
+  {                                                                     \
+    return bigint_fn(a, b);                                             \
+  }
+
+#define HAPLO_ARITH_CMP_KERNELS(name, symbol, op)                       \
+  static HaploValue haplo_arith_##name##_int(HaploValue a, HaploValue b) \
+  {                                                                     \
+    return (HaploValue) {                                               \
+      .type = HAPLO_VAL_BOOL,                                           \
+      .value.boolean = a.value.integer op b.value.integer,              \
+    };                                                                  \
+  }                                                                     \
+  static HaploValue haplo_arith_##name##_float(HaploValue a, HaploValue b) \
+  {                                                                     \
+    return (HaploValue) {                                               \
+      .type = HAPLO_VAL_BOOL,                                           \
+      .value.boolean = haplo_arith_to_double(a) op haplo_arith_to_double(b), \
+    };                                                                  \
+  }                                                                     \
+  static HaploValue haplo_arith_##name##_big(HaploValue a, HaploValue b) \
+  {                                                                     \
+    return (HaploValue) {                                               \
+      .type = HAPLO_VAL_BOOL,                                           \
+      .value.boolean = haplo_bigint_compare(a, b) op 0,                 \
+    };                                                                  \
+  }
+
+HAPLO_ARITH_NUM_OPS(HAPLO_ARITH_NUM_KERNELS)
+HAPLO_ARITH_CMP_OPS(HAPLO_ARITH_CMP_KERNELS)
+
+// The kernels of each operation, indexed by the kinds of the left and
+// the right operand. Missing kernels mean that an operand is not a
+// number.
+#define HAPLO_ARITH_ROW(name, ...)                                      \
+  [HAPLO_ARITH_##name] = {                                              \
+    [HAPLO_ARITH_KIND_INT] = {                                          \
+      [HAPLO_ARITH_KIND_INT] = haplo_arith_##name##_int,                \
+      [HAPLO_ARITH_KIND_FLOAT] = haplo_arith_##name##_float,            \
+      [HAPLO_ARITH_KIND_BIG] = haplo_arith_##name##_big,                \
+    },                                                                  \
+    [HAPLO_ARITH_KIND_FLOAT] = {                                        \
+      [HAPLO_ARITH_KIND_INT] = haplo_arith_##name##_float,              \
+      [HAPLO_ARITH_KIND_FLOAT] = haplo_arith_##name##_float,            \
+      [HAPLO_ARITH_KIND_BIG] = haplo_arith_##name##_float,              \
+    },                                                                  \
+    [HAPLO_ARITH_KIND_BIG] = {                                          \
+      [HAPLO_ARITH_KIND_INT] = haplo_arith_##name##_big,                \
+      [HAPLO_ARITH_KIND_FLOAT] = haplo_arith_##name##_float,            \
+      [HAPLO_ARITH_KIND_BIG] = haplo_arith_##name##_big,                \
+    },                                                                  \
+  },
+
+static const HaploArithKernel
+haplo_arith_table[_HAPLO_ARITH_MAX][_HAPLO_ARITH_KIND_MAX][_HAPLO_ARITH_KIND_MAX] = {
+  HAPLO_ARITH_OPS(HAPLO_ARITH_ROW)
+};
+
+HaploValue haplo_arith_apply(HaploArithOp op, HaploValue a, HaploValue b)
+{
+  HaploArithKernel kernel =
+    haplo_arith_table[op][haplo_arith_kind[a.type]][haplo_arith_kind[b.type]];
+  if (LIKELY(kernel != NULL)) return kernel(a, b);
+
+  if (a.type == HAPLO_VAL_ERROR) return a;
+  if (b.type == HAPLO_VAL_ERROR) return b;
+  return HAPLO_ARITH_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+}
+
+HaploValue haplo_arith_fold(HaploArithOp op, const HaploValue *args, int count)
+{
+  if (op >= HAPLO_ARITH_GT)
+  {
+    if (count < 2)
+      return HAPLO_ARITH_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+    HaploValue result = {0};
+    for (int i = 1; i < count; ++i)
+    {
+      result = haplo_arith_apply(op, args[i - 1], args[i]);
+      if (result.type != HAPLO_VAL_BOOL || !result.value.boolean) break;
+    }
+    return result;
+  }
+
+  if (count < 1)
+    return HAPLO_ARITH_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+  if (count == 1)
+  {
+    HaploValue identity = {
+      .type = HAPLO_VAL_INTEGER,
+      .value.integer = (op == HAPLO_ARITH_MUL || op == HAPLO_ARITH_DIV) ? 1 : 0,
+    };
+    return haplo_arith_apply(op, identity, args[0]);
+  }
+
+  // Only the intermediate bigints need to be freed, the other values
+  // don't own memory
+  HaploValue result = haplo_arith_apply(op, args[0], args[1]);
+  for (int i = 2; i < count && result.type != HAPLO_VAL_ERROR; ++i)
+  {
+    HaploValue next = haplo_arith_apply(op, result, args[i]);
+    if (result.type == HAPLO_VAL_BIGINT) haplo_value_free(result);
+    result = next;
+  }
+  return result;
+}
+
+const char *haplo_arith_op_string(HaploArithOp op)
+{
+  switch(op)
+  {
+#define HAPLO_ARITH_CASE(name, symbol, ...)     \
+  case HAPLO_ARITH_##name:                      \
+    return symbol;
+  HAPLO_ARITH_OPS(HAPLO_ARITH_CASE)
+#undef HAPLO_ARITH_CASE
+  default:
+    break;
+  }
+  return "HAPLO_ARITH_UNKNOWN_OP";
+}
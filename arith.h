@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#ifndef HAPLO_ARITH_H
+#define HAPLO_ARITH_H
+
+#include "value.h"
+
+//
+// Macros
+//
+
+#ifdef HAPLO_NO_PREFIX
+  #define ArithOp HaploArithOp
+  #define arith_apply haplo_arith_apply
+  #define arith_fold haplo_arith_fold
+  #define arith_op_string haplo_arith_op_string
+#endif // HAPLO_NO_PREFIX
+
+// The operations that produce a number:
+//   X(NAME, SYMBOL, C OPERATOR, OVERFLOW CHECK, BIGINT FUNCTION)
+// The overflow check stores the result of two longs and evaluates to
+// true if it does not fit, then the bigint function is used instead
+#define HAPLO_ARITH_NUM_OPS(X)                                          \
+  X(ADD, "+", +, HAPLO_ADD_OVERFLOW, haplo_bigint_add)                  \
+  X(SUB, "-", -, HAPLO_SUB_OVERFLOW, haplo_bigint_sub)                  \
+  X(MUL, "*", *, HAPLO_MUL_OVERFLOW, haplo_bigint_mul)                  \
+  X(DIV, "/", /, haplo_arith_div_overflow, haplo_bigint_div)
+
+// The operations that produce a bool:
+//   X(NAME, SYMBOL, C OPERATOR)
+#define HAPLO_ARITH_CMP_OPS(X)                  \
+  X(GT, ">", >)                                 \
+  X(LT, "<", <)                                 \
+  X(EQ, "=", ==)                                \
+  X(GE, ">=", >=)                               \
+  X(LE, "<=", <=)
+
+#define HAPLO_ARITH_OPS(X)                      \
+  HAPLO_ARITH_NUM_OPS(X)                        \
+  HAPLO_ARITH_CMP_OPS(X)
+
+//
+// Types
+//
+
+typedef enum {
+#define HAPLO_ARITH_ENUM(name, ...) HAPLO_ARITH_##name,
+  HAPLO_ARITH_OPS(HAPLO_ARITH_ENUM)
+#undef HAPLO_ARITH_ENUM
+  _HAPLO_ARITH_MAX,
+} HaploArithOp;
+
+//
+// Functions
+//
+
+// Applies op to two INTEGER, BIGINT or FLOAT values. An INTEGER or
+// a BIGINT mixed with a FLOAT is promoted to a FLOAT. Returns the
+// first of a and b that is an error, or a new value.
+HaploValue haplo_arith_apply(HaploArithOp op, HaploValue a, HaploValue b);
+// Folds op over the count values of args, from left to right:
+//   (- a b c) is (a - b) - c
+//   (< a b c) is (a < b) and (b < c)
+// A single value is taken as the right operand of the identity of
+// op, so (- a) is 0 - a. Comparisons need two values. args are not
+// freed, the result is always a new value.
+HaploValue haplo_arith_fold(HaploArithOp op, const HaploValue *args, int count);
+const char *haplo_arith_op_string(HaploArithOp op);
+
+#endif // HAPLO_ARITH_H
@@ -0,0 +1,1078 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "array.h"
+#include "errors.h"
+#include "utils.h"
+#include "alloc.h"
+#include "cpu.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+// The kernels come in three flavours: plain C, SSE2 and AVX2. SSE2 is
+// always there on x86_64, AVX2 is used if the cpu supports it. The
+// SIMD kernels process whole blocks of elements and return how many
+// they did, the scalar kernels finish the rest.
+#if !defined(HAPLO_ARRAY_NO_SIMD) && defined(__GNUC__) && defined(__x86_64__)
+  #define HAPLO_ARRAY_X86
+  #include <immintrin.h>
+  #define HAPLO_ARRAY_AVX2 __attribute__((target("avx2")))
+#endif
+
+typedef enum {
+  HAPLO_ARRAY_ISA_SCALAR = 0,
+  HAPLO_ARRAY_ISA_SSE2,
+  HAPLO_ARRAY_ISA_AVX2,
+} HaploArrayIsa;
+
+typedef enum {
+  HAPLO_ARRAY_REDUCE_SUM = 0,
+  HAPLO_ARRAY_REDUCE_MIN,
+  HAPLO_ARRAY_REDUCE_MAX,
+  HAPLO_ARRAY_REDUCE_DOT,
+} HaploArrayReduce;
+
+// Returns the best instruction set supported by the cpu
+static HaploArrayIsa haplo_array_isa(void)
+{
+#ifdef HAPLO_ARRAY_X86
+  return haplo_cpu_has_avx2() ? HAPLO_ARRAY_ISA_AVX2 : HAPLO_ARRAY_ISA_SSE2;
+#else
+  return HAPLO_ARRAY_ISA_SCALAR;
+#endif
+}
+
+//
+// Scalar kernels
+//
+
+// The sums and differences wrap around, the sign bit of these is set
+// if the wrapped result differs from the real one
+static inline int64_t haplo_array_add_overflow(int64_t a, int64_t b, int64_t r)
+{
+  return (a ^ r) & (b ^ r);
+}
+
+static inline int64_t haplo_array_sub_overflow(int64_t a, int64_t b, int64_t r)
+{
+  return (a ^ b) & (a ^ r);
+}
+
+// b has len elements, or one if broadcast, divisors must not be 0.
+// Returns true if the result of an integer operation did not fit in
+// 64 bits, the element is then left wrapped around.
+static bool haplo_array_i64_op_scalar(HaploArrayOp op, int64_t *out,
+                                      const int64_t *a, const int64_t *b,
+                                      bool broadcast, int len)
+{
+  int step = broadcast ? 0 : 1;
+  int64_t overflow = 0;
+  switch(op)
+  {
+  case HAPLO_ARRAY_OP_ADD:
+    for (int i = 0; i < len; ++i)
+    {
+      out[i] = (int64_t) ((uint64_t) a[i] + (uint64_t) b[i * step]);
+      overflow |= haplo_array_add_overflow(a[i], b[i * step], out[i]);
+    }
+    break;
+  case HAPLO_ARRAY_OP_SUB:
+    for (int i = 0; i < len; ++i)
+    {
+      out[i] = (int64_t) ((uint64_t) a[i] - (uint64_t) b[i * step]);
+      overflow |= haplo_array_sub_overflow(a[i], b[i * step], out[i]);
+    }
+    break;
+  case HAPLO_ARRAY_OP_MUL:
+    for (int i = 0; i < len; ++i)
+    {
+      long product = 0;
+      if (HAPLO_MUL_OVERFLOW((long) a[i], (long) b[i * step], &product))
+        overflow = -1;
+      out[i] = product;
+    }
+    break;
+  case HAPLO_ARRAY_OP_DIV:
+    // INT64_MIN / -1 is the only quotient that does not fit
+    for (int i = 0; i < len; ++i)
+    {
+      if (b[i * step] == -1)
+      {
+        out[i] = (int64_t) (0 - (uint64_t) a[i]);
+        if (a[i] == INT64_MIN) overflow = -1;
+      } else {
+        out[i] = a[i] / b[i * step];
+      }
+    }
+    break;
+  case HAPLO_ARRAY_OP_LT:
+    for (int i = 0; i < len; ++i) out[i] = a[i] < b[i * step];
+    break;
+  case HAPLO_ARRAY_OP_LE:
+    for (int i = 0; i < len; ++i) out[i] = a[i] <= b[i * step];
+    break;
+  case HAPLO_ARRAY_OP_GT:
+    for (int i = 0; i < len; ++i) out[i] = a[i] > b[i * step];
+    break;
+  case HAPLO_ARRAY_OP_GE:
+    for (int i = 0; i < len; ++i) out[i] = a[i] >= b[i * step];
+    break;
+  case HAPLO_ARRAY_OP_EQ:
+    for (int i = 0; i < len; ++i) out[i] = a[i] == b[i * step];
+    break;
+  default:
+    break;
+  }
+  return overflow < 0;
+}
+
+// out is an f64 array, or an i64 mask for comparisons
+static void haplo_array_f64_op_scalar(HaploArrayOp op, void *out,
+                                      const double *a, const double *b,
+                                      bool broadcast, int len)
+{
+  double *res = out;
+  int64_t *mask = out;
+  int step = broadcast ? 0 : 1;
+  switch(op)
+  {
+  case HAPLO_ARRAY_OP_ADD:
+    for (int i = 0; i < len; ++i) res[i] = a[i] + b[i * step];
+    break;
+  case HAPLO_ARRAY_OP_SUB:
+    for (int i = 0; i < len; ++i) res[i] = a[i] - b[i * step];
+    break;
+  case HAPLO_ARRAY_OP_MUL:
+    for (int i = 0; i < len; ++i) res[i] = a[i] * b[i * step];
+    break;
+  case HAPLO_ARRAY_OP_DIV:
+    for (int i = 0; i < len; ++i) res[i] = a[i] / b[i * step];
+    break;
+  case HAPLO_ARRAY_OP_LT:
+    for (int i = 0; i < len; ++i) mask[i] = a[i] < b[i * step];
+    break;
+  case HAPLO_ARRAY_OP_LE:
+    for (int i = 0; i < len; ++i) mask[i] = a[i] <= b[i * step];
+    break;
+  case HAPLO_ARRAY_OP_GT:
+    for (int i = 0; i < len; ++i) mask[i] = a[i] > b[i * step];
+    break;
+  case HAPLO_ARRAY_OP_GE:
+    for (int i = 0; i < len; ++i) mask[i] = a[i] >= b[i * step];
+    break;
+  case HAPLO_ARRAY_OP_EQ:
+    for (int i = 0; i < len; ++i) mask[i] = a[i] == b[i * step];
+    break;
+  default:
+    break;
+  }
+  return;
+}
+
+static inline int64_t haplo_array_i64_fold(HaploArrayReduce reduce,
+                                           int64_t acc, int64_t x)
+{
+  switch(reduce)
+  {
+  case HAPLO_ARRAY_REDUCE_MIN:
+    return (x < acc) ? x : acc;
+  case HAPLO_ARRAY_REDUCE_MAX:
+    return (x > acc) ? x : acc;
+  default:
+    return (int64_t) ((uint64_t) acc + (uint64_t) x);
+  }
+}
+
+static inline double haplo_array_f64_fold(HaploArrayReduce reduce,
+                                          double acc, double x)
+{
+  switch(reduce)
+  {
+  case HAPLO_ARRAY_REDUCE_MIN:
+    return (x < acc) ? x : acc;
+  case HAPLO_ARRAY_REDUCE_MAX:
+    return (x > acc) ? x : acc;
+  default:
+    return acc + x;
+  }
+}
+
+// Folds the elements of a from start into acc. Sets overflow if a
+// sum, or a product of the dot product, wrapped around.
+static int64_t haplo_array_i64_reduce_scalar(HaploArrayReduce reduce,
+                                             int64_t acc, const int64_t *a,
+                                             const int64_t *b, int start,
+                                             int len, bool *overflow)
+{
+  if (reduce == HAPLO_ARRAY_REDUCE_MIN || reduce == HAPLO_ARRAY_REDUCE_MAX)
+  {
+    for (int i = start; i < len; ++i)
+      acc = haplo_array_i64_fold(reduce, acc, a[i]);
+    return acc;
+  }
+
+  int64_t wrapped = 0;
+  for (int i = start; i < len; ++i)
+  {
+    int64_t x = a[i];
+    if (reduce == HAPLO_ARRAY_REDUCE_DOT)
+    {
+      long product = 0;
+      if (HAPLO_MUL_OVERFLOW((long) a[i], (long) b[i], &product))
+        wrapped = -1;
+      x = product;
+    }
+    int64_t sum = haplo_array_i64_fold(reduce, acc, x);
+    wrapped |= haplo_array_add_overflow(acc, x, sum);
+    acc = sum;
+  }
+  if (wrapped < 0) *overflow = true;
+  return acc;
+}
+
+// Returns true and stores in *result the exact sum of the elements of
+// a, or of the products of a and b for the dot product, if it fits in
+// 64 bits. The sum is kept in two words, so the order of the elements
+// does not matter, but the products must fit.
+static bool haplo_array_i64_sum_exact(HaploArrayReduce reduce, const int64_t *a,
+                                      const int64_t *b, int len, int64_t *result)
+{
+  int64_t high = 0;
+  uint64_t low = 0;
+  for (int i = 0; i < len; ++i)
+  {
+    long x = a[i];
+    if (reduce == HAPLO_ARRAY_REDUCE_DOT && HAPLO_MUL_OVERFLOW((long) a[i], (long) b[i], &x))
+      return false;
+    uint64_t sum = low + (uint64_t) x;
+    high += (x < 0 ? -1 : 0) + (sum < low ? 1 : 0);
+    low = sum;
+  }
+  if (high != (((int64_t) low < 0) ? -1 : 0))
+    return false;
+  *result = (int64_t) low;
+  return true;
+}
+
+static double haplo_array_f64_reduce_scalar(HaploArrayReduce reduce,
+                                            double acc, const double *a,
+                                            const double *b, int start,
+                                            int len)
+{
+  for (int i = start; i < len; ++i)
+    acc = haplo_array_f64_fold(reduce, acc,
+                               (reduce == HAPLO_ARRAY_REDUCE_DOT) ? a[i] * b[i] : a[i]);
+  return acc;
+}
+
+#ifdef HAPLO_ARRAY_X86
+
+//
+// SIMD kernels
+//
+
+// Stores vexpr for each block of width elements of a and b, vexpr
+// sees the blocks as va and vb
+#define HAPLO_ARRAY_SIMD_LOOP(width, vtype, load, set1, store, vexpr)  \
+  do {                                                                 \
+    if (broadcast)                                                     \
+    {                                                                  \
+      vtype vb = set1(b[0]);                                           \
+      for (; i + (width) <= len; i += (width))                         \
+      {                                                                \
+        vtype va = load(a + i);                                        \
+        store(out + i, (vexpr));                                       \
+      }                                                                \
+    } else {                                                           \
+      for (; i + (width) <= len; i += (width))                         \
+      {                                                                \
+        vtype va = load(a + i);                                        \
+        vtype vb = load(b + i);                                        \
+        store(out + i, (vexpr));                                       \
+      }                                                                \
+    }                                                                  \
+  } while(0)
+
+static inline __m128i haplo_array_load_epi64(const int64_t *p)
+{
+  return _mm_load_si128((const __m128i*) p);
+}
+
+static inline void haplo_array_store_epi64(int64_t *p, __m128i v)
+{
+  _mm_store_si128((__m128i*) p, v);
+}
+
+HAPLO_ARRAY_AVX2
+static inline __m256i haplo_array_load256_epi64(const int64_t *p)
+{
+  return _mm256_load_si256((const __m256i*) p);
+}
+
+HAPLO_ARRAY_AVX2
+static inline void haplo_array_store256_epi64(int64_t *p, __m256i v)
+{
+  _mm256_store_si256((__m256i*) p, v);
+}
+
+// Like haplo_array_add_overflow and haplo_array_sub_overflow, the sign
+// bits of the lanes that overflowed are or'ed into *overflow
+static inline __m128i haplo_array_add_epi64(__m128i a, __m128i b, __m128i *overflow)
+{
+  __m128i r = _mm_add_epi64(a, b);
+  *overflow = _mm_or_si128(*overflow, _mm_and_si128(_mm_xor_si128(a, r),
+                                                    _mm_xor_si128(b, r)));
+  return r;
+}
+
+static inline __m128i haplo_array_sub_epi64(__m128i a, __m128i b, __m128i *overflow)
+{
+  __m128i r = _mm_sub_epi64(a, b);
+  *overflow = _mm_or_si128(*overflow, _mm_and_si128(_mm_xor_si128(a, b),
+                                                    _mm_xor_si128(a, r)));
+  return r;
+}
+
+HAPLO_ARRAY_AVX2
+static inline __m256i haplo_array_add256_epi64(__m256i a, __m256i b, __m256i *overflow)
+{
+  __m256i r = _mm256_add_epi64(a, b);
+  *overflow = _mm256_or_si256(*overflow, _mm256_and_si256(_mm256_xor_si256(a, r),
+                                                          _mm256_xor_si256(b, r)));
+  return r;
+}
+
+HAPLO_ARRAY_AVX2
+static inline __m256i haplo_array_sub256_epi64(__m256i a, __m256i b, __m256i *overflow)
+{
+  __m256i r = _mm256_sub_epi64(a, b);
+  *overflow = _mm256_or_si256(*overflow, _mm256_and_si256(_mm256_xor_si256(a, b),
+                                                          _mm256_xor_si256(a, r)));
+  return r;
+}
+
+// SSE2 has no 64 bit multiply and compare, those are left to the
+// scalar kernel. Sets overflow if a sum or difference wrapped around.
+static int haplo_array_i64_op_sse2(HaploArrayOp op, int64_t *out,
+                                   const int64_t *a, const int64_t *b,
+                                   bool broadcast, int len, bool *overflow)
+{
+  int i = 0;
+  __m128i wrapped = _mm_setzero_si128();
+  switch(op)
+  {
+  case HAPLO_ARRAY_OP_ADD:
+    HAPLO_ARRAY_SIMD_LOOP(2, __m128i, haplo_array_load_epi64, _mm_set1_epi64x,
+                          haplo_array_store_epi64,
+                          haplo_array_add_epi64(va, vb, &wrapped));
+    break;
+  case HAPLO_ARRAY_OP_SUB:
+    HAPLO_ARRAY_SIMD_LOOP(2, __m128i, haplo_array_load_epi64, _mm_set1_epi64x,
+                          haplo_array_store_epi64,
+                          haplo_array_sub_epi64(va, vb, &wrapped));
+    break;
+  default:
+    break;
+  }
+  if (_mm_movemask_pd(_mm_castsi128_pd(wrapped)) != 0) *overflow = true;
+  return i;
+}
+
+// Compares produce all ones or all zeros in each lane, masks keep
+// only the lowest bit
+HAPLO_ARRAY_AVX2
+static int haplo_array_i64_op_avx2(HaploArrayOp op, int64_t *out,
+                                   const int64_t *a, const int64_t *b,
+                                   bool broadcast, int len, bool *overflow)
+{
+  int i = 0;
+  const __m256i one = _mm256_set1_epi64x(1);
+  __m256i wrapped = _mm256_setzero_si256();
+  switch(op)
+  {
+  case HAPLO_ARRAY_OP_ADD:
+    HAPLO_ARRAY_SIMD_LOOP(4, __m256i, haplo_array_load256_epi64, _mm256_set1_epi64x,
+                          haplo_array_store256_epi64,
+                          haplo_array_add256_epi64(va, vb, &wrapped));
+    break;
+  case HAPLO_ARRAY_OP_SUB:
+    HAPLO_ARRAY_SIMD_LOOP(4, __m256i, haplo_array_load256_epi64, _mm256_set1_epi64x,
+                          haplo_array_store256_epi64,
+                          haplo_array_sub256_epi64(va, vb, &wrapped));
+    break;
+  case HAPLO_ARRAY_OP_LT:
+    HAPLO_ARRAY_SIMD_LOOP(4, __m256i, haplo_array_load256_epi64, _mm256_set1_epi64x,
+                          haplo_array_store256_epi64,
+                          _mm256_and_si256(_mm256_cmpgt_epi64(vb, va), one));
+    break;
+  case HAPLO_ARRAY_OP_LE:
+    HAPLO_ARRAY_SIMD_LOOP(4, __m256i, haplo_array_load256_epi64, _mm256_set1_epi64x,
+                          haplo_array_store256_epi64,
+                          _mm256_andnot_si256(_mm256_cmpgt_epi64(va, vb), one));
+    break;
+  case HAPLO_ARRAY_OP_GT:
+    HAPLO_ARRAY_SIMD_LOOP(4, __m256i, haplo_array_load256_epi64, _mm256_set1_epi64x,
+                          haplo_array_store256_epi64,
+                          _mm256_and_si256(_mm256_cmpgt_epi64(va, vb), one));
+    break;
+  case HAPLO_ARRAY_OP_GE:
+    HAPLO_ARRAY_SIMD_LOOP(4, __m256i, haplo_array_load256_epi64, _mm256_set1_epi64x,
+                          haplo_array_store256_epi64,
+                          _mm256_andnot_si256(_mm256_cmpgt_epi64(vb, va), one));
+    break;
+  case HAPLO_ARRAY_OP_EQ:
+    HAPLO_ARRAY_SIMD_LOOP(4, __m256i, haplo_array_load256_epi64, _mm256_set1_epi64x,
+                          haplo_array_store256_epi64,
+                          _mm256_and_si256(_mm256_cmpeq_epi64(va, vb), one));
+    break;
+  default:
+    break;
+  }
+  if (_mm256_movemask_pd(_mm256_castsi256_pd(wrapped)) != 0) *overflow = true;
+  return i;
+}
+
+// The masks of f64 comparisons are stored through double pointers,
+// with the bits of the integer 1
+static int haplo_array_f64_op_sse2(HaploArrayOp op, void *res,
+                                   const double *a, const double *b,
+                                   bool broadcast, int len)
+{
+  int i = 0;
+  double *out = res;
+  const __m128d one = _mm_castsi128_pd(_mm_set1_epi64x(1));
+  switch(op)
+  {
+  case HAPLO_ARRAY_OP_ADD:
+    HAPLO_ARRAY_SIMD_LOOP(2, __m128d, _mm_load_pd, _mm_set1_pd, _mm_store_pd,
+                          _mm_add_pd(va, vb));
+    break;
+  case HAPLO_ARRAY_OP_SUB:
+    HAPLO_ARRAY_SIMD_LOOP(2, __m128d, _mm_load_pd, _mm_set1_pd, _mm_store_pd,
+                          _mm_sub_pd(va, vb));
+    break;
+  case HAPLO_ARRAY_OP_MUL:
+    HAPLO_ARRAY_SIMD_LOOP(2, __m128d, _mm_load_pd, _mm_set1_pd, _mm_store_pd,
+                          _mm_mul_pd(va, vb));
+    break;
+  case HAPLO_ARRAY_OP_DIV:
+    HAPLO_ARRAY_SIMD_LOOP(2, __m128d, _mm_load_pd, _mm_set1_pd, _mm_store_pd,
+                          _mm_div_pd(va, vb));
+    break;
+  case HAPLO_ARRAY_OP_LT:
+    HAPLO_ARRAY_SIMD_LOOP(2, __m128d, _mm_load_pd, _mm_set1_pd, _mm_store_pd,
+                          _mm_and_pd(_mm_cmplt_pd(va, vb), one));
+    break;
+  case HAPLO_ARRAY_OP_LE:
+    HAPLO_ARRAY_SIMD_LOOP(2, __m128d, _mm_load_pd, _mm_set1_pd, _mm_store_pd,
+                          _mm_and_pd(_mm_cmple_pd(va, vb), one));
+    break;
+  case HAPLO_ARRAY_OP_GT:
+    HAPLO_ARRAY_SIMD_LOOP(2, __m128d, _mm_load_pd, _mm_set1_pd, _mm_store_pd,
+                          _mm_and_pd(_mm_cmpgt_pd(va, vb), one));
+    break;
+  case HAPLO_ARRAY_OP_GE:
+    HAPLO_ARRAY_SIMD_LOOP(2, __m128d, _mm_load_pd, _mm_set1_pd, _mm_store_pd,
+                          _mm_and_pd(_mm_cmpge_pd(va, vb), one));
+    break;
+  case HAPLO_ARRAY_OP_EQ:
+    HAPLO_ARRAY_SIMD_LOOP(2, __m128d, _mm_load_pd, _mm_set1_pd, _mm_store_pd,
+                          _mm_and_pd(_mm_cmpeq_pd(va, vb), one));
+    break;
+  default:
+    break;
+  }
+  return i;
+}
+
+HAPLO_ARRAY_AVX2
+static int haplo_array_f64_op_avx2(HaploArrayOp op, void *res,
+                                   const double *a, const double *b,
+                                   bool broadcast, int len)
+{
+  int i = 0;
+  double *out = res;
+  const __m256d one = _mm256_castsi256_pd(_mm256_set1_epi64x(1));
+  switch(op)
+  {
+  case HAPLO_ARRAY_OP_ADD:
+    HAPLO_ARRAY_SIMD_LOOP(4, __m256d, _mm256_load_pd, _mm256_set1_pd, _mm256_store_pd,
+                          _mm256_add_pd(va, vb));
+    break;
+  case HAPLO_ARRAY_OP_SUB:
+    HAPLO_ARRAY_SIMD_LOOP(4, __m256d, _mm256_load_pd, _mm256_set1_pd, _mm256_store_pd,
+                          _mm256_sub_pd(va, vb));
+    break;
+  case HAPLO_ARRAY_OP_MUL:
+    HAPLO_ARRAY_SIMD_LOOP(4, __m256d, _mm256_load_pd, _mm256_set1_pd, _mm256_store_pd,
+                          _mm256_mul_pd(va, vb));
+    break;
+  case HAPLO_ARRAY_OP_DIV:
+    HAPLO_ARRAY_SIMD_LOOP(4, __m256d, _mm256_load_pd, _mm256_set1_pd, _mm256_store_pd,
+                          _mm256_div_pd(va, vb));
+    break;
+  case HAPLO_ARRAY_OP_LT:
+    HAPLO_ARRAY_SIMD_LOOP(4, __m256d, _mm256_load_pd, _mm256_set1_pd, _mm256_store_pd,
+                          _mm256_and_pd(_mm256_cmp_pd(va, vb, _CMP_LT_OQ), one));
+    break;
+  case HAPLO_ARRAY_OP_LE:
+    HAPLO_ARRAY_SIMD_LOOP(4, __m256d, _mm256_load_pd, _mm256_set1_pd, _mm256_store_pd,
+                          _mm256_and_pd(_mm256_cmp_pd(va, vb, _CMP_LE_OQ), one));
+    break;
+  case HAPLO_ARRAY_OP_GT:
+    HAPLO_ARRAY_SIMD_LOOP(4, __m256d, _mm256_load_pd, _mm256_set1_pd, _mm256_store_pd,
+                          _mm256_and_pd(_mm256_cmp_pd(va, vb, _CMP_GT_OQ), one));
+    break;
+  case HAPLO_ARRAY_OP_GE:
+    HAPLO_ARRAY_SIMD_LOOP(4, __m256d, _mm256_load_pd, _mm256_set1_pd, _mm256_store_pd,
+                          _mm256_and_pd(_mm256_cmp_pd(va, vb, _CMP_GE_OQ), one));
+    break;
+  case HAPLO_ARRAY_OP_EQ:
+    HAPLO_ARRAY_SIMD_LOOP(4, __m256d, _mm256_load_pd, _mm256_set1_pd, _mm256_store_pd,
+                          _mm256_and_pd(_mm256_cmp_pd(va, vb, _CMP_EQ_OQ), one));
+    break;
+  default:
+    break;
+  }
+  return i;
+}
+
+// The reductions keep one accumulator per lane, the lanes are folded
+// together with the elements left at the end. The integer dot product
+// has no SIMD multiply, it stays scalar. The f64 reductions also run
+// on the rows of matrices, so they do not expect aligned buffers.
+static int64_t haplo_array_i64_reduce_sse2(HaploArrayReduce reduce,
+                                           int64_t acc, const int64_t *a,
+                                           const int64_t *b, int len,
+                                           bool *overflow)
+{
+  if (reduce != HAPLO_ARRAY_REDUCE_SUM)
+    return haplo_array_i64_reduce_scalar(reduce, acc, a, b, 0, len, overflow);
+
+  int i = 0;
+  int64_t lanes[2];
+  __m128i vacc = _mm_setzero_si128();
+  __m128i wrapped = _mm_setzero_si128();
+  for (; i + 2 <= len; i += 2)
+    vacc = haplo_array_add_epi64(vacc, haplo_array_load_epi64(a + i), &wrapped);
+  _mm_storeu_si128((__m128i*) lanes, vacc);
+  if (_mm_movemask_pd(_mm_castsi128_pd(wrapped)) != 0) *overflow = true;
+
+  acc = haplo_array_i64_reduce_scalar(reduce, acc, lanes, NULL, 0, 2, overflow);
+  return haplo_array_i64_reduce_scalar(reduce, acc, a, b, i, len, overflow);
+}
+
+HAPLO_ARRAY_AVX2
+static int64_t haplo_array_i64_reduce_avx2(HaploArrayReduce reduce,
+                                           int64_t acc, const int64_t *a,
+                                           const int64_t *b, int len,
+                                           bool *overflow)
+{
+  if (reduce == HAPLO_ARRAY_REDUCE_DOT)
+    return haplo_array_i64_reduce_scalar(reduce, acc, a, b, 0, len, overflow);
+
+  int i = 0;
+  int64_t lanes[4];
+  __m256i vacc = _mm256_set1_epi64x(acc);
+  __m256i wrapped = _mm256_setzero_si256();
+  if (reduce == HAPLO_ARRAY_REDUCE_SUM)
+    vacc = _mm256_setzero_si256();
+
+  for (; i + 4 <= len; i += 4)
+  {
+    __m256i va = haplo_array_load256_epi64(a + i);
+    switch(reduce)
+    {
+    case HAPLO_ARRAY_REDUCE_MIN:
+      vacc = _mm256_blendv_epi8(vacc, va, _mm256_cmpgt_epi64(vacc, va));
+      break;
+    case HAPLO_ARRAY_REDUCE_MAX:
+      vacc = _mm256_blendv_epi8(vacc, va, _mm256_cmpgt_epi64(va, vacc));
+      break;
+    default:
+      vacc = haplo_array_add256_epi64(vacc, va, &wrapped);
+      break;
+    }
+  }
+  _mm256_storeu_si256((__m256i*) lanes, vacc);
+  if (_mm256_movemask_pd(_mm256_castsi256_pd(wrapped)) != 0) *overflow = true;
+
+  acc = haplo_array_i64_reduce_scalar(reduce, acc, lanes, NULL, 0, 4, overflow);
+  return haplo_array_i64_reduce_scalar(reduce, acc, a, b, i, len, overflow);
+}
+
+static double haplo_array_f64_reduce_sse2(HaploArrayReduce reduce,
+                                          double acc, const double *a,
+                                          const double *b, int len)
+{
+  int i = 0;
+  double lanes[2];
+  __m128d vacc = _mm_set1_pd(acc);
+  if (reduce == HAPLO_ARRAY_REDUCE_SUM || reduce == HAPLO_ARRAY_REDUCE_DOT)
+    vacc = _mm_setzero_pd();
+
+  for (; i + 2 <= len; i += 2)
+  {
+    __m128d va = _mm_loadu_pd(a + i);
+    switch(reduce)
+    {
+    case HAPLO_ARRAY_REDUCE_MIN:
+      vacc = _mm_min_pd(vacc, va);
+      break;
+    case HAPLO_ARRAY_REDUCE_MAX:
+      vacc = _mm_max_pd(vacc, va);
+      break;
+    case HAPLO_ARRAY_REDUCE_DOT:
+      vacc = _mm_add_pd(vacc, _mm_mul_pd(va, _mm_loadu_pd(b + i)));
+      break;
+    default:
+      vacc = _mm_add_pd(vacc, va);
+      break;
+    }
+  }
+  _mm_storeu_pd(lanes, vacc);
+
+  for (int l = 0; l < 2; ++l)
+    acc = haplo_array_f64_fold(reduce, acc, lanes[l]);
+  return haplo_array_f64_reduce_scalar(reduce, acc, a, b, i, len);
+}
+
+HAPLO_ARRAY_AVX2
+static double haplo_array_f64_reduce_avx2(HaploArrayReduce reduce,
+                                          double acc, const double *a,
+                                          const double *b, int len)
+{
+  int i = 0;
+  double lanes[4];
+  __m256d vacc = _mm256_set1_pd(acc);
+  if (reduce == HAPLO_ARRAY_REDUCE_SUM || reduce == HAPLO_ARRAY_REDUCE_DOT)
+    vacc = _mm256_setzero_pd();
+
+  for (; i + 4 <= len; i += 4)
+  {
+    __m256d va = _mm256_loadu_pd(a + i);
+    switch(reduce)
+    {
+    case HAPLO_ARRAY_REDUCE_MIN:
+      vacc = _mm256_min_pd(vacc, va);
+      break;
+    case HAPLO_ARRAY_REDUCE_MAX:
+      vacc = _mm256_max_pd(vacc, va);
+      break;
+    case HAPLO_ARRAY_REDUCE_DOT:
+      vacc = _mm256_add_pd(vacc, _mm256_mul_pd(va, _mm256_loadu_pd(b + i)));
+      break;
+    default:
+      vacc = _mm256_add_pd(vacc, va);
+      break;
+    }
+  }
+  _mm256_storeu_pd(lanes, vacc);
+
+  for (int l = 0; l < 4; ++l)
+    acc = haplo_array_f64_fold(reduce, acc, lanes[l]);
+  return haplo_array_f64_reduce_scalar(reduce, acc, a, b, i, len);
+}
+
+static int haplo_array_f64_axpy_sse2(double *y, double a, const double *x, int len)
+{
+  int i = 0;
+  __m128d va = _mm_set1_pd(a);
+  for (; i + 2 <= len; i += 2)
+    _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i),
+                                    _mm_mul_pd(va, _mm_loadu_pd(x + i))));
+  return i;
+}
+
+HAPLO_ARRAY_AVX2
+static int haplo_array_f64_axpy_avx2(double *y, double a, const double *x, int len)
+{
+  int i = 0;
+  __m256d va = _mm256_set1_pd(a);
+  for (; i + 4 <= len; i += 4)
+    _mm256_storeu_pd(y + i, _mm256_add_pd(_mm256_loadu_pd(y + i),
+                                          _mm256_mul_pd(va, _mm256_loadu_pd(x + i))));
+  return i;
+}
+
+#endif // HAPLO_ARRAY_X86
+
+//
+// Arrays
+//
+
+HaploArray *haplo_array_new(HaploArrayType type, int len)
+{
+  if (len < 0 || len > (INT_MAX - HAPLO_ARRAY_ALIGNMENT) / (int) sizeof(int64_t))
+    return NULL;
+
+  HaploArray *array = haplo_alloc(sizeof(HaploArray));
+  if (UNLIKELY(!array)) return NULL;
+
+  // Both element types have 8 bytes
+  array->block = haplo_calloc(1, len * sizeof(int64_t) + HAPLO_ARRAY_ALIGNMENT);
+  if (UNLIKELY(!array->block))
+  {
+    haplo_free(array);
+    return NULL;
+  }
+
+  uintptr_t data = ((uintptr_t) array->block + HAPLO_ARRAY_ALIGNMENT - 1)
+    & ~(uintptr_t) (HAPLO_ARRAY_ALIGNMENT - 1);
+  array->data.i64 = (int64_t*) data;
+  array->type = type;
+  array->len = len;
+  array->refcount = 1;
+  return array;
+}
+
+HaploArray *haplo_array_ref(HaploArray *array)
+{
+  if (array) array->refcount++;
+  return array;
+}
+
+void haplo_array_free(HaploArray *array)
+{
+  if (!array || --array->refcount != 0) return;
+
+  haplo_free(array->block);
+  haplo_free(array);
+  return;
+}
+
+int haplo_array_len(HaploArray *array)
+{
+  return array ? array->len : 0;
+}
+
+// Runs op on a and b, which has a->len elements or one if broadcast
+static HaploArray *haplo_array_run(HaploArrayOp op, HaploArray *a,
+                                   const void *b, bool broadcast, int *error)
+{
+  if (op == HAPLO_ARRAY_OP_DIV && a->type == HAPLO_ARRAY_I64)
+  {
+    const int64_t *divisors = b;
+    for (int i = 0; i < (broadcast ? 1 : a->len); ++i)
+    {
+      if (divisors[i] == 0)
+      {
+        *error = HAPLO_ERROR_DIVISION_BY_ZERO;
+        return NULL;
+      }
+    }
+  }
+
+  HaploArrayType type = (op >= HAPLO_ARRAY_OP_LT) ? HAPLO_ARRAY_I64 : a->type;
+  HaploArray *out = haplo_array_new(type, a->len);
+  if (UNLIKELY(!out))
+  {
+    *error = HAPLO_ERROR_OUT_OF_MEMORY;
+    return NULL;
+  }
+
+  int done = 0;
+  int len = a->len;
+  if (a->type == HAPLO_ARRAY_I64)
+  {
+    const int64_t *ib = b;
+    bool overflow = false;
+    switch(haplo_array_isa())
+    {
+#ifdef HAPLO_ARRAY_X86
+    case HAPLO_ARRAY_ISA_AVX2:
+      done = haplo_array_i64_op_avx2(op, out->data.i64, a->data.i64, ib, broadcast,
+                                     len, &overflow);
+      break;
+    case HAPLO_ARRAY_ISA_SSE2:
+      done = haplo_array_i64_op_sse2(op, out->data.i64, a->data.i64, ib, broadcast,
+                                     len, &overflow);
+      break;
+#endif // HAPLO_ARRAY_X86
+    default:
+      break;
+    }
+    if (haplo_array_i64_op_scalar(op, out->data.i64 + done, a->data.i64 + done,
+                                  broadcast ? ib : ib + done, broadcast, len - done))
+      overflow = true;
+    // Unlike the arithmetic on INTEGERs, arrays are not promoted to
+    // bigints
+    if (overflow)
+    {
+      haplo_array_free(out);
+      *error = HAPLO_ERROR_OUT_OF_RANGE;
+      return NULL;
+    }
+  } else {
+    const double *fb = b;
+    switch(haplo_array_isa())
+    {
+#ifdef HAPLO_ARRAY_X86
+    case HAPLO_ARRAY_ISA_AVX2:
+      done = haplo_array_f64_op_avx2(op, out->data.f64, a->data.f64, fb, broadcast, len);
+      break;
+    case HAPLO_ARRAY_ISA_SSE2:
+      done = haplo_array_f64_op_sse2(op, out->data.f64, a->data.f64, fb, broadcast, len);
+      break;
+#endif // HAPLO_ARRAY_X86
+    default:
+      break;
+    }
+    haplo_array_f64_op_scalar(op, out->data.i64 + done, a->data.f64 + done,
+                              broadcast ? fb : fb + done, broadcast, len - done);
+  }
+  return out;
+}
+
+HaploArray *haplo_array_op(HaploArrayOp op, HaploArray *a, HaploArray *b,
+                           int *error)
+{
+  assert(a && b);
+  if (a->type != b->type)
+  {
+    *error = HAPLO_ERROR_INTERPRETER_INVALID_TYPE;
+    return NULL;
+  }
+  if (a->len != b->len)
+  {
+    *error = HAPLO_ERROR_LENGTH_MISMATCH;
+    return NULL;
+  }
+  return haplo_array_run(op, a, b->data.i64, false, error);
+}
+
+HaploArray *haplo_array_op_scalar(HaploArrayOp op, HaploArray *a,
+                                  HaploValue scalar, int *error)
+{
+  assert(a);
+  if (a->type == HAPLO_ARRAY_I64 && scalar.type == HAPLO_VAL_INTEGER)
+  {
+    int64_t b = scalar.value.integer;
+    return haplo_array_run(op, a, &b, true, error);
+  }
+  if (a->type == HAPLO_ARRAY_F64 && scalar.type == HAPLO_VAL_FLOAT)
+    return haplo_array_run(op, a, &scalar.value.floating_point, true, error);
+
+  *error = HAPLO_ERROR_INTERPRETER_INVALID_TYPE;
+  return NULL;
+}
+
+static double haplo_array_f64_reduce(HaploArrayReduce reduce, double acc,
+                                     const double *a, const double *b, int len)
+{
+  switch(haplo_array_isa())
+  {
+#ifdef HAPLO_ARRAY_X86
+  case HAPLO_ARRAY_ISA_AVX2:
+    return haplo_array_f64_reduce_avx2(reduce, acc, a, b, len);
+  case HAPLO_ARRAY_ISA_SSE2:
+    return haplo_array_f64_reduce_sse2(reduce, acc, a, b, len);
+#endif // HAPLO_ARRAY_X86
+  default:
+    break;
+  }
+  return haplo_array_f64_reduce_scalar(reduce, acc, a, b, 0, len);
+}
+
+// Folds the elements of a, or the products of a and b for the dot
+// product, with the best kernel
+static HaploValue haplo_array_reduce(HaploArrayReduce reduce, HaploArray *a,
+                                     HaploArray *b)
+{
+  bool min_max = reduce == HAPLO_ARRAY_REDUCE_MIN || reduce == HAPLO_ARRAY_REDUCE_MAX;
+  if (min_max && a->len == 0)
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_ERROR,
+      .value.error = HAPLO_ERROR_LIST_EMPTY,
+    };
+  }
+
+  if (a->type == HAPLO_ARRAY_I64)
+  {
+    const int64_t *ib = b ? b->data.i64 : NULL;
+    int64_t acc = min_max ? a->data.i64[0] : 0;
+    bool overflow = false;
+    switch(haplo_array_isa())
+    {
+#ifdef HAPLO_ARRAY_X86
+    case HAPLO_ARRAY_ISA_AVX2:
+      acc = haplo_array_i64_reduce_avx2(reduce, acc, a->data.i64, ib, a->len, &overflow);
+      break;
+    case HAPLO_ARRAY_ISA_SSE2:
+      acc = haplo_array_i64_reduce_sse2(reduce, acc, a->data.i64, ib, a->len, &overflow);
+      break;
+#endif // HAPLO_ARRAY_X86
+    default:
+      acc = haplo_array_i64_reduce_scalar(reduce, acc, a->data.i64, ib, 0, a->len,
+                                          &overflow);
+      break;
+    }
+    // A partial sum that wrapped around does not mean the total does
+    // not fit, it depends on the order the kernel added the elements.
+    // Only then the sum is done again exactly.
+    if (overflow && !haplo_array_i64_sum_exact(reduce, a->data.i64, ib, a->len, &acc))
+    {
+      return (HaploValue) {
+        .type = HAPLO_VAL_ERROR,
+        .value.error = HAPLO_ERROR_OUT_OF_RANGE,
+      };
+    }
+    return (HaploValue) {
+      .type = HAPLO_VAL_INTEGER,
+      .value.integer = acc,
+    };
+  }
+
+  double acc = min_max ? a->data.f64[0] : 0.0;
+  return (HaploValue) {
+    .type = HAPLO_VAL_FLOAT,
+    .value.floating_point = haplo_array_f64_reduce(reduce, acc, a->data.f64,
+                                                   b ? b->data.f64 : NULL, a->len),
+  };
+}
+
+HaploValue haplo_array_sum(HaploArray *array)
+{
+  return haplo_array_reduce(HAPLO_ARRAY_REDUCE_SUM, array, NULL);
+}
+
+HaploValue haplo_array_min(HaploArray *array)
+{
+  return haplo_array_reduce(HAPLO_ARRAY_REDUCE_MIN, array, NULL);
+}
+
+HaploValue haplo_array_max(HaploArray *array)
+{
+  return haplo_array_reduce(HAPLO_ARRAY_REDUCE_MAX, array, NULL);
+}
+
+HaploValue haplo_array_dot(HaploArray *a, HaploArray *b)
+{
+  int error = 0;
+  if (a->type != b->type)
+    error = HAPLO_ERROR_INTERPRETER_INVALID_TYPE;
+  else if (a->len != b->len)
+    error = HAPLO_ERROR_LENGTH_MISMATCH;
+  if (error < 0)
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_ERROR,
+      .value.error = error,
+    };
+  }
+  return haplo_array_reduce(HAPLO_ARRAY_REDUCE_DOT, a, b);
+}
+
+void haplo_array_f64_axpy(double *y, double a, const double *x, int len)
+{
+  int done = 0;
+  switch(haplo_array_isa())
+  {
+#ifdef HAPLO_ARRAY_X86
+  case HAPLO_ARRAY_ISA_AVX2:
+    done = haplo_array_f64_axpy_avx2(y, a, x, len);
+    break;
+  case HAPLO_ARRAY_ISA_SSE2:
+    done = haplo_array_f64_axpy_sse2(y, a, x, len);
+    break;
+#endif // HAPLO_ARRAY_X86
+  default:
+    break;
+  }
+  for (int i = done; i < len; ++i)
+    y[i] += a * x[i];
+  return;
+}
+
+double haplo_array_f64_total(const double *x, int len)
+{
+  return haplo_array_f64_reduce(HAPLO_ARRAY_REDUCE_SUM, 0.0, x, NULL, len);
+}
+
+HaploValue haplo_array_nth(HaploArray *array, int index)
+{
+  assert(array && index >= 0 && index < array->len);
+  if (array->type == HAPLO_ARRAY_I64)
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_INTEGER,
+      .value.integer = array->data.i64[index],
+    };
+  }
+  return (HaploValue) {
+    .type = HAPLO_VAL_FLOAT,
+    .value.floating_point = array->data.f64[index],
+  };
+}
+
+HaploArray *haplo_array_from_list(HaploArrayType type, HaploValueList *list,
+                                  int *error)
+{
+  HaploValueType value_type =
+    (type == HAPLO_ARRAY_I64) ? HAPLO_VAL_INTEGER : HAPLO_VAL_FLOAT;
+  for (HaploValueList *this = list; this; this = this->next)
+  {
+    if (this->val.type != value_type)
+    {
+      *error = HAPLO_ERROR_INTERPRETER_INVALID_TYPE;
+      return NULL;
+    }
+  }
+
+  HaploArray *array = haplo_array_new(type, haplo_value_list_len(list));
+  if (UNLIKELY(!array))
+  {
+    *error = HAPLO_ERROR_OUT_OF_MEMORY;
+    return NULL;
+  }
+
+  int i = 0;
+  for (HaploValueList *this = list; this; this = this->next, ++i)
+  {
+    if (type == HAPLO_ARRAY_I64)
+      array->data.i64[i] = this->val.value.integer;
+    else
+      array->data.f64[i] = this->val.value.floating_point;
+  }
+  return array;
+}
+
+HaploList *haplo_array_to_list(HaploArray *array)
+{
+  HaploValueList *chain = NULL;
+  for (int i = 0; i < haplo_array_len(array); ++i)
+  {
+    HaploValueList *new_chain =
+      haplo_value_list_push_front(haplo_array_nth(array, i), chain);
+    if (UNLIKELY(new_chain == chain))
+    {
+      haplo_value_list_free(chain);
+      return NULL;
+    }
+    chain = new_chain;
+  }
+  return haplo_list_new(chain);
+}
+
+int haplo_array_string(HaploArray *array, char *buf, int buf_len)
+{
+  int offset = haplo_snprintf_clamp(snprintf(buf, buf_len, "array-%s: ",
+                                             (array->type == HAPLO_ARRAY_I64) ? "i64" : "f64"),
+                                    buf_len);
+  for (int i = 0; i < array->len && offset < buf_len - 1; ++i)
+  {
+    offset += haplo_snprintf_clamp(haplo_value_string(haplo_array_nth(array, i),
+                                                      buf + offset,
+                                                      buf_len - offset),
+                                   buf_len - offset);
+    offset += haplo_snprintf_clamp(snprintf(buf + offset, buf_len - offset, " "),
+                                   buf_len - offset);
+  }
+  return offset;
+}
@@ -0,0 +1,132 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#ifndef HAPLO_ARRAY_H
+#define HAPLO_ARRAY_H
+
+#include "value.h"
+
+#include <stdint.h>
+
+//
+// Macros
+//
+
+#ifdef HAPLO_NO_PREFIX
+  #define Array HaploArray
+  #define ArrayType HaploArrayType
+  #define ArrayOp HaploArrayOp
+  #define array_new haplo_array_new
+  #define array_ref haplo_array_ref
+  #define array_free haplo_array_free
+  #define array_len haplo_array_len
+  #define array_op haplo_array_op
+  #define array_op_scalar haplo_array_op_scalar
+  #define array_sum haplo_array_sum
+  #define array_min haplo_array_min
+  #define array_max haplo_array_max
+  #define array_dot haplo_array_dot
+  #define array_f64_axpy haplo_array_f64_axpy
+  #define array_f64_total haplo_array_f64_total
+  #define array_nth haplo_array_nth
+  #define array_from_list haplo_array_from_list
+  #define array_to_list haplo_array_to_list
+  #define array_string haplo_array_string
+#endif // HAPLO_NO_PREFIX
+
+// The elements of an array are aligned to HAPLO_ARRAY_ALIGNMENT
+// bytes, so the kernels can use aligned loads
+#define HAPLO_ARRAY_ALIGNMENT 64
+
+// Define HAPLO_ARRAY_NO_SIMD to build only the scalar kernels
+
+//
+// Types
+//
+
+typedef enum {
+  HAPLO_ARRAY_I64 = 0,
+  HAPLO_ARRAY_F64,
+  _HAPLO_ARRAY_MAX,
+} HaploArrayType;
+
+// The elementwise operations on arrays. Comparisons produce a mask:
+// an i64 array with 1 where the comparison holds and 0 elsewhere.
+typedef enum {
+  HAPLO_ARRAY_OP_ADD = 0,
+  HAPLO_ARRAY_OP_SUB,
+  HAPLO_ARRAY_OP_MUL,
+  HAPLO_ARRAY_OP_DIV,
+  HAPLO_ARRAY_OP_LT,
+  HAPLO_ARRAY_OP_LE,
+  HAPLO_ARRAY_OP_GT,
+  HAPLO_ARRAY_OP_GE,
+  HAPLO_ARRAY_OP_EQ,
+  _HAPLO_ARRAY_OP_MAX,
+} HaploArrayOp;
+
+// A fixed size array of unboxed numbers of the same type. Arrays are
+// never modified after they are filled, operations return new ones,
+// so they are shared by reference.
+struct HaploArray {
+  HaploArrayType type;
+  int len;
+  unsigned int refcount;
+  // The allocation, data points inside of it
+  void *block;
+  union {
+    int64_t *i64;
+    double *f64;
+  } data;
+};
+
+//
+// Functions
+//
+
+// Returns an array of len zeros, or NULL if out of memory
+HaploArray *haplo_array_new(HaploArrayType type, int len);
+// Returns a new reference to array
+HaploArray *haplo_array_ref(HaploArray *array);
+// Drops a reference to array
+void haplo_array_free(HaploArray *array);
+int haplo_array_len(HaploArray *array);
+// Returns the result of op on each pair of elements of a and b, which
+// must have the same type and length. Returns NULL and sets error on
+// failure, HAPLO_ERROR_OUT_OF_RANGE if an i64 result does not fit in
+// 64 bits: arrays are not promoted to bigints.
+HaploArray *haplo_array_op(HaploArrayOp op, HaploArray *a, HaploArray *b,
+                           int *error);
+// Like haplo_array_op, with scalar in place of every element of b.
+// scalar must be an INTEGER for i64 arrays, a FLOAT for f64 arrays.
+HaploArray *haplo_array_op_scalar(HaploArrayOp op, HaploArray *a,
+                                  HaploValue scalar, int *error);
+// The reductions return an INTEGER for i64 arrays, a FLOAT for f64
+// arrays, or an ERROR. The i64 sum and dot product are
+// HAPLO_ERROR_OUT_OF_RANGE if they, or a product, do not fit.
+HaploValue haplo_array_sum(HaploArray *array);
+HaploValue haplo_array_min(HaploArray *array);
+HaploValue haplo_array_max(HaploArray *array);
+HaploValue haplo_array_dot(HaploArray *a, HaploArray *b);
+// Kernels on plain f64 buffers, like the rows of a matrix. The
+// buffers do not need to be aligned.
+// Adds a times the len elements of x to y
+void haplo_array_f64_axpy(double *y, double a, const double *x, int len);
+// Returns the sum of the len elements of x
+double haplo_array_f64_total(const double *x, int len);
+// index must be in bounds
+HaploValue haplo_array_nth(HaploArray *array, int index);
+// Returns an array with the values of list, which must all be
+// INTEGERs for i64 or FLOATs for f64. Returns NULL and sets error on
+// failure.
+HaploArray *haplo_array_from_list(HaploArrayType type, HaploValueList *list,
+                                  int *error);
+// Returns a list with the elements of array, or NULL if out of memory
+HaploList *haplo_array_to_list(HaploArray *array);
+// Returns the number of bytes written to buf. At most buf_len bytes
+// will be written.
+int haplo_array_string(HaploArray *array, char *buf, int buf_len);
+
+#endif // HAPLO_ARRAY_H
@@ -4,6 +4,8 @@
 // Github:  @San7o
 
 #include "atom.h"
+#include "alloc.h"
+#include "fmt.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -17,15 +19,15 @@ void haplo_atom_free(HaploAtom *atom)
   switch(atom->type)
   {
   case HAPLO_ATOM_STRING:
-    free(atom->value.string);
+    haplo_string_free(atom->value.string);
     atom->value.string = NULL;
     return;
   case HAPLO_ATOM_SYMBOL:
-    free(atom->value.symbol);
+    haplo_free(atom->value.symbol);
     atom->value.symbol = NULL;
     return;
   case HAPLO_ATOM_QUOTE:
-    free(atom->value.quote);
+    haplo_free(atom->value.quote);
     atom->value.quote = NULL;
     return;
   default:
@@ -43,16 +45,13 @@ HaploAtom haplo_atom_deep_copy(HaploAtom atom)
   switch(atom.type)
   {
   case HAPLO_ATOM_STRING:
-    new_atom.value.string = malloc(strlen(atom.value.string)+1);
-    strcpy(new_atom.value.string, atom.value.string);
+    new_atom.value.string = haplo_string_ref(atom.value.string);
     break;
   case HAPLO_ATOM_SYMBOL:
-    new_atom.value.symbol = malloc(strlen(atom.value.symbol)+1);
-    strcpy(new_atom.value.symbol, atom.value.symbol);
+    new_atom.value.symbol = haplo_strdup(atom.value.symbol);
     break;
   case HAPLO_ATOM_QUOTE:
-    new_atom.value.quote = malloc(strlen(atom.value.quote)+1);
-    strcpy(new_atom.value.quote, atom.value.quote);
+    new_atom.value.quote = haplo_strdup(atom.value.quote);
     break;
   case HAPLO_ATOM_INTEGER:
     new_atom.value.integer = atom.value.integer;
@@ -77,13 +76,14 @@ void haplo_atom_string(HaploAtom atom, char buf[HAPLO_ATOM_MAX_STRING_LEN])
   switch(atom.type)
   {
   case HAPLO_ATOM_STRING:
-    sprintf(buf, "\"%s\"", atom.value.string);
+    snprintf(buf, HAPLO_ATOM_MAX_STRING_LEN, "\"%.*s\"",
+             atom.value.string->len, atom.value.string->data);
     break;
   case HAPLO_ATOM_INTEGER:
-    sprintf(buf, "%ld", atom.value.integer);
+    haplo_fmt_long(buf, atom.value.integer);
     break;
   case HAPLO_ATOM_FLOAT:
-    sprintf(buf, "%f", atom.value.floating_point);
+    haplo_fmt_double(buf, atom.value.floating_point);
     break;
   case HAPLO_ATOM_BOOL:
     sprintf(buf, "%s", atom.value.boolean ? "true" : "false");
@@ -6,6 +6,8 @@
 #ifndef HAPLO_ATOM_H
 #define HAPLO_ATOM_H
 
+#include "str.h"
+
 #include <stdbool.h>
 
 //
@@ -39,7 +41,7 @@ typedef enum {
 typedef struct {
   HaploAtomType type;
   union {
-    char* string;
+    HaploString *string;
     long int integer;
     double floating_point;
     bool boolean;
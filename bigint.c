@@ -0,0 +1,482 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "bigint.h"
+#include "errors.h"
+#include "utils.h"
+#include "alloc.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#define HAPLO_BIGINT_ERROR(err)        \
+  (HaploValue) {                       \
+    .type = HAPLO_VAL_ERROR,           \
+    .value.error = (err),              \
+  }
+
+// An INTEGER or BIGINT argument, seen as a sign and a magnitude.
+// Zero has sign 1 and no limbs.
+typedef struct {
+  int sign;
+  int len;
+  const uint32_t *limbs;
+  // The limbs of an INTEGER
+  uint32_t small[2];
+} HaploBigintOperand;
+
+static void haplo_bigint_operand(HaploValue value, HaploBigintOperand *operand)
+{
+  if (value.type == HAPLO_VAL_BIGINT)
+  {
+    operand->sign = value.value.bigint->sign;
+    operand->len = value.value.bigint->len;
+    operand->limbs = value.value.bigint->limbs;
+    return;
+  }
+
+  assert(value.type == HAPLO_VAL_INTEGER);
+  long integer = value.value.integer;
+  unsigned long long magnitude = (integer < 0)
+    ? 0ULL - (unsigned long long) integer : (unsigned long long) integer;
+  operand->sign = (integer < 0) ? -1 : 1;
+  operand->small[0] = (uint32_t) magnitude;
+  operand->small[1] = (uint32_t) (magnitude >> 32);
+  operand->len = operand->small[1] ? 2 : (operand->small[0] ? 1 : 0);
+  operand->limbs = operand->small;
+}
+
+// Returns a bigint with room for capacity zeroed limbs
+static HaploBigint *haplo_bigint_alloc(int capacity)
+{
+  if (capacity < 0 || capacity > (INT_MAX - (int) sizeof(HaploBigint))
+                                  / (int) sizeof(uint32_t))
+    return NULL;
+
+  HaploBigint *bigint = haplo_alloc(sizeof(HaploBigint) + capacity * sizeof(uint32_t));
+  if (UNLIKELY(!bigint)) return NULL;
+
+  bigint->refcount = 1;
+  bigint->sign = 1;
+  bigint->len = capacity;
+  memset(bigint->limbs, 0, capacity * sizeof(uint32_t));
+  return bigint;
+}
+
+// Drops the leading zero limbs of bigint, and turns it into an
+// INTEGER if it fits in a long
+static HaploValue haplo_bigint_finish(HaploBigint *bigint)
+{
+  while (bigint->len > 0 && bigint->limbs[bigint->len - 1] == 0)
+    bigint->len--;
+
+  if (bigint->len <= 2)
+  {
+    unsigned long long magnitude = 0;
+    if (bigint->len > 0) magnitude = bigint->limbs[0];
+    if (bigint->len > 1) magnitude |= (unsigned long long) bigint->limbs[1] << 32;
+
+    bool fits = (bigint->sign > 0) ? magnitude <= LONG_MAX
+      : magnitude <= (unsigned long long) LONG_MAX + 1;
+    if (fits)
+    {
+      long integer = (bigint->sign > 0) ? (long) magnitude
+        : (magnitude == 0) ? 0 : -(long) (magnitude - 1) - 1;
+      haplo_free(bigint);
+      return (HaploValue) {
+        .type = HAPLO_VAL_INTEGER,
+        .value.integer = integer,
+      };
+    }
+  }
+
+  return (HaploValue) {
+    .type = HAPLO_VAL_BIGINT,
+    .value.bigint = bigint,
+  };
+}
+
+//
+// Magnitudes
+//
+
+static int haplo_bigint_mag_len(const uint32_t *a, int len)
+{
+  while (len > 0 && a[len - 1] == 0) len--;
+  return len;
+}
+
+static int haplo_bigint_mag_cmp(const uint32_t *a, int a_len,
+                                const uint32_t *b, int b_len)
+{
+  a_len = haplo_bigint_mag_len(a, a_len);
+  b_len = haplo_bigint_mag_len(b, b_len);
+  if (a_len != b_len) return (a_len < b_len) ? -1 : 1;
+  for (int i = a_len - 1; i >= 0; --i)
+    if (a[i] != b[i]) return (a[i] < b[i]) ? -1 : 1;
+  return 0;
+}
+
+// Adds the a_len limbs of a to the r_len limbs of r, with a_len <=
+// r_len. Returns the carry out of r.
+static uint32_t haplo_bigint_mag_add(uint32_t *r, int r_len,
+                                     const uint32_t *a, int a_len)
+{
+  uint64_t carry = 0;
+  int i = 0;
+  for (; i < a_len; ++i)
+  {
+    carry += (uint64_t) r[i] + a[i];
+    r[i] = (uint32_t) carry;
+    carry >>= 32;
+  }
+  for (; carry && i < r_len; ++i)
+  {
+    carry += r[i];
+    r[i] = (uint32_t) carry;
+    carry >>= 32;
+  }
+  return (uint32_t) carry;
+}
+
+// Subtracts a from r, r must not be lower than a
+static void haplo_bigint_mag_sub(uint32_t *r, int r_len,
+                                 const uint32_t *a, int a_len)
+{
+  a_len = haplo_bigint_mag_len(a, a_len);
+  assert(a_len <= r_len);
+
+  uint32_t borrow = 0;
+  int i = 0;
+  for (; i < a_len; ++i)
+  {
+    uint64_t diff = (uint64_t) r[i] - a[i] - borrow;
+    r[i] = (uint32_t) diff;
+    borrow = (diff >> 32) & 1;
+  }
+  for (; borrow && i < r_len; ++i)
+  {
+    uint64_t diff = (uint64_t) r[i] - borrow;
+    r[i] = (uint32_t) diff;
+    borrow = (diff >> 32) & 1;
+  }
+  return;
+}
+
+// Writes the a_len + b_len limbs of a * b to out
+static void haplo_bigint_mag_mul_school(uint32_t *out,
+                                        const uint32_t *a, int a_len,
+                                        const uint32_t *b, int b_len)
+{
+  memset(out, 0, (a_len + b_len) * sizeof(uint32_t));
+  for (int i = 0; i < a_len; ++i)
+  {
+    uint64_t carry = 0;
+    for (int j = 0; j < b_len; ++j)
+    {
+      carry += (uint64_t) a[i] * b[j] + out[i + j];
+      out[i + j] = (uint32_t) carry;
+      carry >>= 32;
+    }
+    out[i + b_len] = (uint32_t) carry;
+  }
+  return;
+}
+
+// Writes the a_len + b_len limbs of a * b to out. Long numbers are
+// split in a high and a low half, and the product of the halves takes
+// three multiplications instead of four:
+//   z0 = a0 * b0, z2 = a1 * b1, z1 = (a0 + a1) * (b0 + b1) - z0 - z2
+// Returns 0 or a negative error.
+static int haplo_bigint_mag_mul(uint32_t *out,
+                                const uint32_t *a, int a_len,
+                                const uint32_t *b, int b_len)
+{
+  if (a_len < b_len)
+  {
+    const uint32_t *tmp = a;
+    a = b;
+    b = tmp;
+    int tmp_len = a_len;
+    a_len = b_len;
+    b_len = tmp_len;
+  }
+  // The halves of less than four limbs are not shorter than their sum
+  if (b_len < HAPLO_BIGINT_KARATSUBA_THRESHOLD || b_len < 4)
+  {
+    haplo_bigint_mag_mul_school(out, a, a_len, b, b_len);
+    return 0;
+  }
+
+  int error = 0;
+  int m = a_len / 2;
+  if (b_len <= m)
+  {
+    // b is too short to be split, multiply it by each half of a
+    uint32_t *high = haplo_alloc((a_len - m + b_len) * sizeof(uint32_t));
+    if (UNLIKELY(!high)) return HAPLO_ERROR_OUT_OF_MEMORY;
+
+    error = haplo_bigint_mag_mul(out, a, m, b, b_len);
+    if (error == 0)
+      error = haplo_bigint_mag_mul(high, a + m, a_len - m, b, b_len);
+    if (error == 0)
+    {
+      memset(out + m + b_len, 0, (a_len - m) * sizeof(uint32_t));
+      haplo_bigint_mag_add(out + m, a_len + b_len - m, high, a_len - m + b_len);
+    }
+    haplo_free(high);
+    return error;
+  }
+
+  // The sums of the halves and their product
+  int sum_len = a_len - m + 1;
+  uint32_t *tmp = haplo_calloc(4 * sum_len, sizeof(uint32_t));
+  if (UNLIKELY(!tmp)) return HAPLO_ERROR_OUT_OF_MEMORY;
+  uint32_t *sum_a = tmp;
+  uint32_t *sum_b = tmp + sum_len;
+  uint32_t *z1 = tmp + 2 * sum_len;
+
+  memcpy(sum_a, a, m * sizeof(uint32_t));
+  haplo_bigint_mag_add(sum_a, sum_len, a + m, a_len - m);
+  memcpy(sum_b, b, m * sizeof(uint32_t));
+  haplo_bigint_mag_add(sum_b, sum_len, b + m, b_len - m);
+
+  // z0 and z2 go straight to their place in out
+  error = haplo_bigint_mag_mul(out, a, m, b, m);
+  if (error == 0)
+    error = haplo_bigint_mag_mul(out + 2 * m, a + m, a_len - m, b + m, b_len - m);
+  if (error == 0)
+    error = haplo_bigint_mag_mul(z1, sum_a, sum_len, sum_b, sum_len);
+  if (error == 0)
+  {
+    haplo_bigint_mag_sub(z1, 2 * sum_len, out, 2 * m);
+    haplo_bigint_mag_sub(z1, 2 * sum_len, out + 2 * m, a_len + b_len - 2 * m);
+    int z1_len = haplo_bigint_mag_len(z1, 2 * sum_len);
+    assert(z1_len <= a_len + b_len - m);
+    haplo_bigint_mag_add(out + m, a_len + b_len - m, z1, z1_len);
+  }
+
+  haplo_free(tmp);
+  return error;
+}
+
+// Writes a / d to the a_len limbs of q, returns the remainder
+static uint32_t haplo_bigint_mag_div_small(uint32_t *q, const uint32_t *a,
+                                           int a_len, uint32_t d)
+{
+  uint64_t rem = 0;
+  for (int i = a_len - 1; i >= 0; --i)
+  {
+    uint64_t cur = (rem << 32) | a[i];
+    q[i] = (uint32_t) (cur / d);
+    rem = cur % d;
+  }
+  return (uint32_t) rem;
+}
+
+// Writes a / b to the a_len limbs of q, one bit at a time. r is
+// scratch space of b_len + 1 limbs.
+static void haplo_bigint_mag_div(uint32_t *q, uint32_t *r,
+                                 const uint32_t *a, int a_len,
+                                 const uint32_t *b, int b_len)
+{
+  memset(q, 0, a_len * sizeof(uint32_t));
+  memset(r, 0, (b_len + 1) * sizeof(uint32_t));
+  for (long bit = (long) a_len * 32 - 1; bit >= 0; --bit)
+  {
+    for (int i = b_len; i > 0; --i)
+      r[i] = (r[i] << 1) | (r[i - 1] >> 31);
+    r[0] = (r[0] << 1) | ((a[bit / 32] >> (bit % 32)) & 1);
+
+    if (haplo_bigint_mag_cmp(r, b_len + 1, b, b_len) >= 0)
+    {
+      haplo_bigint_mag_sub(r, b_len + 1, b, b_len);
+      q[bit / 32] |= 1u << (bit % 32);
+    }
+  }
+  return;
+}
+
+//
+// Bigints
+//
+
+HaploBigint *haplo_bigint_ref(HaploBigint *bigint)
+{
+  if (bigint) bigint->refcount++;
+  return bigint;
+}
+
+void haplo_bigint_free(HaploBigint *bigint)
+{
+  if (!bigint || --bigint->refcount != 0) return;
+
+  haplo_free(bigint);
+  return;
+}
+
+// Returns a + b, with the sign of b replaced by b_sign
+static HaploValue haplo_bigint_add_signed(HaploBigintOperand *a,
+                                          HaploBigintOperand *b, int b_sign)
+{
+  int len = ((a->len > b->len) ? a->len : b->len) + 1;
+  HaploBigint *out = haplo_bigint_alloc(len);
+  if (UNLIKELY(!out))
+    return HAPLO_BIGINT_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+
+  if (a->sign == b_sign)
+  {
+    memcpy(out->limbs, a->limbs, a->len * sizeof(uint32_t));
+    haplo_bigint_mag_add(out->limbs, len, b->limbs, b->len);
+    out->sign = a->sign;
+  } else if (haplo_bigint_mag_cmp(a->limbs, a->len, b->limbs, b->len) >= 0) {
+    memcpy(out->limbs, a->limbs, a->len * sizeof(uint32_t));
+    haplo_bigint_mag_sub(out->limbs, len, b->limbs, b->len);
+    out->sign = a->sign;
+  } else {
+    memcpy(out->limbs, b->limbs, b->len * sizeof(uint32_t));
+    haplo_bigint_mag_sub(out->limbs, len, a->limbs, a->len);
+    out->sign = b_sign;
+  }
+  return haplo_bigint_finish(out);
+}
+
+HaploValue haplo_bigint_add(HaploValue a, HaploValue b)
+{
+  HaploBigintOperand x, y;
+  haplo_bigint_operand(a, &x);
+  haplo_bigint_operand(b, &y);
+  return haplo_bigint_add_signed(&x, &y, y.sign);
+}
+
+HaploValue haplo_bigint_sub(HaploValue a, HaploValue b)
+{
+  HaploBigintOperand x, y;
+  haplo_bigint_operand(a, &x);
+  haplo_bigint_operand(b, &y);
+  return haplo_bigint_add_signed(&x, &y, -y.sign);
+}
+
+HaploValue haplo_bigint_mul(HaploValue a, HaploValue b)
+{
+  HaploBigintOperand x, y;
+  haplo_bigint_operand(a, &x);
+  haplo_bigint_operand(b, &y);
+
+  HaploBigint *out = haplo_bigint_alloc(x.len + y.len);
+  if (UNLIKELY(!out))
+    return HAPLO_BIGINT_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+
+  int error = haplo_bigint_mag_mul(out->limbs, x.limbs, x.len, y.limbs, y.len);
+  if (error < 0)
+  {
+    haplo_free(out);
+    return HAPLO_BIGINT_ERROR(error);
+  }
+  out->sign = x.sign * y.sign;
+  return haplo_bigint_finish(out);
+}
+
+HaploValue haplo_bigint_div(HaploValue a, HaploValue b)
+{
+  HaploBigintOperand x, y;
+  haplo_bigint_operand(a, &x);
+  haplo_bigint_operand(b, &y);
+  if (y.len == 0)
+    return HAPLO_BIGINT_ERROR(HAPLO_ERROR_DIVISION_BY_ZERO);
+
+  HaploBigint *out = haplo_bigint_alloc(x.len);
+  if (UNLIKELY(!out))
+    return HAPLO_BIGINT_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+
+  if (y.len == 1)
+  {
+    haplo_bigint_mag_div_small(out->limbs, x.limbs, x.len, y.limbs[0]);
+  } else {
+    uint32_t *r = haplo_alloc((y.len + 1) * sizeof(uint32_t));
+    if (UNLIKELY(!r))
+    {
+      haplo_free(out);
+      return HAPLO_BIGINT_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+    }
+    haplo_bigint_mag_div(out->limbs, r, x.limbs, x.len, y.limbs, y.len);
+    haplo_free(r);
+  }
+  out->sign = x.sign * y.sign;
+  return haplo_bigint_finish(out);
+}
+
+int haplo_bigint_compare(HaploValue a, HaploValue b)
+{
+  HaploBigintOperand x, y;
+  haplo_bigint_operand(a, &x);
+  haplo_bigint_operand(b, &y);
+  if (x.sign != y.sign) return x.sign;
+  return x.sign * haplo_bigint_mag_cmp(x.limbs, x.len, y.limbs, y.len);
+}
+
+bool haplo_bigint_equal(HaploBigint *a, HaploBigint *b)
+{
+  return a->sign == b->sign && a->len == b->len
+    && memcmp(a->limbs, b->limbs, a->len * sizeof(uint32_t)) == 0;
+}
+
+uint64_t haplo_bigint_hash(HaploBigint *bigint)
+{
+  // FNV-1a over the limbs
+  uint64_t hash = 14695981039346656037ULL ^ (uint64_t) (bigint->sign < 0);
+  for (int i = 0; i < bigint->len; ++i)
+  {
+    hash ^= bigint->limbs[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+double haplo_bigint_to_double(HaploBigint *bigint)
+{
+  double result = 0;
+  for (int i = bigint->len - 1; i >= 0; --i)
+    result = result * 4294967296.0 + bigint->limbs[i];
+  return bigint->sign * result;
+}
+
+// The digits are found in chunks of nine, dividing by 10^9
+int haplo_bigint_string(HaploBigint *bigint, char *buf, int buf_len)
+{
+  int chunk_count = 0;
+  uint32_t *chunks = haplo_alloc((2 * bigint->len + 1) * sizeof(uint32_t));
+  uint32_t *magnitude = haplo_alloc(bigint->len * sizeof(uint32_t));
+  if (UNLIKELY(!chunks || !magnitude))
+  {
+    haplo_free(chunks);
+    haplo_free(magnitude);
+    return haplo_snprintf_clamp(snprintf(buf, buf_len, "..."), buf_len);
+  }
+
+  memcpy(magnitude, bigint->limbs, bigint->len * sizeof(uint32_t));
+  int len = bigint->len;
+  while (len > 0)
+  {
+    chunks[chunk_count++] = haplo_bigint_mag_div_small(magnitude, magnitude,
+                                                       len, 1000000000);
+    len = haplo_bigint_mag_len(magnitude, len);
+  }
+
+  int offset = haplo_snprintf_clamp(snprintf(buf, buf_len, "%s%u",
+                                             (bigint->sign < 0) ? "-" : "",
+                                             chunks[chunk_count - 1]),
+                                    buf_len);
+  for (int i = chunk_count - 2; i >= 0 && offset < buf_len - 1; --i)
+    offset += haplo_snprintf_clamp(snprintf(buf + offset, buf_len - offset,
+                                            "%09u", chunks[i]),
+                                   buf_len - offset);
+
+  haplo_free(chunks);
+  haplo_free(magnitude);
+  return offset;
+}
@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#ifndef HAPLO_BIGINT_H
+#define HAPLO_BIGINT_H
+
+#include "value.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//
+// Macros
+//
+
+#ifdef HAPLO_NO_PREFIX
+  #define Bigint HaploBigint
+  #define bigint_ref haplo_bigint_ref
+  #define bigint_free haplo_bigint_free
+  #define bigint_add haplo_bigint_add
+  #define bigint_sub haplo_bigint_sub
+  #define bigint_mul haplo_bigint_mul
+  #define bigint_div haplo_bigint_div
+  #define bigint_compare haplo_bigint_compare
+  #define bigint_equal haplo_bigint_equal
+  #define bigint_hash haplo_bigint_hash
+  #define bigint_to_double haplo_bigint_to_double
+  #define bigint_string haplo_bigint_string
+#endif // HAPLO_NO_PREFIX
+
+// Products of numbers with at least this many limbs use Karatsuba
+// multiplication, shorter ones the schoolbook method
+#ifndef HAPLO_BIGINT_KARATSUBA_THRESHOLD
+#define HAPLO_BIGINT_KARATSUBA_THRESHOLD 32
+#endif // HAPLO_BIGINT_KARATSUBA_THRESHOLD
+
+//
+// Types
+//
+
+// An integer that does not fit in a long, stored as a sign and the
+// 32 bit limbs of its magnitude, least significant first. Integers
+// that fit in a long are always INTEGER values, so a value has a
+// single representation. Bigints are never modified, they are shared
+// by reference.
+struct HaploBigint {
+  unsigned int refcount;
+  // 1 or -1
+  int sign;
+  int len;
+  uint32_t limbs[];
+};
+
+//
+// Functions
+//
+
+// Returns a new reference to bigint
+HaploBigint *haplo_bigint_ref(HaploBigint *bigint);
+// Drops a reference to bigint
+void haplo_bigint_free(HaploBigint *bigint);
+// The following functions take INTEGER or BIGINT values, and return
+// an INTEGER if the result fits in a long, a BIGINT otherwise, or an
+// ERROR. The arguments are not freed.
+HaploValue haplo_bigint_add(HaploValue a, HaploValue b);
+HaploValue haplo_bigint_sub(HaploValue a, HaploValue b);
+HaploValue haplo_bigint_mul(HaploValue a, HaploValue b);
+// Truncates towards zero like the division of longs
+HaploValue haplo_bigint_div(HaploValue a, HaploValue b);
+// Returns a negative number, 0 or a positive number if a is lower,
+// equal or greater than b, which are INTEGER or BIGINT values
+int haplo_bigint_compare(HaploValue a, HaploValue b);
+bool haplo_bigint_equal(HaploBigint *a, HaploBigint *b);
+uint64_t haplo_bigint_hash(HaploBigint *bigint);
+// Returns bigint as a double, or an infinity if it is too big
+double haplo_bigint_to_double(HaploBigint *bigint);
+// Writes the decimal digits of bigint. Returns the number of bytes
+// written to buf, at most buf_len bytes will be written.
+int haplo_bigint_string(HaploBigint *bigint, char *buf, int buf_len);
+
+#endif // HAPLO_BIGINT_H
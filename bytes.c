@@ -0,0 +1,402 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#define _POSIX_C_SOURCE 200809L // mmap
+
+#include "bytes.h"
+#include "bigint.h"
+#include "alloc.h"
+#include "utils.h"
+#include "errors.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+// Files are mapped with mmap where there is one, and read whole
+// elsewhere
+#if defined(__unix__) || defined(__APPLE__)
+  #define HAPLO_BYTES_MMAP
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+// The size of the scalars, in bytes
+static const int haplo_bytes_scalar_size[_HAPLO_BYTES_SCALAR_MAX] = {
+  [HAPLO_BYTES_U8] = 1, [HAPLO_BYTES_I8] = 1,
+  [HAPLO_BYTES_U16] = 2, [HAPLO_BYTES_I16] = 2,
+  [HAPLO_BYTES_U32] = 4, [HAPLO_BYTES_I32] = 4,
+  [HAPLO_BYTES_U64] = 8, [HAPLO_BYTES_I64] = 8,
+  [HAPLO_BYTES_F32] = 4, [HAPLO_BYTES_F64] = 8,
+};
+
+static const char *haplo_bytes_scalar_name[_HAPLO_BYTES_SCALAR_MAX] = {
+  [HAPLO_BYTES_U8] = "u8", [HAPLO_BYTES_I8] = "i8",
+  [HAPLO_BYTES_U16] = "u16", [HAPLO_BYTES_I16] = "i16",
+  [HAPLO_BYTES_U32] = "u32", [HAPLO_BYTES_I32] = "i32",
+  [HAPLO_BYTES_U64] = "u64", [HAPLO_BYTES_I64] = "i64",
+  [HAPLO_BYTES_F32] = "f32", [HAPLO_BYTES_F64] = "f64",
+};
+
+HaploBytes *haplo_bytes_new(long len)
+{
+  if (UNLIKELY(len < 0 || (unsigned long) len > SIZE_MAX - sizeof(HaploBytes)))
+    return NULL;
+
+  HaploBytes *bytes = haplo_alloc(sizeof(HaploBytes) + len);
+  if (UNLIKELY(!bytes)) return NULL;
+
+  bytes->refcount = 1;
+  bytes->len = len;
+  bytes->data = bytes->buffer;
+  bytes->writable = true;
+  bytes->parent = NULL;
+  bytes->release = NULL;
+  bytes->owner = NULL;
+  if (len > 0) memset(bytes->buffer, 0, len);
+  return bytes;
+}
+
+HaploBytes *haplo_bytes_wrap(uint8_t *data, long len, bool writable,
+                             HaploBytesRelease release, void *owner)
+{
+  HaploBytes *bytes = haplo_alloc(sizeof(HaploBytes));
+  if (UNLIKELY(!bytes)) return NULL;
+
+  bytes->refcount = 1;
+  bytes->len = len;
+  bytes->data = data;
+  bytes->writable = writable;
+  bytes->parent = NULL;
+  bytes->release = release;
+  bytes->owner = owner;
+  return bytes;
+}
+
+#ifdef HAPLO_BYTES_MMAP
+
+static void haplo_bytes_unmap(void *owner, uint8_t *data, long len)
+{
+  munmap(data, len);
+  return;
+}
+
+HaploBytes *haplo_bytes_map_file(const char *path, bool writable, int *err)
+{
+  int fd = open(path, writable ? O_RDWR : O_RDONLY);
+  if (fd < 0)
+  {
+    *err = HAPLO_ERROR_IO;
+    return NULL;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (uintmax_t) info.st_size > LONG_MAX)
+  {
+    close(fd);
+    *err = HAPLO_ERROR_IO;
+    return NULL;
+  }
+
+  // An empty file can't be mapped, and it needs no memory
+  long len = (long) info.st_size;
+  if (len == 0)
+  {
+    close(fd);
+    HaploBytes *bytes = haplo_bytes_new(0);
+    if (!bytes) *err = HAPLO_ERROR_OUT_OF_MEMORY;
+    else bytes->writable = writable;
+    return bytes;
+  }
+
+  // The mapping stays valid after the file is closed
+  void *data = mmap(NULL, len, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                    MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+  {
+    *err = HAPLO_ERROR_IO;
+    return NULL;
+  }
+  HaploBytes *bytes = haplo_bytes_wrap(data, len, writable, haplo_bytes_unmap, NULL);
+  if (!bytes)
+  {
+    munmap(data, len);
+    *err = HAPLO_ERROR_OUT_OF_MEMORY;
+  }
+  return bytes;
+}
+
+#else
+
+// Writable buffers are copies, their writes don't reach the file
+HaploBytes *haplo_bytes_map_file(const char *path, bool writable, int *err)
+{
+  FILE *file = fopen(path, "rb");
+  long len = -1;
+  if (file && fseek(file, 0, SEEK_END) == 0) len = ftell(file);
+  if (len < 0 || fseek(file, 0, SEEK_SET) != 0)
+  {
+    if (file) fclose(file);
+    *err = HAPLO_ERROR_IO;
+    return NULL;
+  }
+
+  HaploBytes *bytes = haplo_bytes_new(len);
+  if (!bytes)
+  {
+    fclose(file);
+    *err = HAPLO_ERROR_OUT_OF_MEMORY;
+    return NULL;
+  }
+  bool read = fread(bytes->data, 1, len, file) == (size_t) len;
+  fclose(file);
+  if (!read)
+  {
+    haplo_bytes_free(bytes);
+    *err = HAPLO_ERROR_IO;
+    return NULL;
+  }
+  bytes->writable = writable;
+  return bytes;
+}
+
+#endif // HAPLO_BYTES_MMAP
+
+HaploBytes *haplo_bytes_ref(HaploBytes *bytes)
+{
+  if (bytes) bytes->refcount++;
+  return bytes;
+}
+
+void haplo_bytes_free(HaploBytes *bytes)
+{
+  if (!bytes || --bytes->refcount != 0) return;
+  if (bytes->release) bytes->release(bytes->owner, bytes->data, bytes->len);
+  haplo_bytes_free(bytes->parent);
+  haplo_free(bytes);
+  return;
+}
+
+HaploBytes *haplo_bytes_slice(HaploBytes *bytes, long start, long len)
+{
+  HaploBytes *slice = haplo_alloc(sizeof(HaploBytes));
+  if (UNLIKELY(!slice)) return NULL;
+
+  // A slice of a slice shares the memory of the first parent, which
+  // releases it
+  slice->refcount = 1;
+  slice->len = len;
+  slice->data = bytes->data + start;
+  slice->writable = bytes->writable;
+  slice->parent = haplo_bytes_ref(bytes->parent ? bytes->parent : bytes);
+  slice->release = NULL;
+  slice->owner = NULL;
+  return slice;
+}
+
+bool haplo_bytes_scalar_parse(const char *name, HaploBytesScalar *scalar,
+                              bool *big_endian)
+{
+  for (int i = 0; i < _HAPLO_BYTES_SCALAR_MAX; ++i)
+  {
+    size_t len = strlen(haplo_bytes_scalar_name[i]);
+    if (strncmp(name, haplo_bytes_scalar_name[i], len) != 0) continue;
+
+    const char *suffix = name + len;
+    *scalar = i;
+    *big_endian = false;
+    if (haplo_bytes_scalar_size[i] == 1) return *suffix == '\0';
+    if (strcmp(suffix, "le") == 0) return true;
+    *big_endian = true;
+    return strcmp(suffix, "be") == 0;
+  }
+  return false;
+}
+
+uint64_t haplo_bytes_read_uint(const HaploBytes *bytes, long offset,
+                               int size, bool big_endian)
+{
+  // The compiler turns the loops into a load and a byte swap
+  const uint8_t *p = bytes->data + offset;
+  uint64_t value = 0;
+  if (big_endian)
+    for (int i = 0; i < size; ++i) value = (value << 8) | p[i];
+  else
+    for (int i = size - 1; i >= 0; --i) value = (value << 8) | p[i];
+  return value;
+}
+
+void haplo_bytes_write_uint(HaploBytes *bytes, long offset, int size,
+                            bool big_endian, uint64_t value)
+{
+  uint8_t *p = bytes->data + offset;
+  for (int i = 0; i < size; ++i)
+  {
+    p[big_endian ? size - 1 - i : i] = (uint8_t) value;
+    value >>= 8;
+  }
+  return;
+}
+
+// Reads with a size the compiler knows
+#define HAPLO_BYTES_READ(size) haplo_bytes_read_uint(bytes, offset, (size), big_endian)
+
+HaploValue haplo_bytes_get(const HaploBytes *bytes, long offset,
+                           HaploBytesScalar scalar, bool big_endian)
+{
+  if (offset < 0 || offset > bytes->len - haplo_bytes_scalar_size[scalar])
+    return (HaploValue) {
+      .type = HAPLO_VAL_ERROR,
+      .value.error = HAPLO_ERROR_INDEX_OUT_OF_BOUNDS,
+    };
+
+  long integer = 0;
+  uint32_t bits32;
+  uint64_t bits64;
+  float f32;
+  double f64;
+  switch(scalar)
+  {
+  case HAPLO_BYTES_U8:  integer = (uint8_t) HAPLO_BYTES_READ(1); break;
+  case HAPLO_BYTES_I8:  integer = (int8_t) HAPLO_BYTES_READ(1); break;
+  case HAPLO_BYTES_U16: integer = (uint16_t) HAPLO_BYTES_READ(2); break;
+  case HAPLO_BYTES_I16: integer = (int16_t) HAPLO_BYTES_READ(2); break;
+  case HAPLO_BYTES_U32: integer = (uint32_t) HAPLO_BYTES_READ(4); break;
+  case HAPLO_BYTES_I32: integer = (int32_t) HAPLO_BYTES_READ(4); break;
+  case HAPLO_BYTES_I64: integer = (int64_t) HAPLO_BYTES_READ(8); break;
+  case HAPLO_BYTES_U64:
+    bits64 = HAPLO_BYTES_READ(8);
+    if (bits64 <= LONG_MAX)
+    {
+      integer = (long) bits64;
+      break;
+    }
+    // Twice the upper 63 bits, plus the last one
+    HaploValue half = haplo_bigint_mul(
+      (HaploValue) { .type = HAPLO_VAL_INTEGER, .value.integer = (long) (bits64 >> 1) },
+      (HaploValue) { .type = HAPLO_VAL_INTEGER, .value.integer = 2 });
+    if (half.type == HAPLO_VAL_ERROR) return half;
+    HaploValue value = haplo_bigint_add(
+      half, (HaploValue) { .type = HAPLO_VAL_INTEGER, .value.integer = (long) (bits64 & 1) });
+    haplo_value_free(half);
+    return value;
+  case HAPLO_BYTES_F32:
+    bits32 = (uint32_t) HAPLO_BYTES_READ(4);
+    memcpy(&f32, &bits32, sizeof(f32));
+    return (HaploValue) {
+      .type = HAPLO_VAL_FLOAT,
+      .value.floating_point = f32,
+    };
+  case HAPLO_BYTES_F64:
+    bits64 = HAPLO_BYTES_READ(8);
+    memcpy(&f64, &bits64, sizeof(f64));
+    return (HaploValue) {
+      .type = HAPLO_VAL_FLOAT,
+      .value.floating_point = f64,
+    };
+  default:
+    break;
+  }
+  return (HaploValue) {
+    .type = HAPLO_VAL_INTEGER,
+    .value.integer = integer,
+  };
+}
+
+// Returns true if integer is in the range of the integer scalar
+static bool haplo_bytes_scalar_fits(HaploBytesScalar scalar, long integer)
+{
+  switch(scalar)
+  {
+  case HAPLO_BYTES_U8:  return integer >= 0 && integer <= UINT8_MAX;
+  case HAPLO_BYTES_I8:  return integer >= INT8_MIN && integer <= INT8_MAX;
+  case HAPLO_BYTES_U16: return integer >= 0 && integer <= UINT16_MAX;
+  case HAPLO_BYTES_I16: return integer >= INT16_MIN && integer <= INT16_MAX;
+  case HAPLO_BYTES_U32: return integer >= 0 && integer <= (long) UINT32_MAX;
+  case HAPLO_BYTES_I32: return integer >= INT32_MIN && integer <= INT32_MAX;
+  case HAPLO_BYTES_U64: return integer >= 0;
+  default:
+    return true;
+  }
+}
+
+int haplo_bytes_set(HaploBytes *bytes, long offset, HaploBytesScalar scalar,
+                    bool big_endian, HaploValue value)
+{
+  if (!bytes->writable) return HAPLO_ERROR_READ_ONLY;
+  int size = haplo_bytes_scalar_size[scalar];
+  if (offset < 0 || offset > bytes->len - size)
+    return HAPLO_ERROR_INDEX_OUT_OF_BOUNDS;
+
+  uint64_t bits;
+  if (scalar == HAPLO_BYTES_F32 || scalar == HAPLO_BYTES_F64)
+  {
+    double f64;
+    if (value.type == HAPLO_VAL_FLOAT)
+      f64 = value.value.floating_point;
+    else if (value.type == HAPLO_VAL_INTEGER)
+      f64 = (double) value.value.integer;
+    else if (value.type == HAPLO_VAL_BIGINT)
+      f64 = haplo_bigint_to_double(value.value.bigint);
+    else
+      return HAPLO_ERROR_INTERPRETER_INVALID_TYPE;
+    if (scalar == HAPLO_BYTES_F32)
+    {
+      float f32 = (float) f64;
+      uint32_t bits32;
+      memcpy(&bits32, &f32, sizeof(bits32));
+      bits = bits32;
+    }
+    else
+    {
+      memcpy(&bits, &f64, sizeof(bits));
+    }
+  }
+  else
+  {
+    if (value.type == HAPLO_VAL_INTEGER)
+    {
+      if (!haplo_bytes_scalar_fits(scalar, value.value.integer))
+        return HAPLO_ERROR_OUT_OF_RANGE;
+      bits = (uint64_t) value.value.integer;
+    }
+    else if (value.type == HAPLO_VAL_BIGINT)
+    {
+      // Only u64 holds integers above a long, the ones that
+      // haplo_bytes_get returns as bigints
+      HaploBigint *bigint = value.value.bigint;
+      if (scalar != HAPLO_BYTES_U64 || bigint->sign < 0 || bigint->len > 2)
+        return HAPLO_ERROR_OUT_OF_RANGE;
+      bits = bigint->limbs[0];
+      if (bigint->len > 1) bits |= (uint64_t) bigint->limbs[1] << 32;
+    }
+    else
+    {
+      return HAPLO_ERROR_INTERPRETER_INVALID_TYPE;
+    }
+  }
+  haplo_bytes_write_uint(bytes, offset, size, big_endian, bits);
+  return 0;
+}
+
+int haplo_bytes_string(HaploBytes *bytes, char *buf, int buf_len)
+{
+  // The first bytes in hex, a buffer can be gigabytes
+  static const char digits[] = "0123456789abcdef";
+  int offset = haplo_snprintf_clamp(snprintf(buf, buf_len, "bytes: %ld", bytes->len),
+                                    buf_len);
+  for (long i = 0; i < bytes->len && i < 16 && offset < buf_len - 1; ++i)
+  {
+    char hex[4] = { ' ', digits[bytes->data[i] >> 4], digits[bytes->data[i] & 0xf], '\0' };
+    offset += haplo_snprintf_clamp(snprintf(buf + offset, buf_len - offset, "%s", hex),
+                                   buf_len - offset);
+  }
+  if (bytes->len > 16)
+    offset += haplo_snprintf_clamp(snprintf(buf + offset, buf_len - offset, " ..."),
+                                   buf_len - offset);
+  return offset;
+}
@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#ifndef HAPLO_BYTES_H
+#define HAPLO_BYTES_H
+
+#include "value.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//
+// Macros
+//
+
+#ifdef HAPLO_NO_PREFIX
+  #define Bytes HaploBytes
+  #define BytesScalar HaploBytesScalar
+  #define BytesRelease HaploBytesRelease
+  #define bytes_new haplo_bytes_new
+  #define bytes_wrap haplo_bytes_wrap
+  #define bytes_map_file haplo_bytes_map_file
+  #define bytes_ref haplo_bytes_ref
+  #define bytes_free haplo_bytes_free
+  #define bytes_slice haplo_bytes_slice
+  #define bytes_scalar_parse haplo_bytes_scalar_parse
+  #define bytes_read_uint haplo_bytes_read_uint
+  #define bytes_write_uint haplo_bytes_write_uint
+  #define bytes_get haplo_bytes_get
+  #define bytes_set haplo_bytes_set
+  #define bytes_string haplo_bytes_string
+#endif // HAPLO_NO_PREFIX
+
+//
+// Types
+//
+
+// The numbers that can be read from and written to a buffer
+typedef enum {
+  HAPLO_BYTES_U8 = 0,
+  HAPLO_BYTES_I8,
+  HAPLO_BYTES_U16,
+  HAPLO_BYTES_I16,
+  HAPLO_BYTES_U32,
+  HAPLO_BYTES_I32,
+  HAPLO_BYTES_U64,
+  HAPLO_BYTES_I64,
+  HAPLO_BYTES_F32,
+  HAPLO_BYTES_F64,
+  _HAPLO_BYTES_SCALAR_MAX,
+} HaploBytesScalar;
+
+// Releases memory wrapped by haplo_bytes_wrap, owner is the one given
+// to it
+typedef void (*HaploBytesRelease)(void *owner, uint8_t *data, long len);
+
+// A buffer of len bytes at data. The bytes are in buffer, in memory
+// owned by someone else, like a mapped file or memory of the C
+// program, or in the memory of parent for a slice. Buffers are shared
+// by reference, writing to one is seen by all the slices of its
+// memory.
+struct HaploBytes {
+  unsigned int refcount;
+  long len;
+  uint8_t *data;
+  bool writable;
+  // The buffer whose memory a slice shares, or NULL
+  HaploBytes *parent;
+  // Called on data when the last reference is dropped, or NULL if the
+  // memory is in buffer or is not owned
+  HaploBytesRelease release;
+  void *owner;
+  uint8_t buffer[];
+};
+
+//
+// Functions
+//
+
+// Returns a new writable buffer of len zero bytes, or NULL if out of
+// memory
+HaploBytes *haplo_bytes_new(long len);
+// Returns a new buffer of the len bytes at data, without copying
+// them, or NULL if out of memory. If release is not NULL, it is
+// called with owner when the buffer is freed.
+HaploBytes *haplo_bytes_wrap(uint8_t *data, long len, bool writable,
+                             HaploBytesRelease release, void *owner);
+// Returns a new buffer with the bytes of the file at path, mapped in
+// memory where the system can, so they are read only when they are
+// used. Writes to a writable buffer go to the file. Returns NULL and
+// sets *err on errors.
+HaploBytes *haplo_bytes_map_file(const char *path, bool writable, int *err);
+// Returns a new reference to bytes
+HaploBytes *haplo_bytes_ref(HaploBytes *bytes);
+// Drops a reference to bytes
+void haplo_bytes_free(HaploBytes *bytes);
+// Returns a buffer of the len bytes of bytes from start, which shares
+// its memory, or NULL if out of memory
+HaploBytes *haplo_bytes_slice(HaploBytes *bytes, long start, long len);
+// Parses a scalar name like u8, i32le or f64be into *scalar and
+// *big_endian. Names of more than one byte need the le or be suffix.
+// Returns false if name is not a scalar.
+bool haplo_bytes_scalar_parse(const char *name, HaploBytesScalar *scalar,
+                              bool *big_endian);
+// Reads and writes the integer of size bytes, 1, 2, 4 or 8, at
+// offset. The bytes must be in bounds.
+uint64_t haplo_bytes_read_uint(const HaploBytes *bytes, long offset,
+                               int size, bool big_endian);
+void haplo_bytes_write_uint(HaploBytes *bytes, long offset, int size,
+                            bool big_endian, uint64_t value);
+// Returns the scalar at offset as an INTEGER, a BIGINT for the u64
+// values above a long, or a FLOAT. Returns an ERROR value if it is out
+// of bounds.
+HaploValue haplo_bytes_get(const HaploBytes *bytes, long offset,
+                           HaploBytesScalar scalar, bool big_endian);
+// Writes the INTEGER, BIGINT or FLOAT value as the scalar at offset.
+// Returns HAPLO_ERROR_OUT_OF_RANGE if an integer does not fit in an
+// integer scalar, floats are rounded to f32. Returns 0, or a negative
+// error.
+int haplo_bytes_set(HaploBytes *bytes, long offset, HaploBytesScalar scalar,
+                    bool big_endian, HaploValue value);
+// Returns the number of bytes written to buf. At most buf_len bytes
+// will be written.
+int haplo_bytes_string(HaploBytes *bytes, char *buf, int buf_len);
+
+#endif // HAPLO_BYTES_H
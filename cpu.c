@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "cpu.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+  #define HAPLO_CPU_X86
+#endif
+
+enum {
+  HAPLO_CPU_QUERIED = 1 << 0,
+  HAPLO_CPU_SSSE3   = 1 << 1,
+  HAPLO_CPU_AVX2    = 1 << 2,
+};
+
+// Returns the HAPLO_CPU_* flags of the cpu
+static int haplo_cpu_features(void)
+{
+  static int features = 0;
+  if (features == 0)
+  {
+    int found = HAPLO_CPU_QUERIED;
+#ifdef HAPLO_CPU_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3")) found |= HAPLO_CPU_SSSE3;
+    if (__builtin_cpu_supports("avx2")) found |= HAPLO_CPU_AVX2;
+#endif
+    features = found;
+  }
+  return features;
+}
+
+bool haplo_cpu_has_ssse3(void)
+{
+  return (haplo_cpu_features() & HAPLO_CPU_SSSE3) != 0;
+}
+
+bool haplo_cpu_has_avx2(void)
+{
+  return (haplo_cpu_features() & HAPLO_CPU_AVX2) != 0;
+}
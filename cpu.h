@@ -0,0 +1,30 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#ifndef HAPLO_CPU_H
+#define HAPLO_CPU_H
+
+#include <stdbool.h>
+
+//
+// Macros
+//
+
+#ifdef HAPLO_NO_PREFIX
+  #define cpu_has_ssse3 haplo_cpu_has_ssse3
+  #define cpu_has_avx2 haplo_cpu_has_avx2
+#endif // HAPLO_NO_PREFIX
+
+//
+// Functions
+//
+
+// Return true if the cpu supports the instruction set. The cpu is
+// queried once and the answer is shared by all the SIMD kernels. They
+// are always false when not compiled with GCC or clang for x86_64.
+bool haplo_cpu_has_ssse3(void);
+bool haplo_cpu_has_avx2(void);
+
+#endif // HAPLO_CPU_H
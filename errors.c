@@ -61,6 +61,42 @@ const char* haplo_error_string(int error)
     return "ERROR_PARSER_UNEXPECTED_TOKEN";
   case HAPLO_ERROR_LEXER_NULL:
     return "ERROR_LEXER_NULL";
+  case HAPLO_ERROR_POOL_NULL:
+    return "ERROR_POOL_NULL";
+  case HAPLO_ERROR_OUT_OF_MEMORY:
+    return "ERROR_OUT_OF_MEMORY";
+  case HAPLO_ERROR_LIST_EMPTY:
+    return "ERROR_LIST_EMPTY";
+  case HAPLO_ERROR_INDEX_OUT_OF_BOUNDS:
+    return "ERROR_INDEX_OUT_OF_BOUNDS";
+  case HAPLO_ERROR_VALUE_CYCLE:
+    return "ERROR_VALUE_CYCLE";
+  case HAPLO_ERROR_KEY_NOT_FOUND:
+    return "ERROR_KEY_NOT_FOUND";
+  case HAPLO_ERROR_DIVISION_BY_ZERO:
+    return "ERROR_DIVISION_BY_ZERO";
+  case HAPLO_ERROR_LENGTH_MISMATCH:
+    return "ERROR_LENGTH_MISMATCH";
+  case HAPLO_ERROR_EMPTY_PATTERN:
+    return "ERROR_EMPTY_PATTERN";
+  case HAPLO_ERROR_REGEX_SYNTAX:
+    return "ERROR_REGEX_SYNTAX";
+  case HAPLO_ERROR_REGEX_TOO_LARGE:
+    return "ERROR_REGEX_TOO_LARGE";
+  case HAPLO_ERROR_FORMAT_DIRECTIVE:
+    return "ERROR_FORMAT_DIRECTIVE";
+  case HAPLO_ERROR_INVALID_UTF8:
+    return "ERROR_INVALID_UTF8";
+  case HAPLO_ERROR_IO:
+    return "ERROR_IO";
+  case HAPLO_ERROR_READ_ONLY:
+    return "ERROR_READ_ONLY";
+  case HAPLO_ERROR_JSON_SYNTAX:
+    return "ERROR_JSON_SYNTAX";
+  case HAPLO_ERROR_INVALID_ARGUMENT:
+    return "ERROR_INVALID_ARGUMENT";
+  case HAPLO_ERROR_OUT_OF_RANGE:
+    return "ERROR_OUT_OF_RANGE";
   }
   return "ERROR_UNKNOWN";
 }
@@ -38,6 +38,24 @@
 #define HAPLO_ERROR_VALUE_TYPE_UNRECOGNIZED          -25
 #define HAPLO_ERROR_PARSER_UNEXPECTED_TOKEN          -26
 #define HAPLO_ERROR_LEXER_NULL                       -27
+#define HAPLO_ERROR_POOL_NULL                        -28
+#define HAPLO_ERROR_OUT_OF_MEMORY                    -29
+#define HAPLO_ERROR_LIST_EMPTY                       -30
+#define HAPLO_ERROR_INDEX_OUT_OF_BOUNDS              -31
+#define HAPLO_ERROR_VALUE_CYCLE                      -32
+#define HAPLO_ERROR_KEY_NOT_FOUND                    -33
+#define HAPLO_ERROR_DIVISION_BY_ZERO                 -34
+#define HAPLO_ERROR_LENGTH_MISMATCH                  -35
+#define HAPLO_ERROR_EMPTY_PATTERN                    -36
+#define HAPLO_ERROR_REGEX_SYNTAX                     -37
+#define HAPLO_ERROR_REGEX_TOO_LARGE                  -38
+#define HAPLO_ERROR_FORMAT_DIRECTIVE                 -39
+#define HAPLO_ERROR_INVALID_UTF8                     -40
+#define HAPLO_ERROR_IO                               -41
+#define HAPLO_ERROR_READ_ONLY                        -42
+#define HAPLO_ERROR_JSON_SYNTAX                      -43
+#define HAPLO_ERROR_INVALID_ARGUMENT                 -44
+#define HAPLO_ERROR_OUT_OF_RANGE                     -45
 
 #ifdef HAPLO_NO_PREFIX
   #define error_string haplo_error_string
@@ -5,6 +5,7 @@
 
 #include "expr.h"
 #include "errors.h"
+#include "alloc.h"
 
 #include <string.h>
 #include <stdio.h>
@@ -22,7 +23,7 @@ void haplo_expr_free(HaploExpr *expr)
     haplo_expr_free(expr->head);
     haplo_expr_free(expr->tail);
   }
-  free(expr);
+  haplo_free(expr);
   return;
 }
 
@@ -61,7 +62,8 @@ HaploExpr *haplo_expr_deep_copy(HaploExpr *expr)
 {
   if (!expr) return NULL;
 
-  HaploExpr *new_expr = malloc(sizeof(HaploExpr));
+  HaploExpr *new_expr = haplo_calloc(1, sizeof(HaploExpr));
+  if (!new_expr) return NULL;
   new_expr->is_atom = expr->is_atom;
   if (expr->is_atom)
   {
@@ -76,9 +78,13 @@ HaploExpr *haplo_expr_deep_copy(HaploExpr *expr)
 
 int haplo_expr_depth(HaploExpr *expr)
 {
-  if (!expr) return 0;
-  if (expr->is_atom) return 0;
-  return 1 + haplo_expr_depth(expr->tail);
+  int depth = 0;
+  while (expr && !expr->is_atom)
+  {
+    depth++;
+    expr = expr->tail;
+  }
+  return depth;
 }
 
 void haplo_expr_string_rec(HaploExpr *expr, char *str)
@@ -0,0 +1,376 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "fmt.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// The decimal digits of 0 to 99, two by two
+static const char haplo_fmt_pairs[] =
+  "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+  "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+// Writes the digits of value so that they end at end
+static void haplo_fmt_digits(char *end, uint64_t value)
+{
+  while (value >= 100)
+  {
+    int pair = (int) (value % 100) * 2;
+    value /= 100;
+    *--end = haplo_fmt_pairs[pair + 1];
+    *--end = haplo_fmt_pairs[pair];
+  }
+  if (value >= 10)
+  {
+    *--end = haplo_fmt_pairs[value * 2 + 1];
+    *--end = haplo_fmt_pairs[value * 2];
+  }
+  else
+  {
+    *--end = (char) ('0' + value);
+  }
+}
+
+static int haplo_fmt_digit_count(uint64_t value)
+{
+  int digits = 1;
+  for (; value >= 10000; value /= 10000) digits += 4;
+  for (; value >= 10; value /= 10) digits++;
+  return digits;
+}
+
+int haplo_fmt_long(char buf[HAPLO_FMT_LONG_MAX], long value)
+{
+  uint64_t magnitude = (value < 0) ? 0 - (uint64_t) value : (uint64_t) value;
+  int len = haplo_fmt_digit_count(magnitude) + (value < 0);
+  if (value < 0) buf[0] = '-';
+  haplo_fmt_digits(buf + len, magnitude);
+  buf[len] = '\0';
+  return len;
+}
+
+//
+// Grisu2, after "Printing Floating-Point Numbers Quickly and
+// Accurately with Integers" by Florian Loitsch. The double is scaled
+// by a cached power of ten so that its digits can be generated with
+// 64 bit integers, between the boundaries of the values that read
+// back as it.
+//
+
+// f * 2^e
+typedef struct {
+  uint64_t f;
+  int e;
+} HaploFmtFp;
+
+// f * 2^e is about 10^k
+typedef struct {
+  uint64_t f;
+  int e;
+  int k;
+} HaploFmtPower;
+
+// The range of the binary exponent of the scaled numbers
+#define HAPLO_FMT_ALPHA -60
+#define HAPLO_FMT_GAMMA -32
+
+// The powers of ten from 10^-300 to 10^324, every 8
+static const HaploFmtPower haplo_fmt_powers[] = {
+  { 0xAB70FE17C79AC6CAULL, -1060, -300 },
+  { 0xFF77B1FCBEBCDC4FULL, -1034, -292 },
+  { 0xBE5691EF416BD60CULL, -1007, -284 },
+  { 0x8DD01FAD907FFC3CULL,  -980, -276 },
+  { 0xD3515C2831559A83ULL,  -954, -268 },
+  { 0x9D71AC8FADA6C9B5ULL,  -927, -260 },
+  { 0xEA9C227723EE8BCBULL,  -901, -252 },
+  { 0xAECC49914078536DULL,  -874, -244 },
+  { 0x823C12795DB6CE57ULL,  -847, -236 },
+  { 0xC21094364DFB5637ULL,  -821, -228 },
+  { 0x9096EA6F3848984FULL,  -794, -220 },
+  { 0xD77485CB25823AC7ULL,  -768, -212 },
+  { 0xA086CFCD97BF97F4ULL,  -741, -204 },
+  { 0xEF340A98172AACE5ULL,  -715, -196 },
+  { 0xB23867FB2A35B28EULL,  -688, -188 },
+  { 0x84C8D4DFD2C63F3BULL,  -661, -180 },
+  { 0xC5DD44271AD3CDBAULL,  -635, -172 },
+  { 0x936B9FCEBB25C996ULL,  -608, -164 },
+  { 0xDBAC6C247D62A584ULL,  -582, -156 },
+  { 0xA3AB66580D5FDAF6ULL,  -555, -148 },
+  { 0xF3E2F893DEC3F126ULL,  -529, -140 },
+  { 0xB5B5ADA8AAFF80B8ULL,  -502, -132 },
+  { 0x87625F056C7C4A8BULL,  -475, -124 },
+  { 0xC9BCFF6034C13053ULL,  -449, -116 },
+  { 0x964E858C91BA2655ULL,  -422, -108 },
+  { 0xDFF9772470297EBDULL,  -396, -100 },
+  { 0xA6DFBD9FB8E5B88FULL,  -369,  -92 },
+  { 0xF8A95FCF88747D94ULL,  -343,  -84 },
+  { 0xB94470938FA89BCFULL,  -316,  -76 },
+  { 0x8A08F0F8BF0F156BULL,  -289,  -68 },
+  { 0xCDB02555653131B6ULL,  -263,  -60 },
+  { 0x993FE2C6D07B7FACULL,  -236,  -52 },
+  { 0xE45C10C42A2B3B06ULL,  -210,  -44 },
+  { 0xAA242499697392D3ULL,  -183,  -36 },
+  { 0xFD87B5F28300CA0EULL,  -157,  -28 },
+  { 0xBCE5086492111AEBULL,  -130,  -20 },
+  { 0x8CBCCC096F5088CCULL,  -103,  -12 },
+  { 0xD1B71758E219652CULL,   -77,   -4 },
+  { 0x9C40000000000000ULL,   -50,    4 },
+  { 0xE8D4A51000000000ULL,   -24,   12 },
+  { 0xAD78EBC5AC620000ULL,     3,   20 },
+  { 0x813F3978F8940984ULL,    30,   28 },
+  { 0xC097CE7BC90715B3ULL,    56,   36 },
+  { 0x8F7E32CE7BEA5C70ULL,    83,   44 },
+  { 0xD5D238A4ABE98068ULL,   109,   52 },
+  { 0x9F4F2726179A2245ULL,   136,   60 },
+  { 0xED63A231D4C4FB27ULL,   162,   68 },
+  { 0xB0DE65388CC8ADA8ULL,   189,   76 },
+  { 0x83C7088E1AAB65DBULL,   216,   84 },
+  { 0xC45D1DF942711D9AULL,   242,   92 },
+  { 0x924D692CA61BE758ULL,   269,  100 },
+  { 0xDA01EE641A708DEAULL,   295,  108 },
+  { 0xA26DA3999AEF774AULL,   322,  116 },
+  { 0xF209787BB47D6B85ULL,   348,  124 },
+  { 0xB454E4A179DD1877ULL,   375,  132 },
+  { 0x865B86925B9BC5C2ULL,   402,  140 },
+  { 0xC83553C5C8965D3DULL,   428,  148 },
+  { 0x952AB45CFA97A0B3ULL,   455,  156 },
+  { 0xDE469FBD99A05FE3ULL,   481,  164 },
+  { 0xA59BC234DB398C25ULL,   508,  172 },
+  { 0xF6C69A72A3989F5CULL,   534,  180 },
+  { 0xB7DCBF5354E9BECEULL,   561,  188 },
+  { 0x88FCF317F22241E2ULL,   588,  196 },
+  { 0xCC20CE9BD35C78A5ULL,   614,  204 },
+  { 0x98165AF37B2153DFULL,   641,  212 },
+  { 0xE2A0B5DC971F303AULL,   667,  220 },
+  { 0xA8D9D1535CE3B396ULL,   694,  228 },
+  { 0xFB9B7CD9A4A7443CULL,   720,  236 },
+  { 0xBB764C4CA7A44410ULL,   747,  244 },
+  { 0x8BAB8EEFB6409C1AULL,   774,  252 },
+  { 0xD01FEF10A657842CULL,   800,  260 },
+  { 0x9B10A4E5E9913129ULL,   827,  268 },
+  { 0xE7109BFBA19C0C9DULL,   853,  276 },
+  { 0xAC2820D9623BF429ULL,   880,  284 },
+  { 0x80444B5E7AA7CF85ULL,   907,  292 },
+  { 0xBF21E44003ACDD2DULL,   933,  300 },
+  { 0x8E679C2F5E44FF8FULL,   960,  308 },
+  { 0xD433179D9C8CB841ULL,   986,  316 },
+  { 0x9E19DB92B4E31BA9ULL,  1013,  324 },
+};
+
+static HaploFmtFp haplo_fmt_sub(HaploFmtFp x, HaploFmtFp y)
+{
+  return (HaploFmtFp) { x.f - y.f, x.e };
+}
+
+// The product rounded to the upper 64 bits
+static HaploFmtFp haplo_fmt_mul(HaploFmtFp x, HaploFmtFp y)
+{
+  uint64_t x_lo = x.f & 0xffffffff, x_hi = x.f >> 32;
+  uint64_t y_lo = y.f & 0xffffffff, y_hi = y.f >> 32;
+  uint64_t p0 = x_lo * y_lo;
+  uint64_t p1 = x_lo * y_hi;
+  uint64_t p2 = x_hi * y_lo;
+  uint64_t p3 = x_hi * y_hi;
+  uint64_t middle = (p0 >> 32) + (p1 & 0xffffffff) + (p2 & 0xffffffff)
+    + ((uint64_t) 1 << 31);
+  return (HaploFmtFp) {
+    p3 + (p1 >> 32) + (p2 >> 32) + (middle >> 32),
+    x.e + y.e + 64,
+  };
+}
+
+static HaploFmtFp haplo_fmt_normalize(HaploFmtFp x)
+{
+  while ((x.f >> 63) == 0)
+  {
+    x.f <<= 1;
+    x.e--;
+  }
+  return x;
+}
+
+// Sets *minus and *plus to the boundaries of value, the midpoints to
+// its neighbours, with the exponent of the normalized *plus
+static HaploFmtFp haplo_fmt_boundaries(double value, HaploFmtFp *minus,
+                                       HaploFmtFp *plus)
+{
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  uint64_t fraction = bits & (((uint64_t) 1 << 52) - 1);
+  int exponent = (int) (bits >> 52) & 0x7ff;
+
+  HaploFmtFp v = (exponent == 0)
+    ? (HaploFmtFp) { fraction, 1 - 1075 }
+    : (HaploFmtFp) { fraction + ((uint64_t) 1 << 52), exponent - 1075 };
+  // The gap below a power of two is half the one above it
+  bool closer_below = fraction == 0 && exponent > 1;
+  *plus = haplo_fmt_normalize((HaploFmtFp) { 2 * v.f + 1, v.e - 1 });
+  *minus = closer_below ? (HaploFmtFp) { 4 * v.f - 1, v.e - 2 }
+                        : (HaploFmtFp) { 2 * v.f - 1, v.e - 1 };
+  minus->f <<= minus->e - plus->e;
+  minus->e = plus->e;
+  return haplo_fmt_normalize(v);
+}
+
+// Moves the last digit towards the value, while it stays between the
+// boundaries
+static void haplo_fmt_round(char *digits, int len, uint64_t dist, uint64_t delta,
+                            uint64_t rest, uint64_t ten_k)
+{
+  while (rest < dist && delta - rest >= ten_k
+         && (rest + ten_k < dist || dist - rest > rest + ten_k - dist))
+  {
+    digits[len - 1]--;
+    rest += ten_k;
+  }
+}
+
+// Writes the digits of the shortest number in (low, high) closest to
+// w, and sets *exponent so that they are the number times 10^exponent
+static int haplo_fmt_generate(char *digits, int *exponent, HaploFmtFp low,
+                              HaploFmtFp w, HaploFmtFp high)
+{
+  uint64_t delta = haplo_fmt_sub(high, low).f;
+  uint64_t dist = haplo_fmt_sub(high, w).f;
+  int shift = -high.e;
+  uint64_t one = (uint64_t) 1 << shift;
+  uint32_t integral = (uint32_t) (high.f >> shift);
+  uint64_t fractional = high.f & (one - 1);
+
+  int len = 0;
+  int n = haplo_fmt_digit_count(integral);
+  uint32_t pow10 = 1;
+  for (int i = 1; i < n; ++i) pow10 *= 10;
+  while (n > 0)
+  {
+    digits[len++] = (char) ('0' + integral / pow10);
+    integral %= pow10;
+    n--;
+    uint64_t rest = ((uint64_t) integral << shift) + fractional;
+    if (rest <= delta)
+    {
+      *exponent += n;
+      haplo_fmt_round(digits, len, dist, delta, rest, (uint64_t) pow10 << shift);
+      return len;
+    }
+    pow10 /= 10;
+  }
+
+  int m = 0;
+  while (true)
+  {
+    fractional *= 10;
+    digits[len++] = (char) ('0' + (fractional >> shift));
+    fractional &= one - 1;
+    m++;
+    delta *= 10;
+    dist *= 10;
+    if (fractional <= delta) break;
+  }
+  *exponent -= m;
+  haplo_fmt_round(digits, len, dist, delta, fractional, one);
+  return len;
+}
+
+// Writes the shortest digits of the positive finite value, and sets
+// *exponent so that they are value times 10^exponent
+static int haplo_fmt_grisu2(char *digits, int *exponent, double value)
+{
+  HaploFmtFp minus, plus;
+  HaploFmtFp v = haplo_fmt_boundaries(value, &minus, &plus);
+
+  // The cached power that brings the exponent of plus in the range
+  int e = HAPLO_FMT_ALPHA - plus.e - 1;
+  int k = (e * 78913) / (1 << 18) + (e > 0);
+  int index = (300 + k + 7) / 8;
+  HaploFmtFp power = { haplo_fmt_powers[index].f, haplo_fmt_powers[index].e };
+
+  HaploFmtFp w = haplo_fmt_mul(v, power);
+  HaploFmtFp low = haplo_fmt_mul(minus, power);
+  HaploFmtFp high = haplo_fmt_mul(plus, power);
+  // The products may be off by one, the boundaries are moved inward
+  low.f++;
+  high.f--;
+  *exponent = -haplo_fmt_powers[index].k;
+  return haplo_fmt_generate(digits, exponent, low, w, high);
+}
+
+int haplo_fmt_double(char buf[HAPLO_FMT_DOUBLE_MAX], double value)
+{
+  char *out = buf;
+  if (isnan(value))
+  {
+    memcpy(buf, "nan", 4);
+    return 3;
+  }
+  if (signbit(value)) *out++ = '-';
+  if (isinf(value))
+  {
+    memcpy(out, "inf", 4);
+    return (int) (out - buf) + 3;
+  }
+  if (value == 0.0)
+  {
+    memcpy(out, "0.0", 4);
+    return (int) (out - buf) + 3;
+  }
+
+  char digits[20];
+  int exponent;
+  int len = haplo_fmt_grisu2(digits, &exponent, fabs(value));
+  // The value is 0.digits times 10^point
+  int point = len + exponent;
+
+  if (point < -3 || point > 16)
+  {
+    *out++ = digits[0];
+    if (len > 1)
+    {
+      *out++ = '.';
+      memcpy(out, digits + 1, len - 1);
+      out += len - 1;
+    }
+    int power = point - 1;
+    *out++ = 'e';
+    *out++ = (power < 0) ? '-' : '+';
+    if (power < 0) power = -power;
+    int power_len = (power >= 100) ? 3 : 2;
+    haplo_fmt_digits(out + power_len, (uint64_t) power);
+    if (power < 10) out[0] = '0';
+    out += power_len;
+  }
+  else if (point <= 0)
+  {
+    *out++ = '0';
+    *out++ = '.';
+    memset(out, '0', -point);
+    out += -point;
+    memcpy(out, digits, len);
+    out += len;
+  }
+  else if (point < len)
+  {
+    memcpy(out, digits, point);
+    out += point;
+    *out++ = '.';
+    memcpy(out, digits + point, len - point);
+    out += len - point;
+  }
+  else
+  {
+    memcpy(out, digits, len);
+    out += len;
+    memset(out, '0', point - len);
+    out += point - len;
+    memcpy(out, ".0", 2);
+    out += 2;
+  }
+  *out = '\0';
+  return (int) (out - buf);
+}
@@ -0,0 +1,39 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#ifndef HAPLO_FMT_H
+#define HAPLO_FMT_H
+
+//
+// Macros
+//
+
+#ifdef HAPLO_NO_PREFIX
+  #define fmt_long haplo_fmt_long
+  #define fmt_double haplo_fmt_double
+#endif // HAPLO_NO_PREFIX
+
+// The size of the buffers of haplo_fmt_long and haplo_fmt_double,
+// with the NUL
+#define HAPLO_FMT_LONG_MAX 21
+#define HAPLO_FMT_DOUBLE_MAX 32
+
+//
+// Functions
+//
+
+// The formatters don't depend on the locale. They write a NUL after
+// the text and return its length.
+
+// Writes value in decimal
+int haplo_fmt_long(char buf[HAPLO_FMT_LONG_MAX], long value);
+// Writes a decimal that reads back as value, with the Grisu2
+// algorithm. It is the shortest one for all but about 0.2% of the
+// doubles, which get a digit more. Numbers from 1e-4 to 1e16 are
+// written with a decimal point, like 0.3 or 12.0, the others with an
+// exponent, like 1e+300. NaN and the infinities are nan, inf and -inf.
+int haplo_fmt_double(char buf[HAPLO_FMT_DOUBLE_MAX], double value);
+
+#endif // HAPLO_FMT_H
@@ -8,6 +8,10 @@
 
 #include "value.h"
 #include "interpreter.h"
+#include "arith.h"
+#include "iter.h"
+
+#include <stdbool.h>
 
 //
 // Types
@@ -15,6 +19,14 @@
 
 typedef struct {
   HaploValue (*run) (HaploInterpreter *interpreter, HaploValueList *args);
+  // The arithmetic builtins are also called by the interpreter with
+  // haplo_arith_fold, without building the list of the arguments
+  bool arith;
+  HaploArithOp arith_op;
+  // The sequence builtins are called by the interpreter with
+  // haplo_iter_run, so that the map and filter calls that build their
+  // sequence run in the same pass
+  HaploIterOp iter_op;
 } HaploFunction;
 
 #endif // HAPLO_FUNCTION_H
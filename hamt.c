@@ -0,0 +1,604 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "hamt.h"
+#include "errors.h"
+#include "utils.h"
+#include "alloc.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+#define HAPLO_HAMT_MASK ((1u << HAPLO_HAMT_BITS) - 1)
+
+// Returns the bit of the slot of hash in a node at depth shift
+static inline uint32_t haplo_hamt_bit(uint64_t hash, int shift)
+{
+  return 1u << ((hash >> shift) & HAPLO_HAMT_MASK);
+}
+
+// Returns the position of the slot bit among the slots set in map
+static inline int haplo_hamt_index(uint32_t map, uint32_t bit)
+{
+  return HAPLO_POPCOUNT64(map & (bit - 1));
+}
+
+static inline int haplo_hamt_entry_count(HaploHamtNode *node)
+{
+  return node->collisions ? node->collisions : HAPLO_POPCOUNT64(node->datamap);
+}
+
+static inline int haplo_hamt_child_count(HaploHamtNode *node)
+{
+  return HAPLO_POPCOUNT64(node->nodemap);
+}
+
+static inline HaploHamtEntry *haplo_hamt_entries(HaploHamtNode *node)
+{
+  return (HaploHamtEntry*) (node + 1);
+}
+
+static inline HaploHamtNode **haplo_hamt_children(HaploHamtNode *node)
+{
+  return (HaploHamtNode**) (haplo_hamt_entries(node)
+                            + haplo_hamt_entry_count(node));
+}
+
+// Returns a node with room for the given entries and children. The
+// maps must be set before the entries and children are accessed.
+static HaploHamtNode *haplo_hamt_node_alloc(int entries, int children)
+{
+  HaploHamtNode *node = haplo_alloc(sizeof(HaploHamtNode)
+                                    + entries * sizeof(HaploHamtEntry)
+                                    + children * sizeof(HaploHamtNode*));
+  if (UNLIKELY(!node)) return NULL;
+
+  node->datamap = 0;
+  node->nodemap = 0;
+  node->collisions = 0;
+  node->refcount = 1;
+  return node;
+}
+
+static HaploHamtNode *haplo_hamt_node_ref(HaploHamtNode *node)
+{
+  if (node) node->refcount++;
+  return node;
+}
+
+static void haplo_hamt_node_free(HaploHamtNode *node)
+{
+  if (!node || --node->refcount != 0) return;
+
+  HaploHamtEntry *entries = haplo_hamt_entries(node);
+  for (int i = 0; i < haplo_hamt_entry_count(node); ++i)
+  {
+    haplo_value_free(entries[i].key);
+    haplo_value_free(entries[i].value);
+  }
+  HaploHamtNode **children = haplo_hamt_children(node);
+  for (int i = 0; i < haplo_hamt_child_count(node); ++i)
+    haplo_hamt_node_free(children[i]);
+  haplo_free(node);
+  return;
+}
+
+static HaploHamtEntry haplo_hamt_entry_copy(HaploHamtEntry *entry)
+{
+  return (HaploHamtEntry) {
+    .hash = entry->hash,
+    .key = haplo_value_deep_copy(entry->key),
+    .value = haplo_value_deep_copy(entry->value),
+  };
+}
+
+static void haplo_hamt_entry_free(HaploHamtEntry *entry)
+{
+  haplo_value_free(entry->key);
+  haplo_value_free(entry->value);
+  return;
+}
+
+// Copies the entries of src to dst, skipping the one at skip and
+// leaving a hole at hole. Pass -1 to skip nothing or leave no hole.
+static void haplo_hamt_copy_entries(HaploHamtEntry *dst, HaploHamtEntry *src,
+                                    int count, int skip, int hole)
+{
+  int j = 0;
+  for (int i = 0; i < count; ++i)
+  {
+    if (i == skip) continue;
+    if (j == hole) j++;
+    dst[j++] = haplo_hamt_entry_copy(&src[i]);
+  }
+  return;
+}
+
+// Same as haplo_hamt_copy_entries, for children
+static void haplo_hamt_copy_children(HaploHamtNode **dst, HaploHamtNode **src,
+                                     int count, int skip, int hole)
+{
+  int j = 0;
+  for (int i = 0; i < count; ++i)
+  {
+    if (i == skip) continue;
+    if (j == hole) j++;
+    dst[j++] = haplo_hamt_node_ref(src[i]);
+  }
+  return;
+}
+
+// Returns a node holding the entries a and b, whose hashes are equal
+// up to shift. Takes ownership of the entries.
+static HaploHamtNode *haplo_hamt_node_merge(int shift, HaploHamtEntry a,
+                                            HaploHamtEntry b)
+{
+  HaploHamtNode *node;
+  if (shift >= 64)
+  {
+    node = haplo_hamt_node_alloc(2, 0);
+    if (UNLIKELY(!node)) goto out_of_memory;
+    node->collisions = 2;
+    haplo_hamt_entries(node)[0] = a;
+    haplo_hamt_entries(node)[1] = b;
+    return node;
+  }
+
+  uint32_t bit_a = haplo_hamt_bit(a.hash, shift);
+  uint32_t bit_b = haplo_hamt_bit(b.hash, shift);
+  if (bit_a == bit_b)
+  {
+    HaploHamtNode *child = haplo_hamt_node_merge(shift + HAPLO_HAMT_BITS, a, b);
+    if (UNLIKELY(!child)) return NULL;
+
+    node = haplo_hamt_node_alloc(0, 1);
+    if (UNLIKELY(!node))
+    {
+      haplo_hamt_node_free(child);
+      return NULL;
+    }
+    node->nodemap = bit_a;
+    haplo_hamt_children(node)[0] = child;
+    return node;
+  }
+
+  node = haplo_hamt_node_alloc(2, 0);
+  if (UNLIKELY(!node)) goto out_of_memory;
+  node->datamap = bit_a | bit_b;
+  haplo_hamt_entries(node)[bit_a < bit_b ? 0 : 1] = a;
+  haplo_hamt_entries(node)[bit_a < bit_b ? 1 : 0] = b;
+  return node;
+
+ out_of_memory:
+  haplo_hamt_entry_free(&a);
+  haplo_hamt_entry_free(&b);
+  return NULL;
+}
+
+// Returns a copy of node with entry, takes ownership of entry. Sets
+// added if the key was not in node.
+static HaploHamtNode *haplo_hamt_node_put(HaploHamtNode *node, int shift,
+                                          HaploHamtEntry entry, bool *added)
+{
+  HaploHamtNode *new_node;
+  HaploHamtEntry *entries = haplo_hamt_entries(node);
+  HaploHamtNode **children = haplo_hamt_children(node);
+  int entry_count = haplo_hamt_entry_count(node);
+  int child_count = haplo_hamt_child_count(node);
+
+  if (node->collisions)
+  {
+    int found = -1;
+    for (int i = 0; i < entry_count && found < 0; ++i)
+      if (haplo_value_equal(entries[i].key, entry.key)) found = i;
+
+    *added = (found < 0);
+    new_node = haplo_hamt_node_alloc(entry_count + *added, 0);
+    if (UNLIKELY(!new_node)) goto out_of_memory;
+    new_node->collisions = entry_count + *added;
+    haplo_hamt_copy_entries(haplo_hamt_entries(new_node), entries, entry_count,
+                            found, *added ? entry_count : found);
+    haplo_hamt_entries(new_node)[*added ? entry_count : found] = entry;
+    return new_node;
+  }
+
+  uint32_t bit = haplo_hamt_bit(entry.hash, shift);
+  int data_index = haplo_hamt_index(node->datamap, bit);
+  int child_index = haplo_hamt_index(node->nodemap, bit);
+
+  if (node->datamap & bit)
+  {
+    HaploHamtEntry *old = &entries[data_index];
+    if (old->hash == entry.hash && haplo_value_equal(old->key, entry.key))
+    {
+      // Same key, replace the value
+      *added = false;
+      new_node = haplo_hamt_node_alloc(entry_count, child_count);
+      if (UNLIKELY(!new_node)) goto out_of_memory;
+      new_node->datamap = node->datamap;
+      new_node->nodemap = node->nodemap;
+      haplo_hamt_copy_entries(haplo_hamt_entries(new_node), entries,
+                              entry_count, data_index, data_index);
+      haplo_hamt_entries(new_node)[data_index] = entry;
+      haplo_hamt_copy_children(haplo_hamt_children(new_node), children,
+                               child_count, -1, -1);
+      return new_node;
+    }
+
+    // Two keys in the same slot, push both down to a new child
+    *added = true;
+    HaploHamtNode *child = haplo_hamt_node_merge(shift + HAPLO_HAMT_BITS,
+                                                 haplo_hamt_entry_copy(old),
+                                                 entry);
+    if (UNLIKELY(!child)) return NULL;
+
+    new_node = haplo_hamt_node_alloc(entry_count - 1, child_count + 1);
+    if (UNLIKELY(!new_node))
+    {
+      haplo_hamt_node_free(child);
+      return NULL;
+    }
+    new_node->datamap = node->datamap & ~bit;
+    new_node->nodemap = node->nodemap | bit;
+    haplo_hamt_copy_entries(haplo_hamt_entries(new_node), entries,
+                            entry_count, data_index, -1);
+    haplo_hamt_copy_children(haplo_hamt_children(new_node), children,
+                             child_count, -1, child_index);
+    haplo_hamt_children(new_node)[child_index] = child;
+    return new_node;
+  }
+
+  if (node->nodemap & bit)
+  {
+    HaploHamtNode *child = haplo_hamt_node_put(children[child_index],
+                                               shift + HAPLO_HAMT_BITS,
+                                               entry, added);
+    if (UNLIKELY(!child)) return NULL;
+
+    new_node = haplo_hamt_node_alloc(entry_count, child_count);
+    if (UNLIKELY(!new_node))
+    {
+      haplo_hamt_node_free(child);
+      return NULL;
+    }
+    new_node->datamap = node->datamap;
+    new_node->nodemap = node->nodemap;
+    haplo_hamt_copy_entries(haplo_hamt_entries(new_node), entries,
+                            entry_count, -1, -1);
+    haplo_hamt_copy_children(haplo_hamt_children(new_node), children,
+                             child_count, child_index, child_index);
+    haplo_hamt_children(new_node)[child_index] = child;
+    return new_node;
+  }
+
+  // Free slot
+  *added = true;
+  new_node = haplo_hamt_node_alloc(entry_count + 1, child_count);
+  if (UNLIKELY(!new_node)) goto out_of_memory;
+  new_node->datamap = node->datamap | bit;
+  new_node->nodemap = node->nodemap;
+  haplo_hamt_copy_entries(haplo_hamt_entries(new_node), entries,
+                          entry_count, -1, data_index);
+  haplo_hamt_entries(new_node)[data_index] = entry;
+  haplo_hamt_copy_children(haplo_hamt_children(new_node), children,
+                           child_count, -1, -1);
+  return new_node;
+
+ out_of_memory:
+  haplo_hamt_entry_free(&entry);
+  return NULL;
+}
+
+// Returns a copy of node without key, or a new reference to node if
+// key is not there. Sets removed if the key was found.
+static HaploHamtNode *haplo_hamt_node_del(HaploHamtNode *node, int shift,
+                                          uint64_t hash, HaploValue key,
+                                          bool *removed)
+{
+  HaploHamtNode *new_node;
+  HaploHamtEntry *entries = haplo_hamt_entries(node);
+  HaploHamtNode **children = haplo_hamt_children(node);
+  int entry_count = haplo_hamt_entry_count(node);
+  int child_count = haplo_hamt_child_count(node);
+  *removed = false;
+
+  if (node->collisions)
+  {
+    int found = -1;
+    for (int i = 0; i < entry_count && found < 0; ++i)
+      if (haplo_value_equal(entries[i].key, key)) found = i;
+    if (found < 0) return haplo_hamt_node_ref(node);
+
+    *removed = true;
+    new_node = haplo_hamt_node_alloc(entry_count - 1, 0);
+    if (UNLIKELY(!new_node)) return NULL;
+    new_node->collisions = entry_count - 1;
+    haplo_hamt_copy_entries(haplo_hamt_entries(new_node), entries,
+                            entry_count, found, -1);
+    return new_node;
+  }
+
+  uint32_t bit = haplo_hamt_bit(hash, shift);
+  int data_index = haplo_hamt_index(node->datamap, bit);
+  int child_index = haplo_hamt_index(node->nodemap, bit);
+
+  if (node->datamap & bit)
+  {
+    HaploHamtEntry *old = &entries[data_index];
+    if (old->hash != hash || !haplo_value_equal(old->key, key))
+      return haplo_hamt_node_ref(node);
+
+    *removed = true;
+    new_node = haplo_hamt_node_alloc(entry_count - 1, child_count);
+    if (UNLIKELY(!new_node)) return NULL;
+    new_node->datamap = node->datamap & ~bit;
+    new_node->nodemap = node->nodemap;
+    haplo_hamt_copy_entries(haplo_hamt_entries(new_node), entries,
+                            entry_count, data_index, -1);
+    haplo_hamt_copy_children(haplo_hamt_children(new_node), children,
+                             child_count, -1, -1);
+    return new_node;
+  }
+
+  if (!(node->nodemap & bit))
+    return haplo_hamt_node_ref(node);
+
+  HaploHamtNode *child = haplo_hamt_node_del(children[child_index],
+                                             shift + HAPLO_HAMT_BITS,
+                                             hash, key, removed);
+  if (UNLIKELY(!child)) return NULL;
+  if (!*removed)
+  {
+    haplo_hamt_node_free(child);
+    return haplo_hamt_node_ref(node);
+  }
+
+  if (haplo_hamt_child_count(child) == 0 && haplo_hamt_entry_count(child) == 1)
+  {
+    // A child with a single entry is moved up, so that the shape of
+    // the trie does not depend on the order of the updates
+    new_node = haplo_hamt_node_alloc(entry_count + 1, child_count - 1);
+    if (UNLIKELY(!new_node))
+    {
+      haplo_hamt_node_free(child);
+      return NULL;
+    }
+    new_node->datamap = node->datamap | bit;
+    new_node->nodemap = node->nodemap & ~bit;
+    haplo_hamt_copy_entries(haplo_hamt_entries(new_node), entries,
+                            entry_count, -1, data_index);
+    haplo_hamt_entries(new_node)[data_index] =
+      haplo_hamt_entry_copy(&haplo_hamt_entries(child)[0]);
+    haplo_hamt_copy_children(haplo_hamt_children(new_node), children,
+                             child_count, child_index, -1);
+    haplo_hamt_node_free(child);
+    return new_node;
+  }
+
+  new_node = haplo_hamt_node_alloc(entry_count, child_count);
+  if (UNLIKELY(!new_node))
+  {
+    haplo_hamt_node_free(child);
+    return NULL;
+  }
+  new_node->datamap = node->datamap;
+  new_node->nodemap = node->nodemap;
+  haplo_hamt_copy_entries(haplo_hamt_entries(new_node), entries,
+                          entry_count, -1, -1);
+  haplo_hamt_copy_children(haplo_hamt_children(new_node), children,
+                           child_count, child_index, child_index);
+  haplo_hamt_children(new_node)[child_index] = child;
+  return new_node;
+}
+
+static bool haplo_hamt_node_foreach(HaploHamtNode *node,
+                                    HaploHamtForeachFunc func, void *ctx)
+{
+  HaploHamtEntry *entries = haplo_hamt_entries(node);
+  for (int i = 0; i < haplo_hamt_entry_count(node); ++i)
+    if (!func(&entries[i], ctx)) return false;
+
+  HaploHamtNode **children = haplo_hamt_children(node);
+  for (int i = 0; i < haplo_hamt_child_count(node); ++i)
+    if (!haplo_hamt_node_foreach(children[i], func, ctx)) return false;
+  return true;
+}
+
+// Returns a map with root and size, takes ownership of root
+static HaploHamt *haplo_hamt_with_root(HaploHamtNode *root, int size)
+{
+  HaploHamt *hamt = haplo_alloc(sizeof(HaploHamt));
+  if (UNLIKELY(!hamt))
+  {
+    haplo_hamt_node_free(root);
+    return NULL;
+  }
+
+  hamt->root = root;
+  hamt->size = size;
+  hamt->refcount = 1;
+  return hamt;
+}
+
+HaploHamt *haplo_hamt_new(void)
+{
+  return haplo_hamt_with_root(NULL, 0);
+}
+
+HaploHamt *haplo_hamt_ref(HaploHamt *hamt)
+{
+  if (hamt) hamt->refcount++;
+  return hamt;
+}
+
+void haplo_hamt_free(HaploHamt *hamt)
+{
+  if (!hamt || --hamt->refcount != 0) return;
+
+  haplo_hamt_node_free(hamt->root);
+  haplo_free(hamt);
+  return;
+}
+
+int haplo_hamt_size(HaploHamt *hamt)
+{
+  return hamt ? hamt->size : 0;
+}
+
+HaploValue *haplo_hamt_get(HaploHamt *hamt, HaploValue key)
+{
+  assert(hamt);
+  if (!haplo_value_hashable(key)) return NULL;
+
+  uint64_t hash = haplo_value_hash(key);
+  HaploHamtNode *node = hamt->root;
+  for (int shift = 0; node; shift += HAPLO_HAMT_BITS)
+  {
+    HaploHamtEntry *entries = haplo_hamt_entries(node);
+    if (node->collisions)
+    {
+      for (int i = 0; i < node->collisions; ++i)
+        if (haplo_value_equal(entries[i].key, key))
+          return &entries[i].value;
+      return NULL;
+    }
+
+    uint32_t bit = haplo_hamt_bit(hash, shift);
+    if (node->datamap & bit)
+    {
+      HaploHamtEntry *entry = &entries[haplo_hamt_index(node->datamap, bit)];
+      if (entry->hash == hash && haplo_value_equal(entry->key, key))
+        return &entry->value;
+      return NULL;
+    }
+    if (!(node->nodemap & bit)) return NULL;
+
+    node = haplo_hamt_children(node)[haplo_hamt_index(node->nodemap, bit)];
+  }
+  return NULL;
+}
+
+HaploHamt *haplo_hamt_put(HaploHamt *hamt, HaploValue key, HaploValue value)
+{
+  assert(hamt && haplo_value_hashable(key));
+
+  HaploHamtEntry entry = {
+    .hash = haplo_value_hash(key),
+    .key = key,
+    .value = value,
+  };
+
+  HaploHamtNode *root;
+  bool added = true;
+  if (!hamt->root)
+  {
+    root = haplo_hamt_node_alloc(1, 0);
+    if (UNLIKELY(!root))
+    {
+      haplo_hamt_entry_free(&entry);
+      return NULL;
+    }
+    root->datamap = haplo_hamt_bit(entry.hash, 0);
+    haplo_hamt_entries(root)[0] = entry;
+  }
+  else
+  {
+    root = haplo_hamt_node_put(hamt->root, 0, entry, &added);
+    if (UNLIKELY(!root)) return NULL;
+  }
+
+  return haplo_hamt_with_root(root, hamt->size + added);
+}
+
+HaploHamt *haplo_hamt_del(HaploHamt *hamt, HaploValue key)
+{
+  assert(hamt);
+  if (!hamt->root || !haplo_value_hashable(key))
+    return haplo_hamt_ref(hamt);
+
+  bool removed = false;
+  HaploHamtNode *root = haplo_hamt_node_del(hamt->root, 0,
+                                            haplo_value_hash(key), key,
+                                            &removed);
+  if (UNLIKELY(!root)) return NULL;
+  if (!removed)
+  {
+    haplo_hamt_node_free(root);
+    return haplo_hamt_ref(hamt);
+  }
+
+  if (haplo_hamt_entry_count(root) == 0 && haplo_hamt_child_count(root) == 0)
+  {
+    haplo_hamt_node_free(root);
+    root = NULL;
+  }
+  return haplo_hamt_with_root(root, hamt->size - 1);
+}
+
+bool haplo_hamt_foreach(HaploHamt *hamt, HaploHamtForeachFunc func, void *ctx)
+{
+  if (!hamt || !hamt->root) return true;
+  return haplo_hamt_node_foreach(hamt->root, func, ctx);
+}
+
+static bool haplo_hamt_keys_push(HaploHamtEntry *entry, void *ctx)
+{
+  HaploValueList **chain = ctx;
+  HaploValueList *new_chain =
+    haplo_value_list_push_front(haplo_value_deep_copy(entry->key), *chain);
+  if (UNLIKELY(new_chain == *chain)) return false;
+
+  *chain = new_chain;
+  return true;
+}
+
+HaploList *haplo_hamt_keys(HaploHamt *hamt)
+{
+  HaploValueList *chain = NULL;
+  if (!haplo_hamt_foreach(hamt, haplo_hamt_keys_push, &chain))
+  {
+    haplo_value_list_free(chain);
+    return NULL;
+  }
+  return haplo_list_new(chain);
+}
+
+typedef struct {
+  char *buf;
+  int buf_len;
+  int offset;
+} HaploHamtStringCtx;
+
+static bool haplo_hamt_string_entry(HaploHamtEntry *entry, void *ctx)
+{
+  HaploHamtStringCtx *str = ctx;
+  char *buf = str->buf;
+  int buf_len = str->buf_len;
+  int offset = str->offset;
+
+  offset += haplo_snprintf_clamp(haplo_value_string(entry->key, buf + offset,
+                                                    buf_len - offset),
+                                 buf_len - offset);
+  offset += haplo_snprintf_clamp(snprintf(buf + offset, buf_len - offset, "="),
+                                 buf_len - offset);
+  offset += haplo_snprintf_clamp(haplo_value_string(entry->value, buf + offset,
+                                                    buf_len - offset),
+                                 buf_len - offset);
+  offset += haplo_snprintf_clamp(snprintf(buf + offset, buf_len - offset, " "),
+                                 buf_len - offset);
+  str->offset = offset;
+  return offset < buf_len - 1;
+}
+
+int haplo_hamt_string(HaploHamt *hamt, char *buf, int buf_len)
+{
+  HaploHamtStringCtx str = {
+    .buf = buf,
+    .buf_len = buf_len,
+    .offset = haplo_snprintf_clamp(snprintf(buf, buf_len, "pmap: "), buf_len),
+  };
+  haplo_hamt_foreach(hamt, haplo_hamt_string_entry, &str);
+  return str.offset;
+}
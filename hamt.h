@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#ifndef HAPLO_HAMT_H
+#define HAPLO_HAMT_H
+
+#include "value.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//
+// Macros
+//
+
+#ifdef HAPLO_NO_PREFIX
+  #define Hamt HaploHamt
+  #define HamtNode HaploHamtNode
+  #define HamtEntry HaploHamtEntry
+  #define hamt_new haplo_hamt_new
+  #define hamt_ref haplo_hamt_ref
+  #define hamt_free haplo_hamt_free
+  #define hamt_size haplo_hamt_size
+  #define hamt_get haplo_hamt_get
+  #define hamt_put haplo_hamt_put
+  #define hamt_del haplo_hamt_del
+  #define hamt_foreach haplo_hamt_foreach
+  #define hamt_keys haplo_hamt_keys
+  #define hamt_string haplo_hamt_string
+#endif // HAPLO_NO_PREFIX
+
+// Number of hash bits consumed by each level of the trie
+#define HAPLO_HAMT_BITS 5
+
+//
+// Types
+//
+
+typedef struct {
+  uint64_t hash;
+  HaploValue key;
+  HaploValue value;
+} HaploHamtEntry;
+
+// A node of the trie. Each of the 32 slots of a node is empty, holds
+// an entry or holds a child node: datamap and nodemap have a bit set
+// for the slots holding entries and children. The node is followed by
+// its entries and then by the pointers to its children, both in slot
+// order. Nodes are immutable and shared between versions of a map.
+struct HaploHamtNode;
+typedef struct HaploHamtNode HaploHamtNode;
+struct HaploHamtNode {
+  uint32_t datamap;
+  uint32_t nodemap;
+  // Nodes past the last bits of the hash hold keys with the same
+  // hash, their entries are not indexed by datamap
+  int collisions;
+  unsigned int refcount;
+};
+
+// A persistent map. Updates return a new map sharing all the nodes
+// that did not change with the old one, which stays valid.
+struct HaploHamt {
+  HaploHamtNode *root;
+  int size;
+  unsigned int refcount;
+};
+
+// Called on each entry of a map
+typedef bool (*HaploHamtForeachFunc)(HaploHamtEntry *entry, void *ctx);
+
+//
+// Functions
+//
+
+// Returns an empty map, or NULL if out of memory
+HaploHamt *haplo_hamt_new(void);
+// Returns a new reference to hamt
+HaploHamt *haplo_hamt_ref(HaploHamt *hamt);
+// Drops a reference to hamt, nodes are freed when no version of the
+// map uses them anymore
+void haplo_hamt_free(HaploHamt *hamt);
+int haplo_hamt_size(HaploHamt *hamt);
+// Returns the value of key without copying it, or NULL if key is not
+// in hamt
+HaploValue *haplo_hamt_get(HaploHamt *hamt, HaploValue key);
+// Returns a new map where key has value, in O(log32 n). Takes
+// ownership of key and value, key must be hashable. Returns NULL if
+// out of memory.
+HaploHamt *haplo_hamt_put(HaploHamt *hamt, HaploValue key, HaploValue value);
+// Returns a new map without key, or NULL if out of memory
+HaploHamt *haplo_hamt_del(HaploHamt *hamt, HaploValue key);
+// Calls func on every entry of hamt until it returns false. Returns
+// false if func stopped the iteration.
+bool haplo_hamt_foreach(HaploHamt *hamt, HaploHamtForeachFunc func, void *ctx);
+// Returns a list with a copy of the keys of hamt, or NULL if out of
+// memory
+HaploList *haplo_hamt_keys(HaploHamt *hamt);
+// Returns the number of bytes written to buf. At most buf_len bytes
+// will be written.
+int haplo_hamt_string(HaploHamt *hamt, char *buf, int buf_len);
+
+#endif // HAPLO_HAMT_H
@@ -22,7 +22,7 @@ void process_line(Interpreter *interpreter, char* input, ssize_t len)
 {
   int err;
   Parser parser = {0};
-  err = parser_init(&parser, input, len);
+  err = parser_init(&parser, input, len, interpreter->allocator);
   if (err < 0)
   {
     fprintf(stderr, "Error %d after parser_init\n", err);
@@ -40,11 +40,13 @@ void process_line(Interpreter *interpreter, char* input, ssize_t len)
   }
 
   Value val = interpreter_interpret(interpreter, expr);
-  
-  char buf[1024] = {0};
-  
-  haplo_value_string(val, buf, 1024);
-  printf("%s\n", buf);
+
+  StringBuilder builder = {0};
+  if (string_builder_append_value(&builder, val) < 0)
+    fprintf(stderr, "Error out of memory printing the value\n");
+  else
+    printf("%.*s\n", builder.string->len, builder.string->buffer);
+  string_builder_free(&builder);
 
   haplo_value_free(val);
   expr_free(expr);
@@ -155,7 +157,7 @@ void interpret_cmdline(Interpreter *interpreter)
 int main(int argc, char** argv)
 { 
   Interpreter interpreter = {0};
-  interpreter_init(&interpreter);
+  interpreter_init(&interpreter, NULL);
 
   bool interactive = false;
   if (argc > 1)
@@ -178,11 +180,13 @@ int main(int argc, char** argv)
     }
     
     interpreter_destroy(&interpreter);
+    value_list_pool_release();
     return 0;
   }
 
   interpret_cmdline(&interpreter);
   
   interpreter_destroy(&interpreter);
+  value_list_pool_release();
   return 0;
 }
@@ -16,6 +16,24 @@
 #include "parser.h"
 #include "expr.h"
 #include "symbol.h"
+#include "vector.h"
+#include "map.h"
+#include "hamt.h"
+#include "set.h"
+#include "record.h"
+#include "array.h"
+#include "matrix.h"
+#include "bigint.h"
+#include "arith.h"
+#include "iter.h"
+#include "sort.h"
+#include "str.h"
+#include "regex.h"
+#include "fmt.h"
+#include "cpu.h"
+#include "utf8.h"
+#include "bytes.h"
+#include "json.h"
 #include "stdlib/stdlib.h"
 #include "interpreter.h"
 
@@ -5,6 +5,11 @@
 
 #include "errors.h"
 #include "symbol.h"
+#include "alloc.h"
+#include "utils.h"
+#include "arith.h"
+#include "iter.h"
+#include "map.h"
 #include "stdlib/stdlib.h"
 
 #include <stddef.h>
@@ -13,11 +18,25 @@
 #include <stdlib.h>
 #include <assert.h>
 
-int haplo_interpreter_init(HaploInterpreter *interpreter)
+int haplo_interpreter_init(HaploInterpreter *interpreter,
+                           HaploAllocator *allocator)
 {
   if (!interpreter) return HAPLO_ERROR_INTERPRETER_NULL;
 
+  interpreter->allocator = allocator ? allocator : &haplo_default_allocator;
+  interpreter->regex_cache = NULL;
+  int err = haplo_pool_init(&interpreter->list_pool, HAPLO_VALUE_LIST_POOL_CELL_SIZE,
+                            interpreter->allocator);
+  if (err < 0) return err;
+
+  HaploAllocator *prev = haplo_allocator_bind(interpreter->allocator);
   interpreter->symbol_map = haplo_symbol_map_deep_copy(&__haplo_std_symbol_map);
+  haplo_allocator_bind(prev);
+  if (!interpreter->symbol_map || interpreter->allocator->exhausted)
+  {
+    haplo_interpreter_destroy(interpreter);
+    return HAPLO_ERROR_OUT_OF_MEMORY;
+  }
   
   return 0;
 }
@@ -29,13 +48,32 @@ void haplo_interpreter_destroy(HaploInterpreter *interpreter)
   haplo_symbol_map_destroy(interpreter->symbol_map);
   if (interpreter->symbol_map)
   {
-    free(interpreter->symbol_map);
+    haplo_free(interpreter->symbol_map);
     interpreter->symbol_map = NULL;
   }
+  haplo_map_free(interpreter->regex_cache);
+  interpreter->regex_cache = NULL;
+
+  // Unbind the pool before releasing it
+  HaploPool *prev = haplo_value_list_pool_bind(NULL);
+  if (prev != &interpreter->list_pool)
+    haplo_value_list_pool_bind(prev);
+  haplo_pool_destroy(&interpreter->list_pool);
 
   return;
 }
 
+static HaploValue haplo_interpreter_interpret_rec(HaploInterpreter *interpreter,
+                                                 HaploExpr *expr);
+static HaploValueList *haplo_interpreter_interpret_tail_rec(HaploInterpreter *interpreter,
+                                                            HaploExpr *expr);
+static HaploValue haplo_interpreter_call_rec(HaploInterpreter *interpreter,
+                                             HaploValue value,
+                                             HaploValueList *args);
+static HaploValue haplo_interpreter_call_symbol(HaploInterpreter *interpreter,
+                                                HaploSymbol symbol,
+                                                HaploValueList *args);
+
 _Static_assert(_HAPLO_ATOM_MAX == 6,
               "updated HaploAtomType, update haplo_interpreter_eval_atom");
 HaploValue haplo_interpreter_eval_atom(HaploAtom atom)
@@ -43,11 +81,14 @@ HaploValue haplo_interpreter_eval_atom(HaploAtom atom)
   HaploValue new_value = {0};
   switch(atom.type)
   {
-  case HAPLO_ATOM_STRING: ;
-    char* new_string = (char*) malloc(strlen(atom.value.string)+1);
-    strcpy(new_string, atom.value.string);
+  case HAPLO_ATOM_STRING:
+    // Short strings are copied in the value, long ones are shared with
+    // the atom
+    if (atom.value.string->len <= HAPLO_VALUE_INLINE_MAX)
+      return haplo_value_text_new(HAPLO_VAL_STRING, atom.value.string->data,
+                                  atom.value.string->len);
     new_value.type = HAPLO_VAL_STRING;
-    new_value.value.string = new_string;
+    new_value.value.string = haplo_string_ref(atom.value.string);
     break;
   case HAPLO_ATOM_INTEGER:
     new_value.type = HAPLO_VAL_INTEGER;
@@ -61,18 +102,12 @@ HaploValue haplo_interpreter_eval_atom(HaploAtom atom)
     new_value.type = HAPLO_VAL_BOOL;
     new_value.value.boolean = atom.value.boolean;
     break;
-  case HAPLO_ATOM_SYMBOL: ;
-    char* new_symbol = (char*) malloc(strlen(atom.value.symbol)+1);
-    strcpy(new_symbol, atom.value.symbol);
-    new_value.type = HAPLO_VAL_SYMBOL;
-    new_value.value.symbol = new_symbol;
-    break;
-  case HAPLO_ATOM_QUOTE: ;
-    char* new_quote = (char*) malloc(strlen(atom.value.quote)+1);
-    strcpy(new_quote, atom.value.quote);
-    new_value.type = HAPLO_VAL_QUOTE;
-    new_value.value.quote = new_quote;
-    break;
+  case HAPLO_ATOM_SYMBOL:
+    return haplo_value_text_new(HAPLO_VAL_SYMBOL, atom.value.symbol,
+                                strlen(atom.value.symbol));
+  case HAPLO_ATOM_QUOTE:
+    return haplo_value_text_new(HAPLO_VAL_QUOTE, atom.value.quote,
+                                strlen(atom.value.quote));
   default:
     new_value.type = HAPLO_VAL_ERROR;
     new_value.value.error = HAPLO_ERROR_INTERPRETER_INVALID_ATOM;
@@ -81,6 +116,46 @@ HaploValue haplo_interpreter_eval_atom(HaploAtom atom)
   return new_value;
 }
 
+// The public entry points bind the allocator and the list pool of
+// the interpreter to the calling thread for the duration of the
+// evaluation. Returns true if they were already bound, that is if
+// the call is nested inside another evaluation.
+static bool haplo_interpreter_bind(HaploInterpreter *interpreter,
+                                   HaploAllocator **prev_allocator,
+                                   HaploPool **prev_pool)
+{
+  *prev_allocator = haplo_allocator_bind(interpreter->allocator);
+  *prev_pool = haplo_value_list_pool_bind(&interpreter->list_pool);
+
+  bool nested = (*prev_pool == &interpreter->list_pool);
+  if (!nested) interpreter->allocator->exhausted = false;
+  return nested;
+}
+
+static void haplo_interpreter_unbind(HaploAllocator *prev_allocator,
+                                     HaploPool *prev_pool)
+{
+  haplo_allocator_bind(prev_allocator);
+  haplo_value_list_pool_bind(prev_pool);
+  return;
+}
+
+// If the allocator ran out of memory or exceeded its quota during a
+// top level evaluation, the result is replaced with an error
+static HaploValue haplo_interpreter_check_memory(HaploInterpreter *interpreter,
+                                                 HaploValue value,
+                                                 bool nested)
+{
+  if (LIKELY(nested || !interpreter->allocator->exhausted)) return value;
+
+  interpreter->allocator->exhausted = false;
+  haplo_value_free(value);
+  return (HaploValue) {
+    .type = HAPLO_VAL_ERROR,
+    .value.error = HAPLO_ERROR_OUT_OF_MEMORY,
+  };
+}
+
 HaploValue haplo_interpreter_interpret(HaploInterpreter *interpreter,
                                        HaploExpr *expr)
 {
@@ -91,6 +166,751 @@ HaploValue haplo_interpreter_interpret(HaploInterpreter *interpreter,
       .value.error = HAPLO_ERROR_INTERPRETER_NULL,
     };
   }
+
+  HaploAllocator *prev_allocator;
+  HaploPool *prev_pool;
+  bool nested = haplo_interpreter_bind(interpreter, &prev_allocator, &prev_pool);
+  HaploValue out = haplo_interpreter_interpret_rec(interpreter, expr);
+  out = haplo_interpreter_check_memory(interpreter, out, nested);
+  haplo_interpreter_unbind(prev_allocator, prev_pool);
+  return out;
+}
+
+HaploValueList *haplo_interpreter_interpret_tail(HaploInterpreter *interpreter,
+                                                 HaploExpr *expr)
+{
+  if (!interpreter) return NULL;
+
+  HaploAllocator *prev_allocator;
+  HaploPool *prev_pool;
+  haplo_interpreter_bind(interpreter, &prev_allocator, &prev_pool);
+  HaploValueList *out = haplo_interpreter_interpret_tail_rec(interpreter, expr);
+  haplo_interpreter_unbind(prev_allocator, prev_pool);
+  return out;
+}
+
+// Should not free args here
+HaploValue haplo_interpreter_call(HaploInterpreter *interpreter,
+                                  HaploValue value,
+                                  HaploValueList* args)
+{
+  if (!interpreter)
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_ERROR,
+      .value.error = HAPLO_ERROR_INTERPRETER_NULL,
+    };
+  }
+
+  HaploAllocator *prev_allocator;
+  HaploPool *prev_pool;
+  bool nested = haplo_interpreter_bind(interpreter, &prev_allocator, &prev_pool);
+  HaploValue out = haplo_interpreter_call_rec(interpreter, value, args);
+  out = haplo_interpreter_check_memory(interpreter, out, nested);
+  haplo_interpreter_unbind(prev_allocator, prev_pool);
+  return out;
+}
+
+HaploValue haplo_interpreter_apply(HaploInterpreter *interpreter,
+                                   HaploValue function,
+                                   const HaploValue *args, int count)
+{
+  if (function.type == HAPLO_VAL_ERROR) return function;
+  if (function.type != HAPLO_VAL_QUOTE && function.type != HAPLO_VAL_SYMBOL)
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_ERROR,
+      .value.error = HAPLO_ERROR_INTERPRETER_INVALID_TYPE,
+    };
+  }
+  if (!interpreter)
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_ERROR,
+      .value.error = HAPLO_ERROR_INTERPRETER_NULL,
+    };
+  }
+
+  const char *name = haplo_value_text(&function);
+  HaploSymbol symbol;
+  if (haplo_symbol_map_lookup(interpreter->symbol_map, name, &symbol) < 0)
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_ERROR,
+      .value.error = HAPLO_ERROR_INTERPRETER_UNKNOWN_SYMBOL,
+    };
+  }
+  if (symbol.type == HAPLO_SYMBOL_C_FUNCTION && symbol.c_func.arith)
+    return haplo_arith_fold(symbol.c_func.arith_op, args, count);
+
+  HaploAllocator *prev_allocator;
+  HaploPool *prev_pool;
+  bool nested = haplo_interpreter_bind(interpreter, &prev_allocator, &prev_pool);
+
+  HaploValueList *list = NULL;
+  for (int i = count - 1; i >= 0; --i)
+    list = haplo_value_list_push_front(haplo_value_deep_copy(args[i]), list);
+
+  HaploValue out = haplo_interpreter_call_symbol(interpreter, symbol, list);
+  haplo_value_list_free(list);
+  out = haplo_interpreter_check_memory(interpreter, out, nested);
+  haplo_interpreter_unbind(prev_allocator, prev_pool);
+  return out;
+}
+
+// Reads the names of the quoted atoms in the first count expressions
+// of args, the names after the first must be different. Returns a new
+// array, or NULL and sets *err.
+static const char **haplo_interpreter_quoted_names(HaploExpr *args, int count,
+                                                   int *err)
+{
+  const char **names = haplo_alloc((count > 0 ? count : 1) * sizeof(char*));
+  if (UNLIKELY(!names))
+  {
+    *err = HAPLO_ERROR_OUT_OF_MEMORY;
+    return NULL;
+  }
+
+  for (int i = 0; i < count; ++i, args = args->tail)
+  {
+    if (!args->head->is_atom || args->head->atom.type != HAPLO_ATOM_QUOTE)
+    {
+      *err = HAPLO_ERROR_INTERPRETER_INVALID_TYPE;
+      haplo_free(names);
+      return NULL;
+    }
+    names[i] = args->head->atom.value.quote;
+    for (int j = 1; j < i; ++j)
+    {
+      if (strcmp(names[i], names[j]) == 0)
+      {
+        *err = HAPLO_ERROR_INTERPRETER_INVALID_TYPE;
+        haplo_free(names);
+        return NULL;
+      }
+    }
+  }
+  return names;
+}
+
+// Function definition. "(defunc 'FUNCTION_NAME 'PARAMETER ... (FUNCTION_BODY))"
+// The names of the parameters are kept in a shape
+static HaploValue haplo_interpreter_defunc(HaploInterpreter *interpreter,
+                                           HaploExpr *args)
+{
+  int arg_count = haplo_expr_depth(args);
+  if (arg_count < 2)
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_ERROR,
+      .value.error = HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS,
+    };
+  }
+
+  int err = 0;
+  const char **names = haplo_interpreter_quoted_names(args, arg_count - 1, &err);
+  if (!names)
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_ERROR,
+      .value.error = err,
+    };
+  }
+
+  HaploExpr *func_body = args;
+  while (func_body->tail) func_body = func_body->tail;
+
+  HaploSymbol new_function = {
+    .type = HAPLO_SYMBOL_FUNCTION,
+    .func = func_body->head,
+  };
+  if (arg_count > 2)
+  {
+    new_function.shape = haplo_shape_new(names[0], names + 1, arg_count - 2);
+    if (UNLIKELY(!new_function.shape)) err = HAPLO_ERROR_OUT_OF_MEMORY;
+  }
+
+  // Register function
+  if (err == 0)
+    err = haplo_symbol_map_update(interpreter->symbol_map, (char*) names[0],
+                                  new_function);
+  haplo_shape_free(new_function.shape);
+  haplo_free(names);
+  if (err < 0)
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_ERROR,
+      .value.error = err,
+    };
+  }
+
+  return (HaploValue) {
+    .type = HAPLO_VAL_EMPTY,
+  };
+}
+
+// A symbol shadowed by a parameter or by the variable of a loop. The
+// symbol is moved out of the map, not copied, so a function that is
+// running keeps its body.
+typedef struct {
+  char *name;
+  bool shadowed;
+  HaploSymbol symbol;
+} HaploInterpreterBinding;
+
+// Binds name to a copy of value until haplo_interpreter_unbind
+static int haplo_interpreter_bind_variable(HaploInterpreter *interpreter,
+                                           char *name, HaploValue value,
+                                           HaploInterpreterBinding *binding)
+{
+  binding->name = name;
+  binding->symbol = (HaploSymbol) {
+    .type = HAPLO_SYMBOL_VARIABLE,
+    .var = haplo_value_deep_copy(value),
+  };
+  int err = haplo_symbol_map_exchange(interpreter->symbol_map, name,
+                                      &binding->symbol);
+  if (err < 0)
+  {
+    haplo_symbol_free(binding->symbol);
+    binding->shadowed = false;
+    binding->name = NULL;
+    return err;
+  }
+  binding->shadowed = (err == 1);
+  return 0;
+}
+
+// Updates the variable of a binding, the symbol it shadows is kept
+static int haplo_interpreter_rebind_variable(HaploInterpreter *interpreter,
+                                             HaploInterpreterBinding *binding,
+                                             HaploValue value)
+{
+  HaploSymbol symbol = {
+    .type = HAPLO_SYMBOL_VARIABLE,
+    .var = value,
+  };
+  return haplo_symbol_map_update(interpreter->symbol_map, binding->name, symbol);
+}
+
+// Restores the symbol shadowed by binding
+static void haplo_interpreter_unbind_variable(HaploInterpreter *interpreter,
+                                              HaploInterpreterBinding *binding)
+{
+  if (!binding->name) return;
+
+  if (!binding->shadowed)
+  {
+    haplo_symbol_map_delete(interpreter->symbol_map, binding->name);
+    return;
+  }
+  haplo_symbol_map_exchange(interpreter->symbol_map, binding->name,
+                            &binding->symbol);
+  haplo_symbol_free(binding->symbol);
+  return;
+}
+
+// Returns the operation of the sequence builtin called by expr with
+// the right number of arguments, or HAPLO_ITER_OP_NONE. The arguments
+// before the sequence must not be bare symbols, which would take the
+// rest of the arguments.
+static HaploIterOp haplo_interpreter_iter_op(HaploInterpreter *interpreter,
+                                             HaploExpr *expr)
+{
+  if (expr->is_atom || !expr->head || !expr->head->is_atom
+      || expr->head->atom.type != HAPLO_ATOM_SYMBOL)
+    return HAPLO_ITER_OP_NONE;
+
+  int count = 0;
+  for (HaploExpr *arg = expr->tail; arg; arg = arg->tail, ++count)
+    if (arg->tail && arg->head->is_atom
+        && arg->head->atom.type == HAPLO_ATOM_SYMBOL)
+      return HAPLO_ITER_OP_NONE;
+
+  HaploSymbol symbol;
+  if (haplo_symbol_map_lookup(interpreter->symbol_map,
+                              expr->head->atom.value.symbol, &symbol) < 0
+      || symbol.type != HAPLO_SYMBOL_C_FUNCTION)
+    return HAPLO_ITER_OP_NONE;
+
+  HaploIterOp op = symbol.c_func.iter_op;
+  int expected = (op == HAPLO_ITER_OP_FOLD) ? 3 : 2;
+  return (count == expected) ? op : HAPLO_ITER_OP_NONE;
+}
+
+// Returns the operation of the sequence builtin called by expr if its
+// last argument is a call to mapcar or filter, that can run in the
+// same pass, or else HAPLO_ITER_OP_NONE
+static HaploIterOp haplo_interpreter_fused_op(HaploInterpreter *interpreter,
+                                              HaploExpr *expr)
+{
+  HaploExpr *last = expr->tail;
+  if (!last) return HAPLO_ITER_OP_NONE;
+  while (last->tail) last = last->tail;
+
+  HaploIterOp op = haplo_interpreter_iter_op(interpreter, last->head);
+  if (op != HAPLO_ITER_OP_MAP && op != HAPLO_ITER_OP_FILTER)
+    return HAPLO_ITER_OP_NONE;
+  return haplo_interpreter_iter_op(interpreter, expr);
+}
+
+// Returns a new iterator over the values of the sequence built by
+// expr, or NULL and sets *err. The calls to mapcar and filter are not
+// run, they become the stages of the iterator, so no intermediate
+// sequence is stored. Sets *kind to the type of the sequence that
+// feeds the iterator.
+static HaploIter *haplo_interpreter_sequence(HaploInterpreter *interpreter,
+                                             HaploExpr *expr,
+                                             HaploValueType *kind, int *err)
+{
+  HaploIterOp op = haplo_interpreter_iter_op(interpreter, expr);
+  if (op == HAPLO_ITER_OP_MAP || op == HAPLO_ITER_OP_FILTER)
+  {
+    HaploValue function = haplo_interpreter_interpret_rec(interpreter,
+                                                          expr->tail->head);
+    if (function.type != HAPLO_VAL_QUOTE && function.type != HAPLO_VAL_SYMBOL)
+    {
+      *err = (function.type == HAPLO_VAL_ERROR)
+        ? function.value.error : HAPLO_ERROR_INTERPRETER_INVALID_TYPE;
+      haplo_value_free(function);
+      return NULL;
+    }
+
+    HaploIter *source = haplo_interpreter_sequence(interpreter,
+                                                   expr->tail->tail->head,
+                                                   kind, err);
+    HaploIter *iter = NULL;
+    if (source)
+    {
+      iter = (op == HAPLO_ITER_OP_MAP) ? haplo_iter_map(function, source)
+                                       : haplo_iter_filter(function, source);
+      if (UNLIKELY(!iter)) *err = HAPLO_ERROR_OUT_OF_MEMORY;
+    }
+    haplo_iter_free(source);
+    haplo_value_free(function);
+    return iter;
+  }
+
+  HaploValue value = haplo_interpreter_interpret_rec(interpreter, expr);
+  *kind = value.type;
+  HaploIter *iter = haplo_iter_from_sequence(value, err);
+  haplo_value_free(value);
+  return iter;
+}
+
+// Runs a sequence builtin whose sequence is built by mapcar or
+// filter in a single pass, see haplo_interpreter_fused_op
+static HaploValue haplo_interpreter_call_iter(HaploInterpreter *interpreter,
+                                              HaploIterOp op,
+                                              HaploExpr *args)
+{
+  HaploValue function = haplo_interpreter_interpret_rec(interpreter, args->head);
+  HaploValue init = { .type = HAPLO_VAL_EMPTY };
+  args = args->tail;
+  if (op == HAPLO_ITER_OP_FOLD)
+  {
+    init = haplo_interpreter_interpret_rec(interpreter, args->head);
+    args = args->tail;
+  }
+
+  HaploValue out = function;
+  if (function.type != HAPLO_VAL_ERROR && init.type == HAPLO_VAL_ERROR)
+    out = init;
+  if (out.type != HAPLO_VAL_ERROR)
+  {
+    HaploValueType kind;
+    int err = 0;
+    HaploIter *source = haplo_interpreter_sequence(interpreter, args->head,
+                                                   &kind, &err);
+    out = source
+      ? haplo_iter_run(op, interpreter, function, init, source, kind)
+      : (HaploValue) { .type = HAPLO_VAL_ERROR, .value.error = err };
+    haplo_iter_free(source);
+  }
+
+  haplo_value_free(function);
+  haplo_value_free(init);
+  return out;
+}
+
+// Loop over a sequence. "(for-each 'NAME SEQUENCE (BODY))"
+// Evaluates BODY with NAME bound to each value of SEQUENCE, an
+// iterator, a list, a vector or an array. The values are produced
+// one at a time, a range is never stored in memory.
+static HaploValue haplo_interpreter_for_each(HaploInterpreter *interpreter,
+                                             HaploExpr *args)
+{
+  if (haplo_expr_depth(args) != 3)
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_ERROR,
+      .value.error = HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS,
+    };
+  }
+  HaploExpr *name = args->head;
+  HaploExpr *body = args->tail->tail->head;
+  if (!name->is_atom || name->atom.type != HAPLO_ATOM_QUOTE)
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_ERROR,
+      .value.error = HAPLO_ERROR_INTERPRETER_INVALID_TYPE,
+    };
+  }
+
+  HaploValueType kind;
+  int err = 0;
+  HaploIter *iter = haplo_interpreter_sequence(interpreter, args->tail->head,
+                                               &kind, &err);
+  if (!iter)
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_ERROR,
+      .value.error = err,
+    };
+  }
+
+  HaploIterCursor stack_cursors[HAPLO_ITER_STACK_DEPTH];
+  HaploIterCursor *cursors = stack_cursors;
+  if (iter->depth > HAPLO_ITER_STACK_DEPTH)
+  {
+    cursors = haplo_alloc(iter->depth * sizeof(HaploIterCursor));
+    if (UNLIKELY(!cursors))
+    {
+      haplo_iter_free(iter);
+      return (HaploValue) {
+        .type = HAPLO_VAL_ERROR,
+        .value.error = HAPLO_ERROR_OUT_OF_MEMORY,
+      };
+    }
+  }
+  haplo_iter_begin(iter, cursors);
+
+  HaploInterpreterBinding binding;
+  HaploValue value = { .type = HAPLO_VAL_EMPTY };
+  err = haplo_interpreter_bind_variable(interpreter, name->atom.value.quote,
+                                        value, &binding);
+  while (err == 0 && (err = haplo_iter_next(cursors, interpreter, &value)) > 0)
+  {
+    err = haplo_interpreter_rebind_variable(interpreter, &binding, value);
+    haplo_value_free(value);
+    if (err < 0) break;
+
+    HaploValue result = haplo_interpreter_interpret_rec(interpreter, body);
+    haplo_value_free(result); // Ignore the return value
+    err = interpreter->allocator->exhausted ? HAPLO_ERROR_OUT_OF_MEMORY : 0;
+  }
+  haplo_interpreter_unbind_variable(interpreter, &binding);
+
+  if (cursors != stack_cursors) haplo_free(cursors);
+  haplo_iter_free(iter);
+  if (err < 0)
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_ERROR,
+      .value.error = err,
+    };
+  }
+  return (HaploValue) {
+    .type = HAPLO_VAL_EMPTY,
+  };
+}
+
+// Calls to functions with more parameters allocate their bindings
+#define HAPLO_INTERPRETER_STACK_PARAMS 8
+
+// Runs a function defined with defunc. Its parameters are bound to
+// the values of args while the body runs, functions without
+// parameters ignore args.
+static HaploValue haplo_interpreter_call_function(HaploInterpreter *interpreter,
+                                                  HaploSymbol symbol,
+                                                  HaploValueList *args)
+{
+  HaploShape *params = symbol.shape;
+  if (!params)
+    return haplo_interpreter_interpret_rec(interpreter, symbol.func);
+
+  if (haplo_value_list_len(args) != params->field_count)
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_ERROR,
+      .value.error = HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS,
+    };
+  }
+
+  HaploInterpreterBinding stack_bindings[HAPLO_INTERPRETER_STACK_PARAMS];
+  HaploInterpreterBinding *bindings = stack_bindings;
+  if (params->field_count > HAPLO_INTERPRETER_STACK_PARAMS)
+  {
+    bindings = haplo_alloc(params->field_count * sizeof(HaploInterpreterBinding));
+    if (UNLIKELY(!bindings))
+    {
+      return (HaploValue) {
+        .type = HAPLO_VAL_ERROR,
+        .value.error = HAPLO_ERROR_OUT_OF_MEMORY,
+      };
+    }
+  }
+
+  // The names must outlive the bindings, even if the function is
+  // defined again while it runs
+  haplo_shape_ref(params);
+  HaploValue out = { .type = HAPLO_VAL_EMPTY };
+  int bound = 0, err = 0;
+  for (; bound < params->field_count && err == 0; ++bound, args = args->next)
+    err = haplo_interpreter_bind_variable(interpreter, params->fields[bound],
+                                          args->val, &bindings[bound]);
+  if (err == 0)
+    out = haplo_interpreter_interpret_rec(interpreter, symbol.func);
+  else
+    out = (HaploValue) {
+      .type = HAPLO_VAL_ERROR,
+      .value.error = err,
+    };
+
+  while (bound-- > 0)
+    haplo_interpreter_unbind_variable(interpreter, &bindings[bound]);
+  haplo_shape_free(params);
+  if (bindings != stack_bindings) haplo_free(bindings);
+  return out;
+}
+
+// Registers symbol_type as "PREFIXNAME", or as "PREFIXNAME-FIELD" for
+// the accessors of slot. Returns 0 or a negative error.
+static int haplo_interpreter_register_record(HaploInterpreter *interpreter,
+                                             const char *prefix,
+                                             HaploShape *shape,
+                                             HaploSymbolType symbol_type,
+                                             int slot)
+{
+  const char *field = (slot >= 0) ? shape->fields[slot] : NULL;
+  size_t name_len = strlen(prefix) + strlen(shape->name)
+    + (field ? strlen(field) + 1 : 0) + 1;
+  char *name = haplo_alloc(name_len);
+  if (UNLIKELY(!name)) return HAPLO_ERROR_OUT_OF_MEMORY;
+
+  if (field)
+    snprintf(name, name_len, "%s%s-%s", prefix, shape->name, field);
+  else
+    snprintf(name, name_len, "%s%s", prefix, shape->name);
+
+  HaploSymbol symbol = {
+    .type = symbol_type,
+    .shape = shape,
+    .slot = slot,
+  };
+  int err = haplo_symbol_map_update(interpreter->symbol_map, name, symbol);
+  haplo_free(name);
+  return (err < 0) ? err : 0;
+}
+
+// Record definition. "(defrecord 'NAME 'FIELD ...)"
+// Declares the shape NAME and registers its constructor "NAME", and
+// the accessors "NAME-FIELD" and "set-NAME-FIELD" for each field. The
+// slot of each field is resolved here, so accessing it does not look
+// up the field name.
+static HaploValue haplo_interpreter_defrecord(HaploInterpreter *interpreter,
+                                              HaploExpr *args)
+{
+  int arg_count = haplo_expr_depth(args);
+  if (arg_count < 1)
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_ERROR,
+      .value.error = HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS,
+    };
+  }
+
+  int err = 0;
+  HaploShape *shape = NULL;
+  const char **names = haplo_interpreter_quoted_names(args, arg_count, &err);
+  if (!names)
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_ERROR,
+      .value.error = err,
+    };
+  }
+
+  shape = haplo_shape_new(names[0], names + 1, arg_count - 1);
+  if (UNLIKELY(!shape))
+  {
+    err = HAPLO_ERROR_OUT_OF_MEMORY;
+    goto done;
+  }
+
+  err = haplo_interpreter_register_record(interpreter, "", shape,
+                                          HAPLO_SYMBOL_RECORD_NEW, -1);
+  for (int slot = 0; err == 0 && slot < shape->field_count; ++slot)
+  {
+    err = haplo_interpreter_register_record(interpreter, "", shape,
+                                            HAPLO_SYMBOL_RECORD_GET, slot);
+    if (err == 0)
+      err = haplo_interpreter_register_record(interpreter, "set-", shape,
+                                              HAPLO_SYMBOL_RECORD_SET, slot);
+  }
+
+ done:
+  // The symbols hold their own references
+  haplo_shape_free(shape);
+  haplo_free(names);
+  if (err < 0)
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_ERROR,
+      .value.error = err,
+    };
+  }
+  return (HaploValue) {
+    .type = HAPLO_VAL_EMPTY,
+  };
+}
+
+_Static_assert(_HAPLO_SYMBOL_MAX == 6,
+              "Updated HaploSymbolType, maybe should update haplo_interpreter_call_record");
+// Runs the constructor or an accessor of a record
+static HaploValue haplo_interpreter_call_record(HaploSymbol symbol,
+                                                HaploValueList *args)
+{
+  int arg_count = haplo_value_list_len(args);
+  int err = 0;
+  for (HaploValueList *this = args; this; this = this->next)
+    if (this->val.type == HAPLO_VAL_ERROR) return this->val;
+
+  switch(symbol.type)
+  {
+  case HAPLO_SYMBOL_RECORD_NEW: ;
+    // NAME VALUE ...
+    if (arg_count != symbol.shape->field_count)
+    {
+      err = HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS;
+      break;
+    }
+    HaploRecord *record = haplo_record_new(symbol.shape);
+    if (UNLIKELY(!record))
+    {
+      err = HAPLO_ERROR_OUT_OF_MEMORY;
+      break;
+    }
+    for (int i = 0; i < arg_count; ++i, args = args->next)
+      record->slots[i] = haplo_value_deep_copy(args->val);
+    return (HaploValue) {
+      .type = HAPLO_VAL_RECORD,
+      .value.record = record,
+    };
+  case HAPLO_SYMBOL_RECORD_GET:
+    // NAME-FIELD RECORD
+    if (arg_count != 1)
+    {
+      err = HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS;
+      break;
+    }
+    if (args->val.type != HAPLO_VAL_RECORD
+        || args->val.value.record->shape != symbol.shape)
+    {
+      err = HAPLO_ERROR_INTERPRETER_INVALID_TYPE;
+      break;
+    }
+    return haplo_value_deep_copy(args->val.value.record->slots[symbol.slot]);
+  case HAPLO_SYMBOL_RECORD_SET: ;
+    // set-NAME-FIELD VALUE RECORD, writes the field in place
+    if (arg_count != 2)
+    {
+      err = HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS;
+      break;
+    }
+    HaploValue value = args->val;
+    HaploValue target = args->next->val;
+    if (target.type != HAPLO_VAL_RECORD
+        || target.value.record->shape != symbol.shape)
+    {
+      err = HAPLO_ERROR_INTERPRETER_INVALID_TYPE;
+      break;
+    }
+    if (haplo_value_contains(value, target.value.record))
+    {
+      err = HAPLO_ERROR_VALUE_CYCLE;
+      break;
+    }
+    HaploValue *slot = &target.value.record->slots[symbol.slot];
+    haplo_value_free(*slot);
+    *slot = haplo_value_deep_copy(value);
+    return haplo_value_deep_copy(target);
+  default:
+    err = HAPLO_ERROR_INTERPRETER_UNKNOWN_SYMBOL_TYPE;
+    break;
+  }
+  return (HaploValue) {
+    .type = HAPLO_VAL_ERROR,
+    .value.error = err,
+  };
+}
+
+// Calls with more arguments go through the list of arguments
+#define HAPLO_INTERPRETER_ARITH_ARGS 8
+
+// Returns true if name is an arithmetic builtin that can be called
+// with the count arguments of args, and sets op
+static bool haplo_interpreter_arith_op(HaploInterpreter *interpreter,
+                                       const char *name, HaploExpr *args,
+                                       HaploArithOp *op)
+{
+  // Only the names that can belong to an arithmetic builtin are
+  // looked up, the others are not slowed down
+  if (name[0] == '\0' || !strchr("+-*/<>=", name[0])) return false;
+
+  HaploSymbol symbol;
+  if (haplo_symbol_map_lookup(interpreter->symbol_map, name, &symbol) < 0
+      || symbol.type != HAPLO_SYMBOL_C_FUNCTION || !symbol.c_func.arith
+      || haplo_expr_depth(args) > HAPLO_INTERPRETER_ARITH_ARGS)
+    return false;
+
+  *op = symbol.c_func.arith_op;
+  return true;
+}
+
+// Evaluates the arguments of an arithmetic builtin in an array and
+// folds op over them
+static HaploValue haplo_interpreter_call_arith(HaploInterpreter *interpreter,
+                                               HaploArithOp op,
+                                               HaploExpr *args)
+{
+  HaploValue values[HAPLO_INTERPRETER_ARITH_ARGS];
+  int count = 0;
+  for (; args; args = args->tail)
+  {
+    HaploValue value = haplo_interpreter_interpret_rec(interpreter, args->head);
+    if (value.type == HAPLO_VAL_SYMBOL)
+    {
+      // A symbol takes the rest of the arguments, like in
+      // haplo_interpreter_interpret_tail_rec
+      HaploValueList *tail = haplo_interpreter_interpret_tail_rec(interpreter,
+                                                                  args->tail);
+      HaploValue result = haplo_interpreter_call_rec(interpreter, value, tail);
+      haplo_value_free(value);
+      haplo_value_list_free(tail);
+      values[count++] = result;
+      break;
+    }
+    values[count++] = value;
+  }
+
+  HaploValue out = haplo_arith_fold(op, values, count);
+  for (int i = 0; i < count; ++i)
+    haplo_value_free(values[i]);
+  return out;
+}
+
+static HaploValue haplo_interpreter_interpret_rec(HaploInterpreter *interpreter,
+                                                 HaploExpr *expr)
+{
+  // Stop evaluating as soon as memory runs out
+  if (UNLIKELY(interpreter->allocator->exhausted))
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_ERROR,
+      .value.error = HAPLO_ERROR_OUT_OF_MEMORY,
+    };
+  }
   if (!expr)
   {
     return (HaploValue) {
@@ -102,13 +922,13 @@ HaploValue haplo_interpreter_interpret(HaploInterpreter *interpreter,
     return haplo_interpreter_eval_atom(expr->atom);
 
   HaploValue out_val = {0};
-  HaploValue func = haplo_interpreter_interpret(interpreter, expr->head);
+  HaploValue func = haplo_interpreter_interpret_rec(interpreter, expr->head);
 
   // Special symbols
   if (func.type == HAPLO_VAL_SYMBOL)
   {
     // If statement. "(if (CONDITION) (CASE TRUE) (CASE FALSE))"
-    if (strcmp(func.value.symbol, "if") == 0)
+    if (strcmp(haplo_value_text(&func), "if") == 0)
     {
       haplo_value_free(func);
       int expr_depth = haplo_expr_depth(expr->tail);
@@ -120,7 +940,7 @@ HaploValue haplo_interpreter_interpret(HaploInterpreter *interpreter,
         };
       }
       
-      HaploValue condition = haplo_interpreter_interpret(interpreter, expr->tail->head);
+      HaploValue condition = haplo_interpreter_interpret_rec(interpreter, expr->tail->head);
       if (condition.type != HAPLO_VAL_BOOL)
       {
         return (HaploValue) {
@@ -132,14 +952,14 @@ HaploValue haplo_interpreter_interpret(HaploInterpreter *interpreter,
       // Decision
       if (condition.value.boolean)
       {
-        out_val = haplo_interpreter_interpret(interpreter, expr->tail->tail->head);
+        out_val = haplo_interpreter_interpret_rec(interpreter, expr->tail->tail->head);
       } else if (expr_depth == 3) {
-        out_val = haplo_interpreter_interpret(interpreter, expr->tail->tail->tail->head);
+        out_val = haplo_interpreter_interpret_rec(interpreter, expr->tail->tail->tail->head);
       }
       return out_val;
     }
     // While loop. "(while CONDITION FUNCTION)"
-    if (strcmp(func.value.symbol, "while") == 0)
+    if (strcmp(haplo_value_text(&func), "while") == 0)
     {
       int expr_depth = haplo_expr_depth(expr->tail);
       if (expr_depth < 2)
@@ -153,7 +973,7 @@ HaploValue haplo_interpreter_interpret(HaploInterpreter *interpreter,
       haplo_value_free(func);
 
       bool should_loop = true;
-      HaploValue condition = haplo_interpreter_interpret(interpreter, expr->tail->head);
+      HaploValue condition = haplo_interpreter_interpret_rec(interpreter, expr->tail->head);
       if (condition.type != HAPLO_VAL_BOOL)
       {
         return (HaploValue) {
@@ -164,11 +984,19 @@ HaploValue haplo_interpreter_interpret(HaploInterpreter *interpreter,
 
       should_loop = condition.value.boolean;
       while (should_loop) {
-        HaploValue a_val = haplo_interpreter_interpret(interpreter, expr->tail->tail->head);
+        HaploValue a_val = haplo_interpreter_interpret_rec(interpreter, expr->tail->tail->head);
         haplo_value_free(a_val); // Ignore the return value
 
         // Update should_loop
-        condition = haplo_interpreter_interpret(interpreter, expr->tail->head);
+        condition = haplo_interpreter_interpret_rec(interpreter, expr->tail->head);
+        if (condition.type != HAPLO_VAL_BOOL)
+        {
+          haplo_value_free(condition);
+          return (HaploValue) {
+            .type = HAPLO_VAL_ERROR,
+            .value.error = HAPLO_ERROR_INTERPRETER_INVALID_TYPE,
+          };
+        }
         should_loop = condition.value.boolean;
       }
 
@@ -176,94 +1004,74 @@ HaploValue haplo_interpreter_interpret(HaploInterpreter *interpreter,
         .type = HAPLO_VAL_EMPTY,
       };
     }
-    // Function definition. "(defunc 'FUNCTION_NAME (FUNCTION_BODY))"
-    if (strcmp(func.value.symbol, "defunc") == 0)
+    // Function definition. "(defunc 'FUNCTION_NAME 'PARAMETER ... (FUNCTION_BODY))"
+    if (strcmp(haplo_value_text(&func), "defunc") == 0)
     {
       haplo_value_free(func);
-      if (haplo_expr_depth(expr->tail) != 2)
-      {
-        return (HaploValue) {
-          .type = HAPLO_VAL_ERROR,
-          .value.error = HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS,
-        };
-      }
-
-      HaploExpr *func_name = expr->tail->head;
-      HaploExpr *func_body = expr->tail->tail->head;
-
-      if (!func_name->is_atom || func_name->atom.type != HAPLO_ATOM_QUOTE)
-      {
-        return (HaploValue) {
-          .type = HAPLO_VAL_ERROR,
-          .value.error = HAPLO_ERROR_INTERPRETER_INVALID_TYPE,
-        };
-      }
-
-      // Register function
-      HaploSymbol new_function = {
-        .type = HAPLO_SYMBOL_FUNCTION,
-        .func = func_body,
-      };
-      int err = haplo_symbol_map_update(interpreter->symbol_map,
-                                        func_name->atom.value.quote,
-                                        new_function);
-      if (err < 0)
-      {
-        return (HaploValue) {
-          .type = HAPLO_VAL_ERROR,
-          .value.error = err,
-        };
-      }
-      
-      return (HaploValue) {
-        .type = HAPLO_VAL_EMPTY,
-      };
+      return haplo_interpreter_defunc(interpreter, expr->tail);
+    }
+    // Record definition. "(defrecord 'NAME 'FIELD ...)"
+    if (strcmp(haplo_value_text(&func), "defrecord") == 0)
+    {
+      haplo_value_free(func);
+      return haplo_interpreter_defrecord(interpreter, expr->tail);
+    }
+    // Loop over a sequence. "(for-each 'NAME SEQUENCE (BODY))"
+    if (strcmp(haplo_value_text(&func), "for-each") == 0)
+    {
+      haplo_value_free(func);
+      return haplo_interpreter_for_each(interpreter, expr->tail);
+    }
+    // Arithmetic. "(+ NUMBER ...)"
+    HaploArithOp op;
+    if (haplo_interpreter_arith_op(interpreter, haplo_value_text(&func),
+                                   expr->tail, &op))
+    {
+      haplo_value_free(func);
+      return haplo_interpreter_call_arith(interpreter, op, expr->tail);
+    }
+    // Sequence builtins. "(reduce FUNCTION (mapcar FUNCTION SEQUENCE))"
+    HaploIterOp iter_op = haplo_interpreter_fused_op(interpreter, expr);
+    if (iter_op != HAPLO_ITER_OP_NONE)
+    {
+      haplo_value_free(func);
+      return haplo_interpreter_call_iter(interpreter, iter_op, expr->tail);
     }
   }
   
-  HaploValueList *args = haplo_interpreter_interpret_tail(interpreter, expr->tail);
+  HaploValueList *args = haplo_interpreter_interpret_tail_rec(interpreter, expr->tail);
 
-  out_val = haplo_interpreter_call(interpreter, func, args);
+  out_val = haplo_interpreter_call_rec(interpreter, func, args);
 
   haplo_value_free(func);
   haplo_value_list_free(args);
   return out_val;
 }
 
-HaploValueList *haplo_interpreter_interpret_tail(HaploInterpreter *interpreter,
-                                                   HaploExpr *expr)
+static HaploValueList *haplo_interpreter_interpret_tail_rec(HaploInterpreter *interpreter,
+                                                            HaploExpr *expr)
 {
-  if (!interpreter || !expr)
+  if (!expr)
     return NULL;
 
-  HaploValue head = haplo_interpreter_interpret(interpreter, expr->head);
-  HaploValueList *tail = haplo_interpreter_interpret_tail(interpreter, expr->tail);
+  HaploValue head = haplo_interpreter_interpret_rec(interpreter, expr->head);
+  HaploValueList *tail = haplo_interpreter_interpret_tail_rec(interpreter, expr->tail);
 
   if (head.type == HAPLO_VAL_SYMBOL)
   {
-    head = haplo_interpreter_call(interpreter, head, tail);
+    HaploValue result = haplo_interpreter_call_rec(interpreter, head, tail);
+    haplo_value_free(head);
     haplo_value_list_free(tail);
-    return haplo_value_list_push_front(head, NULL);
+    return haplo_value_list_push_front(result, NULL);
   }
 
   return haplo_value_list_push_front(head, tail);
 }
 
-_Static_assert(_HAPLO_SYMBOL_MAX == 3,
-              "Updated HaploSymbolType, maybe should update haplo_interpreter_call");
-// Should not free args here
-HaploValue haplo_interpreter_call(HaploInterpreter *interpreter,
-                                  HaploValue value,
-                                  HaploValueList* args)
+static HaploValue haplo_interpreter_call_rec(HaploInterpreter *interpreter,
+                                             HaploValue value,
+                                             HaploValueList* args)
 {
-  if (!interpreter)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_ERROR,
-      .value.error = HAPLO_ERROR_INTERPRETER_NULL,
-    };
-  }
-
   // Useful debug
   /*
   char buf[1024] = {0};
@@ -280,7 +1088,7 @@ HaploValue haplo_interpreter_call(HaploInterpreter *interpreter,
 
   HaploSymbol symbol;
   int err = haplo_symbol_map_lookup(interpreter->symbol_map,
-                                    value.value.symbol,
+                                    haplo_value_text(&value),
                                     &symbol);
   if (err < 0)
   {
@@ -289,15 +1097,28 @@ HaploValue haplo_interpreter_call(HaploInterpreter *interpreter,
       .value.error = HAPLO_ERROR_INTERPRETER_UNKNOWN_SYMBOL,
     };
   }
+  return haplo_interpreter_call_symbol(interpreter, symbol, args);
+}
 
+_Static_assert(_HAPLO_SYMBOL_MAX == 6,
+              "Updated HaploSymbolType, maybe should update haplo_interpreter_call_symbol");
+static HaploValue haplo_interpreter_call_symbol(HaploInterpreter *interpreter,
+                                                HaploSymbol symbol,
+                                                HaploValueList *args)
+{
   switch(symbol.type)
   {
   case HAPLO_SYMBOL_C_FUNCTION:
     return symbol.c_func.run(interpreter, args);
   case HAPLO_SYMBOL_FUNCTION:
-    return haplo_interpreter_interpret(interpreter, symbol.func);
+    return haplo_interpreter_call_function(interpreter, symbol, args);
   case HAPLO_SYMBOL_VARIABLE:
-    return symbol.var;
+    // The caller owns the result, lists are shared so this is cheap
+    return haplo_value_deep_copy(symbol.var);
+  case HAPLO_SYMBOL_RECORD_NEW:
+  case HAPLO_SYMBOL_RECORD_GET:
+  case HAPLO_SYMBOL_RECORD_SET:
+    return haplo_interpreter_call_record(symbol, args);
   default:
     break;
   }
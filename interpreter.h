@@ -8,6 +8,8 @@
 
 #include "expr.h"
 #include "value.h"
+#include "pool.h"
+#include "alloc.h"
 
 //
 // Macros
@@ -20,6 +22,7 @@
   #define interpreter_interpret haplo_interpreter_interpret
   #define interpreter_interpret_tail haplo_interpreter_interpret_tail
   #define interpreter_call haplo_interpreter_call
+  #define interpreter_apply haplo_interpreter_apply
 #endif // HAPLO_NO_PREFIX
 
 #ifndef HAPLO_INTERPRETER_SYMBOL_MAP_CAPACITY
@@ -34,15 +37,30 @@
 struct HaploSymbolMap;
 typedef struct HaploSymbolMap HaploSymbolMap;
 
+// The interpreter owns the pool of its list cells, so it must not be
+// moved after haplo_interpreter_init. Values produced by the
+// interpreter should be freed before haplo_interpreter_destroy. The
+// default list pool of the thread is shared by all interpreters and is
+// not released, see haplo_value_list_pool_release.
 typedef struct {
   HaploSymbolMap *symbol_map;
+  HaploAllocator *allocator;
+  HaploPool list_pool;
+  // The compiled regular expressions of the pattern strings used by
+  // the regex builtins, created on first use
+  HaploMap *regex_cache;
 } HaploInterpreter;
 
 //
 // Functions
 //
 
-int haplo_interpreter_init(HaploInterpreter *interpreter);
+// Every allocation made while interpreting goes through allocator, a
+// NULL allocator selects haplo_default_allocator. If the quota of the
+// allocator is exceeded, the evaluation stops and returns an error
+// value with HAPLO_ERROR_OUT_OF_MEMORY.
+int haplo_interpreter_init(HaploInterpreter *interpreter,
+                           HaploAllocator *allocator);
 void haplo_interpreter_destroy(HaploInterpreter *interpreter);
 HaploValue haplo_interpreter_interpret(HaploInterpreter *interpreter,
                                        HaploExpr *expr);
@@ -51,5 +69,11 @@ HaploValueList *haplo_interpreter_interpret_tail(HaploInterpreter *interpreter,
 HaploValue haplo_interpreter_call(HaploInterpreter *interpreter,
                                   HaploValue value,
                                   HaploValueList *args);
+// Calls function, a QUOTE or a SYMBOL naming a builtin, a function
+// or a record accessor, with the count values of args. The arguments
+// are not freed.
+HaploValue haplo_interpreter_apply(HaploInterpreter *interpreter,
+                                   HaploValue function,
+                                   const HaploValue *args, int count);
   
 #endif // HAPLO_INTERPRETER_H
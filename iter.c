@@ -0,0 +1,438 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "iter.h"
+#include "vector.h"
+#include "array.h"
+#include "errors.h"
+#include "utils.h"
+#include "alloc.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+#define HAPLO_ITER_ERROR(err)          \
+  (HaploValue) {                       \
+    .type = HAPLO_VAL_ERROR,           \
+    .value.error = (err),              \
+  }
+
+static HaploIter *haplo_iter_new(HaploIterType type, HaploIter *source)
+{
+  HaploIter *iter = haplo_alloc(sizeof(HaploIter));
+  if (UNLIKELY(!iter)) return NULL;
+
+  iter->type = type;
+  iter->refcount = 1;
+  iter->depth = source ? source->depth + 1 : 1;
+  iter->start = iter->end = iter->step = 0;
+  iter->value = (HaploValue) { .type = HAPLO_VAL_EMPTY };
+  iter->source = haplo_iter_ref(source);
+  return iter;
+}
+
+HaploIter *haplo_iter_range(long start, long end, long step, int *err)
+{
+  // A range that never moves would never end
+  if (step == 0)
+  {
+    *err = HAPLO_ERROR_INVALID_ARGUMENT;
+    return NULL;
+  }
+  HaploIter *iter = haplo_iter_new(HAPLO_ITER_RANGE, NULL);
+  if (UNLIKELY(!iter))
+  {
+    *err = HAPLO_ERROR_OUT_OF_MEMORY;
+    return NULL;
+  }
+
+  iter->start = start;
+  iter->end = end;
+  iter->step = step;
+  return iter;
+}
+
+HaploIter *haplo_iter_from_value(HaploValue value)
+{
+  if (value.type == HAPLO_VAL_LIST)
+  {
+    HaploVector *vector = haplo_vector_from_list(value.value.list);
+    if (UNLIKELY(!vector)) return NULL;
+    value = (HaploValue) {
+      .type = HAPLO_VAL_VECTOR,
+      .value.vector = vector,
+    };
+  } else {
+    assert(value.type == HAPLO_VAL_VECTOR || value.type == HAPLO_VAL_ARRAY);
+    value = haplo_value_deep_copy(value);
+  }
+
+  HaploIter *iter = haplo_iter_new(HAPLO_ITER_SEQ, NULL);
+  if (UNLIKELY(!iter))
+  {
+    haplo_value_free(value);
+    return NULL;
+  }
+  iter->value = value;
+  return iter;
+}
+
+HaploIter *haplo_iter_from_sequence(HaploValue value, int *err)
+{
+  HaploIter *iter = NULL;
+  switch(value.type)
+  {
+  case HAPLO_VAL_ITER:
+    return haplo_iter_ref(value.value.iter);
+  case HAPLO_VAL_LIST:
+  case HAPLO_VAL_VECTOR:
+  case HAPLO_VAL_ARRAY:
+    iter = haplo_iter_from_value(value);
+    if (UNLIKELY(!iter)) *err = HAPLO_ERROR_OUT_OF_MEMORY;
+    return iter;
+  case HAPLO_VAL_ERROR:
+    *err = value.value.error;
+    return NULL;
+  default:
+    break;
+  }
+  *err = HAPLO_ERROR_INTERPRETER_INVALID_TYPE;
+  return NULL;
+}
+
+HaploIter *haplo_iter_map(HaploValue function, HaploIter *source)
+{
+  HaploIter *iter = haplo_iter_new(HAPLO_ITER_MAP, source);
+  if (UNLIKELY(!iter)) return NULL;
+
+  iter->value = haplo_value_deep_copy(function);
+  return iter;
+}
+
+HaploIter *haplo_iter_filter(HaploValue function, HaploIter *source)
+{
+  HaploIter *iter = haplo_iter_new(HAPLO_ITER_FILTER, source);
+  if (UNLIKELY(!iter)) return NULL;
+
+  iter->value = haplo_value_deep_copy(function);
+  return iter;
+}
+
+HaploIter *haplo_iter_take(long count, HaploIter *source)
+{
+  HaploIter *iter = haplo_iter_new(HAPLO_ITER_TAKE, source);
+  if (UNLIKELY(!iter)) return NULL;
+
+  iter->end = count;
+  return iter;
+}
+
+HaploIter *haplo_iter_ref(HaploIter *iter)
+{
+  if (iter) iter->refcount++;
+  return iter;
+}
+
+void haplo_iter_free(HaploIter *iter)
+{
+  // The chain of sources is freed in a loop
+  while (iter && --iter->refcount == 0)
+  {
+    HaploIter *source = iter->source;
+    haplo_value_free(iter->value);
+    haplo_free(iter);
+    iter = source;
+  }
+  return;
+}
+
+void haplo_iter_begin(HaploIter *iter, HaploIterCursor *cursors)
+{
+  for (int i = 0; iter; ++i, iter = iter->source)
+  {
+    cursors[i].iter = iter;
+    cursors[i].position = (iter->type == HAPLO_ITER_RANGE) ? iter->start : 0;
+    cursors[i].done = false;
+  }
+  return;
+}
+
+// Returns the number of values of a sequence, vectors can change size
+// while they are walked
+static long haplo_iter_seq_len(HaploValue seq)
+{
+  if (seq.type == HAPLO_VAL_VECTOR) return haplo_vector_len(seq.value.vector);
+  return haplo_array_len(seq.value.array);
+}
+
+static HaploValue haplo_iter_seq_nth(HaploValue seq, long index)
+{
+  if (seq.type == HAPLO_VAL_VECTOR)
+    return haplo_value_deep_copy(seq.value.vector->items[index]);
+  return haplo_array_nth(seq.value.array, index);
+}
+
+_Static_assert(_HAPLO_ITER_MAX == 5,
+              "Added a new iterator type, update haplo_iter_next");
+int haplo_iter_next(HaploIterCursor *cursors, HaploInterpreter *interpreter,
+                    HaploValue *out)
+{
+  HaploIterCursor *cursor = cursors;
+  HaploIter *iter = cursor->iter;
+  if (cursor->done) return 0;
+
+  int found;
+  switch(iter->type)
+  {
+  case HAPLO_ITER_RANGE:
+    if ((iter->step > 0) ? cursor->position >= iter->end
+                         : cursor->position <= iter->end)
+      break;
+    *out = (HaploValue) {
+      .type = HAPLO_VAL_INTEGER,
+      .value.integer = cursor->position,
+    };
+    // The range ends before the position overflows
+    if (HAPLO_ADD_OVERFLOW(cursor->position, iter->step, &cursor->position))
+      cursor->done = true;
+    return 1;
+  case HAPLO_ITER_SEQ:
+    if (cursor->position >= haplo_iter_seq_len(iter->value)) break;
+    *out = haplo_iter_seq_nth(iter->value, cursor->position++);
+    return 1;
+  case HAPLO_ITER_MAP: ;
+    HaploValue value;
+    found = haplo_iter_next(cursors + 1, interpreter, &value);
+    if (found <= 0) return found;
+
+    HaploValue result = haplo_interpreter_apply(interpreter, iter->value,
+                                                &value, 1);
+    haplo_value_free(value);
+    if (result.type == HAPLO_VAL_ERROR) return result.value.error;
+    *out = result;
+    return 1;
+  case HAPLO_ITER_FILTER:
+    while ((found = haplo_iter_next(cursors + 1, interpreter, out)) > 0)
+    {
+      HaploValue keep = haplo_interpreter_apply(interpreter, iter->value, out, 1);
+      if (keep.type == HAPLO_VAL_BOOL && keep.value.boolean) return 1;
+
+      haplo_value_free(*out);
+      if (keep.type == HAPLO_VAL_ERROR) return keep.value.error;
+      if (keep.type != HAPLO_VAL_BOOL)
+      {
+        haplo_value_free(keep);
+        return HAPLO_ERROR_INTERPRETER_INVALID_TYPE;
+      }
+    }
+    return found;
+  case HAPLO_ITER_TAKE:
+    if (cursor->position >= iter->end) break;
+    found = haplo_iter_next(cursors + 1, interpreter, out);
+    if (found > 0) cursor->position++;
+    return found;
+  default:
+    return HAPLO_ERROR_VALUE_TYPE_UNRECOGNIZED;
+  }
+
+  cursor->done = true;
+  return 0;
+}
+
+// Walks the cursors and collects the values in a list or a vector
+static HaploValue haplo_iter_collect(HaploIterCursor *cursors,
+                                     HaploInterpreter *interpreter,
+                                     HaploValueType kind)
+{
+  HaploValueList *chain = NULL;
+  HaploVector *vector = NULL;
+  if (kind != HAPLO_VAL_LIST)
+  {
+    vector = haplo_vector_new(0);
+    if (UNLIKELY(!vector)) return HAPLO_ITER_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+  }
+
+  HaploValue value;
+  int found;
+  while ((found = haplo_iter_next(cursors, interpreter, &value)) > 0)
+  {
+    if (vector)
+    {
+      found = haplo_vector_push(vector, value);
+      if (UNLIKELY(found < 0))
+      {
+        haplo_value_free(value);
+        break;
+      }
+      continue;
+    }
+
+    // Pushing to the front keeps the values in print order
+    HaploValueList *new_chain = haplo_value_list_push_front(value, chain);
+    if (UNLIKELY(new_chain == chain))
+    {
+      found = HAPLO_ERROR_OUT_OF_MEMORY;
+      break;
+    }
+    chain = new_chain;
+  }
+
+  if (found < 0)
+  {
+    haplo_vector_free(vector);
+    haplo_value_list_free(chain);
+    return HAPLO_ITER_ERROR(found);
+  }
+  if (vector)
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_VECTOR,
+      .value.vector = vector,
+    };
+  }
+
+  HaploList *list = haplo_list_new(chain);
+  if (UNLIKELY(!list)) return HAPLO_ITER_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+  return (HaploValue) {
+    .type = HAPLO_VAL_LIST,
+    .value.list = list,
+  };
+}
+
+// Walks the cursors and accumulates the values with function. The
+// first value is the initial one, unless init is given.
+static HaploValue haplo_iter_reduce(HaploIterCursor *cursors,
+                                    HaploInterpreter *interpreter,
+                                    HaploValue function, HaploValue *init)
+{
+  HaploValue acc, value;
+  int found;
+  if (init)
+  {
+    acc = haplo_value_deep_copy(*init);
+  } else {
+    found = haplo_iter_next(cursors, interpreter, &acc);
+    if (found <= 0)
+      return HAPLO_ITER_ERROR(found < 0 ? found : HAPLO_ERROR_LIST_EMPTY);
+  }
+
+  while (acc.type != HAPLO_VAL_ERROR
+         && (found = haplo_iter_next(cursors, interpreter, &value)) > 0)
+  {
+    HaploValue pair[2] = { acc, value };
+    HaploValue next = haplo_interpreter_apply(interpreter, function, pair, 2);
+    haplo_value_free(acc);
+    haplo_value_free(value);
+    acc = next;
+  }
+
+  if (acc.type != HAPLO_VAL_ERROR && found < 0)
+  {
+    haplo_value_free(acc);
+    return HAPLO_ITER_ERROR(found);
+  }
+  return acc;
+}
+
+HaploValue haplo_iter_run(HaploIterOp op, HaploInterpreter *interpreter,
+                          HaploValue function, HaploValue init,
+                          HaploIter *source, HaploValueType kind)
+{
+  if (function.type == HAPLO_VAL_ERROR) return function;
+  if (function.type != HAPLO_VAL_QUOTE && function.type != HAPLO_VAL_SYMBOL)
+    return HAPLO_ITER_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+
+  HaploIter *iter;
+  switch(op)
+  {
+  case HAPLO_ITER_OP_MAP:
+    iter = haplo_iter_map(function, source);
+    break;
+  case HAPLO_ITER_OP_FILTER:
+    iter = haplo_iter_filter(function, source);
+    break;
+  case HAPLO_ITER_OP_REDUCE:
+  case HAPLO_ITER_OP_FOLD:
+    iter = haplo_iter_ref(source);
+    break;
+  default:
+    return HAPLO_ITER_ERROR(HAPLO_ERROR_INTERPRETER_NOT_FUNCTION);
+  }
+  if (UNLIKELY(!iter)) return HAPLO_ITER_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+
+  bool reduce = (op == HAPLO_ITER_OP_REDUCE || op == HAPLO_ITER_OP_FOLD);
+  if (!reduce && kind == HAPLO_VAL_ITER)
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_ITER,
+      .value.iter = iter,
+    };
+  }
+
+  HaploIterCursor stack_cursors[HAPLO_ITER_STACK_DEPTH];
+  HaploIterCursor *cursors = stack_cursors;
+  if (iter->depth > HAPLO_ITER_STACK_DEPTH)
+  {
+    cursors = haplo_alloc(iter->depth * sizeof(HaploIterCursor));
+    if (UNLIKELY(!cursors))
+    {
+      haplo_iter_free(iter);
+      return HAPLO_ITER_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+    }
+  }
+  haplo_iter_begin(iter, cursors);
+
+  HaploValue out = reduce
+    ? haplo_iter_reduce(cursors, interpreter, function,
+                        (op == HAPLO_ITER_OP_FOLD) ? &init : NULL)
+    : haplo_iter_collect(cursors, interpreter, kind);
+
+  if (cursors != stack_cursors) haplo_free(cursors);
+  haplo_iter_free(iter);
+  return out;
+}
+
+_Static_assert(_HAPLO_ITER_MAX == 5,
+              "Added a new iterator type, update haplo_iter_string");
+int haplo_iter_string(HaploIter *iter, char *buf, int buf_len)
+{
+  int offset = haplo_snprintf_clamp(snprintf(buf, buf_len, "iter:"), buf_len);
+  for (; iter && offset < buf_len - 1; iter = iter->source)
+  {
+    switch(iter->type)
+    {
+    case HAPLO_ITER_RANGE:
+      offset += haplo_snprintf_clamp(snprintf(buf + offset, buf_len - offset,
+                                              " range %ld %ld %ld", iter->start,
+                                              iter->end, iter->step),
+                                     buf_len - offset);
+      break;
+    case HAPLO_ITER_SEQ:
+      offset += haplo_snprintf_clamp(snprintf(buf + offset, buf_len - offset,
+                                              " %s", (iter->value.type == HAPLO_VAL_VECTOR)
+                                              ? "vector" : "array"),
+                                     buf_len - offset);
+      break;
+    case HAPLO_ITER_MAP:
+    case HAPLO_ITER_FILTER:
+      offset += haplo_snprintf_clamp(snprintf(buf + offset, buf_len - offset,
+                                              (iter->type == HAPLO_ITER_MAP)
+                                              ? " map " : " filter "),
+                                     buf_len - offset);
+      offset += haplo_snprintf_clamp(haplo_value_string(iter->value, buf + offset,
+                                                        buf_len - offset),
+                                     buf_len - offset);
+      break;
+    case HAPLO_ITER_TAKE:
+      offset += haplo_snprintf_clamp(snprintf(buf + offset, buf_len - offset,
+                                              " take %ld", iter->end),
+                                     buf_len - offset);
+      break;
+    default:
+      break;
+    }
+  }
+  return offset;
+}
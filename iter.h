@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#ifndef HAPLO_ITER_H
+#define HAPLO_ITER_H
+
+#include "value.h"
+#include "interpreter.h"
+
+//
+// Macros
+//
+
+#ifdef HAPLO_NO_PREFIX
+  #define Iter HaploIter
+  #define IterType HaploIterType
+  #define IterCursor HaploIterCursor
+  #define IterOp HaploIterOp
+  #define iter_range haplo_iter_range
+  #define iter_from_value haplo_iter_from_value
+  #define iter_from_sequence haplo_iter_from_sequence
+  #define iter_map haplo_iter_map
+  #define iter_filter haplo_iter_filter
+  #define iter_take haplo_iter_take
+  #define iter_ref haplo_iter_ref
+  #define iter_free haplo_iter_free
+  #define iter_begin haplo_iter_begin
+  #define iter_next haplo_iter_next
+  #define iter_run haplo_iter_run
+  #define iter_string haplo_iter_string
+#endif // HAPLO_NO_PREFIX
+
+// Walking iterators with at most this many stages needs no allocation
+#define HAPLO_ITER_STACK_DEPTH 8
+
+//
+// Types
+//
+
+typedef enum {
+  HAPLO_ITER_RANGE = 0,
+  HAPLO_ITER_SEQ,             // the values of a vector or an array
+  HAPLO_ITER_MAP,
+  HAPLO_ITER_FILTER,
+  HAPLO_ITER_TAKE,
+  _HAPLO_ITER_MAX,
+} HaploIterType;
+
+// A lazy sequence. An iterator is never modified, it describes how
+// its values are produced: they are computed one at a time while a
+// cursor walks it, so an iterator can be walked many times.
+struct HaploIter {
+  HaploIterType type;
+  unsigned int refcount;
+  // The number of stages down to the range or sequence that feeds
+  // the iterator, and the number of cursors needed to walk it
+  int depth;
+  // RANGE: the values from start up to end, excluded. TAKE: end is
+  // the number of values
+  long start, end, step;
+  // SEQ: the vector or array. MAP and FILTER: the function
+  HaploValue value;
+  // MAP, FILTER and TAKE: the iterator they read
+  HaploIter *source;
+};
+
+// The builtins that walk a sequence with a function
+typedef enum {
+  HAPLO_ITER_OP_NONE = 0,
+  HAPLO_ITER_OP_MAP,
+  HAPLO_ITER_OP_FILTER,
+  HAPLO_ITER_OP_REDUCE,
+  HAPLO_ITER_OP_FOLD,
+} HaploIterOp;
+
+// The position of a walk over one stage of an iterator
+typedef struct {
+  HaploIter *iter;
+  // RANGE: the next value. SEQ: the next index. TAKE: the number of
+  // values taken
+  long position;
+  bool done;
+} HaploIterCursor;
+
+//
+// Functions
+//
+
+// The following functions return a new iterator, or NULL if out of
+// memory. They take new references to their arguments.
+// Returns a range from start to end excluded. Returns NULL and sets
+// *err to HAPLO_ERROR_INVALID_ARGUMENT if step is 0, or if out of
+// memory.
+HaploIter *haplo_iter_range(long start, long end, long step, int *err);
+// Returns an iterator over a LIST, a VECTOR or an ARRAY. Lists are
+// copied to a vector, so that they can be walked in order.
+HaploIter *haplo_iter_from_value(HaploValue value);
+// Returns a new reference to value if it is an ITER, or an iterator
+// over a LIST, a VECTOR or an ARRAY. Returns NULL and sets *err if
+// value is not a sequence or if out of memory.
+HaploIter *haplo_iter_from_sequence(HaploValue value, int *err);
+// function is called on each value of source, see haplo_interpreter_apply
+HaploIter *haplo_iter_map(HaploValue function, HaploIter *source);
+// Keeps the values of source for which function returns true
+HaploIter *haplo_iter_filter(HaploValue function, HaploIter *source);
+// The first count values of source
+HaploIter *haplo_iter_take(long count, HaploIter *source);
+HaploIter *haplo_iter_ref(HaploIter *iter);
+void haplo_iter_free(HaploIter *iter);
+// Starts a walk over iter, cursors must hold iter->depth cursors
+void haplo_iter_begin(HaploIter *iter, HaploIterCursor *cursors);
+// Stores the next value of the walk in *out, which the caller owns.
+// Returns 1 if there was a value, 0 at the end of the iterator, or a
+// negative error.
+int haplo_iter_next(HaploIterCursor *cursors, HaploInterpreter *interpreter,
+                    HaploValue *out);
+// Runs op over the values of source in one pass. MAP and FILTER
+// return an iterator if kind is HAPLO_VAL_ITER, or else a list if it
+// is HAPLO_VAL_LIST and a vector otherwise. REDUCE and FOLD call
+// function on the accumulated value and each value, starting from
+// the first value or from init. Returns the result, or an error.
+HaploValue haplo_iter_run(HaploIterOp op, HaploInterpreter *interpreter,
+                          HaploValue function, HaploValue init,
+                          HaploIter *source, HaploValueType kind);
+// Returns the number of bytes written to buf. At most buf_len bytes
+// will be written.
+int haplo_iter_string(HaploIter *iter, char *buf, int buf_len);
+
+#endif // HAPLO_ITER_H
@@ -0,0 +1,961 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "json.h"
+#include "str.h"
+#include "map.h"
+#include "hamt.h"
+#include "vector.h"
+#include "record.h"
+#include "array.h"
+#include "utf8.h"
+#include "fmt.h"
+#include "alloc.h"
+#include "utils.h"
+#include "bigint.h"
+#include "cpu.h"
+#include "errors.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Parsing has two stages. The first one reads the text in blocks of
+// 64 bytes and finds the structural characters, the quotes and the
+// starts of the numbers and literals outside of strings, as bitmasks.
+// The bytes are classified with plain C, SSE2 or AVX2. The second
+// stage builds the values walking the positions of the first.
+#if !defined(HAPLO_JSON_NO_SIMD) && defined(__GNUC__) && defined(__x86_64__)
+  #define HAPLO_JSON_X86
+  #include <immintrin.h>
+  #define HAPLO_JSON_AVX2 __attribute__((target("avx2")))
+#endif
+
+typedef enum {
+  HAPLO_JSON_ISA_SCALAR = 0,
+  HAPLO_JSON_ISA_SSE2,
+  HAPLO_JSON_ISA_AVX2,
+} HaploJsonIsa;
+
+// The classes of the 64 bytes of a block, bit i is byte i
+typedef struct {
+  uint64_t quote;
+  uint64_t backslash;
+  // { } [ ] : ,
+  uint64_t structural;
+  uint64_t whitespace;
+  // The bytes below 0x20, which can't be in strings
+  uint64_t control;
+} HaploJsonBlock;
+
+// The state of the second stage
+typedef struct {
+  const char *data;
+  int len;
+  // The positions found by the first stage
+  const uint32_t *positions;
+  int count;
+  int next;
+  // The STRING holding data, or NULL
+  const HaploValue *source;
+  int depth;
+} HaploJsonParser;
+
+// The text of a value being written, flushed to file if there is one
+typedef struct {
+  HaploStringBuilder builder;
+  FILE *file;
+} HaploJsonWriter;
+
+#define HAPLO_JSON_ERROR(err)          \
+  (HaploValue) {                       \
+    .type = HAPLO_VAL_ERROR,           \
+    .value.error = (err),              \
+  }
+
+// Returns the best instruction set supported by the cpu
+static HaploJsonIsa haplo_json_isa(void)
+{
+#ifdef HAPLO_JSON_X86
+  return haplo_cpu_has_avx2() ? HAPLO_JSON_ISA_AVX2 : HAPLO_JSON_ISA_SSE2;
+#else
+  return HAPLO_JSON_ISA_SCALAR;
+#endif
+}
+
+//
+// Classification
+//
+
+static void haplo_json_classify_scalar(const uint8_t *bytes, HaploJsonBlock *block)
+{
+  memset(block, 0, sizeof(*block));
+  for (int i = 0; i < 64; ++i)
+  {
+    uint64_t bit = 1ULL << i;
+    switch(bytes[i])
+    {
+    case '"':
+      block->quote |= bit;
+      break;
+    case '\\':
+      block->backslash |= bit;
+      break;
+    case '{': case '}': case '[': case ']': case ':': case ',':
+      block->structural |= bit;
+      break;
+    case ' ':
+      block->whitespace |= bit;
+      break;
+    case '\t': case '\n': case '\r':
+      block->whitespace |= bit;
+      block->control |= bit;
+      break;
+    default:
+      if (bytes[i] < 0x20) block->control |= bit;
+      break;
+    }
+  }
+  return;
+}
+
+#ifdef HAPLO_JSON_X86
+
+// Or-ing 0x20 turns [ and ] into { and }
+static void haplo_json_classify_sse2(const uint8_t *bytes, HaploJsonBlock *block)
+{
+  memset(block, 0, sizeof(*block));
+  for (int i = 0; i < 4; ++i)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i*) (bytes + 16 * i));
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i structural = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(lower, _mm_set1_epi8('{')),
+                   _mm_cmpeq_epi8(lower, _mm_set1_epi8('}'))),
+      _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')),
+                   _mm_cmpeq_epi8(v, _mm_set1_epi8(','))));
+    __m128i whitespace = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                   _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+      _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                   _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+    __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(0x1f)), v);
+
+    int shift = 16 * i;
+    block->quote |= (uint64_t) (unsigned) _mm_movemask_epi8(
+      _mm_cmpeq_epi8(v, _mm_set1_epi8('"'))) << shift;
+    block->backslash |= (uint64_t) (unsigned) _mm_movemask_epi8(
+      _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))) << shift;
+    block->structural |= (uint64_t) (unsigned) _mm_movemask_epi8(structural) << shift;
+    block->whitespace |= (uint64_t) (unsigned) _mm_movemask_epi8(whitespace) << shift;
+    block->control |= (uint64_t) (unsigned) _mm_movemask_epi8(control) << shift;
+  }
+  return;
+}
+
+HAPLO_JSON_AVX2
+static void haplo_json_classify_avx2(const uint8_t *bytes, HaploJsonBlock *block)
+{
+  memset(block, 0, sizeof(*block));
+  for (int i = 0; i < 2; ++i)
+  {
+    __m256i v = _mm256_loadu_si256((const __m256i*) (bytes + 32 * i));
+    __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    __m256i structural = _mm256_or_si256(
+      _mm256_or_si256(_mm256_cmpeq_epi8(lower, _mm256_set1_epi8('{')),
+                      _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('}'))),
+      _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')),
+                      _mm256_cmpeq_epi8(v, _mm256_set1_epi8(','))));
+    __m256i whitespace = _mm256_or_si256(
+      _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                      _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+      _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+                      _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+    __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(0x1f)), v);
+
+    int shift = 32 * i;
+    block->quote |= (uint64_t) (uint32_t) _mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'))) << shift;
+    block->backslash |= (uint64_t) (uint32_t) _mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))) << shift;
+    block->structural |= (uint64_t) (uint32_t) _mm256_movemask_epi8(structural) << shift;
+    block->whitespace |= (uint64_t) (uint32_t) _mm256_movemask_epi8(whitespace) << shift;
+    block->control |= (uint64_t) (uint32_t) _mm256_movemask_epi8(control) << shift;
+  }
+  return;
+}
+
+#endif // HAPLO_JSON_X86
+
+//
+// First stage
+//
+
+// Returns the bytes escaped by a backslash. *carry is 1 if the last
+// byte of the block before is a backslash that escapes the first one.
+static uint64_t haplo_json_escaped(uint64_t backslash, uint64_t *carry)
+{
+  uint64_t escaped = *carry;
+  backslash &= ~escaped;
+  *carry = 0;
+  // An escaped backslash escapes nothing, so the backslashes are
+  // taken in order. They are rare, this does not run for most blocks.
+  while (backslash)
+  {
+    int i = HAPLO_CTZ64(backslash);
+    if (i == 63)
+    {
+      *carry = 1;
+      break;
+    }
+    escaped |= 1ULL << (i + 1);
+    backslash &= ~(3ULL << i);
+  }
+  return escaped;
+}
+
+// Bit i of the result is the xor of the bits of x up to i
+static inline uint64_t haplo_json_prefix_xor(uint64_t x)
+{
+  x ^= x << 1;
+  x ^= x << 2;
+  x ^= x << 4;
+  x ^= x << 8;
+  x ^= x << 16;
+  x ^= x << 32;
+  return x;
+}
+
+// Sets *positions to the offsets of the structural characters, of the
+// quotes and of the first bytes of the other values, in order. Returns
+// how many, or a negative error.
+static int haplo_json_scan(const uint8_t *data, int len, uint32_t **positions)
+{
+  // A block has at most 64 positions, but most documents have far
+  // fewer than one per byte, so the array grows as they are found
+  int capacity = len / 8 + 64;
+  *positions = haplo_alloc(capacity * sizeof(uint32_t));
+  if (!*positions) return HAPLO_ERROR_OUT_OF_MEMORY;
+
+  HaploJsonIsa isa = haplo_json_isa();
+  uint64_t escape_carry = 0, in_string_carry = 0, other_carry = 0;
+  uint64_t errors = 0;
+  int count = 0;
+  for (int base = 0; base < len; base += 64)
+  {
+    // The last block is padded with spaces
+    uint8_t tail[64];
+    const uint8_t *bytes = data + base;
+    if (len - base < 64)
+    {
+      memset(tail, ' ', sizeof(tail));
+      memcpy(tail, bytes, len - base);
+      bytes = tail;
+    }
+
+    HaploJsonBlock block;
+    switch(isa)
+    {
+#ifdef HAPLO_JSON_X86
+    case HAPLO_JSON_ISA_AVX2:
+      haplo_json_classify_avx2(bytes, &block);
+      break;
+    case HAPLO_JSON_ISA_SSE2:
+      haplo_json_classify_sse2(bytes, &block);
+      break;
+#endif // HAPLO_JSON_X86
+    default:
+      haplo_json_classify_scalar(bytes, &block);
+      break;
+    }
+
+    // The bytes from an opening quote included to the closing one
+    // excluded are in a string
+    uint64_t quote = block.quote & ~haplo_json_escaped(block.backslash, &escape_carry);
+    uint64_t in_string = haplo_json_prefix_xor(quote) ^ in_string_carry;
+    in_string_carry = (uint64_t) ((int64_t) in_string >> 63);
+    errors |= block.control & in_string;
+
+    // A value other than a string starts after a structural
+    // character, a quote or a space
+    uint64_t other = ~(block.structural | block.whitespace | block.quote | in_string);
+    uint64_t starts = other & ~((other << 1) | other_carry);
+    other_carry = other >> 63;
+
+    uint64_t found = (block.structural & ~in_string) | quote | starts;
+    if (count > capacity - 64)
+    {
+      uint32_t *grown = haplo_realloc(*positions, 2 * (size_t) capacity * sizeof(uint32_t));
+      if (!grown) return HAPLO_ERROR_OUT_OF_MEMORY;
+      *positions = grown;
+      capacity *= 2;
+    }
+    while (found)
+    {
+      (*positions)[count++] = base + HAPLO_CTZ64(found);
+      found &= found - 1;
+    }
+  }
+  if (in_string_carry || errors) return HAPLO_ERROR_JSON_SYNTAX;
+  return count;
+}
+
+//
+// Second stage
+//
+
+static HaploValue haplo_json_parse_value(HaploJsonParser *parser);
+
+static bool haplo_json_delimiter(char c)
+{
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == ','
+    || c == ':' || c == ']' || c == '}' || c == '[' || c == '{' || c == '"';
+}
+
+static bool haplo_json_digit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+// Returns the next position, or -1 at the end
+static inline int haplo_json_next(HaploJsonParser *parser)
+{
+  if (parser->next >= parser->count) return -1;
+  return parser->positions[parser->next++];
+}
+
+// The character at the next position, or 0 at the end
+static inline char haplo_json_peek(HaploJsonParser *parser)
+{
+  if (parser->next >= parser->count) return 0;
+  return parser->data[parser->positions[parser->next]];
+}
+
+static int haplo_json_hex4(const char *p)
+{
+  int value = 0;
+  for (int i = 0; i < 4; ++i)
+  {
+    char c = p[i];
+    int digit = (c >= '0' && c <= '9') ? c - '0'
+      : (c >= 'a' && c <= 'f') ? c - 'a' + 10
+      : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+    if (digit < 0) return -1;
+    value = value * 16 + digit;
+  }
+  return value;
+}
+
+// Writes the escapes in the len bytes of in to out, which has room
+// for len bytes. Returns the number of bytes written, or -1.
+static int haplo_json_unescape(const char *in, int len, char *out)
+{
+  int written = 0;
+  for (int i = 0; i < len; )
+  {
+    const char *backslash = memchr(in + i, '\\', len - i);
+    int run = backslash ? (int) (backslash - (in + i)) : len - i;
+    memcpy(out + written, in + i, run);
+    written += run;
+    i += run;
+    if (i == len) break;
+
+    // The first stage made sure a backslash is followed by a byte
+    char c = in[i + 1];
+    i += 2;
+    switch(c)
+    {
+    case '"': case '\\': case '/':
+      out[written++] = c;
+      continue;
+    case 'b': out[written++] = '\b'; continue;
+    case 'f': out[written++] = '\f'; continue;
+    case 'n': out[written++] = '\n'; continue;
+    case 'r': out[written++] = '\r'; continue;
+    case 't': out[written++] = '\t'; continue;
+    case 'u':
+      break;
+    default:
+      return -1;
+    }
+
+    int codepoint = (len - i >= 4) ? haplo_json_hex4(in + i) : -1;
+    if (codepoint < 0) return -1;
+    i += 4;
+    // A surrogate pair is one codepoint
+    if (codepoint >= 0xd800 && codepoint <= 0xdbff)
+    {
+      int low = (len - i >= 6 && in[i] == '\\' && in[i + 1] == 'u')
+        ? haplo_json_hex4(in + i + 2) : -1;
+      if (low < 0xdc00 || low > 0xdfff) return -1;
+      codepoint = 0x10000 + ((codepoint - 0xd800) << 10) + (low - 0xdc00);
+      i += 6;
+    }
+    else if (codepoint >= 0xdc00 && codepoint <= 0xdfff)
+    {
+      return -1;
+    }
+
+    if (codepoint < 0x80)
+    {
+      out[written++] = (char) codepoint;
+    }
+    else if (codepoint < 0x800)
+    {
+      out[written++] = (char) (0xc0 | (codepoint >> 6));
+      out[written++] = (char) (0x80 | (codepoint & 0x3f));
+    }
+    else if (codepoint < 0x10000)
+    {
+      out[written++] = (char) (0xe0 | (codepoint >> 12));
+      out[written++] = (char) (0x80 | ((codepoint >> 6) & 0x3f));
+      out[written++] = (char) (0x80 | (codepoint & 0x3f));
+    }
+    else
+    {
+      out[written++] = (char) (0xf0 | (codepoint >> 18));
+      out[written++] = (char) (0x80 | ((codepoint >> 12) & 0x3f));
+      out[written++] = (char) (0x80 | ((codepoint >> 6) & 0x3f));
+      out[written++] = (char) (0x80 | (codepoint & 0x3f));
+    }
+  }
+  return written;
+}
+
+// Parses the string opening at start, its closing quote is the next
+// position
+static HaploValue haplo_json_parse_string(HaploJsonParser *parser, int start)
+{
+  int end = haplo_json_next(parser);
+  if (end < 0) return HAPLO_JSON_ERROR(HAPLO_ERROR_JSON_SYNTAX);
+  const char *bytes = parser->data + start + 1;
+  int len = end - start - 1;
+
+  // Strings without escapes are not decoded, and long ones share the
+  // bytes of the text
+  if (!memchr(bytes, '\\', len))
+  {
+    if (parser->source)
+      return haplo_value_string_slice(parser->source, start + 1, len);
+    return haplo_value_text_new(HAPLO_VAL_STRING, bytes, len);
+  }
+
+  // An escape is never shorter than what it stands for
+  HaploStringBuilder builder = {0};
+  if (haplo_string_builder_reserve(&builder, len) < 0)
+    return HAPLO_JSON_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+  int written = haplo_json_unescape(bytes, len, builder.string->buffer);
+  if (written < 0)
+  {
+    haplo_string_builder_free(&builder);
+    return HAPLO_JSON_ERROR(HAPLO_ERROR_JSON_SYNTAX);
+  }
+  builder.string->len = written;
+  return haplo_value_string_build(&builder);
+}
+
+// Returns the integer of the len digits, which does not fit in a long,
+// as a BIGINT. The digits are added 18 at a time.
+static HaploValue haplo_json_parse_bigint(const char *digits, int len, bool negative)
+{
+  if (len > HAPLO_JSON_DIGITS_MAX)
+    return HAPLO_JSON_ERROR(HAPLO_ERROR_OUT_OF_RANGE);
+
+  HaploValue value = { .type = HAPLO_VAL_INTEGER, .value.integer = 0 };
+  for (int i = 0; i < len; )
+  {
+    long part = 0, scale = 1;
+    for (int end = (len - i < 18) ? len : i + 18; i < end; ++i)
+    {
+      part = part * 10 + (digits[i] - '0');
+      scale *= 10;
+    }
+    HaploValue scaled = haplo_bigint_mul(value, (HaploValue) {
+        .type = HAPLO_VAL_INTEGER,
+        .value.integer = scale,
+      });
+    haplo_value_free(value);
+    if (scaled.type == HAPLO_VAL_ERROR) return scaled;
+    value = haplo_bigint_add(scaled, (HaploValue) {
+        .type = HAPLO_VAL_INTEGER,
+        .value.integer = negative ? -part : part,
+      });
+    haplo_value_free(scaled);
+    if (value.type == HAPLO_VAL_ERROR) return value;
+  }
+  return value;
+}
+
+static HaploValue haplo_json_parse_number(HaploJsonParser *parser, int start)
+{
+  const char *data = parser->data;
+  int len = parser->len, i = start;
+  bool negative = data[i] == '-';
+  if (negative) i++;
+
+  // The integer part is read while it is checked, 19 digits always
+  // fit in 64 bits
+  int digits_start = i;
+  uint64_t integer = 0;
+  if (i < len && data[i] == '0')
+    i++;
+  else if (i < len && data[i] >= '1' && data[i] <= '9')
+    for (; i < len && haplo_json_digit(data[i]); ++i)
+      integer = integer * 10 + (data[i] - '0');
+  else
+    return HAPLO_JSON_ERROR(HAPLO_ERROR_JSON_SYNTAX);
+  int digits = i - digits_start;
+
+  bool is_float = false;
+  if (i < len && data[i] == '.')
+  {
+    is_float = true;
+    if (++i >= len || !haplo_json_digit(data[i]))
+      return HAPLO_JSON_ERROR(HAPLO_ERROR_JSON_SYNTAX);
+    while (i < len && haplo_json_digit(data[i])) i++;
+  }
+  if (i < len && (data[i] == 'e' || data[i] == 'E'))
+  {
+    is_float = true;
+    if (++i < len && (data[i] == '+' || data[i] == '-')) i++;
+    if (i >= len || !haplo_json_digit(data[i]))
+      return HAPLO_JSON_ERROR(HAPLO_ERROR_JSON_SYNTAX);
+    while (i < len && haplo_json_digit(data[i])) i++;
+  }
+  if (i < len && !haplo_json_delimiter(data[i]))
+    return HAPLO_JSON_ERROR(HAPLO_ERROR_JSON_SYNTAX);
+
+  if (!is_float && digits <= 19)
+  {
+    if (integer <= (uint64_t) LONG_MAX)
+      return (HaploValue) {
+        .type = HAPLO_VAL_INTEGER,
+        .value.integer = negative ? -(long) integer : (long) integer,
+      };
+    if (negative && integer == (uint64_t) LONG_MAX + 1)
+      return (HaploValue) {
+        .type = HAPLO_VAL_INTEGER,
+        .value.integer = LONG_MIN,
+      };
+  }
+  // Integers that don't fit in a long are bigints, as in arithmetic
+  if (!is_float)
+    return haplo_json_parse_bigint(data + digits_start, digits, negative);
+
+  // strtod needs a NUL after the number
+  char stack_buf[64];
+  int number_len = i - start;
+  char *buf = (number_len < (int) sizeof(stack_buf)) ? stack_buf
+    : haplo_alloc(number_len + 1);
+  if (!buf) return HAPLO_JSON_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+  memcpy(buf, data + start, number_len);
+  buf[number_len] = '\0';
+  double value = strtod(buf, NULL);
+  if (buf != stack_buf) haplo_free(buf);
+  // JSON can't write infinities back
+  if (isinf(value)) return HAPLO_JSON_ERROR(HAPLO_ERROR_OUT_OF_RANGE);
+  return (HaploValue) {
+    .type = HAPLO_VAL_FLOAT,
+    .value.floating_point = value,
+  };
+}
+
+static HaploValue haplo_json_parse_literal(HaploJsonParser *parser, int start)
+{
+  static const struct {
+    const char *text;
+    HaploValue value;
+  } literals[] = {
+    { "true", { .type = HAPLO_VAL_BOOL, .value.boolean = true } },
+    { "false", { .type = HAPLO_VAL_BOOL, .value.boolean = false } },
+    { "null", { .type = HAPLO_VAL_EMPTY } },
+  };
+  for (size_t i = 0; i < sizeof(literals) / sizeof(literals[0]); ++i)
+  {
+    int len = strlen(literals[i].text);
+    if (parser->len - start >= len
+        && memcmp(parser->data + start, literals[i].text, len) == 0
+        && (parser->len - start == len
+            || haplo_json_delimiter(parser->data[start + len])))
+      return literals[i].value;
+  }
+  return HAPLO_JSON_ERROR(HAPLO_ERROR_JSON_SYNTAX);
+}
+
+static HaploValue haplo_json_parse_array(HaploJsonParser *parser)
+{
+  HaploVector *vector = haplo_vector_new(0);
+  if (!vector) return HAPLO_JSON_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+  HaploValue array = {
+    .type = HAPLO_VAL_VECTOR,
+    .value.vector = vector,
+  };
+  if (haplo_json_peek(parser) == ']')
+  {
+    parser->next++;
+    return array;
+  }
+
+  while (true)
+  {
+    HaploValue item = haplo_json_parse_value(parser);
+    if (item.type == HAPLO_VAL_ERROR)
+    {
+      haplo_value_free(array);
+      return item;
+    }
+    int err = haplo_vector_push(vector, item);
+    if (err < 0)
+    {
+      haplo_value_free(array);
+      return HAPLO_JSON_ERROR(err);
+    }
+
+    int position = haplo_json_next(parser);
+    char c = (position >= 0) ? parser->data[position] : 0;
+    if (c == ']') return array;
+    if (c != ',')
+    {
+      haplo_value_free(array);
+      return HAPLO_JSON_ERROR(HAPLO_ERROR_JSON_SYNTAX);
+    }
+  }
+}
+
+static HaploValue haplo_json_parse_object(HaploJsonParser *parser)
+{
+  HaploMap *map = haplo_map_new();
+  if (!map) return HAPLO_JSON_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+  HaploValue object = {
+    .type = HAPLO_VAL_MAP,
+    .value.map = map,
+  };
+  if (haplo_json_peek(parser) == '}')
+  {
+    parser->next++;
+    return object;
+  }
+
+  int err = HAPLO_ERROR_JSON_SYNTAX;
+  while (true)
+  {
+    int position = haplo_json_next(parser);
+    if (position < 0 || parser->data[position] != '"') goto failed;
+    HaploValue key = haplo_json_parse_string(parser, position);
+    if (key.type == HAPLO_VAL_ERROR)
+    {
+      err = key.value.error;
+      goto failed;
+    }
+    position = haplo_json_next(parser);
+    if (position < 0 || parser->data[position] != ':')
+    {
+      haplo_value_free(key);
+      goto failed;
+    }
+    HaploValue value = haplo_json_parse_value(parser);
+    if (value.type == HAPLO_VAL_ERROR)
+    {
+      haplo_value_free(key);
+      err = value.value.error;
+      goto failed;
+    }
+    // A key seen again keeps its last value
+    err = haplo_map_put(map, key, value);
+    if (err < 0) goto failed;
+
+    err = HAPLO_ERROR_JSON_SYNTAX;
+    position = haplo_json_next(parser);
+    char c = (position >= 0) ? parser->data[position] : 0;
+    if (c == '}') return object;
+    if (c != ',') goto failed;
+  }
+
+ failed:
+  haplo_value_free(object);
+  return HAPLO_JSON_ERROR(err);
+}
+
+static HaploValue haplo_json_parse_value(HaploJsonParser *parser)
+{
+  int position = haplo_json_next(parser);
+  if (position < 0) return HAPLO_JSON_ERROR(HAPLO_ERROR_JSON_SYNTAX);
+
+  HaploValue value;
+  switch(parser->data[position])
+  {
+  case '{':
+  case '[':
+    if (parser->depth >= HAPLO_JSON_DEPTH_MAX)
+      return HAPLO_JSON_ERROR(HAPLO_ERROR_JSON_SYNTAX);
+    parser->depth++;
+    value = (parser->data[position] == '{') ? haplo_json_parse_object(parser)
+      : haplo_json_parse_array(parser);
+    parser->depth--;
+    return value;
+  case '"':
+    return haplo_json_parse_string(parser, position);
+  case 't':
+  case 'f':
+  case 'n':
+    return haplo_json_parse_literal(parser, position);
+  default:
+    if (parser->data[position] == '-' || haplo_json_digit(parser->data[position]))
+      return haplo_json_parse_number(parser, position);
+    return HAPLO_JSON_ERROR(HAPLO_ERROR_JSON_SYNTAX);
+  }
+}
+
+HaploValue haplo_json_parse(const char *data, int len, const HaploValue *source)
+{
+  if (!haplo_utf8_valid(data, len))
+    return HAPLO_JSON_ERROR(HAPLO_ERROR_INVALID_UTF8);
+
+  uint32_t *positions = NULL;
+  int count = haplo_json_scan((const uint8_t *) data, len, &positions);
+  if (count < 0)
+  {
+    haplo_free(positions);
+    return HAPLO_JSON_ERROR(count);
+  }
+
+  HaploJsonParser parser = {
+    .data = data,
+    .len = len,
+    .positions = positions,
+    .count = count,
+    .next = 0,
+    .source = (source && source->type == HAPLO_VAL_STRING) ? source : NULL,
+    .depth = 0,
+  };
+  HaploValue value = haplo_json_parse_value(&parser);
+  // Nothing can follow the document
+  if (value.type != HAPLO_VAL_ERROR && parser.next != parser.count)
+  {
+    haplo_value_free(value);
+    value = HAPLO_JSON_ERROR(HAPLO_ERROR_JSON_SYNTAX);
+  }
+  haplo_free(positions);
+  return value;
+}
+
+//
+// Writing
+//
+
+static int haplo_json_write_value(HaploJsonWriter *writer, HaploValue value);
+
+static inline int haplo_json_append(HaploJsonWriter *writer, const char *data, int len)
+{
+  return haplo_string_builder_append(&writer->builder, data, len);
+}
+
+// Hands what was written so far to the file, once there is enough
+static int haplo_json_flush(HaploJsonWriter *writer, bool force)
+{
+  HaploString *string = writer->builder.string;
+  if (!writer->file || !string) return 0;
+  if (!force && string->len < HAPLO_JSON_FLUSH_SIZE) return 0;
+  if (fwrite(string->buffer, 1, string->len, writer->file) != (size_t) string->len)
+    return HAPLO_ERROR_IO;
+  string->len = 0;
+  return 0;
+}
+
+static int haplo_json_write_string(HaploJsonWriter *writer, const char *bytes, int len)
+{
+  // The bytes that need an escape: the quote, the backslash and the
+  // control characters
+  static const char *escapes[0x20] = {
+    "\\u0000", "\\u0001", "\\u0002", "\\u0003", "\\u0004", "\\u0005", "\\u0006", "\\u0007",
+    "\\b", "\\t", "\\n", "\\u000b", "\\f", "\\r", "\\u000e", "\\u000f",
+    "\\u0010", "\\u0011", "\\u0012", "\\u0013", "\\u0014", "\\u0015", "\\u0016", "\\u0017",
+    "\\u0018", "\\u0019", "\\u001a", "\\u001b", "\\u001c", "\\u001d", "\\u001e", "\\u001f",
+  };
+  int err = haplo_json_append(writer, "\"", 1);
+  int run = 0;
+  for (int i = 0; i < len && err == 0; ++i)
+  {
+    unsigned char c = bytes[i];
+    if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+    // The bytes before the escape are appended at once
+    err = haplo_json_append(writer, bytes + run, i - run);
+    const char *escape = (c == '"') ? "\\\"" : (c == '\\') ? "\\\\" : escapes[c];
+    if (err == 0) err = haplo_json_append(writer, escape, strlen(escape));
+    run = i + 1;
+  }
+  if (err == 0) err = haplo_json_append(writer, bytes + run, len - run);
+  if (err == 0) err = haplo_json_append(writer, "\"", 1);
+  return err;
+}
+
+static int haplo_json_write_key(HaploJsonWriter *writer, HaploValue key)
+{
+  if (key.type != HAPLO_VAL_STRING && key.type != HAPLO_VAL_QUOTE
+      && key.type != HAPLO_VAL_SYMBOL)
+    return HAPLO_ERROR_INTERPRETER_INVALID_TYPE;
+  int err = haplo_json_write_string(writer, haplo_value_text(&key),
+                                    haplo_value_text_len(&key));
+  if (err == 0) err = haplo_json_append(writer, ":", 1);
+  return err;
+}
+
+typedef struct {
+  HaploJsonWriter *writer;
+  bool first;
+  int err;
+} HaploJsonHamtCtx;
+
+static bool haplo_json_write_hamt_entry(HaploHamtEntry *entry, void *ctx)
+{
+  HaploJsonHamtCtx *hamt_ctx = ctx;
+  if (!hamt_ctx->first)
+    hamt_ctx->err = haplo_json_append(hamt_ctx->writer, ",", 1);
+  hamt_ctx->first = false;
+  if (hamt_ctx->err == 0)
+    hamt_ctx->err = haplo_json_write_key(hamt_ctx->writer, entry->key);
+  if (hamt_ctx->err == 0)
+    hamt_ctx->err = haplo_json_write_value(hamt_ctx->writer, entry->value);
+  return hamt_ctx->err == 0;
+}
+
+static int haplo_json_write_list(HaploJsonWriter *writer, HaploList *list)
+{
+  // The cells are chained from the last value
+  int len = haplo_list_len(list);
+  HaploValueList *stack_cells[64];
+  HaploValueList **cells = stack_cells;
+  if (len > 64)
+  {
+    cells = haplo_alloc(len * sizeof(HaploValueList*));
+    if (!cells) return HAPLO_ERROR_OUT_OF_MEMORY;
+  }
+  HaploValueList *this = (len > 0) ? list->first : NULL;
+  for (int i = len - 1; i >= 0; --i)
+  {
+    cells[i] = this;
+    this = this->next;
+  }
+
+  int err = haplo_json_append(writer, "[", 1);
+  for (int i = 0; i < len && err == 0; ++i)
+  {
+    if (i > 0) err = haplo_json_append(writer, ",", 1);
+    if (err == 0) err = haplo_json_write_value(writer, cells[i]->val);
+  }
+  if (err == 0) err = haplo_json_append(writer, "]", 1);
+  if (cells != stack_cells) haplo_free(cells);
+  return err;
+}
+
+_Static_assert(_HAPLO_VAL_MAX == 20,
+              "Added a new value type, maybe update haplo_json_write_value");
+static int haplo_json_write_value(HaploJsonWriter *writer, HaploValue value)
+{
+  int err = haplo_json_flush(writer, false);
+  if (err < 0) return err;
+
+  char buf[HAPLO_FMT_DOUBLE_MAX];
+  switch(value.type)
+  {
+  case HAPLO_VAL_INTEGER:
+    return haplo_string_builder_append_long(&writer->builder, value.value.integer);
+  case HAPLO_VAL_FLOAT:
+    // fmt writes nan and inf, which JSON does not have
+    if (value.value.floating_point != value.value.floating_point
+        || value.value.floating_point - value.value.floating_point != 0.0)
+      return haplo_json_append(writer, "null", 4);
+    return haplo_json_append(writer, buf, haplo_fmt_double(buf, value.value.floating_point));
+  case HAPLO_VAL_BIGINT:
+    return haplo_string_builder_append_value(&writer->builder, value);
+  case HAPLO_VAL_STRING:
+    return haplo_json_write_string(writer, haplo_value_text(&value),
+                                   haplo_value_text_len(&value));
+  case HAPLO_VAL_BOOL:
+    return value.value.boolean ? haplo_json_append(writer, "true", 4)
+      : haplo_json_append(writer, "false", 5);
+  case HAPLO_VAL_EMPTY:
+    return haplo_json_append(writer, "null", 4);
+  case HAPLO_VAL_LIST:
+    return haplo_json_write_list(writer, value.value.list);
+  case HAPLO_VAL_VECTOR:
+    err = haplo_json_append(writer, "[", 1);
+    for (int i = 0; i < value.value.vector->len && err == 0; ++i)
+    {
+      if (i > 0) err = haplo_json_append(writer, ",", 1);
+      if (err == 0) err = haplo_json_write_value(writer, value.value.vector->items[i]);
+    }
+    return (err == 0) ? haplo_json_append(writer, "]", 1) : err;
+  case HAPLO_VAL_ARRAY:
+    err = haplo_json_append(writer, "[", 1);
+    for (int i = 0; i < value.value.array->len && err == 0; ++i)
+    {
+      if (i > 0) err = haplo_json_append(writer, ",", 1);
+      if (err == 0) err = haplo_json_write_value(writer, haplo_array_nth(value.value.array, i));
+    }
+    return (err == 0) ? haplo_json_append(writer, "]", 1) : err;
+  case HAPLO_VAL_MAP:
+    err = haplo_json_append(writer, "{", 1);
+    bool first = true;
+    for (int i = 0; i < value.value.map->capacity && err == 0; ++i)
+    {
+      HaploMapEntry *entry = &value.value.map->entries[i];
+      if (entry->hash <= HAPLO_MAP_SLOT_DELETED) continue;
+      if (!first) err = haplo_json_append(writer, ",", 1);
+      first = false;
+      if (err == 0) err = haplo_json_write_key(writer, entry->key);
+      if (err == 0) err = haplo_json_write_value(writer, entry->value);
+    }
+    return (err == 0) ? haplo_json_append(writer, "}", 1) : err;
+  case HAPLO_VAL_PMAP: ;
+    HaploJsonHamtCtx ctx = { .writer = writer, .first = true, .err = 0 };
+    err = haplo_json_append(writer, "{", 1);
+    if (err == 0) haplo_hamt_foreach(value.value.hamt, haplo_json_write_hamt_entry, &ctx);
+    if (err == 0) err = ctx.err;
+    return (err == 0) ? haplo_json_append(writer, "}", 1) : err;
+  case HAPLO_VAL_RECORD: ;
+    HaploRecord *record = value.value.record;
+    err = haplo_json_append(writer, "{", 1);
+    for (int i = 0; i < record->shape->field_count && err == 0; ++i)
+    {
+      if (i > 0) err = haplo_json_append(writer, ",", 1);
+      const char *field = record->shape->fields[i];
+      if (err == 0) err = haplo_json_write_string(writer, field, strlen(field));
+      if (err == 0) err = haplo_json_append(writer, ":", 1);
+      if (err == 0) err = haplo_json_write_value(writer, record->slots[i]);
+    }
+    return (err == 0) ? haplo_json_append(writer, "}", 1) : err;
+  case HAPLO_VAL_ERROR:
+    return value.value.error;
+  default:
+    return HAPLO_ERROR_INTERPRETER_INVALID_TYPE;
+  }
+}
+
+int haplo_json_stringify(HaploStringBuilder *builder, HaploValue value)
+{
+  HaploJsonWriter writer = {
+    .builder = *builder,
+    .file = NULL,
+  };
+  int err = haplo_json_write_value(&writer, value);
+  *builder = writer.builder;
+  return err;
+}
+
+int haplo_json_write(FILE *file, HaploValue value)
+{
+  HaploJsonWriter writer = {
+    .builder = {0},
+    .file = file,
+  };
+  int err = haplo_json_write_value(&writer, value);
+  if (err == 0) err = haplo_json_flush(&writer, true);
+  haplo_string_builder_free(&writer.builder);
+  return err;
+}
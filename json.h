@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#ifndef HAPLO_JSON_H
+#define HAPLO_JSON_H
+
+#include "value.h"
+
+#include <stdio.h>
+
+//
+// Macros
+//
+
+#ifdef HAPLO_NO_PREFIX
+  #define json_parse haplo_json_parse
+  #define json_stringify haplo_json_stringify
+  #define json_write haplo_json_write
+#endif // HAPLO_NO_PREFIX
+
+// Documents nested deeper than this are rejected
+#define HAPLO_JSON_DEPTH_MAX 512
+
+// Integers with more digits than this are rejected, they become
+// bigints in quadratic time
+#define HAPLO_JSON_DIGITS_MAX 4096
+
+// haplo_json_write hands the text to the file in chunks of about this
+// many bytes
+#define HAPLO_JSON_FLUSH_SIZE 65536
+
+// Define HAPLO_JSON_NO_SIMD to scan the text without SIMD
+
+//
+// Functions
+//
+
+// Parses the JSON document in the len bytes of data, which must be
+// UTF-8. Objects become maps with string keys, arrays vectors, null
+// an EMPTY value. Integers become INTEGER values when they fit in a
+// long and BIGINT values otherwise, other numbers floats. Numbers out
+// of the range of a double are an HAPLO_ERROR_OUT_OF_RANGE error. If source is the STRING that holds data, strings without
+// escapes share its bytes. Returns an ERROR value if the document is
+// not valid.
+HaploValue haplo_json_parse(const char *data, int len, const HaploValue *source);
+// Appends value as JSON to builder. Lists, vectors and arrays become
+// arrays, maps and records objects, EMPTY null. Map keys must be
+// strings, quotes or symbols. Floats that are not finite become null.
+// Returns 0, or a negative error.
+int haplo_json_stringify(HaploStringBuilder *builder, HaploValue value);
+// Writes value as JSON to file, as haplo_json_stringify, without
+// building the whole text in memory. Returns 0, or a negative error.
+int haplo_json_write(FILE *file, HaploValue value);
+
+#endif // HAPLO_JSON_H
@@ -5,6 +5,8 @@
 
 #include "errors.h"
 #include "lexer.h"
+#include "alloc.h"
+#include "utf8.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -173,13 +175,16 @@ int haplo_lexer_peek(HaploLexer *l, HaploToken *tok, HaploAtom *atom)
     int ret = haplo_lexer_atom_len(l);
     if (ret < 0) return ret;
     if (ret < 2) return HAPLO_ERROR_LEXER_ATOM_STRING_SIZE;
+    // Strings are UTF-8, so they can be indexed by codepoint
+    if (!haplo_utf8_valid(l->input + l->cursor + 1, ret - 2))
+      return HAPLO_ERROR_INVALID_UTF8;
 
     if (atom)
     {
       atom->type = HAPLO_ATOM_STRING;
-      atom->value.string = (char *) malloc(ret);
-      strncpy(atom->value.string, l->input + l->cursor + 1, ret - 2); // Ignore the '"'
-      atom->value.string[ret-1] = '\0';
+      // Ignore the '"'
+      atom->value.string = haplo_string_new(l->input + l->cursor + 1, ret - 2);
+      if (!atom->value.string) return HAPLO_ERROR_OUT_OF_MEMORY;
     }
     if (tok) *tok = HAPLO_LEX_ATOM;
     return ret;
@@ -242,9 +247,8 @@ int haplo_lexer_peek(HaploLexer *l, HaploToken *tok, HaploAtom *atom)
   if (atom)
   {
     atom->type = HAPLO_ATOM_SYMBOL;
-    atom->value.symbol = (char *) malloc(ret + 1);
-    strncpy(atom->value.symbol, l->input + l->cursor, ret);
-    atom->value.symbol[ret] = '\0';
+    atom->value.symbol = haplo_strndup(l->input + l->cursor, ret);
+    if (!atom->value.symbol) return HAPLO_ERROR_OUT_OF_MEMORY;
   }
   if (tok) *tok = HAPLO_LEX_ATOM;
   return ret;
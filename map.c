@@ -0,0 +1,227 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "map.h"
+#include "errors.h"
+#include "utils.h"
+#include "alloc.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+
+// Hashes of keys never collide with the markers of free slots
+static uint64_t haplo_map_hash(HaploValue key)
+{
+  uint64_t hash = haplo_value_hash(key);
+  return (hash <= HAPLO_MAP_SLOT_DELETED) ? hash + 2 : hash;
+}
+
+HaploMap *haplo_map_new(void)
+{
+  HaploMap *map = haplo_alloc(sizeof(HaploMap));
+  if (UNLIKELY(!map)) return NULL;
+
+  map->entries = NULL;
+  map->capacity = 0;
+  map->len = 0;
+  map->deleted = 0;
+  map->refcount = 1;
+  return map;
+}
+
+HaploMap *haplo_map_ref(HaploMap *map)
+{
+  if (map) map->refcount++;
+  return map;
+}
+
+void haplo_map_free(HaploMap *map)
+{
+  if (!map || --map->refcount != 0) return;
+
+  for (int i = 0; i < map->capacity; ++i)
+  {
+    if (map->entries[i].hash <= HAPLO_MAP_SLOT_DELETED) continue;
+    haplo_value_free(map->entries[i].key);
+    haplo_value_free(map->entries[i].value);
+  }
+  haplo_free(map->entries);
+  haplo_free(map);
+  return;
+}
+
+int haplo_map_size(HaploMap *map)
+{
+  return map ? map->len : 0;
+}
+
+// Returns the slot holding key, or -1
+static int haplo_map_find(HaploMap *map, HaploValue key, uint64_t hash)
+{
+  if (map->capacity == 0) return -1;
+
+  int mask = map->capacity - 1;
+  for (int i = hash & mask; ; i = (i + 1) & mask)
+  {
+    HaploMapEntry *entry = &map->entries[i];
+    if (entry->hash == HAPLO_MAP_SLOT_EMPTY) return -1;
+    if (entry->hash == hash && haplo_value_equal(entry->key, key))
+      return i;
+  }
+}
+
+// Moves the entries to a table of capacity slots, dropping the
+// deleted ones. The cached hashes avoid hashing the keys again.
+static int haplo_map_resize(HaploMap *map, int capacity)
+{
+  HaploMapEntry *entries = haplo_calloc(capacity, sizeof(HaploMapEntry));
+  if (UNLIKELY(!entries)) return HAPLO_ERROR_OUT_OF_MEMORY;
+
+  int mask = capacity - 1;
+  for (int i = 0; i < map->capacity; ++i)
+  {
+    HaploMapEntry *entry = &map->entries[i];
+    if (entry->hash <= HAPLO_MAP_SLOT_DELETED) continue;
+
+    int j = entry->hash & mask;
+    while (entries[j].hash != HAPLO_MAP_SLOT_EMPTY)
+      j = (j + 1) & mask;
+    entries[j] = *entry;
+  }
+
+  haplo_free(map->entries);
+  map->entries = entries;
+  map->capacity = capacity;
+  map->deleted = 0;
+  return 0;
+}
+
+HaploValue *haplo_map_get(HaploMap *map, HaploValue key)
+{
+  assert(map);
+  if (!haplo_value_hashable(key)) return NULL;
+
+  int i = haplo_map_find(map, key, haplo_map_hash(key));
+  return (i < 0) ? NULL : &map->entries[i].value;
+}
+
+int haplo_map_put(HaploMap *map, HaploValue key, HaploValue value)
+{
+  assert(map);
+  int error = 0;
+  if (!haplo_value_hashable(key))
+  {
+    error = HAPLO_ERROR_INTERPRETER_INVALID_TYPE;
+    goto failed;
+  }
+
+  uint64_t hash = haplo_map_hash(key);
+  int i = haplo_map_find(map, key, hash);
+  if (i >= 0)
+  {
+    haplo_value_free(key);
+    haplo_value_free(map->entries[i].value);
+    map->entries[i].value = value;
+    return 0;
+  }
+
+  // Keep the load factor, deleted slots included, under 3/4
+  if ((map->len + map->deleted + 1) * 4 > map->capacity * 3)
+  {
+    int capacity = map->capacity;
+    if (capacity == 0)
+      capacity = HAPLO_MAP_MIN_CAPACITY;
+    else if ((map->len + 1) * 4 > capacity * 3 / 2)
+    {
+      // Grow only if the table is not mostly deleted slots
+      if (UNLIKELY(capacity > INT_MAX / 2))
+      {
+        error = HAPLO_ERROR_OUT_OF_MEMORY;
+        goto failed;
+      }
+      capacity *= 2;
+    }
+
+    error = haplo_map_resize(map, capacity);
+    if (error < 0) goto failed;
+  }
+
+  int mask = map->capacity - 1;
+  for (i = hash & mask; map->entries[i].hash > HAPLO_MAP_SLOT_DELETED;
+       i = (i + 1) & mask);
+  if (map->entries[i].hash == HAPLO_MAP_SLOT_DELETED) map->deleted--;
+
+  map->entries[i] = (HaploMapEntry) {
+    .hash = hash,
+    .key = key,
+    .value = value,
+  };
+  map->len++;
+  return 0;
+
+ failed:
+  haplo_value_free(key);
+  haplo_value_free(value);
+  return error;
+}
+
+bool haplo_map_del(HaploMap *map, HaploValue key)
+{
+  assert(map);
+  if (!haplo_value_hashable(key)) return false;
+
+  int i = haplo_map_find(map, key, haplo_map_hash(key));
+  if (i < 0) return false;
+
+  haplo_value_free(map->entries[i].key);
+  haplo_value_free(map->entries[i].value);
+  map->entries[i] = (HaploMapEntry) { .hash = HAPLO_MAP_SLOT_DELETED };
+  map->len--;
+  map->deleted++;
+  return true;
+}
+
+HaploList *haplo_map_keys(HaploMap *map)
+{
+  HaploValueList *chain = NULL;
+  for (int i = 0; map && i < map->capacity; ++i)
+  {
+    if (map->entries[i].hash <= HAPLO_MAP_SLOT_DELETED) continue;
+
+    HaploValueList *new_chain =
+      haplo_value_list_push_front(haplo_value_deep_copy(map->entries[i].key),
+                                  chain);
+    if (UNLIKELY(new_chain == chain))
+    {
+      haplo_value_list_free(chain);
+      return NULL;
+    }
+    chain = new_chain;
+  }
+  return haplo_list_new(chain);
+}
+
+int haplo_map_string(HaploMap *map, char *buf, int buf_len)
+{
+  int offset = haplo_snprintf_clamp(snprintf(buf, buf_len, "map: "), buf_len);
+  for (int i = 0; map && i < map->capacity && offset < buf_len - 1; ++i)
+  {
+    HaploMapEntry *entry = &map->entries[i];
+    if (entry->hash <= HAPLO_MAP_SLOT_DELETED) continue;
+
+    offset += haplo_snprintf_clamp(haplo_value_string(entry->key, buf + offset,
+                                                      buf_len - offset),
+                                   buf_len - offset);
+    offset += haplo_snprintf_clamp(snprintf(buf + offset, buf_len - offset, "="),
+                                   buf_len - offset);
+    offset += haplo_snprintf_clamp(haplo_value_string(entry->value, buf + offset,
+                                                      buf_len - offset),
+                                   buf_len - offset);
+    offset += haplo_snprintf_clamp(snprintf(buf + offset, buf_len - offset, " "),
+                                   buf_len - offset);
+  }
+  return offset;
+}
@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#ifndef HAPLO_MAP_H
+#define HAPLO_MAP_H
+
+#include "value.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//
+// Macros
+//
+
+#ifdef HAPLO_NO_PREFIX
+  #define Map HaploMap
+  #define MapEntry HaploMapEntry
+  #define map_new haplo_map_new
+  #define map_ref haplo_map_ref
+  #define map_free haplo_map_free
+  #define map_size haplo_map_size
+  #define map_get haplo_map_get
+  #define map_put haplo_map_put
+  #define map_del haplo_map_del
+  #define map_keys haplo_map_keys
+  #define map_string haplo_map_string
+#endif // HAPLO_NO_PREFIX
+
+// Number of slots of a map the first time it grows, must be a power
+// of two
+#ifndef HAPLO_MAP_MIN_CAPACITY
+#define HAPLO_MAP_MIN_CAPACITY 8
+#endif // HAPLO_MAP_MIN_CAPACITY
+
+// Hashes marking the free slots of a map
+#define HAPLO_MAP_SLOT_EMPTY   0
+#define HAPLO_MAP_SLOT_DELETED 1
+
+//
+// Types
+//
+
+// A slot of the table. The hash of the key is cached in the slot, it
+// is never one of the HAPLO_MAP_SLOT_* markers.
+typedef struct {
+  uint64_t hash;
+  HaploValue key;
+  HaploValue value;
+} HaploMapEntry;
+
+// A hash map with open addressing and linear probing. Like vectors,
+// maps are mutable and shared by reference.
+struct HaploMap {
+  HaploMapEntry *entries;
+  // Number of slots, a power of two
+  int capacity;
+  int len;
+  // Number of deleted slots, they count for the load factor
+  int deleted;
+  unsigned int refcount;
+};
+
+//
+// Functions
+//
+
+// Returns an empty map, or NULL if out of memory
+HaploMap *haplo_map_new(void);
+// Returns a new reference to map
+HaploMap *haplo_map_ref(HaploMap *map);
+// Drops a reference to map, its keys and values are freed with the
+// last one
+void haplo_map_free(HaploMap *map);
+int haplo_map_size(HaploMap *map);
+// Returns the value of key without copying it, or NULL if key is not
+// in map
+HaploValue *haplo_map_get(HaploMap *map, HaploValue key);
+// Sets the value of key, freeing the previous one. Takes ownership of
+// key and value. Key must be hashable. Returns 0 on success, or a
+// negative error.
+int haplo_map_put(HaploMap *map, HaploValue key, HaploValue value);
+// Removes key from map. Returns true if it was there.
+bool haplo_map_del(HaploMap *map, HaploValue key);
+// Returns a list with a copy of the keys of map, or NULL if out of
+// memory
+HaploList *haplo_map_keys(HaploMap *map);
+// Returns the number of bytes written to buf. At most buf_len bytes
+// will be written.
+int haplo_map_string(HaploMap *map, char *buf, int buf_len);
+
+#endif // HAPLO_MAP_H
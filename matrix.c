@@ -0,0 +1,230 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "matrix.h"
+#include "errors.h"
+#include "utils.h"
+#include "alloc.h"
+#include "fmt.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+
+#define HAPLO_MATRIX_MIN(a, b) ((a) < (b) ? (a) : (b))
+
+// Returns a matrix over storage, taking ownership of the reference
+static HaploMatrix *haplo_matrix_view(HaploArray *storage, double *data,
+                                      int rows, int cols, int stride)
+{
+  HaploMatrix *matrix = haplo_alloc(sizeof(HaploMatrix));
+  if (UNLIKELY(!matrix))
+  {
+    haplo_array_free(storage);
+    return NULL;
+  }
+
+  matrix->storage = storage;
+  matrix->data = data;
+  matrix->rows = rows;
+  matrix->cols = cols;
+  matrix->stride = stride;
+  matrix->refcount = 1;
+  return matrix;
+}
+
+HaploMatrix *haplo_matrix_new(int rows, int cols)
+{
+  if (rows < 0 || cols < 0 || (cols > 0 && rows > INT_MAX / cols))
+    return NULL;
+
+  HaploArray *storage = haplo_array_new(HAPLO_ARRAY_F64, rows * cols);
+  if (UNLIKELY(!storage)) return NULL;
+  return haplo_matrix_view(storage, storage->data.f64, rows, cols, cols);
+}
+
+HaploMatrix *haplo_matrix_from_array(int rows, int cols, HaploArray *array,
+                                     int *error)
+{
+  if (array->type != HAPLO_ARRAY_F64)
+  {
+    *error = HAPLO_ERROR_INTERPRETER_INVALID_TYPE;
+    return NULL;
+  }
+  if (rows < 0 || cols < 0 || (cols > 0 && rows > INT_MAX / cols)
+      || rows * cols != array->len)
+  {
+    *error = HAPLO_ERROR_LENGTH_MISMATCH;
+    return NULL;
+  }
+
+  HaploMatrix *matrix = haplo_matrix_view(haplo_array_ref(array),
+                                          array->data.f64, rows, cols, cols);
+  if (UNLIKELY(!matrix)) *error = HAPLO_ERROR_OUT_OF_MEMORY;
+  return matrix;
+}
+
+HaploMatrix *haplo_matrix_ref(HaploMatrix *matrix)
+{
+  if (matrix) matrix->refcount++;
+  return matrix;
+}
+
+void haplo_matrix_free(HaploMatrix *matrix)
+{
+  if (!matrix || --matrix->refcount != 0) return;
+
+  haplo_array_free(matrix->storage);
+  haplo_free(matrix);
+  return;
+}
+
+// The product is accumulated one block at a time: each row of a block
+// of the result is updated with the rows of a block of b, scaled by
+// the elements of a, so the inner loop runs on contiguous rows
+HaploMatrix *haplo_matrix_mul(HaploMatrix *a, HaploMatrix *b, int *error)
+{
+  assert(a && b);
+  if (a->cols != b->rows)
+  {
+    *error = HAPLO_ERROR_LENGTH_MISMATCH;
+    return NULL;
+  }
+
+  HaploMatrix *out = haplo_matrix_new(a->rows, b->cols);
+  if (UNLIKELY(!out))
+  {
+    *error = HAPLO_ERROR_OUT_OF_MEMORY;
+    return NULL;
+  }
+
+  for (int ii = 0; ii < a->rows; ii += HAPLO_MATRIX_BLOCK)
+  {
+    int i_end = HAPLO_MATRIX_MIN(ii + HAPLO_MATRIX_BLOCK, a->rows);
+    for (int kk = 0; kk < a->cols; kk += HAPLO_MATRIX_BLOCK)
+    {
+      int k_end = HAPLO_MATRIX_MIN(kk + HAPLO_MATRIX_BLOCK, a->cols);
+      for (int jj = 0; jj < b->cols; jj += HAPLO_MATRIX_BLOCK)
+      {
+        int j_len = HAPLO_MATRIX_MIN(jj + HAPLO_MATRIX_BLOCK, b->cols) - jj;
+        for (int i = ii; i < i_end; ++i)
+          for (int k = kk; k < k_end; ++k)
+            haplo_array_f64_axpy(&haplo_matrix_at(out, i, jj),
+                                 haplo_matrix_at(a, i, k),
+                                 &haplo_matrix_at(b, k, jj), j_len);
+      }
+    }
+  }
+  return out;
+}
+
+HaploMatrix *haplo_matrix_transpose(HaploMatrix *matrix, int *error)
+{
+  assert(matrix);
+  HaploMatrix *out = haplo_matrix_new(matrix->cols, matrix->rows);
+  if (UNLIKELY(!out))
+  {
+    *error = HAPLO_ERROR_OUT_OF_MEMORY;
+    return NULL;
+  }
+
+  // Reads go along the rows and writes along the columns of a block,
+  // both fit in the cache
+  for (int ii = 0; ii < matrix->rows; ii += HAPLO_MATRIX_BLOCK)
+  {
+    int i_end = HAPLO_MATRIX_MIN(ii + HAPLO_MATRIX_BLOCK, matrix->rows);
+    for (int jj = 0; jj < matrix->cols; jj += HAPLO_MATRIX_BLOCK)
+    {
+      int j_end = HAPLO_MATRIX_MIN(jj + HAPLO_MATRIX_BLOCK, matrix->cols);
+      for (int i = ii; i < i_end; ++i)
+        for (int j = jj; j < j_end; ++j)
+          haplo_matrix_at(out, j, i) = haplo_matrix_at(matrix, i, j);
+    }
+  }
+  return out;
+}
+
+HaploMatrix *haplo_matrix_slice_rows(HaploMatrix *matrix, int start, int end,
+                                     int *error)
+{
+  assert(matrix);
+  if (start < 0 || end < start || end > matrix->rows)
+  {
+    *error = HAPLO_ERROR_INDEX_OUT_OF_BOUNDS;
+    return NULL;
+  }
+
+  HaploMatrix *view = haplo_matrix_view(haplo_array_ref(matrix->storage),
+                                        matrix->data + (long) start * matrix->stride,
+                                        end - start, matrix->cols, matrix->stride);
+  if (UNLIKELY(!view)) *error = HAPLO_ERROR_OUT_OF_MEMORY;
+  return view;
+}
+
+HaploMatrix *haplo_matrix_slice_cols(HaploMatrix *matrix, int start, int end,
+                                     int *error)
+{
+  assert(matrix);
+  if (start < 0 || end < start || end > matrix->cols)
+  {
+    *error = HAPLO_ERROR_INDEX_OUT_OF_BOUNDS;
+    return NULL;
+  }
+
+  HaploMatrix *view = haplo_matrix_view(haplo_array_ref(matrix->storage),
+                                        matrix->data + start,
+                                        matrix->rows, end - start, matrix->stride);
+  if (UNLIKELY(!view)) *error = HAPLO_ERROR_OUT_OF_MEMORY;
+  return view;
+}
+
+HaploMatrix *haplo_matrix_sum(HaploMatrix *matrix, int axis, int *error)
+{
+  assert(matrix);
+  if (axis != 0 && axis != 1)
+  {
+    *error = HAPLO_ERROR_INDEX_OUT_OF_BOUNDS;
+    return NULL;
+  }
+
+  HaploMatrix *out = (axis == 0) ? haplo_matrix_new(1, matrix->cols)
+                                 : haplo_matrix_new(matrix->rows, 1);
+  if (UNLIKELY(!out))
+  {
+    *error = HAPLO_ERROR_OUT_OF_MEMORY;
+    return NULL;
+  }
+
+  for (int i = 0; i < matrix->rows; ++i)
+  {
+    double *row = &haplo_matrix_at(matrix, i, 0);
+    if (axis == 0)
+      haplo_array_f64_axpy(out->data, 1.0, row, matrix->cols);
+    else
+      out->data[i] = haplo_array_f64_total(row, matrix->cols);
+  }
+  return out;
+}
+
+int haplo_matrix_string(HaploMatrix *matrix, char *buf, int buf_len)
+{
+  int offset = haplo_snprintf_clamp(snprintf(buf, buf_len, "matrix: "), buf_len);
+  for (int i = 0; i < matrix->rows && offset < buf_len - 1; ++i)
+  {
+    offset += haplo_snprintf_clamp(snprintf(buf + offset, buf_len - offset, "["),
+                                   buf_len - offset);
+    for (int j = 0; j < matrix->cols; ++j)
+    {
+      char number[HAPLO_FMT_DOUBLE_MAX];
+      haplo_fmt_double(number, haplo_matrix_at(matrix, i, j));
+      offset += haplo_snprintf_clamp(snprintf(buf + offset, buf_len - offset,
+                                              (j == 0) ? "%s" : " %s", number),
+                                     buf_len - offset);
+    }
+    offset += haplo_snprintf_clamp(snprintf(buf + offset, buf_len - offset, "] "),
+                                   buf_len - offset);
+  }
+  return offset;
+}
@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#ifndef HAPLO_MATRIX_H
+#define HAPLO_MATRIX_H
+
+#include "value.h"
+#include "array.h"
+
+//
+// Macros
+//
+
+#ifdef HAPLO_NO_PREFIX
+  #define Matrix HaploMatrix
+  #define matrix_new haplo_matrix_new
+  #define matrix_from_array haplo_matrix_from_array
+  #define matrix_ref haplo_matrix_ref
+  #define matrix_free haplo_matrix_free
+  #define matrix_at haplo_matrix_at
+  #define matrix_mul haplo_matrix_mul
+  #define matrix_transpose haplo_matrix_transpose
+  #define matrix_slice_rows haplo_matrix_slice_rows
+  #define matrix_slice_cols haplo_matrix_slice_cols
+  #define matrix_sum haplo_matrix_sum
+  #define matrix_string haplo_matrix_string
+#endif // HAPLO_NO_PREFIX
+
+// Matrix multiplication and transposition work on square blocks of
+// HAPLO_MATRIX_BLOCK elements per side, so that the rows in use stay
+// in the cache
+#ifndef HAPLO_MATRIX_BLOCK
+#define HAPLO_MATRIX_BLOCK 64
+#endif // HAPLO_MATRIX_BLOCK
+
+// The element at row and col of matrix
+#define haplo_matrix_at(matrix, row, col) \
+  ((matrix)->data[(row) * (matrix)->stride + (col)])
+
+//
+// Types
+//
+
+// A dense matrix of f64 elements in row major order. The elements are
+// stored in an f64 array, slices are views on the same array with a
+// different offset and size. Like arrays, matrices are never modified
+// once they are filled, so they are shared by reference.
+struct HaploMatrix {
+  HaploArray *storage;
+  // The first element, inside storage
+  double *data;
+  int rows;
+  int cols;
+  // The number of elements between the starts of two rows
+  int stride;
+  unsigned int refcount;
+};
+
+//
+// Functions
+//
+
+// Returns a matrix of zeros, or NULL if out of memory or if the size
+// is too big
+HaploMatrix *haplo_matrix_new(int rows, int cols);
+// Returns a matrix sharing the elements of array, which must be an
+// f64 array of rows * cols elements. Returns NULL and sets error on
+// failure.
+HaploMatrix *haplo_matrix_from_array(int rows, int cols, HaploArray *array,
+                                     int *error);
+// Returns a new reference to matrix
+HaploMatrix *haplo_matrix_ref(HaploMatrix *matrix);
+// Drops a reference to matrix
+void haplo_matrix_free(HaploMatrix *matrix);
+// The following functions return a new matrix, or NULL and set error
+// on failure
+// Returns the product of a and b, a must have as many cols as b rows
+HaploMatrix *haplo_matrix_mul(HaploMatrix *a, HaploMatrix *b, int *error);
+HaploMatrix *haplo_matrix_transpose(HaploMatrix *matrix, int *error);
+// Returns a view on the rows in [start, end) of matrix
+HaploMatrix *haplo_matrix_slice_rows(HaploMatrix *matrix, int start, int end,
+                                     int *error);
+// Returns a view on the columns in [start, end) of matrix
+HaploMatrix *haplo_matrix_slice_cols(HaploMatrix *matrix, int start, int end,
+                                     int *error);
+// Sums the elements along axis: 0 adds up the rows into a single row,
+// 1 adds up the columns into a single column
+HaploMatrix *haplo_matrix_sum(HaploMatrix *matrix, int axis, int *error);
+// Returns the number of bytes written to buf. At most buf_len bytes
+// will be written.
+int haplo_matrix_string(HaploMatrix *matrix, char *buf, int buf_len);
+
+#endif // HAPLO_MATRIX_H
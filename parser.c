@@ -7,14 +7,15 @@
 #include "errors.h"
 
 #include <stdlib.h>
-#include <assert.h>
 
-int haplo_parser_init(HaploParser *parser, char *input, unsigned int len)
+int haplo_parser_init(HaploParser *parser, char *input, unsigned int len,
+                      HaploAllocator *allocator)
 {
   if (!parser) return HAPLO_ERROR_PARSER_NULL;
   if (!input) return HAPLO_ERROR_PARSER_INPUT_NULL;
 
   parser->error = 0;
+  parser->allocator = allocator ? allocator : &haplo_default_allocator;
   
   haplo_lexer_init(&parser->lexer, input, len, &haplo_default_token_char);
   
@@ -40,7 +41,11 @@ bool haplo_parser_check_error(HaploParser *parser)
 
 _Static_assert(_HAPLO_LEX_MAX == 7,
               "Updated HaploToken, maybe update haplo_parser_parse_rec");
-HaploExpr *haplo_parser_parse_rec(HaploParser *parser)
+// Parses the rest of a list into *slot. Each expression is linked to
+// its parent as soon as it is allocated, so everything parsed so far
+// is reachable from parser->root and is freed from there when an
+// error jumps out.
+static HaploExpr *haplo_parser_parse_rec(HaploParser *parser, HaploExpr **slot)
 {
   if (!parser) return NULL;  
   parser->error = 0;
@@ -48,8 +53,13 @@ HaploExpr *haplo_parser_parse_rec(HaploParser *parser)
   int ret;
   HaploToken token = HAPLO_LEX_NONE;
   HaploAtom atom = {0};
-  HaploExpr *expr = calloc(1, sizeof(HaploExpr));
-  assert(expr);
+  HaploExpr *expr = haplo_calloc(1, sizeof(HaploExpr));
+  *slot = expr;
+  if (!expr)
+  {
+    parser->error = HAPLO_ERROR_OUT_OF_MEMORY;
+    HAPLO_PARSER_ERROR();
+  }
   
   // Head expression
 
@@ -58,6 +68,7 @@ HaploExpr *haplo_parser_parse_rec(HaploParser *parser)
   {
     parser->error = ret;
     haplo_expr_free(expr);
+    *slot = NULL;
     if (parser->error == HAPLO_ERROR_LEXER_END_OF_INPUT)
       return NULL;
     
@@ -74,26 +85,29 @@ HaploExpr *haplo_parser_parse_rec(HaploParser *parser)
     if (ret < 0)
     {
       parser->error = ret;
-      haplo_expr_free(expr);
       HAPLO_PARSER_ERROR();
     }
     
     if (token != HAPLO_LEX_ATOM)
     {
       parser->error = HAPLO_ERROR_PARSER_UNEXPECTED_TOKEN;
-      haplo_expr_free(expr);
       HAPLO_PARSER_ERROR();
     }
     if (atom.type != HAPLO_ATOM_SYMBOL)
     {
       haplo_atom_free(&atom);
       parser->error = HAPLO_ERROR_PARSER_UNEXPECTED_TOKEN;
-      haplo_expr_free(expr);
       HAPLO_PARSER_ERROR();
     }
 
     atom.type = HAPLO_ATOM_QUOTE;
-    expr->head = malloc(sizeof(HaploExpr));
+    expr->head = haplo_alloc(sizeof(HaploExpr));
+    if (!expr->head)
+    {
+      haplo_atom_free(&atom);
+      parser->error = HAPLO_ERROR_OUT_OF_MEMORY;
+      HAPLO_PARSER_ERROR();
+    }
     *expr->head = (HaploExpr){
       .is_atom = true,
       .atom = atom,
@@ -105,10 +119,15 @@ HaploExpr *haplo_parser_parse_rec(HaploParser *parser)
     if (ret < 0)
     {
       parser->error = ret;
-      haplo_expr_free(expr);
       HAPLO_PARSER_ERROR();
     }
-    expr->head = malloc(sizeof(HaploExpr));
+    expr->head = haplo_alloc(sizeof(HaploExpr));
+    if (!expr->head)
+    {
+      haplo_atom_free(&atom);
+      parser->error = HAPLO_ERROR_OUT_OF_MEMORY;
+      HAPLO_PARSER_ERROR();
+    }
     *expr->head = (HaploExpr){
       .is_atom = true,
       .atom = atom,
@@ -118,18 +137,16 @@ HaploExpr *haplo_parser_parse_rec(HaploParser *parser)
 
     haplo_lexer_next(&parser->lexer, NULL, NULL);
     
-    expr->head = haplo_parser_parse_rec(parser);
+    haplo_parser_parse_rec(parser, &expr->head);
 
     ret = haplo_lexer_peek(&parser->lexer, &token, &atom);
     if (ret < 0)
     {
       parser->error = ret;
-      haplo_expr_free(expr);    
       HAPLO_PARSER_ERROR();
     }
     if (token != HAPLO_LEX_CLOSE)
     {
-      haplo_expr_free(expr);
       if (token == HAPLO_LEX_ATOM)
         haplo_atom_free(&atom);
       parser->error = HAPLO_ERROR_MALFORMED_PARENTHESIS;
@@ -139,40 +156,53 @@ HaploExpr *haplo_parser_parse_rec(HaploParser *parser)
     if (ret < 0)
     {
       parser->error = ret;
-      haplo_expr_free(expr);    
       HAPLO_PARSER_ERROR();
     }
     break;
   case HAPLO_LEX_CLOSE:
-    haplo_expr_free(expr);
-    return NULL;
   case HAPLO_LEX_EOF:
     haplo_expr_free(expr);
+    *slot = NULL;
     return NULL;
   default:
-    haplo_expr_free(expr);
     parser->error = HAPLO_ERROR_PARSER_TOKEN_UNRECOGNIZED;
     HAPLO_PARSER_ERROR();
   }
 
   // Optional tail expression
-  expr->tail = haplo_parser_parse_rec(parser);
+  haplo_parser_parse_rec(parser, &expr->tail);
   return expr;
 }
 
+static HaploExpr *haplo_parser_parse_expr(HaploParser *parser);
+
 HaploExpr *haplo_parser_parse(HaploParser *parser)
 {
   if (!parser) return NULL;
   if (!parser->lexer.input) return NULL;
   if (parser->lexer.input_size == 0) return NULL;
   parser->error = 0;
+  parser->root = NULL;
 
+  HaploAllocator *prev = haplo_allocator_bind(parser->allocator);
   if (setjmp(parser->jump_buf)) {
-    // The parser jumps here when it encounters an error
+    // The parser jumps here when it encounters an error. What was
+    // parsed is freed, or it would stay charged to the allocator.
+    haplo_expr_free(parser->root);
+    parser->root = NULL;
+    haplo_allocator_bind(prev);
     haplo_parser_dump(parser);
     return NULL;
   }
 
+  HaploExpr *expr = haplo_parser_parse_expr(parser);
+  parser->root = NULL;
+  haplo_allocator_bind(prev);
+  return expr;
+}
+
+static HaploExpr *haplo_parser_parse_expr(HaploParser *parser)
+{
   int ret;
   HaploToken token = HAPLO_LEX_NONE;
   HaploAtom atom = {0};
@@ -197,18 +227,16 @@ HaploExpr *haplo_parser_parse(HaploParser *parser)
   {
     haplo_lexer_next(&parser->lexer, NULL, NULL);
     
-    expr = haplo_parser_parse_rec(parser);
+    expr = haplo_parser_parse_rec(parser, &parser->root);
 
     ret = haplo_lexer_peek(&parser->lexer, &token, &atom);
     if (ret < 0)
     {
-      haplo_expr_free(expr);
       parser->error = ret;
       HAPLO_PARSER_ERROR();
     }
     if (token != HAPLO_LEX_CLOSE)
     {
-      haplo_expr_free(expr);
       if (token == HAPLO_LEX_ATOM)
         haplo_atom_free(&atom);
       parser->error = HAPLO_ERROR_MALFORMED_PARENTHESIS;
@@ -217,12 +245,11 @@ HaploExpr *haplo_parser_parse(HaploParser *parser)
     ret = haplo_lexer_next(&parser->lexer, NULL, NULL);
     if (ret < 0)
     {
-      haplo_expr_free(expr);
       HAPLO_PARSER_ERROR();
     }
     return expr;
   }
 
-  expr = haplo_parser_parse_rec(parser);
+  expr = haplo_parser_parse_rec(parser, &parser->root);
   return expr;
 }
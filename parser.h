@@ -9,6 +9,7 @@
 #include "atom.h"
 #include "expr.h"
 #include "lexer.h"
+#include "alloc.h"
 
 #include <stdio.h>
 #include <stdbool.h>
@@ -40,13 +41,18 @@ typedef struct {
   HaploLexer lexer;
   int error;
   jmp_buf jump_buf;
+  HaploAllocator *allocator;  // used for the expressions
+  // The expression being parsed, freed if an error jumps out
+  HaploExpr *root;
 } HaploParser;
 
 //
 // Functions
 //
 
-int haplo_parser_init(HaploParser *parser, char *input, unsigned int len);
+// A NULL allocator selects haplo_default_allocator
+int haplo_parser_init(HaploParser *parser, char *input, unsigned int len,
+                      HaploAllocator *allocator);
 int haplo_parser_dump(HaploParser *parser);
 bool haplo_parser_check_error(HaploParser *parser);
 HaploExpr *haplo_parser_parse(HaploParser *parser);
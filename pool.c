@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "pool.h"
+#include "errors.h"
+
+#include <stdint.h>
+#include <assert.h>
+
+// Cells start after the slab header, keeping them 16 bytes aligned
+#define HAPLO_POOL_SLAB_HEADER_SIZE \
+  ((sizeof(HaploPoolSlab) + 15) & ~(size_t)15)
+
+int haplo_pool_init(HaploPool *pool, size_t cell_size,
+                    HaploAllocator *allocator)
+{
+  if (!pool) return HAPLO_ERROR_POOL_NULL;
+  if (cell_size < sizeof(HaploPoolCell)) cell_size = sizeof(HaploPoolCell);
+
+  pool->cell_size = (cell_size + 15) & ~(size_t)15;
+  pool->allocator = allocator ? allocator : &haplo_default_allocator;
+  pool->slabs = NULL;
+  pool->free_list = NULL;
+  pool->bump = NULL;
+  pool->bump_end = NULL;
+
+  assert(pool->cell_size <= HAPLO_POOL_SLAB_SIZE - HAPLO_POOL_SLAB_HEADER_SIZE);
+  return 0;
+}
+
+void haplo_pool_destroy(HaploPool *pool)
+{
+  if (!pool) return;
+
+  HaploPoolSlab *slab = pool->slabs;
+  while (slab)
+  {
+    HaploPoolSlab *next = slab->next;
+    haplo_allocator_free(pool->allocator, slab, HAPLO_POOL_SLAB_SIZE);
+    slab = next;
+  }
+
+  pool->slabs = NULL;
+  pool->free_list = NULL;
+  pool->bump = NULL;
+  pool->bump_end = NULL;
+  return;
+}
+
+static int haplo_pool_grow(HaploPool *pool)
+{
+  void *mem = haplo_allocator_alloc(pool->allocator, HAPLO_POOL_SLAB_SIZE,
+                                    HAPLO_POOL_SLAB_SIZE);
+  if (!mem) return -1;
+
+  HaploPoolSlab *slab = (HaploPoolSlab*) mem;
+  slab->pool = pool;
+  slab->next = pool->slabs;
+  pool->slabs = slab;
+
+  // Cells are handed out lazily from the new slab instead of being
+  // threaded into the free list all at once
+  pool->bump = (char*) mem + HAPLO_POOL_SLAB_HEADER_SIZE;
+  pool->bump_end = (char*) mem + HAPLO_POOL_SLAB_SIZE;
+  return 0;
+}
+
+void *haplo_pool_alloc(HaploPool *pool)
+{
+  if (!pool) return NULL;
+
+  HaploPoolCell *cell = pool->free_list;
+  if (cell)
+  {
+    pool->free_list = cell->next;
+    return cell;
+  }
+
+  if (pool->bump == NULL ||
+      (size_t)(pool->bump_end - pool->bump) < pool->cell_size)
+  {
+    if (haplo_pool_grow(pool) < 0) return NULL;
+  }
+
+  void *out = pool->bump;
+  pool->bump += pool->cell_size;
+  return out;
+}
+
+void haplo_pool_free(void *cell)
+{
+  if (!cell) return;
+
+  HaploPoolSlab *slab = (HaploPoolSlab*)
+    ((uintptr_t) cell & ~((uintptr_t) HAPLO_POOL_SLAB_SIZE - 1));
+  HaploPool *pool = slab->pool;
+
+  HaploPoolCell *free_cell = (HaploPoolCell*) cell;
+  free_cell->next = pool->free_list;
+  pool->free_list = free_cell;
+  return;
+}
@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#ifndef HAPLO_POOL_H
+#define HAPLO_POOL_H
+
+#include "alloc.h"
+
+#include <stddef.h>
+
+//
+// Macros
+//
+
+#ifdef HAPLO_NO_PREFIX
+  #define Pool HaploPool
+  #define PoolSlab HaploPoolSlab
+  #define PoolCell HaploPoolCell
+  #define pool_init haplo_pool_init
+  #define pool_destroy haplo_pool_destroy
+  #define pool_alloc haplo_pool_alloc
+  #define pool_free haplo_pool_free
+#endif // HAPLO_NO_PREFIX
+
+// Size and alignment of a slab, must be a power of two. Cells are
+// carved out of slabs, and the owner of a cell is found by masking
+// its address with the slab size.
+#ifndef HAPLO_POOL_SLAB_SIZE
+#define HAPLO_POOL_SLAB_SIZE (16 * 1024)
+#endif // HAPLO_POOL_SLAB_SIZE
+
+//
+// Types
+//
+
+struct HaploPool;
+typedef struct HaploPool HaploPool;
+
+struct HaploPoolSlab;
+typedef struct HaploPoolSlab HaploPoolSlab;
+
+// Header at the start of every slab
+struct HaploPoolSlab {
+  HaploPool *pool;
+  HaploPoolSlab *next;
+};
+
+// A free cell, the link is stored inside the cell itself
+struct HaploPoolCell;
+typedef struct HaploPoolCell HaploPoolCell;
+
+struct HaploPoolCell {
+  HaploPoolCell *next;
+};
+
+// A pool of fixed size cells. A pool is not thread safe, it is meant
+// to be owned by a single interpreter.
+struct HaploPool {
+  size_t cell_size;
+  HaploAllocator *allocator;  // where slabs come from
+  HaploPoolSlab *slabs;
+  HaploPoolCell *free_list;
+  char *bump;        // next never used cell in the newest slab
+  char *bump_end;
+};
+
+//
+// Functions
+//
+
+// A NULL allocator selects haplo_default_allocator
+int haplo_pool_init(HaploPool *pool, size_t cell_size,
+                    HaploAllocator *allocator);
+// Releases all the slabs at once, every cell allocated from the pool
+// becomes invalid.
+void haplo_pool_destroy(HaploPool *pool);
+// Returns a cell of pool->cell_size bytes, or NULL if a new slab
+// could not be allocated
+void *haplo_pool_alloc(HaploPool *pool);
+// Gives the cell back to the pool that allocated it
+void haplo_pool_free(void *cell);
+
+#endif // HAPLO_POOL_H
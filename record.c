@@ -0,0 +1,111 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "record.h"
+#include "utils.h"
+#include "alloc.h"
+
+#include <stdio.h>
+#include <string.h>
+
+HaploShape *haplo_shape_new(const char *name, const char **fields,
+                            int field_count)
+{
+  HaploShape *shape = haplo_alloc(sizeof(HaploShape));
+  if (UNLIKELY(!shape)) return NULL;
+
+  shape->field_count = 0;
+  shape->refcount = 1;
+  shape->name = haplo_strdup(name);
+  shape->fields = haplo_calloc(field_count > 0 ? field_count : 1, sizeof(char*));
+  if (UNLIKELY(!shape->name || !shape->fields)) goto out_of_memory;
+
+  for (; shape->field_count < field_count; ++shape->field_count)
+  {
+    shape->fields[shape->field_count] = haplo_strdup(fields[shape->field_count]);
+    if (UNLIKELY(!shape->fields[shape->field_count])) goto out_of_memory;
+  }
+  return shape;
+
+ out_of_memory:
+  haplo_shape_free(shape);
+  return NULL;
+}
+
+HaploShape *haplo_shape_ref(HaploShape *shape)
+{
+  if (shape) shape->refcount++;
+  return shape;
+}
+
+void haplo_shape_free(HaploShape *shape)
+{
+  if (!shape || --shape->refcount != 0) return;
+
+  for (int i = 0; i < shape->field_count; ++i)
+    haplo_free(shape->fields[i]);
+  haplo_free(shape->fields);
+  haplo_free(shape->name);
+  haplo_free(shape);
+  return;
+}
+
+int haplo_shape_field(HaploShape *shape, const char *field)
+{
+  for (int i = 0; i < shape->field_count; ++i)
+    if (strcmp(shape->fields[i], field) == 0)
+      return i;
+  return -1;
+}
+
+HaploRecord *haplo_record_new(HaploShape *shape)
+{
+  HaploRecord *record = haplo_alloc(sizeof(HaploRecord)
+                                    + shape->field_count * sizeof(HaploValue));
+  if (UNLIKELY(!record)) return NULL;
+
+  record->shape = haplo_shape_ref(shape);
+  record->refcount = 1;
+  for (int i = 0; i < shape->field_count; ++i)
+    record->slots[i] = (HaploValue) { .type = HAPLO_VAL_EMPTY };
+  return record;
+}
+
+HaploRecord *haplo_record_ref(HaploRecord *record)
+{
+  if (record) record->refcount++;
+  return record;
+}
+
+void haplo_record_free(HaploRecord *record)
+{
+  if (!record || --record->refcount != 0) return;
+
+  for (int i = 0; i < record->shape->field_count; ++i)
+    haplo_value_free(record->slots[i]);
+  haplo_shape_free(record->shape);
+  haplo_free(record);
+  return;
+}
+
+int haplo_record_string(HaploRecord *record, char *buf, int buf_len)
+{
+  HaploShape *shape = record->shape;
+  int offset = haplo_snprintf_clamp(snprintf(buf, buf_len, "%s: ", shape->name),
+                                    buf_len);
+  for (int i = 0; i < shape->field_count && offset < buf_len - 1; ++i)
+  {
+    offset += haplo_snprintf_clamp(snprintf(buf + offset, buf_len - offset,
+                                            "%s=", shape->fields[i]),
+                                   buf_len - offset);
+    offset += haplo_snprintf_clamp(haplo_value_string(record->slots[i],
+                                                      buf + offset,
+                                                      buf_len - offset),
+                                   buf_len - offset);
+    offset += haplo_snprintf_clamp(snprintf(buf + offset, buf_len - offset, " "),
+                                   buf_len - offset);
+  }
+  return offset;
+}
@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#ifndef HAPLO_RECORD_H
+#define HAPLO_RECORD_H
+
+#include "value.h"
+
+//
+// Macros
+//
+
+#ifdef HAPLO_NO_PREFIX
+  #define Shape HaploShape
+  #define Record HaploRecord
+  #define shape_new haplo_shape_new
+  #define shape_ref haplo_shape_ref
+  #define shape_free haplo_shape_free
+  #define shape_field haplo_shape_field
+  #define record_new haplo_record_new
+  #define record_ref haplo_record_ref
+  #define record_free haplo_record_free
+  #define record_string haplo_record_string
+#endif // HAPLO_NO_PREFIX
+
+//
+// Types
+//
+
+// The layout of a record, declared once by defrecord and shared by
+// all of its instances
+struct HaploShape;
+typedef struct HaploShape HaploShape;
+struct HaploShape {
+  char *name;
+  char **fields;
+  int field_count;
+  unsigned int refcount;
+};
+
+// An instance of a shape, its fields are stored in slots in the order
+// of the shape. Like vectors, records are mutable and shared by
+// reference.
+struct HaploRecord {
+  HaploShape *shape;
+  unsigned int refcount;
+  HaploValue slots[];
+};
+
+//
+// Functions
+//
+
+// Returns a shape with a copy of name and fields, or NULL if out of
+// memory
+HaploShape *haplo_shape_new(const char *name, const char **fields,
+                            int field_count);
+// Returns a new reference to shape
+HaploShape *haplo_shape_ref(HaploShape *shape);
+void haplo_shape_free(HaploShape *shape);
+// Returns the slot of field in shape, or -1
+int haplo_shape_field(HaploShape *shape, const char *field);
+// Returns a record of shape with EMPTY slots, or NULL if out of
+// memory
+HaploRecord *haplo_record_new(HaploShape *shape);
+// Returns a new reference to record
+HaploRecord *haplo_record_ref(HaploRecord *record);
+// Drops a reference to record, its slots are freed with the last one
+void haplo_record_free(HaploRecord *record);
+// Returns the number of bytes written to buf. At most buf_len bytes
+// will be written.
+int haplo_record_string(HaploRecord *record, char *buf, int buf_len);
+
+#endif // HAPLO_RECORD_H
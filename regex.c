@@ -0,0 +1,1242 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "regex.h"
+#include "errors.h"
+#include "alloc.h"
+#include "utf8.h"
+#include "utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define HAPLO_REGEX_HAS(class, byte) \
+  (((class)->bits[(byte) >> 3] >> ((byte) & 7)) & 1)
+#define HAPLO_REGEX_ADD(class, byte) \
+  ((class)->bits[(byte) >> 3] |= (uint8_t) (1 << ((byte) & 7)))
+// Groups nested deeper are rejected, so parsing can't overflow the
+// stack
+#define HAPLO_REGEX_MAX_DEPTH 256
+// The size of the hash table of the DFA states, a power of two
+#define HAPLO_REGEX_DFA_TABLE_SIZE (2 * HAPLO_REGEX_DFA_MAX_STATES)
+#define HAPLO_REGEX_CODEPOINT_MAX 0x10ffff
+// How many byte ranges a pattern shares classes for, and how many
+// states the sequences of a set share
+#define HAPLO_REGEX_BYTE_RANGES_MAX 64
+#define HAPLO_REGEX_SUFFIXES_MAX 64
+
+typedef enum {
+  HAPLO_REGEX_NODE_CLASS = 0,
+  HAPLO_REGEX_NODE_EMPTY,
+  HAPLO_REGEX_NODE_CONCAT,
+  HAPLO_REGEX_NODE_ALT,
+  HAPLO_REGEX_NODE_REPEAT,    // left from min to max times, -1 is unbounded
+  HAPLO_REGEX_NODE_UTF8,      // right sequences from left, one of them
+} HaploRegexNodeType;
+
+typedef struct {
+  HaploRegexNodeType type;
+  int left;
+  int right;
+  int min;
+  int max;
+  int class;
+} HaploRegexNode;
+
+// Codepoints from low to high
+typedef struct {
+  int low;
+  int high;
+} HaploRegexRange;
+
+// The encoding of some codepoints, with a class for each byte
+typedef struct {
+  int len;
+  int class[4];
+} HaploRegexSequence;
+
+typedef struct {
+  unsigned char low;
+  unsigned char high;
+  int class;
+} HaploRegexByteRange;
+
+// Sets of codepoints, like . and [^a], are read as an ASCII class and
+// ranges of the other codepoints. Their UTF-8 encodings are split in
+// sequences of byte classes, so that the DFA reads whole codepoints.
+typedef struct {
+  const char *pattern;
+  int len;
+  int pos;
+  int depth;
+  HaploRegexNode *nodes;
+  int node_count;
+  int node_capacity;
+  int class_capacity;
+  // The codepoints above 0x7f of the set being read
+  HaploRegexRange *ranges;
+  int range_count;
+  int range_capacity;
+  HaploRegexSequence *sequences;
+  int sequence_count;
+  int sequence_capacity;
+  HaploRegexByteRange byte_ranges[HAPLO_REGEX_BYTE_RANGES_MAX];
+  int byte_range_count;
+  HaploRegex *regex;
+  int err;
+} HaploRegexParser;
+
+//
+// Parser
+//
+
+// Returns the index of a copy of node, or -1 and sets the error
+static int haplo_regex_node_new(HaploRegexParser *parser, HaploRegexNode node)
+{
+  if (parser->node_count == parser->node_capacity)
+  {
+    int capacity = parser->node_capacity ? 2 * parser->node_capacity : 16;
+    HaploRegexNode *nodes = haplo_realloc(parser->nodes,
+                                          capacity * sizeof(HaploRegexNode));
+    if (UNLIKELY(!nodes))
+    {
+      parser->err = HAPLO_ERROR_OUT_OF_MEMORY;
+      return -1;
+    }
+    parser->nodes = nodes;
+    parser->node_capacity = capacity;
+  }
+  parser->nodes[parser->node_count] = node;
+  return parser->node_count++;
+}
+
+// Returns the index of a new empty class, or -1 and sets the error
+static int haplo_regex_class_new(HaploRegexParser *parser)
+{
+  HaploRegex *regex = parser->regex;
+  if (regex->class_count == parser->class_capacity)
+  {
+    int capacity = parser->class_capacity ? 2 * parser->class_capacity : 16;
+    HaploRegexClass *classes = haplo_realloc(regex->classes,
+                                             capacity * sizeof(HaploRegexClass));
+    if (UNLIKELY(!classes))
+    {
+      parser->err = HAPLO_ERROR_OUT_OF_MEMORY;
+      return -1;
+    }
+    regex->classes = classes;
+    parser->class_capacity = capacity;
+  }
+  memset(&regex->classes[regex->class_count], 0, sizeof(HaploRegexClass));
+  return regex->class_count++;
+}
+
+static int haplo_regex_syntax_error(HaploRegexParser *parser)
+{
+  parser->err = HAPLO_ERROR_REGEX_SYNTAX;
+  return -1;
+}
+
+static void haplo_regex_class_range(HaploRegexClass *class, int low, int high)
+{
+  for (int byte = low; byte <= high; ++byte)
+    HAPLO_REGEX_ADD(class, byte);
+}
+
+static void haplo_regex_class_invert(HaploRegexClass *class)
+{
+  for (int i = 0; i < 32; ++i)
+    class->bits[i] = (uint8_t) ~class->bits[i];
+}
+
+// Adds the bytes of the escape \c to class. Returns the byte if the
+// escape is a single one, -1 if it is a set, or -2 if it is not valid.
+static int haplo_regex_escape(HaploRegexClass *class, unsigned char c)
+{
+  HaploRegexClass set = {0};
+  int byte = -1;
+  switch(c)
+  {
+  case 'd': case 'D':
+    haplo_regex_class_range(&set, '0', '9');
+    break;
+  case 'w': case 'W':
+    haplo_regex_class_range(&set, '0', '9');
+    haplo_regex_class_range(&set, 'a', 'z');
+    haplo_regex_class_range(&set, 'A', 'Z');
+    HAPLO_REGEX_ADD(&set, '_');
+    break;
+  case 's': case 'S':
+    haplo_regex_class_range(&set, '\t', '\r');
+    HAPLO_REGEX_ADD(&set, ' ');
+    break;
+  case 'n': byte = '\n'; break;
+  case 'r': byte = '\r'; break;
+  case 't': byte = '\t'; break;
+  case 'f': byte = '\f'; break;
+  case 'v': byte = '\v'; break;
+  default:
+    // Other letters and digits are kept for future escapes
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))
+      return -2;
+    byte = c;
+    break;
+  }
+
+  if (byte >= 0)
+  {
+    HAPLO_REGEX_ADD(class, byte);
+    return byte;
+  }
+  if (c == 'D' || c == 'W' || c == 'S') haplo_regex_class_invert(&set);
+  for (int i = 0; i < 32; ++i) class->bits[i] |= set.bits[i];
+  return -1;
+}
+
+// Returns the codepoint at the position of the parser, which is
+// valid UTF-8, and moves past it
+static int haplo_regex_utf8_decode(HaploRegexParser *parser)
+{
+  unsigned char lead = (unsigned char) parser->pattern[parser->pos++];
+  if (lead < 0x80) return lead;
+  int len = (lead < 0xe0) ? 2 : (lead < 0xf0) ? 3 : 4;
+  int codepoint = lead & (0x7f >> len);
+  for (int i = 1; i < len; ++i)
+    codepoint = (codepoint << 6) | ((unsigned char) parser->pattern[parser->pos++] & 0x3f);
+  return codepoint;
+}
+
+// Writes the UTF-8 encoding of codepoint to bytes, returns its length
+static int haplo_regex_utf8_encode(int codepoint, unsigned char *bytes)
+{
+  if (codepoint < 0x80)
+  {
+    bytes[0] = (unsigned char) codepoint;
+    return 1;
+  }
+  static const unsigned char leads[] = { 0, 0, 0xc0, 0xe0, 0xf0 };
+  int len = (codepoint < 0x800) ? 2 : (codepoint < 0x10000) ? 3 : 4;
+  for (int i = len - 1; i > 0; --i, codepoint >>= 6)
+    bytes[i] = (unsigned char) (0x80 | (codepoint & 0x3f));
+  bytes[0] = (unsigned char) (leads[len] | codepoint);
+  return len;
+}
+
+// Adds the codepoints from low to high above 0x7f to the set, returns
+// 0 or -1 and sets the error
+static int haplo_regex_range_add(HaploRegexParser *parser, int low, int high)
+{
+  if (parser->range_count == parser->range_capacity)
+  {
+    int capacity = parser->range_capacity ? 2 * parser->range_capacity : 16;
+    HaploRegexRange *ranges = haplo_realloc(parser->ranges,
+                                            capacity * sizeof(HaploRegexRange));
+    if (UNLIKELY(!ranges))
+    {
+      parser->err = HAPLO_ERROR_OUT_OF_MEMORY;
+      return -1;
+    }
+    parser->ranges = ranges;
+    parser->range_capacity = capacity;
+  }
+  parser->ranges[parser->range_count++] = (HaploRegexRange) { low, high };
+  return 0;
+}
+
+// Adds the codepoints from low to high to the set of ascii and the
+// ranges, returns 0 or -1 and sets the error
+static int haplo_regex_set_add(HaploRegexParser *parser, HaploRegexClass *ascii,
+                               int low, int high)
+{
+  if (low < 0x80) haplo_regex_class_range(ascii, low, (high < 0x80) ? high : 0x7f);
+  if (high < 0x80) return 0;
+  return haplo_regex_range_add(parser, (low < 0x80) ? 0x80 : low, high);
+}
+
+// Adds the escape \c to the set. Returns the byte if the escape is a
+// single one, -1 if it is a set, or -2 and sets the error.
+static int haplo_regex_set_escape(HaploRegexParser *parser, HaploRegexClass *ascii,
+                                  unsigned char c)
+{
+  HaploRegexClass set = {0};
+  int byte = haplo_regex_escape(&set, c);
+  if (byte == -2)
+  {
+    haplo_regex_syntax_error(parser);
+    return -2;
+  }
+  // The bytes above 0x7f of \D \W \S stand for all the other
+  // codepoints
+  bool others = false;
+  for (int i = 0; i < 16; ++i)
+  {
+    ascii->bits[i] |= set.bits[i];
+    others |= set.bits[16 + i] != 0;
+  }
+  if (others && haplo_regex_range_add(parser, 0x80, HAPLO_REGEX_CODEPOINT_MAX) < 0)
+    return -2;
+  return byte;
+}
+
+// Returns the class of the bytes from low to high, or -1 and sets the
+// error. The classes of the sequences are shared.
+static int haplo_regex_byte_range_class(HaploRegexParser *parser,
+                                        unsigned char low, unsigned char high)
+{
+  for (int i = 0; i < parser->byte_range_count; ++i)
+    if (parser->byte_ranges[i].low == low && parser->byte_ranges[i].high == high)
+      return parser->byte_ranges[i].class;
+
+  int class = haplo_regex_class_new(parser);
+  if (class < 0) return -1;
+  haplo_regex_class_range(&parser->regex->classes[class], low, high);
+  if (parser->byte_range_count < HAPLO_REGEX_BYTE_RANGES_MAX)
+    parser->byte_ranges[parser->byte_range_count++] =
+      (HaploRegexByteRange) { low, high, class };
+  return class;
+}
+
+// Adds the sequence of the len classes, returns 0 or -1 and sets the
+// error
+static int haplo_regex_sequence_add(HaploRegexParser *parser, const int *classes, int len)
+{
+  if (parser->sequence_count == parser->sequence_capacity)
+  {
+    int capacity = parser->sequence_capacity ? 2 * parser->sequence_capacity : 16;
+    HaploRegexSequence *sequences = haplo_realloc(parser->sequences,
+                                                  capacity * sizeof(HaploRegexSequence));
+    if (UNLIKELY(!sequences))
+    {
+      parser->err = HAPLO_ERROR_OUT_OF_MEMORY;
+      return -1;
+    }
+    parser->sequences = sequences;
+    parser->sequence_capacity = capacity;
+  }
+
+  HaploRegexSequence *sequence = &parser->sequences[parser->sequence_count++];
+  sequence->len = len;
+  memcpy(sequence->class, classes, len * sizeof(int));
+  return 0;
+}
+
+// Adds the sequences of the codepoints from low to high, above 0x7f.
+// The range is split until the encodings of its ends have the same
+// length and each byte goes over a range independent of the others,
+// like in the utf8-ranges of Rust. Returns 0 or -1 and sets the error.
+static int haplo_regex_utf8_ranges(HaploRegexParser *parser, int low, int high)
+{
+  // Surrogates are not codepoints
+  if (low <= 0xdfff && high >= 0xd800)
+  {
+    if (low < 0xd800 && haplo_regex_utf8_ranges(parser, low, 0xd7ff) < 0) return -1;
+    return (high > 0xdfff) ? haplo_regex_utf8_ranges(parser, 0xe000, high) : 0;
+  }
+
+  static const int last[] = { 0x7ff, 0xffff };
+  for (int i = 0; i < 2; ++i)
+    if (low <= last[i] && high > last[i])
+      return (haplo_regex_utf8_ranges(parser, low, last[i]) < 0) ? -1
+        : haplo_regex_utf8_ranges(parser, last[i] + 1, high);
+
+  for (int i = 1; i < 4; ++i)
+  {
+    int mask = (1 << (6 * i)) - 1;
+    if ((low & ~mask) == (high & ~mask)) continue;
+    if ((low & mask) != 0)
+      return (haplo_regex_utf8_ranges(parser, low, low | mask) < 0) ? -1
+        : haplo_regex_utf8_ranges(parser, (low | mask) + 1, high);
+    if ((high & mask) != mask)
+      return (haplo_regex_utf8_ranges(parser, low, (high & ~mask) - 1) < 0) ? -1
+        : haplo_regex_utf8_ranges(parser, high & ~mask, high);
+  }
+
+  unsigned char low_bytes[4], high_bytes[4];
+  int classes[4];
+  int len = haplo_regex_utf8_encode(low, low_bytes);
+  haplo_regex_utf8_encode(high, high_bytes);
+  for (int i = 0; i < len; ++i)
+  {
+    classes[i] = haplo_regex_byte_range_class(parser, low_bytes[i], high_bytes[i]);
+    if (classes[i] < 0) return -1;
+  }
+  return haplo_regex_sequence_add(parser, classes, len);
+}
+
+static int haplo_regex_compare_range(const void *a, const void *b)
+{
+  int x = ((const HaploRegexRange *) a)->low, y = ((const HaploRegexRange *) b)->low;
+  return (x > y) - (x < y);
+}
+
+// Returns the node of the codepoints in ascii and the ranges, or of
+// the others if negate, or -1 and sets the error
+static int haplo_regex_set_node(HaploRegexParser *parser, HaploRegexClass *ascii,
+                                bool negate)
+{
+  // Sorted and merged, the ranges can be inverted
+  HaploRegexRange *ranges = parser->ranges;
+  int count = 0;
+  if (parser->range_count > 1)
+    qsort(ranges, parser->range_count, sizeof(HaploRegexRange), haplo_regex_compare_range);
+  for (int i = 0; i < parser->range_count; ++i)
+  {
+    if (count > 0 && ranges[i].low <= ranges[count - 1].high + 1)
+    {
+      if (ranges[i].high > ranges[count - 1].high)
+        ranges[count - 1].high = ranges[i].high;
+      continue;
+    }
+    ranges[count++] = ranges[i];
+  }
+  parser->range_count = count;
+
+  if (negate)
+  {
+    for (int i = 0; i < 16; ++i) ascii->bits[i] = (uint8_t) ~ascii->bits[i];
+    int next = 0x80;
+    for (int i = 0; i < count; ++i)
+    {
+      if (parser->ranges[i].low > next
+          && haplo_regex_range_add(parser, next, parser->ranges[i].low - 1) < 0)
+        return -1;
+      next = parser->ranges[i].high + 1;
+    }
+    if (next <= HAPLO_REGEX_CODEPOINT_MAX
+        && haplo_regex_range_add(parser, next, HAPLO_REGEX_CODEPOINT_MAX) < 0)
+      return -1;
+    memmove(parser->ranges, parser->ranges + count,
+            (parser->range_count - count) * sizeof(HaploRegexRange));
+    parser->range_count -= count;
+  }
+
+  // Sets of ASCII stay a class
+  bool empty = true;
+  for (int i = 0; i < 16; ++i) empty &= ascii->bits[i] == 0;
+  int first = parser->sequence_count;
+  if (parser->range_count == 0 || !empty)
+  {
+    int class = haplo_regex_class_new(parser);
+    if (class < 0) return -1;
+    parser->regex->classes[class] = *ascii;
+    if (parser->range_count == 0)
+      return haplo_regex_node_new(parser, (HaploRegexNode) {
+          .type = HAPLO_REGEX_NODE_CLASS,
+          .class = class,
+        });
+    if (haplo_regex_sequence_add(parser, &class, 1) < 0) return -1;
+  }
+  for (int i = 0; i < parser->range_count; ++i)
+    if (haplo_regex_utf8_ranges(parser, parser->ranges[i].low, parser->ranges[i].high) < 0)
+      return -1;
+  return haplo_regex_node_new(parser, (HaploRegexNode) {
+      .type = HAPLO_REGEX_NODE_UTF8,
+      .left = first,
+      .right = parser->sequence_count - first,
+    });
+}
+
+// Returns the node of the bytes of codepoint one after the other, or
+// -1 and sets the error
+static int haplo_regex_codepoint_node(HaploRegexParser *parser, int codepoint)
+{
+  unsigned char bytes[4];
+  int len = haplo_regex_utf8_encode(codepoint, bytes);
+  int node = -1;
+  for (int i = 0; i < len; ++i)
+  {
+    int class = haplo_regex_byte_range_class(parser, bytes[i], bytes[i]);
+    if (class < 0) return -1;
+    int next = haplo_regex_node_new(parser, (HaploRegexNode) {
+        .type = HAPLO_REGEX_NODE_CLASS,
+        .class = class,
+      });
+    if (next < 0) return -1;
+    node = (i == 0) ? next : haplo_regex_node_new(parser, (HaploRegexNode) {
+        .type = HAPLO_REGEX_NODE_CONCAT,
+        .left = node,
+        .right = next,
+      });
+    if (node < 0) return -1;
+  }
+  return node;
+}
+
+// Reads a codepoint or an escape of a bracket expression into the set.
+// Returns the codepoint if it can start a range, -1 if it can't, or
+// -2 and sets the error.
+static int haplo_regex_bracket_item(HaploRegexParser *parser, HaploRegexClass *ascii)
+{
+  if (parser->pattern[parser->pos] == '\\')
+  {
+    if (++parser->pos == parser->len)
+    {
+      haplo_regex_syntax_error(parser);
+      return -2;
+    }
+    unsigned char c = (unsigned char) parser->pattern[parser->pos];
+    if (c < 0x80)
+    {
+      parser->pos++;
+      return haplo_regex_set_escape(parser, ascii, c);
+    }
+  }
+  int codepoint = haplo_regex_utf8_decode(parser);
+  if (haplo_regex_set_add(parser, ascii, codepoint, codepoint) < 0) return -2;
+  return codepoint;
+}
+
+// Parses [...] after the '[', returns the node of the set
+static int haplo_regex_parse_bracket(HaploRegexParser *parser)
+{
+  HaploRegexClass ascii = {0};
+  parser->range_count = 0;
+
+  bool negate = parser->pos < parser->len && parser->pattern[parser->pos] == '^';
+  if (negate) parser->pos++;
+  // A ']' right after the '[' is a byte of the class
+  for (bool first = true; ; first = false)
+  {
+    if (parser->pos == parser->len) return haplo_regex_syntax_error(parser);
+    if (parser->pattern[parser->pos] == ']' && !first)
+    {
+      parser->pos++;
+      break;
+    }
+
+    int low = haplo_regex_bracket_item(parser, &ascii);
+    if (low == -2) return -1;
+    if (low >= 0 && parser->pos + 1 < parser->len
+        && parser->pattern[parser->pos] == '-'
+        && parser->pattern[parser->pos + 1] != ']')
+    {
+      parser->pos++;
+      int high = haplo_regex_bracket_item(parser, &ascii);
+      if (high == -2) return -1;
+      if (high < low) return haplo_regex_syntax_error(parser);
+      if (haplo_regex_set_add(parser, &ascii, low, high) < 0) return -1;
+    }
+  }
+  return haplo_regex_set_node(parser, &ascii, negate);
+}
+
+static int haplo_regex_parse_alt(HaploRegexParser *parser);
+
+static int haplo_regex_parse_atom(HaploRegexParser *parser)
+{
+  unsigned char c = (unsigned char) parser->pattern[parser->pos++];
+  switch(c)
+  {
+  case '(': ;
+    if (++parser->depth > HAPLO_REGEX_MAX_DEPTH)
+      return haplo_regex_syntax_error(parser);
+    // Groups don't capture, (?:...) is accepted as the same
+    if (parser->pos + 1 < parser->len && parser->pattern[parser->pos] == '?'
+        && parser->pattern[parser->pos + 1] == ':')
+      parser->pos += 2;
+    int node = haplo_regex_parse_alt(parser);
+    if (node < 0) return -1;
+    if (parser->pos == parser->len || parser->pattern[parser->pos] != ')')
+      return haplo_regex_syntax_error(parser);
+    parser->pos++;
+    parser->depth--;
+    return node;
+  case '[':
+    return haplo_regex_parse_bracket(parser);
+  case '*': case '+': case '?': case '{': case '^': case '$':
+    return haplo_regex_syntax_error(parser);
+  default:
+    break;
+  }
+
+  // Other codepoints are their bytes one after the other, so that
+  // repeating them repeats all the bytes
+  HaploRegexClass ascii = {0};
+  parser->range_count = 0;
+  if (c == '.')
+  {
+    haplo_regex_class_range(&ascii, 0, 0x7f);
+    ascii.bits['\n' >> 3] &= (uint8_t) ~(1 << ('\n' & 7));
+    if (haplo_regex_range_add(parser, 0x80, HAPLO_REGEX_CODEPOINT_MAX) < 0) return -1;
+    return haplo_regex_set_node(parser, &ascii, false);
+  }
+  if (c == '\\')
+  {
+    if (parser->pos == parser->len) return haplo_regex_syntax_error(parser);
+    if ((unsigned char) parser->pattern[parser->pos] < 0x80)
+    {
+      if (haplo_regex_set_escape(parser, &ascii,
+                                 (unsigned char) parser->pattern[parser->pos++]) == -2)
+        return -1;
+      return haplo_regex_set_node(parser, &ascii, false);
+    }
+  }
+  else
+  {
+    parser->pos--;
+  }
+  return haplo_regex_codepoint_node(parser, haplo_regex_utf8_decode(parser));
+}
+
+// Reads a number of a {n,m} repetition, or returns -1
+static int haplo_regex_parse_count(HaploRegexParser *parser)
+{
+  int count = -1;
+  while (parser->pos < parser->len
+         && parser->pattern[parser->pos] >= '0' && parser->pattern[parser->pos] <= '9')
+  {
+    count = ((count < 0) ? 0 : count * 10) + (parser->pattern[parser->pos++] - '0');
+    if (count > HAPLO_REGEX_MAX_REPEAT) return -2;
+  }
+  return count;
+}
+
+static int haplo_regex_parse_repeat(HaploRegexParser *parser)
+{
+  int node = haplo_regex_parse_atom(parser);
+  while (node >= 0 && parser->pos < parser->len)
+  {
+    int min, max;
+    switch(parser->pattern[parser->pos])
+    {
+    case '*': min = 0; max = -1; break;
+    case '+': min = 1; max = -1; break;
+    case '?': min = 0; max = 1; break;
+    case '{':
+      parser->pos++;
+      min = haplo_regex_parse_count(parser);
+      max = min;
+      if (min >= 0 && parser->pos < parser->len && parser->pattern[parser->pos] == ',')
+      {
+        parser->pos++;
+        max = haplo_regex_parse_count(parser);
+      }
+      if (min < 0 || max < -1 || (max >= 0 && max < min)
+          || parser->pos == parser->len || parser->pattern[parser->pos] != '}')
+        return haplo_regex_syntax_error(parser);
+      break;
+    default:
+      return node;
+    }
+    parser->pos++;
+    node = haplo_regex_node_new(parser, (HaploRegexNode) {
+        .type = HAPLO_REGEX_NODE_REPEAT,
+        .left = node,
+        .min = min,
+        .max = max,
+      });
+  }
+  return node;
+}
+
+static int haplo_regex_parse_concat(HaploRegexParser *parser)
+{
+  int node = haplo_regex_node_new(parser, (HaploRegexNode) {
+      .type = HAPLO_REGEX_NODE_EMPTY,
+    });
+  bool empty = true;
+  while (node >= 0 && parser->pos < parser->len
+         && parser->pattern[parser->pos] != '|' && parser->pattern[parser->pos] != ')')
+  {
+    int next = haplo_regex_parse_repeat(parser);
+    if (next < 0) return -1;
+    node = empty ? next : haplo_regex_node_new(parser, (HaploRegexNode) {
+        .type = HAPLO_REGEX_NODE_CONCAT,
+        .left = node,
+        .right = next,
+      });
+    empty = false;
+  }
+  return node;
+}
+
+static int haplo_regex_parse_alt(HaploRegexParser *parser)
+{
+  int node = haplo_regex_parse_concat(parser);
+  while (node >= 0 && parser->pos < parser->len && parser->pattern[parser->pos] == '|')
+  {
+    parser->pos++;
+    int next = haplo_regex_parse_concat(parser);
+    if (next < 0) return -1;
+    node = haplo_regex_node_new(parser, (HaploRegexNode) {
+        .type = HAPLO_REGEX_NODE_ALT,
+        .left = node,
+        .right = next,
+      });
+  }
+  return node;
+}
+
+//
+// Compiler
+//
+
+// Returns the index of a new NFA state, or a negative error
+static int haplo_regex_state_new(HaploRegex *regex, HaploRegexOp op,
+                                 int out, int out1, int class)
+{
+  if (regex->state_count == HAPLO_REGEX_MAX_STATES)
+    return HAPLO_ERROR_REGEX_TOO_LARGE;
+  // The states grow by powers of two
+  int count = regex->state_count;
+  if (count >= 16 && (count & (count - 1)) == 0)
+  {
+    HaploRegexState *states = haplo_realloc(regex->states,
+                                            2 * count * sizeof(HaploRegexState));
+    if (UNLIKELY(!states)) return HAPLO_ERROR_OUT_OF_MEMORY;
+    regex->states = states;
+  }
+  regex->states[count] = (HaploRegexState) {
+    .op = op,
+    .out = out,
+    .out1 = out1,
+    .class = class,
+  };
+  return regex->state_count++;
+}
+
+// Emits the states of the sequences of node, which continue to out.
+// Sequences that end with the same classes share those states, all
+// the codepoints after the first byte end with continuation bytes.
+// Returns the first state, or a negative error.
+static int haplo_regex_emit_utf8(HaploRegex *regex, const HaploRegexParser *parser,
+                                 const HaploRegexNode *node, int out)
+{
+  struct {
+    int class;
+    int out;
+    int state;
+  } suffixes[HAPLO_REGEX_SUFFIXES_MAX];
+  int suffix_count = 0;
+
+  int first = -1;
+  for (int s = node->left; s < node->left + node->right; ++s)
+  {
+    const HaploRegexSequence *sequence = &parser->sequences[s];
+    int next = out;
+    for (int i = sequence->len - 1; i >= 0; --i)
+    {
+      int state = -1;
+      for (int k = 0; k < suffix_count && state < 0; ++k)
+        if (suffixes[k].class == sequence->class[i] && suffixes[k].out == next)
+          state = suffixes[k].state;
+      if (state < 0)
+      {
+        state = haplo_regex_state_new(regex, HAPLO_REGEX_CLASS, next, -1, sequence->class[i]);
+        if (state < 0) return state;
+        if (suffix_count < HAPLO_REGEX_SUFFIXES_MAX)
+        {
+          suffixes[suffix_count].class = sequence->class[i];
+          suffixes[suffix_count].out = next;
+          suffixes[suffix_count++].state = state;
+        }
+      }
+      next = state;
+    }
+    first = (first < 0) ? next
+      : haplo_regex_state_new(regex, HAPLO_REGEX_SPLIT, next, first, -1);
+    if (first < 0) return first;
+  }
+  return first;
+}
+
+// Emits the states of node, which continue to out. Returns the first
+// state, or a negative error.
+static int haplo_regex_emit(HaploRegex *regex, const HaploRegexParser *parser,
+                            int node, int out)
+{
+  const HaploRegexNode *nodes = parser->nodes;
+  const HaploRegexNode *this = &nodes[node];
+  int left, right;
+  switch(this->type)
+  {
+  case HAPLO_REGEX_NODE_CLASS:
+    return haplo_regex_state_new(regex, HAPLO_REGEX_CLASS, out, -1, this->class);
+  case HAPLO_REGEX_NODE_EMPTY:
+    return out;
+  case HAPLO_REGEX_NODE_CONCAT:
+    right = haplo_regex_emit(regex, parser, this->right, out);
+    if (right < 0) return right;
+    return haplo_regex_emit(regex, parser, this->left, right);
+  case HAPLO_REGEX_NODE_ALT:
+    left = haplo_regex_emit(regex, parser, this->left, out);
+    if (left < 0) return left;
+    right = haplo_regex_emit(regex, parser, this->right, out);
+    if (right < 0) return right;
+    return haplo_regex_state_new(regex, HAPLO_REGEX_SPLIT, left, right, -1);
+  case HAPLO_REGEX_NODE_UTF8:
+    return haplo_regex_emit_utf8(regex, parser, this, out);
+  case HAPLO_REGEX_NODE_REPEAT:
+    break;
+  }
+
+  // The optional copies are nested, x{0,2} is (x(x)?)?, so that the
+  // NFA stays small
+  int next = out;
+  if (this->max < 0)
+  {
+    int loop = haplo_regex_state_new(regex, HAPLO_REGEX_SPLIT, -1, out, -1);
+    if (loop < 0) return loop;
+    int body = haplo_regex_emit(regex, parser, this->left, loop);
+    if (body < 0) return body;
+    regex->states[loop].out = body;
+    next = loop;
+  }
+  for (int i = this->min; i < this->max; ++i)
+  {
+    int body = haplo_regex_emit(regex, parser, this->left, next);
+    if (body < 0) return body;
+    next = haplo_regex_state_new(regex, HAPLO_REGEX_SPLIT, body, out, -1);
+    if (next < 0) return next;
+  }
+  for (int i = 0; i < this->min; ++i)
+  {
+    next = haplo_regex_emit(regex, parser, this->left, next);
+    if (next < 0) return next;
+  }
+  return next;
+}
+
+// Appends to prefix the bytes every match of node starts with.
+// Returns false if the node can continue with something else.
+static bool haplo_regex_find_prefix(HaploRegex *regex, const HaploRegexNode *nodes,
+                                    int node)
+{
+  const HaploRegexNode *this = &nodes[node];
+  switch(this->type)
+  {
+  case HAPLO_REGEX_NODE_CLASS: ;
+    const HaploRegexClass *class = &regex->classes[this->class];
+    int byte = -1;
+    for (int b = 0; b < 256; ++b)
+    {
+      if (!HAPLO_REGEX_HAS(class, b)) continue;
+      if (byte >= 0) return false;
+      byte = b;
+    }
+    if (byte < 0 || regex->prefix_len == HAPLO_REGEX_MAX_PREFIX) return false;
+    regex->prefix[regex->prefix_len++] = (char) byte;
+    return true;
+  case HAPLO_REGEX_NODE_CONCAT:
+    return haplo_regex_find_prefix(regex, nodes, this->left)
+      && haplo_regex_find_prefix(regex, nodes, this->right);
+  case HAPLO_REGEX_NODE_REPEAT:
+    // The first copy is there, like the bytes of a repeated codepoint
+    if (this->min > 0) haplo_regex_find_prefix(regex, nodes, this->left);
+    return false;
+  default:
+    return false;
+  }
+}
+
+// Splits the bytes in classes that no class of the pattern tells apart
+static void haplo_regex_byte_classes(HaploRegex *regex)
+{
+  unsigned char next[256];
+  int remap[512];
+  memset(regex->byte_class, 0, sizeof(regex->byte_class));
+  int count = 1;
+  for (int c = 0; c < regex->class_count; ++c)
+  {
+    memset(remap, -1, sizeof(remap));
+    int new_count = 0;
+    for (int b = 0; b < 256; ++b)
+    {
+      int key = 2 * regex->byte_class[b] + HAPLO_REGEX_HAS(&regex->classes[c], b);
+      if (remap[key] < 0) remap[key] = new_count++;
+      next[b] = (unsigned char) remap[key];
+    }
+    memcpy(regex->byte_class, next, sizeof(next));
+    count = new_count;
+  }
+
+  for (int b = 255; b >= 0; --b)
+    regex->class_byte[regex->byte_class[b]] = (unsigned char) b;
+  regex->byte_class_count = count;
+}
+
+HaploRegex *haplo_regex_compile(const char *pattern, int len, int *err)
+{
+  HaploRegex *regex = haplo_calloc(1, sizeof(HaploRegex));
+  if (UNLIKELY(!regex)) goto out_of_memory;
+  regex->refcount = 1;
+  regex->dfa_start = -1;
+  regex->pattern = haplo_string_new(pattern, len);
+  regex->states = haplo_alloc(16 * sizeof(HaploRegexState));
+  if (UNLIKELY(!regex->pattern || !regex->states)) goto out_of_memory;
+  if (!haplo_utf8_valid(pattern, len))
+  {
+    haplo_regex_free(regex);
+    *err = HAPLO_ERROR_INVALID_UTF8;
+    return NULL;
+  }
+
+  // ^ and $ are only accepted around the whole pattern
+  int end = len;
+  regex->anchored_start = len > 0 && pattern[0] == '^';
+  if (len > regex->anchored_start && pattern[len - 1] == '$')
+  {
+    int escapes = 0;
+    while (end - 2 - escapes >= 0 && pattern[end - 2 - escapes] == '\\') escapes++;
+    if (escapes % 2 == 0)
+    {
+      regex->anchored_end = true;
+      end--;
+    }
+  }
+
+  HaploRegexParser parser = {
+    .pattern = pattern,
+    .len = end,
+    .pos = regex->anchored_start,
+    .regex = regex,
+  };
+  int root = haplo_regex_parse_alt(&parser);
+  if (root >= 0 && parser.pos != parser.len)
+    root = haplo_regex_syntax_error(&parser);
+  if (root < 0)
+  {
+    haplo_free(parser.nodes);
+    haplo_free(parser.ranges);
+    haplo_free(parser.sequences);
+    haplo_regex_free(regex);
+    *err = parser.err;
+    return NULL;
+  }
+
+  int match = haplo_regex_state_new(regex, HAPLO_REGEX_MATCH, -1, -1, -1);
+  regex->start = (match < 0) ? match
+    : haplo_regex_emit(regex, &parser, root, match);
+  if (regex->start >= 0 && !regex->anchored_start)
+    haplo_regex_find_prefix(regex, parser.nodes, root);
+  haplo_free(parser.nodes);
+  haplo_free(parser.ranges);
+  haplo_free(parser.sequences);
+  if (regex->start < 0)
+  {
+    *err = regex->start;
+    haplo_regex_free(regex);
+    return NULL;
+  }
+
+  haplo_regex_byte_classes(regex);
+  haplo_string_search_init(&regex->prefix_search, regex->prefix, regex->prefix_len);
+
+  int count = regex->state_count;
+  regex->set = haplo_alloc(count * sizeof(int));
+  regex->stack = haplo_alloc((2 * count + 1) * sizeof(int));
+  regex->marks = haplo_calloc(count, sizeof(unsigned int));
+  regex->threads = haplo_alloc(2 * count * sizeof(HaploRegexThread));
+  regex->dfa = haplo_alloc(HAPLO_REGEX_DFA_MAX_STATES * sizeof(HaploRegexDfaState *));
+  regex->dfa_table = haplo_alloc(HAPLO_REGEX_DFA_TABLE_SIZE * sizeof(int));
+  if (UNLIKELY(!regex->set || !regex->stack || !regex->marks || !regex->threads
+               || !regex->dfa || !regex->dfa_table))
+    goto out_of_memory;
+  memset(regex->dfa_table, 0, HAPLO_REGEX_DFA_TABLE_SIZE * sizeof(int));
+  return regex;
+
+ out_of_memory:
+  haplo_regex_free(regex);
+  *err = HAPLO_ERROR_OUT_OF_MEMORY;
+  return NULL;
+}
+
+HaploRegex *haplo_regex_ref(HaploRegex *regex)
+{
+  if (regex) regex->refcount++;
+  return regex;
+}
+
+static void haplo_regex_dfa_clear(HaploRegex *regex)
+{
+  for (int i = 0; i < regex->dfa_count; ++i)
+    haplo_free(regex->dfa[i]);
+  regex->dfa_count = 0;
+  regex->dfa_start = -1;
+  if (regex->dfa_table)
+    memset(regex->dfa_table, 0, HAPLO_REGEX_DFA_TABLE_SIZE * sizeof(int));
+}
+
+void haplo_regex_free(HaploRegex *regex)
+{
+  if (!regex || --regex->refcount != 0) return;
+
+  haplo_regex_dfa_clear(regex);
+  haplo_string_free(regex->pattern);
+  haplo_free(regex->states);
+  haplo_free(regex->classes);
+  haplo_free(regex->set);
+  haplo_free(regex->stack);
+  haplo_free(regex->marks);
+  haplo_free(regex->threads);
+  haplo_free(regex->dfa);
+  haplo_free(regex->dfa_table);
+  haplo_free(regex);
+  return;
+}
+
+//
+// Simulation
+//
+
+// Starts a new set of marked states
+static void haplo_regex_next_generation(HaploRegex *regex)
+{
+  if (++regex->generation == 0)
+  {
+    memset(regex->marks, 0, regex->state_count * sizeof(unsigned int));
+    regex->generation = 1;
+  }
+}
+
+// Appends to set the CLASS and MATCH states reachable from state
+// without reading a byte, which are not marked yet
+static void haplo_regex_closure(HaploRegex *regex, int *set, int *count, int state)
+{
+  int *stack = regex->stack;
+  int top = 0;
+  stack[top++] = state;
+  while (top > 0)
+  {
+    int this = stack[--top];
+    if (regex->marks[this] == regex->generation) continue;
+    regex->marks[this] = regex->generation;
+    if (regex->states[this].op == HAPLO_REGEX_SPLIT)
+    {
+      stack[top++] = regex->states[this].out1;
+      stack[top++] = regex->states[this].out;
+    }
+    else
+    {
+      set[(*count)++] = this;
+    }
+  }
+}
+
+static int haplo_regex_compare_int(const void *a, const void *b)
+{
+  int x = *(const int *) a, y = *(const int *) b;
+  return (x > y) - (x < y);
+}
+
+// Returns the DFA state of the count NFA states of set, adding it if
+// it is new, or a negative error. The DFA is flushed when it is full.
+static int haplo_regex_dfa_state(HaploRegex *regex, int *set, int count)
+{
+  qsort(set, count, sizeof(int), haplo_regex_compare_int);
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (int i = 0; i < count; ++i)
+  {
+    hash ^= (uint64_t) set[i];
+    hash *= 0x100000001b3ULL;
+  }
+
+  int mask = HAPLO_REGEX_DFA_TABLE_SIZE - 1;
+  int slot = (int) (hash & mask);
+  for (; regex->dfa_table[slot] != 0; slot = (slot + 1) & mask)
+  {
+    HaploRegexDfaState *state = regex->dfa[regex->dfa_table[slot] - 1];
+    if (state->hash == hash && state->nfa_count == count
+        && memcmp(state->nfa, set, count * sizeof(int)) == 0)
+      return regex->dfa_table[slot] - 1;
+  }
+
+  if (regex->dfa_count == HAPLO_REGEX_DFA_MAX_STATES)
+  {
+    haplo_regex_dfa_clear(regex);
+    regex->dfa_flushes++;
+    slot = (int) (hash & mask);
+  }
+
+  int classes = regex->byte_class_count;
+  HaploRegexDfaState *state = haplo_alloc(sizeof(HaploRegexDfaState)
+                                          + (classes + count) * sizeof(int));
+  if (UNLIKELY(!state)) return HAPLO_ERROR_OUT_OF_MEMORY;
+  state->hash = hash;
+  state->nfa_count = count;
+  state->nfa = state->next + classes;
+  state->match = false;
+  for (int i = 0; i < classes; ++i) state->next[i] = -1;
+  for (int i = 0; i < count; ++i)
+  {
+    state->nfa[i] = set[i];
+    if (regex->states[set[i]].op == HAPLO_REGEX_MATCH) state->match = true;
+  }
+
+  regex->dfa[regex->dfa_count] = state;
+  regex->dfa_table[slot] = ++regex->dfa_count;
+  return regex->dfa_count - 1;
+}
+
+static int haplo_regex_dfa_start(HaploRegex *regex)
+{
+  if (regex->dfa_start >= 0) return regex->dfa_start;
+
+  int count = 0;
+  haplo_regex_next_generation(regex);
+  haplo_regex_closure(regex, regex->set, &count, regex->start);
+  int start = haplo_regex_dfa_state(regex, regex->set, count);
+  if (start >= 0) regex->dfa_start = start;
+  return start;
+}
+
+// Returns the DFA state after reading a byte of class from the state
+// from, and caches it, or returns a negative error
+static int haplo_regex_dfa_next(HaploRegex *regex, int from, int class)
+{
+  HaploRegexDfaState *state = regex->dfa[from];
+  unsigned char byte = regex->class_byte[class];
+  int count = 0;
+  haplo_regex_next_generation(regex);
+  for (int i = 0; i < state->nfa_count; ++i)
+  {
+    HaploRegexState *nfa = &regex->states[state->nfa[i]];
+    if (nfa->op == HAPLO_REGEX_CLASS && HAPLO_REGEX_HAS(&regex->classes[nfa->class], byte))
+      haplo_regex_closure(regex, regex->set, &count, nfa->out);
+  }
+  // Unanchored patterns can start a match at any byte
+  if (!regex->anchored_start)
+    haplo_regex_closure(regex, regex->set, &count, regex->start);
+
+  unsigned int flushes = regex->dfa_flushes;
+  int next = haplo_regex_dfa_state(regex, regex->set, count);
+  if (next >= 0 && flushes == regex->dfa_flushes)
+    regex->dfa[from]->next[class] = next;
+  return next;
+}
+
+// Returns 1 and sets *end to the first end of a match that starts at
+// pos or later, 0 if there is none, or a negative error
+static int haplo_regex_dfa_scan(HaploRegex *regex, const char *text, int len,
+                                int pos, int *end)
+{
+  int state = haplo_regex_dfa_start(regex);
+  if (state < 0) return state;
+
+  for (int i = pos; ; ++i)
+  {
+    HaploRegexDfaState *this = regex->dfa[state];
+    if (this->match && (!regex->anchored_end || i == len))
+    {
+      *end = i;
+      return 1;
+    }
+    if (i == len || this->nfa_count == 0) return 0;
+
+    // From the start state, the text up to the next occurrence of the
+    // prefix can't start a match
+    if (state == regex->dfa_start && regex->prefix_len > 0)
+    {
+      int found = haplo_string_search(&regex->prefix_search, text + i, len - i);
+      if (found < 0) return 0;
+      i += found;
+    }
+
+    int class = regex->byte_class[(unsigned char) text[i]];
+    int next = this->next[class];
+    if (next < 0)
+    {
+      next = haplo_regex_dfa_next(regex, state, class);
+      if (next < 0) return next;
+    }
+    state = next;
+  }
+}
+
+// Runs the NFA from pos with a thread per state, which keeps the
+// earliest start. Threads are seeded up to last_start. Returns 1 and
+// sets the leftmost longest match, or 0.
+static int haplo_regex_pike(HaploRegex *regex, const char *text, int len,
+                            int pos, int last_start, int *start, int *end)
+{
+  HaploRegexThread *current = regex->threads;
+  HaploRegexThread *next = regex->threads + regex->state_count;
+  int current_count = 0;
+  int best_start = -1, best_end = -1;
+  haplo_regex_next_generation(regex);
+
+  for (int i = pos; ; ++i)
+  {
+    // The threads are sorted by their start, the new one is the last
+    if (best_start < 0 && i <= last_start)
+    {
+      if (current_count == 0 && regex->prefix_len > 0)
+      {
+        int found = haplo_string_search(&regex->prefix_search, text + i, len - i);
+        if (found < 0 || i + found > last_start) break;
+        i += found;
+      }
+      int count = 0;
+      haplo_regex_closure(regex, regex->set, &count, regex->start);
+      for (int t = 0; t < count; ++t)
+        current[current_count++] = (HaploRegexThread) { regex->set[t], i };
+    }
+    if (current_count == 0) break;
+
+    haplo_regex_next_generation(regex);
+    int next_count = 0;
+    for (int t = 0; t < current_count; ++t)
+    {
+      HaploRegexThread thread = current[t];
+      if (best_start >= 0 && thread.start > best_start) break;
+
+      HaploRegexState *state = &regex->states[thread.state];
+      if (state->op == HAPLO_REGEX_MATCH)
+      {
+        if (!regex->anchored_end || i == len)
+        {
+          best_start = thread.start;
+          best_end = i;
+        }
+        continue;
+      }
+      if (i < len && HAPLO_REGEX_HAS(&regex->classes[state->class],
+                                     (unsigned char) text[i]))
+      {
+        int count = 0;
+        haplo_regex_closure(regex, regex->set, &count, state->out);
+        for (int s = 0; s < count; ++s)
+          next[next_count++] = (HaploRegexThread) { regex->set[s], thread.start };
+      }
+    }
+    if (i == len) break;
+
+    HaploRegexThread *swap = current;
+    current = next;
+    next = swap;
+    current_count = next_count;
+  }
+
+  if (best_start < 0) return 0;
+  *start = best_start;
+  *end = best_end;
+  return 1;
+}
+
+int haplo_regex_match(HaploRegex *regex, const char *text, int len)
+{
+  int end;
+  return haplo_regex_dfa_scan(regex, text, len, 0, &end);
+}
+
+int haplo_regex_search(HaploRegex *regex, const char *text, int len,
+                       int pos, int *start, int *end)
+{
+  if (pos > len || (regex->anchored_start && pos > 0)) return 0;
+
+  // The DFA rejects texts without a match quickly, and bounds the
+  // start of the leftmost one
+  int first_end;
+  int found = haplo_regex_dfa_scan(regex, text, len, pos, &first_end);
+  if (found <= 0) return found;
+  return haplo_regex_pike(regex, text, len, pos, first_end, start, end);
+}
+
+int haplo_regex_next(const char *text, int len, int start, int end)
+{
+  if (end > start) return end;
+  if (end == len) return len + 1;
+  return end + haplo_utf8_advance(text + end, len - end, 1);
+}
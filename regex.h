@@ -0,0 +1,149 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#ifndef HAPLO_REGEX_H
+#define HAPLO_REGEX_H
+
+#include "value.h"
+#include "str.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//
+// Macros
+//
+
+#ifdef HAPLO_NO_PREFIX
+  #define Regex HaploRegex
+  #define regex_compile haplo_regex_compile
+  #define regex_ref haplo_regex_ref
+  #define regex_free haplo_regex_free
+  #define regex_match haplo_regex_match
+  #define regex_search haplo_regex_search
+  #define regex_next haplo_regex_next
+#endif // HAPLO_NO_PREFIX
+
+// Patterns compiling to more NFA states are rejected. A . takes
+// about 25 states, one for each byte range of the UTF-8 encodings.
+#define HAPLO_REGEX_MAX_STATES 32768
+// The largest count of a {n,m} repetition
+#define HAPLO_REGEX_MAX_REPEAT 1000
+// The lazy DFA is flushed when it caches this many states
+#define HAPLO_REGEX_DFA_MAX_STATES 1024
+// Literal prefixes longer than this are not searched whole
+#define HAPLO_REGEX_MAX_PREFIX 64
+
+//
+// Types
+//
+
+typedef enum {
+  HAPLO_REGEX_CLASS = 0,    // a byte of the class, then out
+  HAPLO_REGEX_SPLIT,        // out and out1
+  HAPLO_REGEX_MATCH,
+} HaploRegexOp;
+
+// A state of the Thompson NFA
+typedef struct {
+  HaploRegexOp op;
+  int out;
+  int out1;
+  int class;
+} HaploRegexState;
+
+// A set of bytes
+typedef struct {
+  uint8_t bits[32];
+} HaploRegexClass;
+
+// A state of the DFA, built from the set of NFA states it stands for
+// the first time it is reached
+typedef struct {
+  uint64_t hash;
+  int nfa_count;
+  bool match;
+  // The sorted CLASS and MATCH states of the set, after next
+  int *nfa;
+  // The next DFA state for each byte class, or -1 if it is not
+  // computed yet
+  int next[];
+} HaploRegexDfaState;
+
+typedef struct {
+  int state;
+  int start;
+} HaploRegexThread;
+
+// A compiled pattern. The syntax is the one of POSIX extended
+// regular expressions without back references: . [] [^] | () (?:)
+// * + ? {n} {n,} {n,m}, the escapes \d \w \s \D \W \S \n \r \t, and
+// ^ and $ at the start and the end of the whole pattern. Matches are
+// leftmost longest, and take linear time in the length of the text.
+// Patterns and texts are UTF-8: ., sets and repeated codepoints match
+// whole codepoints, \d \w \s are ASCII.
+struct HaploRegex {
+  unsigned int refcount;
+  HaploString *pattern;
+  bool anchored_start;
+  bool anchored_end;
+
+  HaploRegexState *states;
+  int state_count;
+  int start;
+  HaploRegexClass *classes;
+  int class_count;
+
+  // Bytes that no class tells apart share a DFA transition
+  unsigned char byte_class[256];
+  unsigned char class_byte[256];
+  int byte_class_count;
+
+  // Every match starts with the prefix, when it is not empty
+  char prefix[HAPLO_REGEX_MAX_PREFIX];
+  int prefix_len;
+  HaploStringSearch prefix_search;
+
+  // The lazy DFA, its states are found by their NFA set in table
+  HaploRegexDfaState **dfa;
+  int dfa_count;
+  int *dfa_table;
+  int dfa_start;
+  unsigned int dfa_flushes;
+
+  // Scratch space of the simulations
+  int *set;
+  int *stack;
+  unsigned int *marks;
+  unsigned int generation;
+  HaploRegexThread *threads;
+};
+
+//
+// Functions
+//
+
+// Returns the compiled pattern of len bytes, or NULL and sets *err to
+// a negative error, HAPLO_ERROR_INVALID_UTF8 if pattern is not UTF-8
+HaploRegex *haplo_regex_compile(const char *pattern, int len, int *err);
+// Returns a new reference to regex
+HaploRegex *haplo_regex_ref(HaploRegex *regex);
+// Drops a reference to regex
+void haplo_regex_free(HaploRegex *regex);
+// Returns 1 if regex matches a part of the len bytes of text, 0 if it
+// does not, or a negative error. Only the lazy DFA runs.
+int haplo_regex_match(HaploRegex *regex, const char *text, int len);
+// Finds the leftmost longest match of regex in the len bytes of text
+// that starts at pos or later. Returns 1 and sets *start and *end, 0
+// if there is none, or a negative error.
+int haplo_regex_search(HaploRegex *regex, const char *text, int len,
+                       int pos, int *start, int *end);
+// Returns the position to search from after the match from start to
+// end of the len bytes of text. An empty match is stepped over with
+// the codepoint after it, or len + 1 at the end of text, so matches
+// stay between codepoints.
+int haplo_regex_next(const char *text, int len, int start, int end);
+
+#endif // HAPLO_REGEX_H
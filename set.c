@@ -0,0 +1,368 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "set.h"
+#include "errors.h"
+#include "utils.h"
+#include "alloc.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+static inline bool haplo_set_is_dense(HaploValue value)
+{
+  return value.type == HAPLO_VAL_INTEGER && value.value.integer >= 0
+    && value.value.integer < HAPLO_SET_DENSE_LIMIT;
+}
+
+static inline int haplo_set_count_words(uint64_t *words)
+{
+  int count = 0;
+  for (int i = 0; i < HAPLO_SET_CHUNK_WORDS; ++i)
+    count += HAPLO_POPCOUNT64(words[i]);
+  return count;
+}
+
+// Makes room for chunk_count chunks in the directory of set
+static int haplo_set_reserve(HaploSet *set, int chunk_count)
+{
+  if (chunk_count <= set->chunk_count) return 0;
+
+  HaploSetChunk **chunks = haplo_realloc(set->chunks,
+                                         chunk_count * sizeof(HaploSetChunk*));
+  if (UNLIKELY(!chunks)) return HAPLO_ERROR_OUT_OF_MEMORY;
+
+  memset(chunks + set->chunk_count, 0,
+         (chunk_count - set->chunk_count) * sizeof(HaploSetChunk*));
+  set->chunks = chunks;
+  set->chunk_count = chunk_count;
+  return 0;
+}
+
+// Adds a copy of key to the values of set that are not in the
+// bitmaps, if it is not there yet
+static int haplo_set_others_add(HaploSet *set, HaploValue key)
+{
+  if (!set->others)
+  {
+    set->others = haplo_map_new();
+    if (UNLIKELY(!set->others)) return HAPLO_ERROR_OUT_OF_MEMORY;
+  }
+  if (haplo_map_get(set->others, key)) return 0;
+
+  int error = haplo_map_put(set->others, haplo_value_deep_copy(key),
+                            (HaploValue) { .type = HAPLO_VAL_EMPTY });
+  if (error < 0) return error;
+  set->len++;
+  return 0;
+}
+
+HaploSet *haplo_set_new(void)
+{
+  HaploSet *set = haplo_alloc(sizeof(HaploSet));
+  if (UNLIKELY(!set)) return NULL;
+
+  set->chunks = NULL;
+  set->chunk_count = 0;
+  set->others = NULL;
+  set->len = 0;
+  set->refcount = 1;
+  return set;
+}
+
+HaploSet *haplo_set_ref(HaploSet *set)
+{
+  if (set) set->refcount++;
+  return set;
+}
+
+void haplo_set_free(HaploSet *set)
+{
+  if (!set || --set->refcount != 0) return;
+
+  for (int i = 0; i < set->chunk_count; ++i)
+    haplo_free(set->chunks[i]);
+  haplo_free(set->chunks);
+  haplo_map_free(set->others);
+  haplo_free(set);
+  return;
+}
+
+int haplo_set_size(HaploSet *set)
+{
+  return set ? set->len : 0;
+}
+
+int haplo_set_add(HaploSet *set, HaploValue value)
+{
+  assert(set);
+  int error = 0;
+  if (!haplo_value_hashable(value))
+  {
+    error = HAPLO_ERROR_INTERPRETER_INVALID_TYPE;
+    goto done;
+  }
+
+  if (!haplo_set_is_dense(value))
+  {
+    error = haplo_set_others_add(set, value);
+    goto done;
+  }
+
+  long integer = value.value.integer;
+  int chunk_index = integer >> HAPLO_SET_CHUNK_BITS;
+  error = haplo_set_reserve(set, chunk_index + 1);
+  if (error < 0) goto done;
+
+  HaploSetChunk *chunk = set->chunks[chunk_index];
+  if (!chunk)
+  {
+    chunk = haplo_calloc(1, sizeof(HaploSetChunk));
+    if (UNLIKELY(!chunk))
+    {
+      error = HAPLO_ERROR_OUT_OF_MEMORY;
+      goto done;
+    }
+    set->chunks[chunk_index] = chunk;
+  }
+
+  uint64_t *word = &chunk->words[(integer >> 6) & (HAPLO_SET_CHUNK_WORDS - 1)];
+  uint64_t bit = 1ULL << (integer & 63);
+  if (!(*word & bit))
+  {
+    *word |= bit;
+    chunk->count++;
+    set->len++;
+  }
+
+ done:
+  haplo_value_free(value);
+  return error;
+}
+
+bool haplo_set_has(HaploSet *set, HaploValue value)
+{
+  assert(set);
+  if (!haplo_set_is_dense(value))
+    return set->others && haplo_map_get(set->others, value);
+
+  long integer = value.value.integer;
+  int chunk_index = integer >> HAPLO_SET_CHUNK_BITS;
+  if (chunk_index >= set->chunk_count || !set->chunks[chunk_index])
+    return false;
+
+  uint64_t word =
+    set->chunks[chunk_index]->words[(integer >> 6) & (HAPLO_SET_CHUNK_WORDS - 1)];
+  return (word >> (integer & 63)) & 1;
+}
+
+// The word operations of set algebra
+typedef enum {
+  HAPLO_SET_OP_UNION = 0,
+  HAPLO_SET_OP_INTERSECTION,
+  HAPLO_SET_OP_DIFFERENCE,
+} HaploSetOp;
+
+// Returns the chunk of the result of op, NULL if it would be empty.
+// Sets error on failure.
+static HaploSetChunk *haplo_set_chunk_op(HaploSetChunk *a, HaploSetChunk *b,
+                                         HaploSetOp op, int *error)
+{
+  if (!a && (op != HAPLO_SET_OP_UNION || !b)) return NULL;
+  if (!b && op == HAPLO_SET_OP_INTERSECTION) return NULL;
+
+  HaploSetChunk *chunk = haplo_alloc(sizeof(HaploSetChunk));
+  if (UNLIKELY(!chunk))
+  {
+    *error = HAPLO_ERROR_OUT_OF_MEMORY;
+    return NULL;
+  }
+
+  if (!a || !b)
+  {
+    // Union or difference with an empty chunk
+    memcpy(chunk, a ? a : b, sizeof(HaploSetChunk));
+    return chunk;
+  }
+
+  switch(op)
+  {
+  case HAPLO_SET_OP_UNION:
+    for (int i = 0; i < HAPLO_SET_CHUNK_WORDS; ++i)
+      chunk->words[i] = a->words[i] | b->words[i];
+    break;
+  case HAPLO_SET_OP_INTERSECTION:
+    for (int i = 0; i < HAPLO_SET_CHUNK_WORDS; ++i)
+      chunk->words[i] = a->words[i] & b->words[i];
+    break;
+  case HAPLO_SET_OP_DIFFERENCE:
+    for (int i = 0; i < HAPLO_SET_CHUNK_WORDS; ++i)
+      chunk->words[i] = a->words[i] & ~b->words[i];
+    break;
+  }
+
+  chunk->count = haplo_set_count_words(chunk->words);
+  if (chunk->count == 0)
+  {
+    haplo_free(chunk);
+    return NULL;
+  }
+  return chunk;
+}
+
+// Returns the result of op on a and b
+static HaploSet *haplo_set_op(HaploSet *a, HaploSet *b, HaploSetOp op)
+{
+  assert(a && b);
+  HaploSet *set = haplo_set_new();
+  if (UNLIKELY(!set)) return NULL;
+
+  int chunk_count = a->chunk_count;
+  if (op == HAPLO_SET_OP_UNION && b->chunk_count > chunk_count)
+    chunk_count = b->chunk_count;
+  if (op == HAPLO_SET_OP_INTERSECTION && b->chunk_count < chunk_count)
+    chunk_count = b->chunk_count;
+
+  int error = haplo_set_reserve(set, chunk_count);
+  if (error < 0) goto failed;
+
+  for (int i = 0; i < chunk_count; ++i)
+  {
+    HaploSetChunk *chunk_a = (i < a->chunk_count) ? a->chunks[i] : NULL;
+    HaploSetChunk *chunk_b = (i < b->chunk_count) ? b->chunks[i] : NULL;
+    set->chunks[i] = haplo_set_chunk_op(chunk_a, chunk_b, op, &error);
+    if (error < 0) goto failed;
+    if (set->chunks[i]) set->len += set->chunks[i]->count;
+  }
+
+  // Values are split between bitmaps and others in the same way in
+  // every set, so others are only compared with others
+  HaploMap *maps[2] = { a->others, b->others };
+  for (int m = 0; m < 2; ++m)
+  {
+    if (!maps[m]) continue;
+    if (m == 1 && op != HAPLO_SET_OP_UNION) break;
+
+    for (int i = 0; i < maps[m]->capacity; ++i)
+    {
+      HaploMapEntry *entry = &maps[m]->entries[i];
+      if (entry->hash <= HAPLO_MAP_SLOT_DELETED) continue;
+
+      bool in_b = b->others && haplo_map_get(b->others, entry->key);
+      if ((op == HAPLO_SET_OP_INTERSECTION && !in_b)
+          || (op == HAPLO_SET_OP_DIFFERENCE && in_b))
+        continue;
+
+      error = haplo_set_others_add(set, entry->key);
+      if (error < 0) goto failed;
+    }
+  }
+  return set;
+
+ failed:
+  haplo_set_free(set);
+  return NULL;
+}
+
+HaploSet *haplo_set_union(HaploSet *a, HaploSet *b)
+{
+  return haplo_set_op(a, b, HAPLO_SET_OP_UNION);
+}
+
+HaploSet *haplo_set_intersection(HaploSet *a, HaploSet *b)
+{
+  return haplo_set_op(a, b, HAPLO_SET_OP_INTERSECTION);
+}
+
+HaploSet *haplo_set_difference(HaploSet *a, HaploSet *b)
+{
+  return haplo_set_op(a, b, HAPLO_SET_OP_DIFFERENCE);
+}
+
+bool haplo_set_foreach(HaploSet *set, HaploSetForeachFunc func, void *ctx)
+{
+  if (!set) return true;
+
+  for (int c = 0; c < set->chunk_count; ++c)
+  {
+    HaploSetChunk *chunk = set->chunks[c];
+    if (!chunk) continue;
+
+    for (int w = 0; w < HAPLO_SET_CHUNK_WORDS; ++w)
+    {
+      for (uint64_t word = chunk->words[w]; word; word &= word - 1)
+      {
+        long integer = ((long) c << HAPLO_SET_CHUNK_BITS)
+          + w * 64 + HAPLO_CTZ64(word);
+        HaploValue value = {
+          .type = HAPLO_VAL_INTEGER,
+          .value.integer = integer,
+        };
+        if (!func(value, ctx)) return false;
+      }
+    }
+  }
+
+  for (int i = 0; set->others && i < set->others->capacity; ++i)
+  {
+    HaploMapEntry *entry = &set->others->entries[i];
+    if (entry->hash <= HAPLO_MAP_SLOT_DELETED) continue;
+    if (!func(entry->key, ctx)) return false;
+  }
+  return true;
+}
+
+static bool haplo_set_list_push(HaploValue value, void *ctx)
+{
+  HaploValueList **chain = ctx;
+  HaploValueList *new_chain =
+    haplo_value_list_push_front(haplo_value_deep_copy(value), *chain);
+  if (UNLIKELY(new_chain == *chain)) return false;
+
+  *chain = new_chain;
+  return true;
+}
+
+HaploList *haplo_set_to_list(HaploSet *set)
+{
+  HaploValueList *chain = NULL;
+  if (!haplo_set_foreach(set, haplo_set_list_push, &chain))
+  {
+    haplo_value_list_free(chain);
+    return NULL;
+  }
+  return haplo_list_new(chain);
+}
+
+typedef struct {
+  char *buf;
+  int buf_len;
+  int offset;
+} HaploSetStringCtx;
+
+static bool haplo_set_string_value(HaploValue value, void *ctx)
+{
+  HaploSetStringCtx *str = ctx;
+  str->offset += haplo_snprintf_clamp(haplo_value_string(value,
+                                                         str->buf + str->offset,
+                                                         str->buf_len - str->offset),
+                                      str->buf_len - str->offset);
+  str->offset += haplo_snprintf_clamp(snprintf(str->buf + str->offset,
+                                               str->buf_len - str->offset, " "),
+                                      str->buf_len - str->offset);
+  return str->offset < str->buf_len - 1;
+}
+
+int haplo_set_string(HaploSet *set, char *buf, int buf_len)
+{
+  HaploSetStringCtx str = {
+    .buf = buf,
+    .buf_len = buf_len,
+    .offset = haplo_snprintf_clamp(snprintf(buf, buf_len, "set: "), buf_len),
+  };
+  haplo_set_foreach(set, haplo_set_string_value, &str);
+  return str.offset;
+}
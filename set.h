@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#ifndef HAPLO_SET_H
+#define HAPLO_SET_H
+
+#include "value.h"
+#include "map.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//
+// Macros
+//
+
+#ifdef HAPLO_NO_PREFIX
+  #define Set HaploSet
+  #define SetChunk HaploSetChunk
+  #define set_new haplo_set_new
+  #define set_ref haplo_set_ref
+  #define set_free haplo_set_free
+  #define set_size haplo_set_size
+  #define set_add haplo_set_add
+  #define set_has haplo_set_has
+  #define set_union haplo_set_union
+  #define set_intersection haplo_set_intersection
+  #define set_difference haplo_set_difference
+  #define set_foreach haplo_set_foreach
+  #define set_to_list haplo_set_to_list
+  #define set_string haplo_set_string
+#endif // HAPLO_NO_PREFIX
+
+// Integers in [0, HAPLO_SET_DENSE_LIMIT) are stored in bitmaps
+#ifndef HAPLO_SET_DENSE_LIMIT
+#define HAPLO_SET_DENSE_LIMIT (1L << 24)
+#endif // HAPLO_SET_DENSE_LIMIT
+
+// Each bitmap chunk covers 2^HAPLO_SET_CHUNK_BITS integers
+#define HAPLO_SET_CHUNK_BITS  12
+#define HAPLO_SET_CHUNK_WORDS ((1 << HAPLO_SET_CHUNK_BITS) / 64)
+
+//
+// Types
+//
+
+// A bitmap over a range of integers, with its number of bits set
+typedef struct {
+  int count;
+  uint64_t words[HAPLO_SET_CHUNK_WORDS];
+} HaploSetChunk;
+
+// A set of hashable values. Small non negative integers are kept in
+// bitmap chunks, allocated only for the ranges in use, so set algebra
+// over them works a word at a time. Every other value is a key of a
+// map. Like maps, sets are mutable and shared by reference.
+struct HaploSet {
+  // Chunk i holds the integers in [i, i + 1) << HAPLO_SET_CHUNK_BITS,
+  // or is NULL if it has none
+  HaploSetChunk **chunks;
+  int chunk_count;
+  // Values that are not in the bitmaps, NULL if there are none
+  HaploMap *others;
+  int len;
+  unsigned int refcount;
+};
+
+// Called on each value of a set
+typedef bool (*HaploSetForeachFunc)(HaploValue value, void *ctx);
+
+//
+// Functions
+//
+
+// Returns an empty set, or NULL if out of memory
+HaploSet *haplo_set_new(void);
+// Returns a new reference to set
+HaploSet *haplo_set_ref(HaploSet *set);
+// Drops a reference to set, its values are freed with the last one
+void haplo_set_free(HaploSet *set);
+int haplo_set_size(HaploSet *set);
+// Adds value to set, takes ownership of value which must be
+// hashable. Returns 0 on success, or a negative error.
+int haplo_set_add(HaploSet *set, HaploValue value);
+bool haplo_set_has(HaploSet *set, HaploValue value);
+// The following functions return a new set, or NULL if out of memory
+HaploSet *haplo_set_union(HaploSet *a, HaploSet *b);
+HaploSet *haplo_set_intersection(HaploSet *a, HaploSet *b);
+// Returns the values of a that are not in b
+HaploSet *haplo_set_difference(HaploSet *a, HaploSet *b);
+// Calls func on every value of set until it returns false, the
+// integers of the bitmaps first in increasing order. Returns false if
+// func stopped the iteration.
+bool haplo_set_foreach(HaploSet *set, HaploSetForeachFunc func, void *ctx);
+// Returns a list with a copy of the values of set, in the order of
+// haplo_set_foreach. Returns NULL if out of memory.
+HaploList *haplo_set_to_list(HaploSet *set);
+// Returns the number of bytes written to buf. At most buf_len bytes
+// will be written.
+int haplo_set_string(HaploSet *set, char *buf, int buf_len);
+
+#endif // HAPLO_SET_H
@@ -0,0 +1,601 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "sort.h"
+#include "bigint.h"
+#include "str.h"
+#include "errors.h"
+#include "alloc.h"
+#include "utils.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Runs of at most this many items are sorted by insertion
+#define HAPLO_SORT_INSERTION_MAX 24
+// Longer partitions take the pivot from 9 items instead of 3
+#define HAPLO_SORT_NINTHER_MIN 128
+// The insertion sort of a partition that looks sorted gives up after
+// this many moves
+#define HAPLO_SORT_PARTIAL_LIMIT 8
+
+typedef enum {
+  HAPLO_SORT_EMPTY = 0,
+  HAPLO_SORT_INTEGER,
+  HAPLO_SORT_FLOAT,
+  HAPLO_SORT_STRING,
+  HAPLO_SORT_NUMBER,          // mixed numbers, or bigints
+  HAPLO_SORT_INVALID,
+} HaploSortKind;
+
+// A key to sort and the index of its value. Ties are broken by the
+// index, so no two items are equal and every sort is stable.
+typedef struct {
+  union {
+    uint64_t bits;            // integers and floats, in unsigned order
+    const char *string;
+    const HaploValue *value;
+  } key;
+  int index;
+  int len;                    // the length of a string key
+} HaploSortItem;
+
+typedef bool (*HaploSortLess)(const HaploSortItem *a, const HaploSortItem *b);
+
+// Returns the kind of a sequence of kind keys followed by a key of
+// type
+static HaploSortKind haplo_sort_kind(HaploSortKind kind, HaploValueType type)
+{
+  HaploSortKind next;
+  switch(type)
+  {
+  case HAPLO_VAL_INTEGER:
+    next = HAPLO_SORT_INTEGER;
+    break;
+  case HAPLO_VAL_FLOAT:
+    next = HAPLO_SORT_FLOAT;
+    break;
+  case HAPLO_VAL_BIGINT:
+    next = HAPLO_SORT_NUMBER;
+    break;
+  case HAPLO_VAL_STRING:
+    next = HAPLO_SORT_STRING;
+    break;
+  default:
+    return HAPLO_SORT_INVALID;
+  }
+
+  if (kind == HAPLO_SORT_EMPTY || kind == next) return next;
+  if (kind == HAPLO_SORT_INVALID || kind == HAPLO_SORT_STRING
+      || next == HAPLO_SORT_STRING)
+    return HAPLO_SORT_INVALID;
+  return HAPLO_SORT_NUMBER;
+}
+
+static double haplo_sort_to_double(HaploValue value)
+{
+  switch(value.type)
+  {
+  case HAPLO_VAL_INTEGER:
+    return (double) value.value.integer;
+  case HAPLO_VAL_BIGINT:
+    return haplo_bigint_to_double(value.value.bigint);
+  default:
+    return value.value.floating_point;
+  }
+}
+
+int haplo_sort_compare(HaploValue a, HaploValue b)
+{
+  if (a.type == HAPLO_VAL_INTEGER && b.type == HAPLO_VAL_INTEGER)
+    return (a.value.integer > b.value.integer) - (a.value.integer < b.value.integer);
+  if (a.type == HAPLO_VAL_STRING)
+    return haplo_string_compare_bytes(haplo_value_text(&a), haplo_value_text_len(&a),
+                                      haplo_value_text(&b), haplo_value_text_len(&b));
+  if (a.type != HAPLO_VAL_FLOAT && b.type != HAPLO_VAL_FLOAT)
+    return haplo_bigint_compare(a, b);
+
+  double x = haplo_sort_to_double(a);
+  double y = haplo_sort_to_double(b);
+  if (isnan(x) || isnan(y))
+    return isnan(x) - isnan(y);
+  return (x > y) - (x < y);
+}
+
+// Maps a long to bits with the same unsigned order
+static uint64_t haplo_sort_integer_bits(long integer)
+{
+  return (uint64_t) integer ^ ((uint64_t) 1 << 63);
+}
+
+// Maps a double to bits with the same unsigned order. -0.0 is equal
+// to 0.0, and all NaNs are equal and after infinity.
+static uint64_t haplo_sort_float_bits(double floating_point)
+{
+  if (isnan(floating_point)) floating_point = NAN;
+  if (floating_point == 0.0) floating_point = 0.0;
+
+  uint64_t bits;
+  memcpy(&bits, &floating_point, sizeof(bits));
+  uint64_t sign = (uint64_t) 1 << 63;
+  return (bits & sign) ? ~bits : bits ^ sign;
+}
+
+static bool haplo_sort_less_bits(const HaploSortItem *a, const HaploSortItem *b)
+{
+  if (a->key.bits != b->key.bits) return a->key.bits < b->key.bits;
+  return a->index < b->index;
+}
+
+static bool haplo_sort_less_string(const HaploSortItem *a, const HaploSortItem *b)
+{
+  int cmp = haplo_string_compare_bytes(a->key.string, a->len,
+                                       b->key.string, b->len);
+  return (cmp != 0) ? cmp < 0 : a->index < b->index;
+}
+
+static bool haplo_sort_less_value(const HaploSortItem *a, const HaploSortItem *b)
+{
+  int cmp = haplo_sort_compare(*a->key.value, *b->key.value);
+  return (cmp != 0) ? cmp < 0 : a->index < b->index;
+}
+
+static void haplo_sort_swap(HaploSortItem *a, HaploSortItem *b)
+{
+  HaploSortItem tmp = *a;
+  *a = *b;
+  *b = tmp;
+}
+
+//
+// pdqsort, see "Pattern-defeating Quicksort" by Orson Peters
+//
+
+// If guarded is false, the item before begin must not be greater
+// than the items in [begin, end)
+static void haplo_sort_insertion(HaploSortItem *begin, HaploSortItem *end,
+                                 HaploSortLess less, bool guarded)
+{
+  if (begin == end) return;
+  for (HaploSortItem *cur = begin + 1; cur != end; ++cur)
+  {
+    HaploSortItem *sift = cur;
+    if (!less(sift, sift - 1)) continue;
+
+    HaploSortItem tmp = *sift;
+    do {
+      *sift = *(sift - 1);
+      --sift;
+    } while ((!guarded || sift != begin) && less(&tmp, sift - 1));
+    *sift = tmp;
+  }
+}
+
+// Sorts by insertion as long as it takes few moves. Returns true if
+// [begin, end) was sorted.
+static bool haplo_sort_partial_insertion(HaploSortItem *begin, HaploSortItem *end,
+                                         HaploSortLess less)
+{
+  if (begin == end) return true;
+  ptrdiff_t moves = 0;
+  for (HaploSortItem *cur = begin + 1; cur != end; ++cur)
+  {
+    HaploSortItem *sift = cur;
+    if (!less(sift, sift - 1)) continue;
+
+    HaploSortItem tmp = *sift;
+    do {
+      *sift = *(sift - 1);
+      --sift;
+    } while (sift != begin && less(&tmp, sift - 1));
+    *sift = tmp;
+
+    moves += cur - sift;
+    if (moves > HAPLO_SORT_PARTIAL_LIMIT) return false;
+  }
+  return true;
+}
+
+static void haplo_sort_sift_down(HaploSortItem *heap, ptrdiff_t root,
+                                 ptrdiff_t size, HaploSortLess less)
+{
+  while (2 * root + 1 < size)
+  {
+    ptrdiff_t child = 2 * root + 1;
+    if (child + 1 < size && less(&heap[child], &heap[child + 1])) child++;
+    if (!less(&heap[root], &heap[child])) return;
+    haplo_sort_swap(&heap[root], &heap[child]);
+    root = child;
+  }
+}
+
+// The fallback when the pivots keep being bad, O(n log n) in any case
+static void haplo_sort_heap(HaploSortItem *begin, HaploSortItem *end,
+                            HaploSortLess less)
+{
+  ptrdiff_t size = end - begin;
+  for (ptrdiff_t root = size / 2 - 1; root >= 0; --root)
+    haplo_sort_sift_down(begin, root, size, less);
+  while (--size > 0)
+  {
+    haplo_sort_swap(&begin[0], &begin[size]);
+    haplo_sort_sift_down(begin, 0, size, less);
+  }
+}
+
+static void haplo_sort_sort2(HaploSortItem *a, HaploSortItem *b,
+                             HaploSortLess less)
+{
+  if (less(b, a)) haplo_sort_swap(a, b);
+}
+
+static void haplo_sort_sort3(HaploSortItem *a, HaploSortItem *b,
+                             HaploSortItem *c, HaploSortLess less)
+{
+  haplo_sort_sort2(a, b, less);
+  haplo_sort_sort2(b, c, less);
+  haplo_sort_sort2(a, b, less);
+}
+
+// Partitions [begin, end) around the pivot in *begin, and returns its
+// final position. The pivot must be a median, so that the scans stop
+// at an item on both sides. Sets *sorted if no item was swapped.
+static HaploSortItem *haplo_sort_partition(HaploSortItem *begin, HaploSortItem *end,
+                                           HaploSortLess less, bool *sorted)
+{
+  HaploSortItem pivot = *begin;
+  HaploSortItem *first = begin;
+  HaploSortItem *last = end;
+
+  while (less(++first, &pivot));
+  if (first - 1 == begin)
+    while (first < last && !less(--last, &pivot));
+  else
+    while (!less(--last, &pivot));
+
+  *sorted = first >= last;
+  while (first < last)
+  {
+    haplo_sort_swap(first, last);
+    while (less(++first, &pivot));
+    while (!less(--last, &pivot));
+  }
+
+  HaploSortItem *pivot_pos = first - 1;
+  *begin = *pivot_pos;
+  *pivot_pos = pivot;
+  return pivot_pos;
+}
+
+// Swaps a few items of an unbalanced partition, to break the pattern
+// that produced it
+static void haplo_sort_shuffle(HaploSortItem *begin, HaploSortItem *end)
+{
+  ptrdiff_t size = end - begin;
+  if (size < HAPLO_SORT_INSERTION_MAX) return;
+
+  ptrdiff_t quarter = size / 4;
+  haplo_sort_swap(begin, begin + quarter);
+  haplo_sort_swap(end - 1, end - quarter);
+  if (size > HAPLO_SORT_NINTHER_MIN)
+  {
+    haplo_sort_swap(begin + 1, begin + (quarter + 1));
+    haplo_sort_swap(begin + 2, begin + (quarter + 2));
+    haplo_sort_swap(end - 2, end - (quarter + 1));
+    haplo_sort_swap(end - 3, end - (quarter + 2));
+  }
+}
+
+// No two items are equal, so the partition of the items equal to the
+// pivot of pdqsort is never needed
+static void haplo_sort_pdq(HaploSortItem *begin, HaploSortItem *end,
+                           HaploSortLess less, int bad_allowed, bool leftmost)
+{
+  while (true)
+  {
+    ptrdiff_t size = end - begin;
+    if (size < HAPLO_SORT_INSERTION_MAX)
+    {
+      haplo_sort_insertion(begin, end, less, leftmost);
+      return;
+    }
+
+    ptrdiff_t half = size / 2;
+    if (size > HAPLO_SORT_NINTHER_MIN)
+    {
+      haplo_sort_sort3(begin, begin + half, end - 1, less);
+      haplo_sort_sort3(begin + 1, begin + (half - 1), end - 2, less);
+      haplo_sort_sort3(begin + 2, begin + (half + 1), end - 3, less);
+      haplo_sort_sort3(begin + (half - 1), begin + half, begin + (half + 1), less);
+      haplo_sort_swap(begin, begin + half);
+    } else {
+      haplo_sort_sort3(begin + half, begin, end - 1, less);
+    }
+
+    bool sorted;
+    HaploSortItem *pivot_pos = haplo_sort_partition(begin, end, less, &sorted);
+    ptrdiff_t left_size = pivot_pos - begin;
+    ptrdiff_t right_size = end - (pivot_pos + 1);
+
+    if (left_size < size / 8 || right_size < size / 8)
+    {
+      if (--bad_allowed == 0)
+      {
+        haplo_sort_heap(begin, end, less);
+        return;
+      }
+      haplo_sort_shuffle(begin, pivot_pos);
+      haplo_sort_shuffle(pivot_pos + 1, end);
+    } else if (sorted
+               && haplo_sort_partial_insertion(begin, pivot_pos, less)
+               && haplo_sort_partial_insertion(pivot_pos + 1, end, less)) {
+      return;
+    }
+
+    // Recurse into the left partition, loop on the right one
+    haplo_sort_pdq(begin, pivot_pos, less, bad_allowed, leftmost);
+    begin = pivot_pos + 1;
+    leftmost = false;
+  }
+}
+
+static void haplo_sort_pdqsort(HaploSortItem *items, int count, HaploSortLess less)
+{
+  int bad_allowed = 1;
+  for (int n = count; n > 1; n >>= 1) bad_allowed++;
+  haplo_sort_pdq(items, items + count, less, bad_allowed, true);
+}
+
+//
+// Radix sorts
+//
+
+// Least significant digit radix sort of the bits of the keys. tmp
+// holds count items.
+static void haplo_sort_radix_bits(HaploSortItem *items, HaploSortItem *tmp,
+                                  int count)
+{
+  // The counts of the 8 bytes are taken in one pass
+  int counts[8][256] = {{0}};
+  for (int i = 0; i < count; ++i)
+    for (int byte = 0; byte < 8; ++byte)
+      counts[byte][(items[i].key.bits >> (byte * 8)) & 0xFF]++;
+
+  HaploSortItem *from = items, *to = tmp;
+  for (int byte = 0; byte < 8; ++byte)
+  {
+    int shift = byte * 8;
+    // A byte shared by every key does not change the order
+    if (counts[byte][(from[0].key.bits >> shift) & 0xFF] == count) continue;
+
+    int offset = 0;
+    for (int digit = 0; digit < 256; ++digit)
+    {
+      int digit_count = counts[byte][digit];
+      counts[byte][digit] = offset;
+      offset += digit_count;
+    }
+    for (int i = 0; i < count; ++i)
+      to[counts[byte][(from[i].key.bits >> shift) & 0xFF]++] = from[i];
+
+    HaploSortItem *swap = from;
+    from = to;
+    to = swap;
+  }
+  if (from != items) memcpy(items, from, count * sizeof(HaploSortItem));
+}
+
+// Returns the byte of the string at depth plus one, or 0 if the
+// string ends before it
+static int haplo_sort_string_digit(const HaploSortItem *item, int depth)
+{
+  return (depth < item->len) ? (unsigned char) item->key.string[depth] + 1 : 0;
+}
+
+// Most significant digit radix sort of the strings, which share their
+// first depth bytes. tmp holds count items.
+static void haplo_sort_radix_string(HaploSortItem *items, HaploSortItem *tmp,
+                                    int count, int depth)
+{
+  while (count >= HAPLO_SORT_INSERTION_MAX)
+  {
+    int starts[258] = {0};
+    for (int i = 0; i < count; ++i)
+      starts[haplo_sort_string_digit(&items[i], depth) + 1]++;
+
+    int first = haplo_sort_string_digit(&items[0], depth);
+    if (starts[first + 1] == count)
+    {
+      // Equal strings keep the order of their indices
+      if (first == 0) return;
+      depth++;
+      continue;
+    }
+
+    for (int digit = 0; digit < 257; ++digit)
+      starts[digit + 1] += starts[digit];
+    int next[257];
+    memcpy(next, starts, sizeof(next));
+    for (int i = 0; i < count; ++i)
+      tmp[next[haplo_sort_string_digit(&items[i], depth)]++] = items[i];
+    memcpy(items, tmp, count * sizeof(HaploSortItem));
+
+    // The strings that end here are sorted. The largest bucket is
+    // sorted by the loop, so the recursion on the others, which hold
+    // at most half of the items, stays shallow.
+    int largest = 1;
+    for (int digit = 2; digit < 257; ++digit)
+      if (starts[digit + 1] - starts[digit] > starts[largest + 1] - starts[largest])
+        largest = digit;
+    for (int digit = 1; digit < 257; ++digit)
+    {
+      int bucket = starts[digit + 1] - starts[digit];
+      if (digit != largest && bucket > 1)
+        haplo_sort_radix_string(items + starts[digit], tmp, bucket, depth + 1);
+    }
+    items += starts[largest];
+    count = starts[largest + 1] - starts[largest];
+    depth++;
+  }
+  haplo_sort_insertion(items, items + count, haplo_sort_less_string, true);
+}
+
+int haplo_sort_order(const HaploValue *keys, int count, int *order)
+{
+  HaploSortKind kind = HAPLO_SORT_EMPTY;
+  for (int i = 0; i < count && kind != HAPLO_SORT_INVALID; ++i)
+    kind = haplo_sort_kind(kind, keys[i].type);
+  if (kind == HAPLO_SORT_INVALID) return HAPLO_ERROR_INTERPRETER_INVALID_TYPE;
+  if (count == 0) return 0;
+
+  bool radix = count >= HAPLO_SORT_RADIX_MIN && kind != HAPLO_SORT_NUMBER;
+  HaploSortItem *items = haplo_alloc((radix ? 2 : 1) * count * sizeof(HaploSortItem));
+  if (UNLIKELY(!items)) return HAPLO_ERROR_OUT_OF_MEMORY;
+
+  for (int i = 0; i < count; ++i)
+  {
+    items[i].index = i;
+    switch(kind)
+    {
+    case HAPLO_SORT_INTEGER:
+      items[i].key.bits = haplo_sort_integer_bits(keys[i].value.integer);
+      break;
+    case HAPLO_SORT_FLOAT:
+      items[i].key.bits = haplo_sort_float_bits(keys[i].value.floating_point);
+      break;
+    case HAPLO_SORT_STRING:
+      // Inline strings point into keys, which outlive the sort
+      items[i].key.string = haplo_value_text(&keys[i]);
+      items[i].len = haplo_value_text_len(&keys[i]);
+      break;
+    default:
+      items[i].key.value = &keys[i];
+      break;
+    }
+  }
+
+  if (kind == HAPLO_SORT_NUMBER)
+    haplo_sort_pdqsort(items, count, haplo_sort_less_value);
+  else if (kind == HAPLO_SORT_STRING && radix)
+    haplo_sort_radix_string(items, items + count, count, 0);
+  else if (kind == HAPLO_SORT_STRING)
+    haplo_sort_pdqsort(items, count, haplo_sort_less_string);
+  else if (radix)
+    haplo_sort_radix_bits(items, items + count, count);
+  else
+    haplo_sort_pdqsort(items, count, haplo_sort_less_bits);
+
+  for (int i = 0; i < count; ++i)
+    order[i] = items[i].index;
+  haplo_free(items);
+  return 0;
+}
+
+int haplo_sort_values(HaploValue *values, const HaploValue *keys, int count)
+{
+  if (count == 0) return 0;
+
+  int *order = haplo_alloc(count * sizeof(int));
+  HaploValue *sorted = haplo_alloc(count * sizeof(HaploValue));
+  int err = (order && sorted) ? 0 : HAPLO_ERROR_OUT_OF_MEMORY;
+  if (err == 0)
+    err = haplo_sort_order(keys, count, order);
+
+  if (err == 0)
+  {
+    for (int i = 0; i < count; ++i)
+      sorted[i] = values[order[i]];
+    memcpy(values, sorted, count * sizeof(HaploValue));
+  }
+  haplo_free(sorted);
+  haplo_free(order);
+  return err;
+}
+
+// Merges two runs of cells, sorted in descending order. On ties the
+// cells of left, which come first in the chain, come first.
+static HaploValueList *haplo_sort_merge(HaploValueList *left,
+                                        HaploValueList *right)
+{
+  HaploValueList *first = NULL, **link = &first;
+  while (left && right)
+  {
+    if (haplo_sort_compare(left->val, right->val) >= 0)
+    {
+      *link = left;
+      left = left->next;
+    } else {
+      *link = right;
+      right = right->next;
+    }
+    link = &(*link)->next;
+  }
+  *link = left ? left : right;
+  return first;
+}
+
+HaploList *haplo_sort_list(HaploList *list, int *err)
+{
+  // The chain can go on past the list, when push-back grew it for
+  // another list, so only the first len cells are read
+  int len = haplo_list_len(list);
+  HaploSortKind kind = HAPLO_SORT_EMPTY;
+  HaploValueList *cell = list->first;
+  for (int i = 0; i < len; ++i, cell = cell->next)
+    kind = haplo_sort_kind(kind, cell->val.type);
+  if (kind == HAPLO_SORT_INVALID)
+  {
+    *err = HAPLO_ERROR_INTERPRETER_INVALID_TYPE;
+    return NULL;
+  }
+
+  // The cells are shared with the other versions of the list, so the
+  // sort relinks copies of them
+  HaploValueList *first = NULL, **link = &first;
+  cell = list->first;
+  for (int i = 0; i < len; ++i, cell = cell->next)
+  {
+    HaploValueList *copy =
+      haplo_value_list_push_front(haplo_value_deep_copy(cell->val), NULL);
+    if (UNLIKELY(!copy))
+    {
+      haplo_value_list_free(first);
+      *err = HAPLO_ERROR_OUT_OF_MEMORY;
+      return NULL;
+    }
+    *link = copy;
+    link = &copy->next;
+  }
+
+  // A list is printed from its last cell, so the chain is sorted in
+  // descending order. runs[i] holds a run of 2^i cells or nothing,
+  // and the runs that come first in the chain have higher indices.
+  HaploValueList *runs[64] = {0};
+  cell = first;
+  while (cell)
+  {
+    HaploValueList *run = cell;
+    cell = cell->next;
+    run->next = NULL;
+
+    int i = 0;
+    for (; runs[i]; ++i)
+    {
+      run = haplo_sort_merge(runs[i], run);
+      runs[i] = NULL;
+    }
+    runs[i] = run;
+  }
+
+  HaploValueList *sorted = NULL;
+  for (int i = 0; i < 64; ++i)
+    if (runs[i]) sorted = haplo_sort_merge(runs[i], sorted);
+
+  HaploList *new_list = haplo_list_new(sorted);
+  if (UNLIKELY(!new_list)) *err = HAPLO_ERROR_OUT_OF_MEMORY;
+  return new_list;
+}
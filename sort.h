@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#ifndef HAPLO_SORT_H
+#define HAPLO_SORT_H
+
+#include "value.h"
+
+//
+// Macros
+//
+
+#ifdef HAPLO_NO_PREFIX
+  #define sort_compare haplo_sort_compare
+  #define sort_order haplo_sort_order
+  #define sort_values haplo_sort_values
+  #define sort_list haplo_sort_list
+#endif // HAPLO_NO_PREFIX
+
+// Shorter inputs are sorted by comparisons instead of radix passes
+#define HAPLO_SORT_RADIX_MIN 64
+
+//
+// Functions
+//
+
+// Values are sorted in ascending order. The keys must be all numbers,
+// which are INTEGER, FLOAT or BIGINT values, or all strings. A NaN is
+// greater than any other number. The sorts are stable.
+
+// Returns a negative number, 0 or a positive number if a is lower,
+// equal or greater than b. a and b must be both numbers or both
+// strings.
+int haplo_sort_compare(HaploValue a, HaploValue b);
+// Writes to order the indices of the count keys in sorted order.
+// Homogeneous integers, floats and strings are sorted with radix
+// sorts, mixed numbers with pdqsort. Returns 0, or a negative error.
+int haplo_sort_order(const HaploValue *keys, int count, int *order);
+// Sorts the count values in place by their keys, which can be the
+// values themselves. Returns 0, or a negative error.
+int haplo_sort_values(HaploValue *values, const HaploValue *keys, int count);
+// Returns a sorted copy of list, or NULL and sets *err. The cells are
+// copied once and sorted by a bottom-up merge sort that relinks them.
+HaploList *haplo_sort_list(HaploList *list, int *err);
+
+#endif // HAPLO_SORT_H
@@ -0,0 +1,209 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "stdlib.h"
+#include "../value.h"
+#include "../array.h"
+#include "../errors.h"
+
+static HaploValue haplo_std_array_new(HaploArrayType type, HaploValueList *args)
+{
+  HaploValue err = haplo_std_find_error(args, haplo_value_list_len(args));
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  int error = 0;
+  HaploArray *array = haplo_array_from_list(type, args, &error);
+  if (!array)
+    return HAPLO_STD_ERROR(error);
+
+  return (HaploValue) {
+    .type = HAPLO_VAL_ARRAY,
+    .value.array = array,
+  };
+}
+
+// array-i64 INTEGER ...
+// Returns: ARRAY
+HAPLO_STD_FUNC_STR(array_i64, "array-i64")
+{
+  return haplo_std_array_new(HAPLO_ARRAY_I64, args);
+}
+
+// array-f64 FLOAT ...
+// Returns: ARRAY
+HAPLO_STD_FUNC_STR(array_f64, "array-f64")
+{
+  return haplo_std_array_new(HAPLO_ARRAY_F64, args);
+}
+
+// Runs op on the array and the array or scalar in args
+static HaploValue haplo_std_array_op(HaploValueList *args, HaploArrayOp op)
+{
+  if (haplo_value_list_len(args) != 2)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue err = haplo_std_find_error(args, 2);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  HaploValue a, b;
+  a = args->val;
+  b = args->next->val;
+  if (a.type != HAPLO_VAL_ARRAY)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+
+  int error = 0;
+  HaploArray *array = (b.type == HAPLO_VAL_ARRAY)
+    ? haplo_array_op(op, a.value.array, b.value.array, &error)
+    : haplo_array_op_scalar(op, a.value.array, b, &error);
+  if (!array)
+    return HAPLO_STD_ERROR(error);
+
+  return (HaploValue) {
+    .type = HAPLO_VAL_ARRAY,
+    .value.array = array,
+  };
+}
+
+// array-add ARRAY ARRAY|NUMBER
+// Returns: ARRAY | ERROR if an i64 element does not fit in 64 bits
+HAPLO_STD_FUNC_STR(array_add, "array-add")
+{
+  return haplo_std_array_op(args, HAPLO_ARRAY_OP_ADD);
+}
+
+// array-sub ARRAY ARRAY|NUMBER
+// Returns: ARRAY | ERROR if an i64 element does not fit in 64 bits
+HAPLO_STD_FUNC_STR(array_sub, "array-sub")
+{
+  return haplo_std_array_op(args, HAPLO_ARRAY_OP_SUB);
+}
+
+// array-mul ARRAY ARRAY|NUMBER
+// Returns: ARRAY | ERROR if an i64 element does not fit in 64 bits
+HAPLO_STD_FUNC_STR(array_mul, "array-mul")
+{
+  return haplo_std_array_op(args, HAPLO_ARRAY_OP_MUL);
+}
+
+// array-div ARRAY ARRAY|NUMBER
+// Returns: ARRAY | ERROR if an i64 element is divided by 0, or
+// does not fit in 64 bits
+HAPLO_STD_FUNC_STR(array_div, "array-div")
+{
+  return haplo_std_array_op(args, HAPLO_ARRAY_OP_DIV);
+}
+
+// array-lt ARRAY ARRAY|NUMBER
+// Returns: ARRAY of i64, 1 where the element is lower and 0 elsewhere
+HAPLO_STD_FUNC_STR(array_lt, "array-lt")
+{
+  return haplo_std_array_op(args, HAPLO_ARRAY_OP_LT);
+}
+
+// array-le ARRAY ARRAY|NUMBER
+// Returns: ARRAY of i64
+HAPLO_STD_FUNC_STR(array_le, "array-le")
+{
+  return haplo_std_array_op(args, HAPLO_ARRAY_OP_LE);
+}
+
+// array-gt ARRAY ARRAY|NUMBER
+// Returns: ARRAY of i64
+HAPLO_STD_FUNC_STR(array_gt, "array-gt")
+{
+  return haplo_std_array_op(args, HAPLO_ARRAY_OP_GT);
+}
+
+// array-ge ARRAY ARRAY|NUMBER
+// Returns: ARRAY of i64
+HAPLO_STD_FUNC_STR(array_ge, "array-ge")
+{
+  return haplo_std_array_op(args, HAPLO_ARRAY_OP_GE);
+}
+
+// array-eq ARRAY ARRAY|NUMBER
+// Returns: ARRAY of i64
+HAPLO_STD_FUNC_STR(array_eq, "array-eq")
+{
+  return haplo_std_array_op(args, HAPLO_ARRAY_OP_EQ);
+}
+
+// Runs reduce on the array in args
+static HaploValue haplo_std_array_reduce(HaploValueList *args,
+                                         HaploValue (*reduce)(HaploArray*))
+{
+  if (haplo_value_list_len(args) != 1)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue array = args->val;
+  if (array.type == HAPLO_VAL_ERROR) return array;
+  if (array.type != HAPLO_VAL_ARRAY)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+
+  return reduce(array.value.array);
+}
+
+// array-sum ARRAY
+// Returns: INTEGER | FLOAT | ERROR if the i64 sum does not fit in 64 bits
+HAPLO_STD_FUNC_STR(array_sum, "array-sum")
+{
+  return haplo_std_array_reduce(args, haplo_array_sum);
+}
+
+// array-min ARRAY
+// Returns: INTEGER | FLOAT | ERROR if ARRAY is empty
+HAPLO_STD_FUNC_STR(array_min, "array-min")
+{
+  return haplo_std_array_reduce(args, haplo_array_min);
+}
+
+// array-max ARRAY
+// Returns: INTEGER | FLOAT | ERROR if ARRAY is empty
+HAPLO_STD_FUNC_STR(array_max, "array-max")
+{
+  return haplo_std_array_reduce(args, haplo_array_max);
+}
+
+// array-dot ARRAY ARRAY
+// Returns: INTEGER | FLOAT | ERROR if the i64 sum or a product does not
+// fit in 64 bits
+HAPLO_STD_FUNC_STR(array_dot, "array-dot")
+{
+  if (haplo_value_list_len(args) != 2)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue err = haplo_std_find_error(args, 2);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  HaploValue a, b;
+  a = args->val;
+  b = args->next->val;
+  if (a.type != HAPLO_VAL_ARRAY || b.type != HAPLO_VAL_ARRAY)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+
+  return haplo_array_dot(a.value.array, b.value.array);
+}
+
+// array->list ARRAY
+// Returns: LIST
+HAPLO_STD_FUNC_STR(array_to_list, "array->list")
+{
+  if (haplo_value_list_len(args) != 1)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue array = args->val;
+  if (array.type == HAPLO_VAL_ERROR) return array;
+  if (array.type != HAPLO_VAL_ARRAY)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+
+  HaploList *list = haplo_array_to_list(array.value.array);
+  if (!list)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+
+  return (HaploValue) {
+    .type = HAPLO_VAL_LIST,
+    .value.list = list,
+  };
+}
@@ -0,0 +1,204 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "stdlib.h"
+#include "../value.h"
+#include "../bytes.h"
+#include "../utf8.h"
+#include "../alloc.h"
+#include "../errors.h"
+
+#include <limits.h>
+#include <string.h>
+
+// Checks that args has from min to max values, the first of type, and
+// returns the first error among them, or an EMPTY value
+static HaploValue haplo_std_bytes_check(HaploValueList *args, int min, int max,
+                                        HaploValueType type)
+{
+  int arg_count = haplo_value_list_len(args);
+  if (arg_count < min || arg_count > max)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue err = haplo_std_find_error(args, arg_count);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  if (args->val.type != type)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+  return (HaploValue) { .type = HAPLO_VAL_EMPTY };
+}
+
+static HaploValue haplo_std_bytes_value(HaploBytes *bytes)
+{
+  if (!bytes) return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+  return (HaploValue) {
+    .type = HAPLO_VAL_BYTES,
+    .value.bytes = bytes,
+  };
+}
+
+// Parses the OFFSET and TYPE arguments of bytes-read and bytes-write
+static int haplo_std_bytes_scalar(HaploValueList *args, long *offset,
+                                  HaploBytesScalar *scalar, bool *big_endian)
+{
+  if (args->val.type != HAPLO_VAL_INTEGER || args->next->val.type != HAPLO_VAL_QUOTE
+      || !haplo_bytes_scalar_parse(haplo_value_text(&args->next->val), scalar, big_endian))
+    return HAPLO_ERROR_INTERPRETER_INVALID_TYPE;
+  *offset = args->val.value.integer;
+  return 0;
+}
+
+// make-bytes LENGTH
+// A writable buffer of LENGTH zero bytes
+// Returns: BYTES
+HAPLO_STD_FUNC_STR(make_bytes, "make-bytes")
+{
+  HaploValue err = haplo_std_bytes_check(args, 1, 1, HAPLO_VAL_INTEGER);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+  if (args->val.value.integer < 0)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INDEX_OUT_OF_BOUNDS);
+
+  return haplo_std_bytes_value(haplo_bytes_new(args->val.value.integer));
+}
+
+// bytes-map PATH
+// bytes-map PATH WRITABLE
+// The bytes of the file at PATH, mapped in memory and not copied.
+// Writes to a WRITABLE buffer go to the file.
+// Returns: BYTES
+HAPLO_STD_FUNC_STR(bytes_map, "bytes-map")
+{
+  HaploValue err_val = haplo_std_bytes_check(args, 1, 2, HAPLO_VAL_STRING);
+  if (err_val.type == HAPLO_VAL_ERROR) return err_val;
+  bool writable = false;
+  if (args->next)
+  {
+    if (args->next->val.type != HAPLO_VAL_BOOL)
+      return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+    writable = args->next->val.value.boolean;
+  }
+
+  // Slices of strings are not NUL terminated
+  int len = haplo_value_text_len(&args->val);
+  char *path = haplo_alloc(len + 1);
+  if (!path) return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+  memcpy(path, haplo_value_text(&args->val), len);
+  path[len] = '\0';
+
+  int err = 0;
+  HaploBytes *bytes = haplo_bytes_map_file(path, writable, &err);
+  haplo_free(path);
+  if (!bytes) return HAPLO_STD_ERROR(err);
+  return haplo_std_bytes_value(bytes);
+}
+
+// bytes-length BYTES
+// Returns: INTEGER
+HAPLO_STD_FUNC_STR(bytes_length, "bytes-length")
+{
+  HaploValue err = haplo_std_bytes_check(args, 1, 1, HAPLO_VAL_BYTES);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  return (HaploValue) {
+    .type = HAPLO_VAL_INTEGER,
+    .value.integer = args->val.value.bytes->len,
+  };
+}
+
+// bytes-slice BYTES START
+// bytes-slice BYTES START END
+// The bytes from START up to END excluded, by default the end of
+// BYTES. The slice shares the memory of BYTES.
+// Returns: BYTES
+HAPLO_STD_FUNC_STR(bytes_slice, "bytes-slice")
+{
+  HaploValue err = haplo_std_bytes_check(args, 2, 3, HAPLO_VAL_BYTES);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  HaploBytes *bytes = args->val.value.bytes;
+  long bounds[2] = { 0, bytes->len };
+  HaploValueList *this = args->next;
+  for (int i = 0; this; ++i, this = this->next)
+  {
+    if (this->val.type != HAPLO_VAL_INTEGER)
+      return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+    bounds[i] = this->val.value.integer;
+  }
+  if (bounds[0] < 0 || bounds[0] > bounds[1] || bounds[1] > bytes->len)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INDEX_OUT_OF_BOUNDS);
+
+  return haplo_std_bytes_value(haplo_bytes_slice(bytes, bounds[0],
+                                                 bounds[1] - bounds[0]));
+}
+
+// bytes-read BYTES OFFSET TYPE
+// The number at OFFSET of BYTES. TYPE is a quote: 'u8 or 'i8, or
+// 'u16 'i16 'u32 'i32 'u64 'i64 'f32 'f64 followed by le for little
+// endian or be for big endian, like 'u32le.
+// Returns: INTEGER, or FLOAT for 'f32 and 'f64
+HAPLO_STD_FUNC_STR(bytes_read, "bytes-read")
+{
+  HaploValue err_val = haplo_std_bytes_check(args, 3, 3, HAPLO_VAL_BYTES);
+  if (err_val.type == HAPLO_VAL_ERROR) return err_val;
+
+  long offset;
+  HaploBytesScalar scalar;
+  bool big_endian;
+  int err = haplo_std_bytes_scalar(args->next, &offset, &scalar, &big_endian);
+  if (err < 0) return HAPLO_STD_ERROR(err);
+  return haplo_bytes_get(args->val.value.bytes, offset, scalar, big_endian);
+}
+
+// bytes-write BYTES OFFSET TYPE VALUE
+// Writes VALUE as a TYPE, see bytes-read, at OFFSET of BYTES, in
+// place. An integer that does not fit in TYPE is an error.
+// Returns: BYTES
+HAPLO_STD_FUNC_STR(bytes_write, "bytes-write")
+{
+  HaploValue err_val = haplo_std_bytes_check(args, 4, 4, HAPLO_VAL_BYTES);
+  if (err_val.type == HAPLO_VAL_ERROR) return err_val;
+
+  long offset;
+  HaploBytesScalar scalar;
+  bool big_endian;
+  int err = haplo_std_bytes_scalar(args->next, &offset, &scalar, &big_endian);
+  if (err == 0)
+    err = haplo_bytes_set(args->val.value.bytes, offset, scalar, big_endian,
+                          args->next->next->next->val);
+  if (err < 0) return HAPLO_STD_ERROR(err);
+  return haplo_value_deep_copy(args->val);
+}
+
+// string->bytes STRING
+// A writable copy of the bytes of STRING
+// Returns: BYTES
+HAPLO_STD_FUNC_STR(string_to_bytes, "string->bytes")
+{
+  HaploValue err = haplo_std_bytes_check(args, 1, 1, HAPLO_VAL_STRING);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  int len = haplo_value_text_len(&args->val);
+  HaploBytes *bytes = haplo_bytes_new(len);
+  if (!bytes) return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+  memcpy(bytes->data, haplo_value_text(&args->val), len);
+  return haplo_std_bytes_value(bytes);
+}
+
+// bytes->string BYTES
+// A copy of BYTES as a string, which must be valid UTF-8
+// Returns: STRING
+HAPLO_STD_FUNC_STR(bytes_to_string, "bytes->string")
+{
+  HaploValue err = haplo_std_bytes_check(args, 1, 1, HAPLO_VAL_BYTES);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  HaploBytes *bytes = args->val.value.bytes;
+  if (bytes->len > INT_MAX)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+  if (!haplo_utf8_valid((const char *) bytes->data, (int) bytes->len))
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INVALID_UTF8);
+  return haplo_value_text_new(HAPLO_VAL_STRING, (const char *) bytes->data,
+                              (int) bytes->len);
+}
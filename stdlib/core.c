@@ -33,10 +33,11 @@ HAPLO_STD_FUNC(setq)
     };
 
     int err = haplo_symbol_map_update(interpreter->symbol_map,
-                                      first.value.quote,
+                                      haplo_value_text(&first),
                                       var);
     if (err < 0)
     {
+      haplo_value_free(var.var);
       return (HaploValue) {
         .type = HAPLO_VAL_ERROR,
         .value.error = err,
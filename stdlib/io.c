@@ -5,6 +5,7 @@
 
 #include "stdlib.h"
 #include "../value.h"
+#include "../str.h"
 #include "../errors.h"
 
 #include <stdio.h>
@@ -21,12 +22,20 @@ HAPLO_STD_FUNC(print)
     };
   }
     
-  HaploValue val;
-  val = args->val;
-    
-  char buf[1024] = {0};
-  haplo_value_string(val, &buf[0], 1024);
-  printf("%s\n", buf);
+  // The value is printed whole, however long it is
+  HaploStringBuilder builder = {0};
+  int err = haplo_string_builder_append_value(&builder, args->val);
+  if (err < 0)
+  {
+    haplo_string_builder_free(&builder);
+    return (HaploValue) {
+      .type = HAPLO_VAL_ERROR,
+      .value.error = err,
+    };
+  }
+  fwrite(builder.string->buffer, 1, builder.string->len, stdout);
+  putchar('\n');
+  haplo_string_builder_free(&builder);
 
   return (HaploValue) {
     .type = HAPLO_VAL_EMPTY,
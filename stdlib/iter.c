@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "stdlib.h"
+#include "../value.h"
+#include "../iter.h"
+#include "../errors.h"
+
+// Wraps iter in a value, or returns an error if it is NULL
+static HaploValue haplo_std_iter_value(HaploIter *iter)
+{
+  if (!iter)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+
+  return (HaploValue) {
+    .type = HAPLO_VAL_ITER,
+    .value.iter = iter,
+  };
+}
+
+// range END
+// range START END
+// range START END STEP
+// The integers from START, 0 by default, up to END excluded
+// Returns: ITER
+HAPLO_STD_FUNC(range)
+{
+  int arg_count = haplo_value_list_len(args);
+  if (arg_count < 1 || arg_count > 3)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue err = haplo_std_find_error(args, arg_count);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  long bounds[3] = { 0, 0, 1 };
+  int first = (arg_count == 1) ? 1 : 0;
+  for (int i = 0; i < arg_count; ++i, args = args->next)
+  {
+    if (args->val.type != HAPLO_VAL_INTEGER)
+      return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+    bounds[first + i] = args->val.value.integer;
+  }
+  int error = 0;
+  HaploIter *iter = haplo_iter_range(bounds[0], bounds[1], bounds[2], &error);
+  if (!iter) return HAPLO_STD_ERROR(error);
+  return haplo_std_iter_value(iter);
+}
+
+// Reads the function or the count, and the sequence in args
+static HaploValue haplo_std_iter_args(HaploValueList *args, HaploIter **source)
+{
+  if (haplo_value_list_len(args) != 2)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue err = haplo_std_find_error(args, 2);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  int error = 0;
+  *source = haplo_iter_from_sequence(args->next->val, &error);
+  if (!*source)
+    return HAPLO_STD_ERROR(error);
+  return (HaploValue) { .type = HAPLO_VAL_EMPTY };
+}
+
+// iter-map FUNCTION SEQUENCE
+// FUNCTION is a quoted name, SEQUENCE an ITER, a LIST, a VECTOR or
+// an ARRAY
+// Returns: ITER over the results of FUNCTION on each value
+HAPLO_STD_FUNC_STR(iter_map, "iter-map")
+{
+  HaploIter *source;
+  HaploValue err = haplo_std_iter_args(args, &source);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  HaploIter *iter = haplo_iter_map(args->val, source);
+  haplo_iter_free(source);
+  return haplo_std_iter_value(iter);
+}
+
+// iter-filter FUNCTION SEQUENCE
+// Returns: ITER over the values for which FUNCTION returns true
+HAPLO_STD_FUNC_STR(iter_filter, "iter-filter")
+{
+  HaploIter *source;
+  HaploValue err = haplo_std_iter_args(args, &source);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  HaploIter *iter = haplo_iter_filter(args->val, source);
+  haplo_iter_free(source);
+  return haplo_std_iter_value(iter);
+}
+
+// iter-take COUNT SEQUENCE
+// Returns: ITER over the first COUNT values
+HAPLO_STD_FUNC_STR(iter_take, "iter-take")
+{
+  if (haplo_value_list_len(args) == 2 && args->val.type != HAPLO_VAL_INTEGER
+      && args->val.type != HAPLO_VAL_ERROR)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+
+  HaploIter *source;
+  HaploValue err = haplo_std_iter_args(args, &source);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  HaploIter *iter = haplo_iter_take(args->val.value.integer, source);
+  haplo_iter_free(source);
+  return haplo_std_iter_value(iter);
+}
+
+// Runs op over the sequence in the last of the count values of args
+static HaploValue haplo_std_iter_run(HaploIterOp op,
+                                     HaploInterpreter *interpreter,
+                                     HaploValueList *args, int count)
+{
+  if (haplo_value_list_len(args) != count)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue err = haplo_std_find_error(args, count);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  HaploValue function = args->val;
+  HaploValue init = { .type = HAPLO_VAL_EMPTY };
+  if (count == 3)
+  {
+    args = args->next;
+    init = args->val;
+  }
+  HaploValue sequence = args->next->val;
+
+  int error = 0;
+  HaploIter *source = haplo_iter_from_sequence(sequence, &error);
+  if (!source)
+    return HAPLO_STD_ERROR(error);
+
+  HaploValue out = haplo_iter_run(op, interpreter, function, init, source,
+                                  sequence.type);
+  haplo_iter_free(source);
+  return out;
+}
+
+// The sequence builtins, the interpreter runs the mapcar and filter
+// calls that build their SEQUENCE in the same pass, see
+// haplo_iter_run:
+//
+// mapcar FUNCTION SEQUENCE
+// filter FUNCTION SEQUENCE
+// Returns: a LIST for a LIST, an ITER for an ITER, or else a VECTOR
+// reduce FUNCTION SEQUENCE
+// fold FUNCTION INIT SEQUENCE
+// Returns: the accumulated value
+#define HAPLO_STD_ITER_FUNC(fn, op, count)                           \
+  HAPLO_STD_FUNC_DEFINE(fn, #fn,                                     \
+                        .run = __haplo_std_##fn,                     \
+                        .iter_op = HAPLO_ITER_OP_##op)               \
+  {                                                                  \
+    return haplo_std_iter_run(HAPLO_ITER_OP_##op, interpreter,       \
+                              args, count);                          \
+  }
+
+HAPLO_STD_ITER_FUNC(mapcar, MAP, 2)
+HAPLO_STD_ITER_FUNC(filter, FILTER, 2)
+HAPLO_STD_ITER_FUNC(reduce, REDUCE, 2)
+HAPLO_STD_ITER_FUNC(fold, FOLD, 3)
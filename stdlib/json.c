@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "stdlib.h"
+#include "../value.h"
+#include "../json.h"
+#include "../bytes.h"
+#include "../str.h"
+#include "../errors.h"
+
+#include <limits.h>
+#include <stdio.h>
+
+// Checks that args has one value, and returns it if it is an error,
+// or an EMPTY value
+static HaploValue haplo_std_json_check(HaploValueList *args)
+{
+  if (haplo_value_list_len(args) != 1)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+  if (args->val.type == HAPLO_VAL_ERROR) return args->val;
+  return (HaploValue) { .type = HAPLO_VAL_EMPTY };
+}
+
+// json-parse TEXT
+// The value of the JSON document in the STRING or BYTES TEXT. Objects
+// become maps, arrays vectors and null empty. Strings parsed from a
+// STRING share its memory.
+// Returns: any
+HAPLO_STD_FUNC_STR(json_parse, "json-parse")
+{
+  HaploValue err = haplo_std_json_check(args);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  if (args->val.type == HAPLO_VAL_STRING)
+    return haplo_json_parse(haplo_value_text(&args->val),
+                            haplo_value_text_len(&args->val), &args->val);
+  if (args->val.type == HAPLO_VAL_BYTES)
+  {
+    HaploBytes *bytes = args->val.value.bytes;
+    if (bytes->len > INT_MAX)
+      return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+    return haplo_json_parse((const char *) bytes->data, (int) bytes->len, NULL);
+  }
+  return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+}
+
+// json-stringify VALUE
+// VALUE as JSON. Lists and vectors become arrays, maps and records
+// objects, empty null.
+// Returns: STRING
+HAPLO_STD_FUNC_STR(json_stringify, "json-stringify")
+{
+  HaploValue err_val = haplo_std_json_check(args);
+  if (err_val.type == HAPLO_VAL_ERROR) return err_val;
+
+  HaploStringBuilder builder = {0};
+  int err = haplo_json_stringify(&builder, args->val);
+  if (err < 0)
+  {
+    haplo_string_builder_free(&builder);
+    return HAPLO_STD_ERROR(err);
+  }
+  return haplo_value_string_build(&builder);
+}
+
+// json-print VALUE
+// Prints VALUE as JSON, see json-stringify, without building the
+// whole text first
+// Returns: EMPTY
+HAPLO_STD_FUNC_STR(json_print, "json-print")
+{
+  HaploValue err_val = haplo_std_json_check(args);
+  if (err_val.type == HAPLO_VAL_ERROR) return err_val;
+
+  int err = haplo_json_write(stdout, args->val);
+  if (err < 0) return HAPLO_STD_ERROR(err);
+  putchar('\n');
+  return (HaploValue) { .type = HAPLO_VAL_EMPTY };
+}
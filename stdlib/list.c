@@ -5,26 +5,36 @@
 
 #include "stdlib.h"
 #include "../value.h"
+#include "../vector.h"
+#include "../array.h"
 #include "../errors.h"
 
 // list VALUE ...
 // Returns: LIST
 HAPLO_STD_FUNC(list)
 {
-  HaploValueList* new_list = NULL;
+  HaploValueList* new_chain = NULL;
   HaploValue new_value = {0};
   HaploValueList* this = args;
   while (this)
   {
     new_value = haplo_value_deep_copy(this->val);
-    new_list = haplo_value_list_push_front(new_value, new_list);
+    new_chain = haplo_value_list_push_front(new_value, new_chain);
     this = this->next;
   }
-    
+
+  HaploList *new_list = haplo_list_new(new_chain);
+  if (!new_list) goto out_of_memory;
   return (HaploValue) {
     .type = HAPLO_VAL_LIST,
     .value.list = new_list,
   };
+
+ out_of_memory:
+  return (HaploValue) {
+    .type = HAPLO_VAL_ERROR,
+    .value.error = HAPLO_ERROR_OUT_OF_MEMORY,
+  };
 }
 
 // append VALUE LIST
@@ -45,17 +55,113 @@ HAPLO_STD_FUNC(append)
 
   if (val.type != HAPLO_VAL_LIST && list.type == HAPLO_VAL_LIST)
   {
-    HaploValueList *new_list = haplo_value_list_deep_copy(list.value.list);
+    // The new list shares all the cells of the old one
     HaploValue new_val = haplo_value_deep_copy(val);
+    HaploList *new_list = haplo_list_push_front(list.value.list, new_val);
+    if (!new_list) goto out_of_memory;
     return (HaploValue) {
       .type = HAPLO_VAL_LIST,
-      .value.list = haplo_value_list_push_front(new_val, new_list),
+      .value.list = new_list,
     };
   } else if (list.type == HAPLO_VAL_ERROR)
   {
     return list;
   }
   
+  return (HaploValue) {
+    .type = HAPLO_VAL_ERROR,
+    .value.error = HAPLO_ERROR_INTERPRETER_INVALID_TYPE,
+  };
+
+ out_of_memory:
+  return (HaploValue) {
+    .type = HAPLO_VAL_ERROR,
+    .value.error = HAPLO_ERROR_OUT_OF_MEMORY,
+  };
+}
+
+// push-back VALUE LIST
+// Adds VALUE at the other end of LIST than append, in O(1) unless
+// the back of LIST is already taken by another list
+// Returns: LIST
+HAPLO_STD_FUNC_STR(push_back, "push-back")
+{
+  if (haplo_value_list_len(args) != 2)
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_ERROR,
+      .value.error = HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS,
+    };
+  }
+    
+  HaploValue val, list;
+  val = args->val;
+  list = args->next->val;
+
+  if (val.type != HAPLO_VAL_LIST && list.type == HAPLO_VAL_LIST)
+  {
+    HaploValue new_val = haplo_value_deep_copy(val);
+    HaploList *new_list = haplo_list_push_back(list.value.list, new_val);
+    if (!new_list) goto out_of_memory;
+    return (HaploValue) {
+      .type = HAPLO_VAL_LIST,
+      .value.list = new_list,
+    };
+  } else if (list.type == HAPLO_VAL_ERROR)
+  {
+    return list;
+  }
+  
+  return (HaploValue) {
+    .type = HAPLO_VAL_ERROR,
+    .value.error = HAPLO_ERROR_INTERPRETER_INVALID_TYPE,
+  };
+
+ out_of_memory:
+  return (HaploValue) {
+    .type = HAPLO_VAL_ERROR,
+    .value.error = HAPLO_ERROR_OUT_OF_MEMORY,
+  };
+}
+
+// length LIST|VECTOR|ARRAY
+// Returns: INTEGER
+HAPLO_STD_FUNC(length)
+{
+  if (haplo_value_list_len(args) != 1)
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_ERROR,
+      .value.error = HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS,
+    };
+  }
+    
+  HaploValue val;
+  val = args->val;
+
+  if (val.type == HAPLO_VAL_LIST)
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_INTEGER,
+      .value.integer = haplo_list_len(val.value.list),
+    };
+  } else if (val.type == HAPLO_VAL_VECTOR)
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_INTEGER,
+      .value.integer = haplo_vector_len(val.value.vector),
+    };
+  } else if (val.type == HAPLO_VAL_ARRAY)
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_INTEGER,
+      .value.integer = haplo_array_len(val.value.array),
+    };
+  } else if (val.type == HAPLO_VAL_ERROR)
+  {
+    return val;
+  }
+  
   return (HaploValue) {
     .type = HAPLO_VAL_ERROR,
     .value.error = HAPLO_ERROR_INTERPRETER_INVALID_TYPE,
@@ -79,8 +185,10 @@ HAPLO_STD_FUNC(head)
 
   if (val.type == HAPLO_VAL_LIST)
   {
+    if (haplo_list_len(val.value.list) == 0) goto empty_list;
+
     HaploValue head, new_head;
-    head = val.value.list->val;
+    head = val.value.list->first->val;
     new_head = haplo_value_deep_copy(head);
     return new_head;
   } else if (val.type == HAPLO_VAL_ERROR)
@@ -92,6 +200,12 @@ HAPLO_STD_FUNC(head)
     .type = HAPLO_VAL_ERROR,
     .value.error = HAPLO_ERROR_INTERPRETER_INVALID_TYPE,
   };
+
+ empty_list:
+  return (HaploValue) {
+    .type = HAPLO_VAL_ERROR,
+    .value.error = HAPLO_ERROR_LIST_EMPTY,
+  };
 }
 
 // tail LIST
@@ -111,9 +225,16 @@ HAPLO_STD_FUNC(tail)
 
   if (val.type == HAPLO_VAL_LIST)
   {
-    HaploValueList *list, *new_list;
-    list = val.value.list->next;
-    new_list = haplo_value_list_deep_copy(list);
+    if (haplo_list_len(val.value.list) == 0) goto empty_list;
+
+    HaploList *new_list = haplo_list_tail(val.value.list);
+    if (!new_list)
+    {
+      return (HaploValue) {
+        .type = HAPLO_VAL_ERROR,
+        .value.error = HAPLO_ERROR_OUT_OF_MEMORY,
+      };
+    }
     return (HaploValue) {
       .type = HAPLO_VAL_LIST,
       .value.list = new_list,
@@ -127,4 +248,10 @@ HAPLO_STD_FUNC(tail)
     .type = HAPLO_VAL_ERROR,
     .value.error = HAPLO_ERROR_INTERPRETER_INVALID_TYPE,
   };
+
+ empty_list:
+  return (HaploValue) {
+    .type = HAPLO_VAL_ERROR,
+    .value.error = HAPLO_ERROR_LIST_EMPTY,
+  };
 }
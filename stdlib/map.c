@@ -0,0 +1,215 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "stdlib.h"
+#include "../value.h"
+#include "../map.h"
+#include "../hamt.h"
+#include "../errors.h"
+
+// map KEY VALUE ...
+// Returns: MAP
+HAPLO_STD_FUNC(map)
+{
+  if (haplo_value_list_len(args) % 2 != 0)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploMap *map = haplo_map_new();
+  if (!map)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+
+  for (HaploValueList *this = args; this; this = this->next->next)
+  {
+    if (haplo_value_contains(this->next->val, map))
+    {
+      haplo_map_free(map);
+      return HAPLO_STD_ERROR(HAPLO_ERROR_VALUE_CYCLE);
+    }
+    int error = haplo_map_put(map, haplo_value_deep_copy(this->val),
+                              haplo_value_deep_copy(this->next->val));
+    if (error < 0)
+    {
+      haplo_map_free(map);
+      return HAPLO_STD_ERROR(error);
+    }
+  }
+
+  return (HaploValue) {
+    .type = HAPLO_VAL_MAP,
+    .value.map = map,
+  };
+}
+
+// pmap KEY VALUE ...
+// Returns: PMAP, a persistent map
+HAPLO_STD_FUNC(pmap)
+{
+  if (haplo_value_list_len(args) % 2 != 0)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploHamt *hamt = haplo_hamt_new();
+  if (!hamt)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+
+  for (HaploValueList *this = args; this; this = this->next->next)
+  {
+    if (!haplo_value_hashable(this->val))
+    {
+      haplo_hamt_free(hamt);
+      return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+    }
+
+    HaploHamt *new_hamt = haplo_hamt_put(hamt, haplo_value_deep_copy(this->val),
+                                         haplo_value_deep_copy(this->next->val));
+    haplo_hamt_free(hamt);
+    if (!new_hamt)
+      return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+    hamt = new_hamt;
+  }
+
+  return (HaploValue) {
+    .type = HAPLO_VAL_PMAP,
+    .value.hamt = hamt,
+  };
+}
+
+// map-get KEY MAP|PMAP
+// Returns: VALUE
+HAPLO_STD_FUNC_STR(map_get, "map-get")
+{
+  if (haplo_value_list_len(args) != 2)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue err = haplo_std_find_error(args, 2);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  HaploValue key, map;
+  key = args->val;
+  map = args->next->val;
+  if (!haplo_value_hashable(key)
+      || (map.type != HAPLO_VAL_MAP && map.type != HAPLO_VAL_PMAP))
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+
+  HaploValue *value = (map.type == HAPLO_VAL_MAP) ?
+    haplo_map_get(map.value.map, key) : haplo_hamt_get(map.value.hamt, key);
+  if (!value)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_KEY_NOT_FOUND);
+
+  return haplo_value_deep_copy(*value);
+}
+
+// map-put KEY VALUE MAP|PMAP
+// Sets KEY to VALUE in MAP, in place. A PMAP is not changed, a new
+// one with KEY is returned.
+// Returns: MAP|PMAP
+HAPLO_STD_FUNC_STR(map_put, "map-put")
+{
+  if (haplo_value_list_len(args) != 3)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue err = haplo_std_find_error(args, 3);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  HaploValue key, val, map;
+  key = args->val;
+  val = args->next->val;
+  map = args->next->next->val;
+  if (map.type == HAPLO_VAL_PMAP && haplo_value_hashable(key))
+  {
+    HaploHamt *hamt = haplo_hamt_put(map.value.hamt, haplo_value_deep_copy(key),
+                                     haplo_value_deep_copy(val));
+    if (!hamt)
+      return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+    return (HaploValue) {
+      .type = HAPLO_VAL_PMAP,
+      .value.hamt = hamt,
+    };
+  }
+  if (!haplo_value_hashable(key) || map.type != HAPLO_VAL_MAP)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+  if (haplo_value_contains(val, map.value.map))
+    return HAPLO_STD_ERROR(HAPLO_ERROR_VALUE_CYCLE);
+
+  int error = haplo_map_put(map.value.map, haplo_value_deep_copy(key),
+                            haplo_value_deep_copy(val));
+  if (error < 0)
+    return HAPLO_STD_ERROR(error);
+
+  return haplo_value_deep_copy(map);
+}
+
+// map-del KEY MAP|PMAP
+// Removes KEY from MAP, in place. A PMAP is not changed, a new one
+// without KEY is returned.
+// Returns: MAP|PMAP
+HAPLO_STD_FUNC_STR(map_del, "map-del")
+{
+  if (haplo_value_list_len(args) != 2)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue err = haplo_std_find_error(args, 2);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  HaploValue key, map;
+  key = args->val;
+  map = args->next->val;
+  if (map.type == HAPLO_VAL_PMAP && haplo_value_hashable(key))
+  {
+    HaploHamt *hamt = haplo_hamt_del(map.value.hamt, key);
+    if (!hamt)
+      return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+    return (HaploValue) {
+      .type = HAPLO_VAL_PMAP,
+      .value.hamt = hamt,
+    };
+  }
+  if (!haplo_value_hashable(key) || map.type != HAPLO_VAL_MAP)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+
+  haplo_map_del(map.value.map, key);
+  return haplo_value_deep_copy(map);
+}
+
+// map-keys MAP|PMAP
+// Returns: LIST
+HAPLO_STD_FUNC_STR(map_keys, "map-keys")
+{
+  if (haplo_value_list_len(args) != 1)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue map = args->val;
+  if (map.type == HAPLO_VAL_ERROR) return map;
+  if (map.type != HAPLO_VAL_MAP && map.type != HAPLO_VAL_PMAP)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+
+  HaploList *keys = (map.type == HAPLO_VAL_MAP) ?
+    haplo_map_keys(map.value.map) : haplo_hamt_keys(map.value.hamt);
+  if (!keys)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+
+  return (HaploValue) {
+    .type = HAPLO_VAL_LIST,
+    .value.list = keys,
+  };
+}
+
+// map-size MAP|PMAP
+// Returns: INTEGER
+HAPLO_STD_FUNC_STR(map_size, "map-size")
+{
+  if (haplo_value_list_len(args) != 1)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue map = args->val;
+  if (map.type == HAPLO_VAL_ERROR) return map;
+  if (map.type != HAPLO_VAL_MAP && map.type != HAPLO_VAL_PMAP)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+
+  return (HaploValue) {
+    .type = HAPLO_VAL_INTEGER,
+    .value.integer = (map.type == HAPLO_VAL_MAP) ?
+      haplo_map_size(map.value.map) : haplo_hamt_size(map.value.hamt),
+  };
+}
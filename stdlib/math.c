@@ -5,402 +5,62 @@
 
 #include "stdlib.h"
 #include "../value.h"
+#include "../arith.h"
+#include "../alloc.h"
 #include "../errors.h"
 
-#include <stdio.h>
+// Calls with more arguments copy them to the heap
+#define HAPLO_STD_MATH_STACK_ARGS 16
 
-// + INTEGER INTEGER
-// Returns: INTEGER | ERROR
-// + FLOAT FLOAT
-// Returns: FLOAT | ERROR
-HAPLO_STD_FUNC_STR(plus, "+")
+// Moves the values of args to an array and folds op over them
+static HaploValue haplo_std_math_fold(HaploArithOp op, HaploValueList *args)
 {
-  if (haplo_value_list_len(args) != 2)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_ERROR,
-      .value.error = HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS,
-    };
-  }
-    
-  HaploValue a, b;
-  a = args->val;
-  b = args->next->val;
-
-  if (a.type == HAPLO_VAL_INTEGER && b.type == HAPLO_VAL_INTEGER)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_INTEGER,
-      .value.integer = a.value.integer + b.value.integer,
-    };
-  } else if (a.type == HAPLO_VAL_FLOAT && b.type == HAPLO_VAL_FLOAT)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_FLOAT,
-      .value.floating_point = a.value.floating_point + b.value.floating_point,
-    };
-  } else if (b.type == HAPLO_VAL_ERROR)
-  {
-    return b;
-  } else if (a.type == HAPLO_VAL_ERROR)
-  {
-    return a;
-  }
-    
-  return (HaploValue) {
-    .type = HAPLO_VAL_ERROR,
-    .value.error = HAPLO_ERROR_INTERPRETER_INVALID_TYPE,
-  };
+  int count = haplo_value_list_len(args);
+  HaploValue stack_values[HAPLO_STD_MATH_STACK_ARGS];
+  HaploValue *values = stack_values;
+  if (count > HAPLO_STD_MATH_STACK_ARGS)
+  {
+    values = haplo_alloc(count * sizeof(HaploValue));
+    if (!values)
+    {
+      return (HaploValue) {
+        .type = HAPLO_VAL_ERROR,
+        .value.error = HAPLO_ERROR_OUT_OF_MEMORY,
+      };
+    }
+  }
+
+  for (int i = 0; i < count; ++i, args = args->next)
+    values[i] = args->val;
+  HaploValue result = haplo_arith_fold(op, values, count);
+
+  if (values != stack_values) haplo_free(values);
+  return result;
 }
 
-// - INTEGER INTEGER
-// Returns: INTEGER | ERROR
-// - FLOAT FLOAT
-// Returns: FLOAT | ERROR
-HAPLO_STD_FUNC_STR(minus, "-")
-{
-  if (haplo_value_list_len(args) != 2)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_ERROR,
-      .value.error = HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS,
-    };
-  }
-    
-  HaploValue a, b;
-  a = args->val;
-  b = args->next->val;
-
-  if (a.type == HAPLO_VAL_INTEGER && b.type == HAPLO_VAL_INTEGER)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_INTEGER,
-      .value.integer = a.value.integer - b.value.integer,
-    };
-  } else if (a.type == HAPLO_VAL_FLOAT && b.type == HAPLO_VAL_FLOAT)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_FLOAT,
-      .value.floating_point = a.value.floating_point - b.value.floating_point,
-    };
-  } else if (b.type == HAPLO_VAL_ERROR)
-  {
-    return b;
-  } else if (a.type == HAPLO_VAL_ERROR)
-  {
-    return a;
-  }
-  
-  return (HaploValue) {
-    .type = HAPLO_VAL_ERROR,
-    .value.error = HAPLO_ERROR_INTERPRETER_INVALID_TYPE,
-  };
-}
-
-// * INTEGER INTEGER
-// Returns: INTEGER | ERROR
-// * FLOAT FLOAT
-// Returns: FLOAT | ERROR
-HAPLO_STD_FUNC_STR(times, "*")
-{
-  if (haplo_value_list_len(args) != 2)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_ERROR,
-      .value.error = HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS,
-    };
-  }
-
-  HaploValue a, b;
-  a = args->val;
-  b = args->next->val;
-
-  if (a.type == HAPLO_VAL_INTEGER && b.type == HAPLO_VAL_INTEGER)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_INTEGER,
-      .value.integer = a.value.integer * b.value.integer,
-    };
-  } else if (a.type == HAPLO_VAL_FLOAT && b.type == HAPLO_VAL_FLOAT)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_FLOAT,
-      .value.floating_point = a.value.floating_point * b.value.floating_point,
-    };
-  } else if (b.type == HAPLO_VAL_ERROR)
-  {
-    return b;
-  } else if (a.type == HAPLO_VAL_ERROR)
-  {
-    return a;
-  }
-    
-  return (HaploValue) {
-    .type = HAPLO_VAL_ERROR,
-    .value.error = HAPLO_ERROR_INTERPRETER_INVALID_TYPE,
-  };
-}
-
-// / INTEGER INTEGER
-// Returns: INTEGER | ERROR
-// / FLOAT FLOAT
-// Returns: FLOAT | ERROR
-HAPLO_STD_FUNC_STR(div, "/")
-{
-  if (haplo_value_list_len(args) != 2)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_ERROR,
-      .value.error = HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS,
-    };
-  }
-    
-  HaploValue a, b;
-  a = args->val;
-  b = args->next->val;
-
-  if (a.type == HAPLO_VAL_INTEGER && b.type == HAPLO_VAL_INTEGER)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_INTEGER,
-      .value.integer = a.value.integer / b.value.integer,
-    };
-  } else if (a.type == HAPLO_VAL_FLOAT && b.type == HAPLO_VAL_FLOAT)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_FLOAT,
-      .value.floating_point = a.value.floating_point / b.value.floating_point,
-    };
-  } else if (b.type == HAPLO_VAL_ERROR)
-  {
-    return b;
-  } else if (a.type == HAPLO_VAL_ERROR)
-  {
-    return a;
-  }
-  
-  return (HaploValue) {
-    .type = HAPLO_VAL_ERROR,
-    .value.error = HAPLO_ERROR_INTERPRETER_INVALID_TYPE,
-  };
-}
-
-// > INTEGER INTEGER
+// The arithmetic builtins, see HAPLO_ARITH_OPS:
+//
+// + NUMBER ...
+// - NUMBER ...
+// * NUMBER ...
+// / NUMBER ...
+// Returns: INTEGER | BIGINT | FLOAT | ERROR
+// > NUMBER NUMBER ...
+// < NUMBER NUMBER ...
+// = NUMBER NUMBER ...
+// >= NUMBER NUMBER ...
+// <= NUMBER NUMBER ...
 // Returns: BOOL | ERROR
-// > FLOAT FLOAT
-// Returns: BOOL | ERROR
-HAPLO_STD_FUNC_STR(greater, ">")
-{
-  if (haplo_value_list_len(args) != 2)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_ERROR,
-      .value.error = HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS,
-    };
-  }
-    
-  HaploValue a, b;
-  a = args->val;
-  b = args->next->val;
-
-  if (a.type == HAPLO_VAL_INTEGER && b.type == HAPLO_VAL_INTEGER)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_BOOL,
-      .value.boolean = (a.value.integer > b.value.integer),
-    };
-  } else if (a.type == HAPLO_VAL_FLOAT && b.type == HAPLO_VAL_FLOAT)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_BOOL,
-      .value.boolean = (a.value.floating_point > b.value.floating_point),
-    };
-  } else if (b.type == HAPLO_VAL_ERROR)
-  {
-    return b;
-  } else if (a.type == HAPLO_VAL_ERROR)
-  {
-    return a;
-  }
-  
-  return (HaploValue) {
-    .type = HAPLO_VAL_ERROR,
-    .value.error = HAPLO_ERROR_INTERPRETER_INVALID_TYPE,
-  };
-}
-
-// < INTEGER INTEGER
-// Returns: BOOL | ERROR
-// < FLOAT FLOAT
-// Returns: BOOL | ERROR
-HAPLO_STD_FUNC_STR(lesser, "<")
-{
-  if (haplo_value_list_len(args) != 2)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_ERROR,
-      .value.error = HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS,
-    };
-  }
-    
-  HaploValue a, b;
-  a = args->val;
-  b = args->next->val;
-
-  if (a.type == HAPLO_VAL_INTEGER && b.type == HAPLO_VAL_INTEGER)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_BOOL,
-      .value.boolean = (a.value.integer < b.value.integer),
-    };
-  } else if (a.type == HAPLO_VAL_FLOAT && b.type == HAPLO_VAL_FLOAT)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_BOOL,
-      .value.boolean = (a.value.floating_point < b.value.floating_point),
-    };
-  } else if (b.type == HAPLO_VAL_ERROR)
-  {
-    return b;
-  } else if (a.type == HAPLO_VAL_ERROR)
-  {
-    return a;
-  }
-  
-  return (HaploValue) {
-    .type = HAPLO_VAL_ERROR,
-    .value.error = HAPLO_ERROR_INTERPRETER_INVALID_TYPE,
-  };
-}
-
-// = INTEGER INTEGER
-// Returns: BOOL | ERROR
-// = FLOAT FLOAT
-// Returns: BOOL | ERROR
-HAPLO_STD_FUNC_STR(equal, "=")
-{
-  if (haplo_value_list_len(args) != 2)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_ERROR,
-      .value.error = HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS,
-    };
-  }
-    
-  HaploValue a, b;
-  a = args->val;
-  b = args->next->val;
-
-  if (a.type == HAPLO_VAL_INTEGER && b.type == HAPLO_VAL_INTEGER)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_BOOL,
-      .value.boolean = (a.value.integer == b.value.integer),
-    };
-  } else if (a.type == HAPLO_VAL_FLOAT && b.type == HAPLO_VAL_FLOAT)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_BOOL,
-      .value.boolean = (a.value.floating_point == b.value.floating_point),
-    };
-  } else if (b.type == HAPLO_VAL_ERROR)
-  {
-    return b;
-  } else if (a.type == HAPLO_VAL_ERROR)
-  {
-    return a;
-  }
-  
-  return (HaploValue) {
-    .type = HAPLO_VAL_ERROR,
-    .value.error = HAPLO_ERROR_INTERPRETER_INVALID_TYPE,
-  };
-}
-
-// >= INTEGER INTEGER
-// Returns: BOOL | ERROR
-// >= FLOAT FLOAT
-// Returns: BOOL | ERROR
-HAPLO_STD_FUNC_STR(greater_or_equal, ">=")
-{
-  if (haplo_value_list_len(args) != 2)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_ERROR,
-      .value.error = HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS,
-    };
-  }
-    
-  HaploValue a, b;
-  a = args->val;
-  b = args->next->val;
-
-  if (a.type == HAPLO_VAL_INTEGER && b.type == HAPLO_VAL_INTEGER)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_BOOL,
-      .value.boolean = (a.value.integer >= b.value.integer),
-    };
-  } else if (a.type == HAPLO_VAL_FLOAT && b.type == HAPLO_VAL_FLOAT)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_BOOL,
-      .value.boolean = (a.value.floating_point >= b.value.floating_point),
-    };
-  } else if (b.type == HAPLO_VAL_ERROR)
-  {
-    return b;
-  } else if (a.type == HAPLO_VAL_ERROR)
-  {
-    return a;
-  }
-  
-  return (HaploValue) {
-    .type = HAPLO_VAL_ERROR,
-    .value.error = HAPLO_ERROR_INTERPRETER_INVALID_TYPE,
-  };
-}
-
-// <= INTEGER INTEGER
-// Returns: BOOL | ERROR
-// <= FLOAT FLOAT
-// Returns: BOOL | ERROR
-HAPLO_STD_FUNC_STR(lesser_or_equal, "<=")
-{
-  if (haplo_value_list_len(args) != 2)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_ERROR,
-      .value.error = HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS,
-    };
-  }
-    
-  HaploValue a, b;
-  a = args->val;
-  b = args->next->val;
-
-  if (a.type == HAPLO_VAL_INTEGER && b.type == HAPLO_VAL_INTEGER)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_BOOL,
-      .value.boolean = (a.value.integer <= b.value.integer),
-    };
-  } else if (a.type == HAPLO_VAL_FLOAT && b.type == HAPLO_VAL_FLOAT)
-  {
-    return (HaploValue) {
-      .type = HAPLO_VAL_BOOL,
-      .value.boolean = (a.value.floating_point <= b.value.floating_point),
-    };
-  } else if (b.type == HAPLO_VAL_ERROR)
-  {
-    return b;
-  } else if (a.type == HAPLO_VAL_ERROR)
-  {
-    return a;
-  }
-  
-  return (HaploValue) {
-    .type = HAPLO_VAL_ERROR,
-    .value.error = HAPLO_ERROR_INTERPRETER_INVALID_TYPE,
-  };
-}
+//
+// A NUMBER is an INTEGER, a BIGINT or a FLOAT, integers are promoted
+// to floats when they are mixed with them
+#define HAPLO_STD_MATH_FUNC(name, symbol, ...)                       \
+  HAPLO_STD_FUNC_DEFINE(arith_##name, symbol,                        \
+                        .run = __haplo_std_arith_##name,             \
+                        .arith = true,                               \
+                        .arith_op = HAPLO_ARITH_##name)              \
+  {                                                                  \
+    return haplo_std_math_fold(HAPLO_ARITH_##name, args);            \
+  }
+
+HAPLO_ARITH_OPS(HAPLO_STD_MATH_FUNC)
@@ -0,0 +1,208 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "stdlib.h"
+#include "../value.h"
+#include "../array.h"
+#include "../matrix.h"
+#include "../errors.h"
+
+#include <limits.h>
+
+// Wraps matrix in a value, or returns error if it is NULL
+static HaploValue haplo_std_matrix_value(HaploMatrix *matrix, int error)
+{
+  if (!matrix)
+    return HAPLO_STD_ERROR(error);
+
+  return (HaploValue) {
+    .type = HAPLO_VAL_MATRIX,
+    .value.matrix = matrix,
+  };
+}
+
+// matrix ROWS COLS FLOAT ...
+// matrix ROWS COLS ARRAY
+// The elements are in row major order, an f64 ARRAY is shared
+// without copying it
+// Returns: MATRIX
+HAPLO_STD_FUNC(matrix)
+{
+  int arg_count = haplo_value_list_len(args);
+  if (arg_count < 2)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue err = haplo_std_find_error(args, arg_count);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  HaploValue rows, cols;
+  rows = args->val;
+  cols = args->next->val;
+  if (rows.type != HAPLO_VAL_INTEGER || cols.type != HAPLO_VAL_INTEGER)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+  if (rows.value.integer < 0 || rows.value.integer > INT_MAX
+      || cols.value.integer < 0 || cols.value.integer > INT_MAX)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_LENGTH_MISMATCH);
+
+  HaploValueList *elements = args->next->next;
+  if (arg_count == 3 && elements->val.type == HAPLO_VAL_ARRAY)
+  {
+    int error = 0;
+    HaploMatrix *matrix = haplo_matrix_from_array(rows.value.integer,
+                                                  cols.value.integer,
+                                                  elements->val.value.array,
+                                                  &error);
+    return haplo_std_matrix_value(matrix, error);
+  }
+
+  int error = 0;
+  HaploArray *array = haplo_array_from_list(HAPLO_ARRAY_F64, elements, &error);
+  if (!array)
+    return HAPLO_STD_ERROR(error);
+
+  HaploMatrix *matrix = haplo_matrix_from_array(rows.value.integer,
+                                                cols.value.integer,
+                                                array, &error);
+  haplo_array_free(array);
+  return haplo_std_matrix_value(matrix, error);
+}
+
+// matmul MATRIX MATRIX
+// Returns: MATRIX
+HAPLO_STD_FUNC(matmul)
+{
+  if (haplo_value_list_len(args) != 2)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue err = haplo_std_find_error(args, 2);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  HaploValue a, b;
+  a = args->val;
+  b = args->next->val;
+  if (a.type != HAPLO_VAL_MATRIX || b.type != HAPLO_VAL_MATRIX)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+
+  int error = 0;
+  HaploMatrix *matrix = haplo_matrix_mul(a.value.matrix, b.value.matrix, &error);
+  return haplo_std_matrix_value(matrix, error);
+}
+
+// transpose MATRIX
+// Returns: MATRIX
+HAPLO_STD_FUNC(transpose)
+{
+  if (haplo_value_list_len(args) != 1)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue matrix = args->val;
+  if (matrix.type == HAPLO_VAL_ERROR) return matrix;
+  if (matrix.type != HAPLO_VAL_MATRIX)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+
+  int error = 0;
+  return haplo_std_matrix_value(haplo_matrix_transpose(matrix.value.matrix, &error),
+                                error);
+}
+
+// Reads the two integers and the matrix in args
+static HaploValue haplo_std_matrix_int_args(HaploValueList *args,
+                                            long *first, long *second,
+                                            HaploMatrix **matrix)
+{
+  if (haplo_value_list_len(args) != 3)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue err = haplo_std_find_error(args, 3);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  HaploValue a, b, m;
+  a = args->val;
+  b = args->next->val;
+  m = args->next->next->val;
+  if (a.type != HAPLO_VAL_INTEGER || b.type != HAPLO_VAL_INTEGER
+      || m.type != HAPLO_VAL_MATRIX)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+
+  *first = a.value.integer;
+  *second = b.value.integer;
+  *matrix = m.value.matrix;
+  return (HaploValue) { .type = HAPLO_VAL_EMPTY };
+}
+
+// matrix-rows START END MATRIX
+// Returns: MATRIX with the rows in [START, END), sharing the elements
+HAPLO_STD_FUNC_STR(matrix_rows, "matrix-rows")
+{
+  long start, end;
+  HaploMatrix *matrix;
+  HaploValue err = haplo_std_matrix_int_args(args, &start, &end, &matrix);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+  if (start < 0 || end > matrix->rows)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INDEX_OUT_OF_BOUNDS);
+
+  int error = 0;
+  return haplo_std_matrix_value(haplo_matrix_slice_rows(matrix, start, end, &error),
+                                error);
+}
+
+// matrix-cols START END MATRIX
+// Returns: MATRIX with the columns in [START, END), sharing the
+// elements
+HAPLO_STD_FUNC_STR(matrix_cols, "matrix-cols")
+{
+  long start, end;
+  HaploMatrix *matrix;
+  HaploValue err = haplo_std_matrix_int_args(args, &start, &end, &matrix);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+  if (start < 0 || end > matrix->cols)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INDEX_OUT_OF_BOUNDS);
+
+  int error = 0;
+  return haplo_std_matrix_value(haplo_matrix_slice_cols(matrix, start, end, &error),
+                                error);
+}
+
+// matrix-ref ROW COL MATRIX
+// Returns: FLOAT
+HAPLO_STD_FUNC_STR(matrix_ref, "matrix-ref")
+{
+  long row, col;
+  HaploMatrix *matrix;
+  HaploValue err = haplo_std_matrix_int_args(args, &row, &col, &matrix);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+  if (row < 0 || row >= matrix->rows || col < 0 || col >= matrix->cols)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INDEX_OUT_OF_BOUNDS);
+
+  return (HaploValue) {
+    .type = HAPLO_VAL_FLOAT,
+    .value.floating_point = haplo_matrix_at(matrix, row, col),
+  };
+}
+
+// matrix-sum AXIS MATRIX
+// Returns: MATRIX with one row if AXIS is 0, one column if it is 1
+HAPLO_STD_FUNC_STR(matrix_sum, "matrix-sum")
+{
+  if (haplo_value_list_len(args) != 2)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue err = haplo_std_find_error(args, 2);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  HaploValue axis, matrix;
+  axis = args->val;
+  matrix = args->next->val;
+  if (axis.type != HAPLO_VAL_INTEGER || matrix.type != HAPLO_VAL_MATRIX)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+
+  if (axis.value.integer != 0 && axis.value.integer != 1)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INDEX_OUT_OF_BOUNDS);
+
+  int error = 0;
+  return haplo_std_matrix_value(haplo_matrix_sum(matrix.value.matrix,
+                                                 axis.value.integer, &error),
+                                error);
+}
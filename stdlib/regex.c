@@ -0,0 +1,241 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "stdlib.h"
+#include "../value.h"
+#include "../regex.h"
+#include "../map.h"
+#include "../alloc.h"
+#include "../errors.h"
+
+#include <limits.h>
+#include <string.h>
+
+// The cache of an interpreter is cleared when it holds more patterns
+#define HAPLO_STD_REGEX_CACHE_MAX 64
+
+// Checks that args has count values, a pattern and then strings, and
+// returns the first error among them, or an EMPTY value
+static HaploValue haplo_std_regex_check(HaploValueList *args, int count)
+{
+  if (haplo_value_list_len(args) != count)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue err = haplo_std_find_error(args, count);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  if (args->val.type != HAPLO_VAL_STRING && args->val.type != HAPLO_VAL_REGEX)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+  for (args = args->next; args; args = args->next)
+    if (args->val.type != HAPLO_VAL_STRING)
+      return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+  return (HaploValue) { .type = HAPLO_VAL_EMPTY };
+}
+
+// Returns a new reference to the compiled pattern, a STRING or a
+// REGEX, or NULL and sets *err. Pattern strings are compiled once
+// per interpreter.
+static HaploRegex *haplo_std_regex_get(HaploInterpreter *interpreter,
+                                       HaploValue pattern, int *err)
+{
+  if (pattern.type == HAPLO_VAL_REGEX)
+    return haplo_regex_ref(pattern.value.regex);
+
+  HaploMap *cache = interpreter ? interpreter->regex_cache : NULL;
+  HaploValue *cached = cache ? haplo_map_get(cache, pattern) : NULL;
+  if (cached) return haplo_regex_ref(cached->value.regex);
+
+  HaploRegex *regex = haplo_regex_compile(haplo_value_text(&pattern),
+                                          haplo_value_text_len(&pattern), err);
+  if (!regex || !interpreter) return regex;
+
+  if (cache && haplo_map_size(cache) >= HAPLO_STD_REGEX_CACHE_MAX)
+  {
+    haplo_map_free(cache);
+    cache = interpreter->regex_cache = NULL;
+  }
+  if (!cache)
+    cache = interpreter->regex_cache = haplo_map_new();
+  // The pattern still works if it can't be cached
+  if (cache)
+    haplo_map_put(cache, haplo_value_deep_copy(pattern), (HaploValue) {
+        .type = HAPLO_VAL_REGEX,
+        .value.regex = haplo_regex_ref(regex),
+      });
+  return regex;
+}
+
+// regex-compile PATTERN
+// PATTERN compiled, see haplo_regex_compile for the syntax. The regex
+// builtins also take PATTERN as a STRING, and compile it once.
+// Returns: REGEX
+HAPLO_STD_FUNC_STR(regex_compile, "regex-compile")
+{
+  HaploValue err_val = haplo_std_regex_check(args, 1);
+  if (err_val.type == HAPLO_VAL_ERROR) return err_val;
+
+  int err = 0;
+  HaploRegex *regex = haplo_std_regex_get(interpreter, args->val, &err);
+  if (!regex) return HAPLO_STD_ERROR(err);
+  return (HaploValue) {
+    .type = HAPLO_VAL_REGEX,
+    .value.regex = regex,
+  };
+}
+
+// regex-match PATTERN STRING
+// True if PATTERN matches a part of STRING
+// Returns: BOOL
+HAPLO_STD_FUNC_STR(regex_match, "regex-match")
+{
+  HaploValue err_val = haplo_std_regex_check(args, 2);
+  if (err_val.type == HAPLO_VAL_ERROR) return err_val;
+
+  int err = 0;
+  HaploRegex *regex = haplo_std_regex_get(interpreter, args->val, &err);
+  if (!regex) return HAPLO_STD_ERROR(err);
+  HaploValue *string = &args->next->val;
+  int found = haplo_regex_match(regex, haplo_value_text(string),
+                                haplo_value_text_len(string));
+  haplo_regex_free(regex);
+  if (found < 0) return HAPLO_STD_ERROR(found);
+  return (HaploValue) {
+    .type = HAPLO_VAL_BOOL,
+    .value.boolean = found,
+  };
+}
+
+// regex-find-all PATTERN STRING
+// The leftmost longest matches of PATTERN in STRING, left to right,
+// which share the bytes of STRING
+// Returns: LIST
+HAPLO_STD_FUNC_STR(regex_find_all, "regex-find-all")
+{
+  HaploValue err_val = haplo_std_regex_check(args, 2);
+  if (err_val.type == HAPLO_VAL_ERROR) return err_val;
+
+  int err = 0;
+  HaploRegex *regex = haplo_std_regex_get(interpreter, args->val, &err);
+  if (!regex) return HAPLO_STD_ERROR(err);
+  HaploValue *string = &args->next->val;
+  const char *bytes = haplo_value_text(string);
+  int len = haplo_value_text_len(string);
+
+  // Pushing the matches in order to the front of the chain gives the
+  // list in order
+  HaploValueList *chain = NULL;
+  int start, end, found;
+  for (int pos = 0;
+       (found = haplo_regex_search(regex, bytes, len, pos, &start, &end)) > 0;
+       pos = haplo_regex_next(bytes, len, start, end))
+  {
+    HaploValue match = haplo_value_string_slice(string, start, end - start);
+    if (match.type == HAPLO_VAL_ERROR) goto out_of_memory;
+    HaploValueList *new_chain = haplo_value_list_push_front(match, chain);
+    if (new_chain == chain)
+    {
+      haplo_value_free(match);
+      goto out_of_memory;
+    }
+    chain = new_chain;
+  }
+  haplo_regex_free(regex);
+  if (found < 0)
+  {
+    haplo_value_list_free(chain);
+    return HAPLO_STD_ERROR(found);
+  }
+
+  HaploList *list = haplo_list_new(chain);
+  if (!list)
+  {
+    haplo_value_list_free(chain);
+    return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+  }
+  return (HaploValue) {
+    .type = HAPLO_VAL_LIST,
+    .value.list = list,
+  };
+
+ out_of_memory:
+  haplo_regex_free(regex);
+  haplo_value_list_free(chain);
+  return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+}
+
+// regex-replace PATTERN STRING REPLACEMENT
+// STRING with the matches of PATTERN, as in regex-find-all, replaced
+// by REPLACEMENT, which is inserted as it is
+// Returns: STRING
+HAPLO_STD_FUNC_STR(regex_replace, "regex-replace")
+{
+  HaploValue err_val = haplo_std_regex_check(args, 3);
+  if (err_val.type == HAPLO_VAL_ERROR) return err_val;
+
+  int err = 0;
+  HaploRegex *regex = haplo_std_regex_get(interpreter, args->val, &err);
+  if (!regex) return HAPLO_STD_ERROR(err);
+  HaploValue *string = &args->next->val;
+  HaploValue *replacement = &args->next->next->val;
+  const char *bytes = haplo_value_text(string);
+  int len = haplo_value_text_len(string);
+  int replacement_len = haplo_value_text_len(replacement);
+
+  // The matches are collected first, so the result is allocated once
+  int *spans = NULL;
+  int span_count = 0, span_capacity = 0;
+  long out_len = len;
+  int start, end, found;
+  for (int pos = 0;
+       (found = haplo_regex_search(regex, bytes, len, pos, &start, &end)) > 0;
+       pos = haplo_regex_next(bytes, len, start, end))
+  {
+    if (span_count == span_capacity)
+    {
+      span_capacity = span_capacity ? 2 * span_capacity : 8;
+      int *new_spans = haplo_realloc(spans, 2 * span_capacity * sizeof(int));
+      if (!new_spans)
+      {
+        found = HAPLO_ERROR_OUT_OF_MEMORY;
+        break;
+      }
+      spans = new_spans;
+    }
+    spans[2 * span_count] = start;
+    spans[2 * span_count + 1] = end;
+    span_count++;
+    out_len += replacement_len - (end - start);
+  }
+  haplo_regex_free(regex);
+  if (found == 0 && out_len > INT_MAX) found = HAPLO_ERROR_OUT_OF_MEMORY;
+  if (found < 0)
+  {
+    haplo_free(spans);
+    return HAPLO_STD_ERROR(found);
+  }
+  if (span_count == 0)
+    return haplo_value_deep_copy(*string);
+
+  HaploValue out;
+  char *out_bytes = haplo_value_string_alloc(&out, (int) out_len);
+  if (!out_bytes)
+  {
+    haplo_free(spans);
+    return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+  }
+  int copied = 0;
+  for (int i = 0; i < span_count; ++i)
+  {
+    start = spans[2 * i];
+    memcpy(out_bytes, bytes + copied, start - copied);
+    out_bytes += start - copied;
+    memcpy(out_bytes, haplo_value_text(replacement), replacement_len);
+    out_bytes += replacement_len;
+    copied = spans[2 * i + 1];
+  }
+  memcpy(out_bytes, bytes + copied, len - copied);
+  haplo_free(spans);
+  return out;
+}
@@ -0,0 +1,166 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "stdlib.h"
+#include "../value.h"
+#include "../set.h"
+#include "../errors.h"
+
+// set VALUE ...
+// Returns: SET
+HAPLO_STD_FUNC(set)
+{
+  HaploSet *set = haplo_set_new();
+  if (!set)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+
+  for (HaploValueList *this = args; this; this = this->next)
+  {
+    int error = haplo_set_add(set, haplo_value_deep_copy(this->val));
+    if (error < 0)
+    {
+      haplo_set_free(set);
+      return HAPLO_STD_ERROR(error);
+    }
+  }
+
+  return (HaploValue) {
+    .type = HAPLO_VAL_SET,
+    .value.set = set,
+  };
+}
+
+// set-add VALUE SET
+// Adds VALUE to SET, in place
+// Returns: SET
+HAPLO_STD_FUNC_STR(set_add, "set-add")
+{
+  if (haplo_value_list_len(args) != 2)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue err = haplo_std_find_error(args, 2);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  HaploValue val, set;
+  val = args->val;
+  set = args->next->val;
+  if (!haplo_value_hashable(val) || set.type != HAPLO_VAL_SET)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+
+  int error = haplo_set_add(set.value.set, haplo_value_deep_copy(val));
+  if (error < 0)
+    return HAPLO_STD_ERROR(error);
+
+  return haplo_value_deep_copy(set);
+}
+
+// set-has? VALUE SET
+// Returns: BOOL
+HAPLO_STD_FUNC_STR(set_has, "set-has?")
+{
+  if (haplo_value_list_len(args) != 2)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue err = haplo_std_find_error(args, 2);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  HaploValue val, set;
+  val = args->val;
+  set = args->next->val;
+  if (set.type != HAPLO_VAL_SET)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+
+  return (HaploValue) {
+    .type = HAPLO_VAL_BOOL,
+    .value.boolean = haplo_set_has(set.value.set, val),
+  };
+}
+
+// set-size SET
+// Returns: INTEGER
+HAPLO_STD_FUNC_STR(set_size, "set-size")
+{
+  if (haplo_value_list_len(args) != 1)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue set = args->val;
+  if (set.type == HAPLO_VAL_ERROR) return set;
+  if (set.type != HAPLO_VAL_SET)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+
+  return (HaploValue) {
+    .type = HAPLO_VAL_INTEGER,
+    .value.integer = haplo_set_size(set.value.set),
+  };
+}
+
+// Runs one of the set algebra functions on the two sets in args
+static HaploValue haplo_std_set_op(HaploValueList *args,
+                                   HaploSet *(*op)(HaploSet*, HaploSet*))
+{
+  if (haplo_value_list_len(args) != 2)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue err = haplo_std_find_error(args, 2);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  HaploValue a, b;
+  a = args->val;
+  b = args->next->val;
+  if (a.type != HAPLO_VAL_SET || b.type != HAPLO_VAL_SET)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+
+  HaploSet *set = op(a.value.set, b.value.set);
+  if (!set)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+
+  return (HaploValue) {
+    .type = HAPLO_VAL_SET,
+    .value.set = set,
+  };
+}
+
+// set-union SET SET
+// Returns: SET
+HAPLO_STD_FUNC_STR(set_union, "set-union")
+{
+  return haplo_std_set_op(args, haplo_set_union);
+}
+
+// set-intersection SET SET
+// Returns: SET
+HAPLO_STD_FUNC_STR(set_intersection, "set-intersection")
+{
+  return haplo_std_set_op(args, haplo_set_intersection);
+}
+
+// set-difference SET SET
+// Returns: SET with the values of the first SET not in the second
+HAPLO_STD_FUNC_STR(set_difference, "set-difference")
+{
+  return haplo_std_set_op(args, haplo_set_difference);
+}
+
+// set->list SET
+// Returns: LIST
+HAPLO_STD_FUNC_STR(set_to_list, "set->list")
+{
+  if (haplo_value_list_len(args) != 1)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue set = args->val;
+  if (set.type == HAPLO_VAL_ERROR) return set;
+  if (set.type != HAPLO_VAL_SET)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+
+  HaploList *list = haplo_set_to_list(set.value.set);
+  if (!list)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+
+  return (HaploValue) {
+    .type = HAPLO_VAL_LIST,
+    .value.list = list,
+  };
+}
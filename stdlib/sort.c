@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "stdlib.h"
+#include "../value.h"
+#include "../vector.h"
+#include "../sort.h"
+#include "../alloc.h"
+#include "../errors.h"
+
+// sort SEQUENCE
+// Sorts a LIST or a VECTOR of numbers or of strings in ascending
+// order, see haplo_sort_order. Lists are copied, vectors are sorted
+// in place.
+// Returns: LIST | VECTOR
+HAPLO_STD_FUNC(sort)
+{
+  if (haplo_value_list_len(args) != 1)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue sequence = args->val;
+  if (sequence.type == HAPLO_VAL_ERROR) return sequence;
+
+  int err = 0;
+  switch(sequence.type)
+  {
+  case HAPLO_VAL_LIST: ;
+    HaploList *list = haplo_sort_list(sequence.value.list, &err);
+    if (!list) return HAPLO_STD_ERROR(err);
+    return (HaploValue) {
+      .type = HAPLO_VAL_LIST,
+      .value.list = list,
+    };
+  case HAPLO_VAL_VECTOR: ;
+    HaploVector *vector = sequence.value.vector;
+    err = haplo_sort_values(vector->items, vector->items, vector->len);
+    if (err < 0) return HAPLO_STD_ERROR(err);
+    return haplo_value_deep_copy(sequence);
+  default:
+    break;
+  }
+  return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+}
+
+// sort-by FUNCTION SEQUENCE
+// Sorts a LIST or a VECTOR by the keys FUNCTION returns for its
+// values, which are numbers or strings. FUNCTION is called once per
+// value. Lists are copied, vectors are sorted in place.
+// Returns: LIST | VECTOR
+HAPLO_STD_FUNC_STR(sort_by, "sort-by")
+{
+  if (haplo_value_list_len(args) != 2)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue err_val = haplo_std_find_error(args, 2);
+  if (err_val.type == HAPLO_VAL_ERROR) return err_val;
+
+  HaploValue function = args->val;
+  HaploValue sequence = args->next->val;
+  if ((function.type != HAPLO_VAL_QUOTE && function.type != HAPLO_VAL_SYMBOL)
+      || (sequence.type != HAPLO_VAL_LIST && sequence.type != HAPLO_VAL_VECTOR))
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+
+  // Lists are sorted in a vector of their values
+  HaploVector *vector = (sequence.type == HAPLO_VAL_LIST)
+    ? haplo_vector_from_list(sequence.value.list)
+    : haplo_vector_ref(sequence.value.vector);
+  if (!vector)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+
+  int count = haplo_vector_len(vector);
+  HaploValue *keys = haplo_alloc((count > 0 ? count : 1) * sizeof(HaploValue));
+  int err = keys ? 0 : HAPLO_ERROR_OUT_OF_MEMORY;
+  int key_count = 0;
+  // FUNCTION may change the vector, its length is checked each time
+  for (; err == 0 && key_count < haplo_vector_len(vector); ++key_count)
+  {
+    HaploValue key = haplo_interpreter_apply(interpreter, function,
+                                             &vector->items[key_count], 1);
+    if (key.type == HAPLO_VAL_ERROR)
+    {
+      err = key.value.error;
+      break;
+    }
+    keys[key_count] = key;
+  }
+  if (err == 0 && key_count != count)
+    err = HAPLO_ERROR_LENGTH_MISMATCH;
+  if (err == 0)
+    err = haplo_sort_values(vector->items, keys, count);
+
+  for (int i = 0; i < key_count; ++i)
+    haplo_value_free(keys[i]);
+  haplo_free(keys);
+
+  HaploValue out = HAPLO_STD_ERROR(err);
+  if (err == 0 && sequence.type == HAPLO_VAL_VECTOR)
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_VECTOR,
+      .value.vector = vector,
+    };
+  }
+  if (err == 0)
+  {
+    HaploList *list = haplo_vector_to_list(vector);
+    out = list ? (HaploValue) { .type = HAPLO_VAL_LIST, .value.list = list }
+               : HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+  }
+  haplo_vector_free(vector);
+  return out;
+}
@@ -16,3 +16,11 @@ __attribute__((destructor))
 static void __haplo_std_symbol_map_free(void) {
   haplo_symbol_map_destroy(&__haplo_std_symbol_map);
 }
+
+HaploValue haplo_std_find_error(HaploValueList *args, int n)
+{
+  for (int i = 0; i < n && args; ++i, args = args->next)
+    if (args->val.type == HAPLO_VAL_ERROR)
+      return args->val;
+  return (HaploValue) { .type = HAPLO_VAL_EMPTY };
+}
@@ -14,10 +14,26 @@
 
 extern HaploSymbolMap __haplo_std_symbol_map;
 
+// The ERROR value of the error code err
+#define HAPLO_STD_ERROR(err)           \
+  (HaploValue) {                       \
+    .type = HAPLO_VAL_ERROR,           \
+    .value.error = (err),              \
+  }
+
+// Returns the first error among the first n values of args, or an
+// EMPTY value if there is none
+HaploValue haplo_std_find_error(HaploValueList *args, int n);
+
 #define HAPLO_STD_FUNC(fn)    \
   HAPLO_STD_FUNC_STR(fn, #fn)
 
 #define HAPLO_STD_FUNC_STR(fn, func_string)    \
+  HAPLO_STD_FUNC_DEFINE(fn, func_string, .run = __haplo_std_##fn)
+
+// Registers fn as func_string, the variadic arguments initialize
+// its HaploFunction
+#define HAPLO_STD_FUNC_DEFINE(fn, func_string, ...)    \
     HaploValue __haplo_std_##fn(HaploInterpreter *, HaploValueList *); \
     __attribute__((constructor)) static void __haplo_std_register_##fn(void) \
     {                                                \
@@ -31,7 +47,7 @@ extern HaploSymbolMap __haplo_std_symbol_map;
                               (HaploSymbol){ \
                                 .type = HAPLO_SYMBOL_C_FUNCTION,  \
                                 .c_func = (HaploFunction) {\
-                                  .run = __haplo_std_##fn \
+                                  __VA_ARGS__ \
                                 }               \
                               });               \
     } \
@@ -0,0 +1,489 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "stdlib.h"
+#include "../value.h"
+#include "../vector.h"
+#include "../str.h"
+#include "../utf8.h"
+#include "../bigint.h"
+#include "../errors.h"
+
+#include <limits.h>
+#include <string.h>
+
+// Checks that args has count values, and returns the first error
+// among them, an INVALID_TYPE error if one of the first strings is
+// not a string, or an EMPTY value
+static HaploValue haplo_std_string_check(HaploValueList *args, int count,
+                                         int strings)
+{
+  if (haplo_value_list_len(args) != count)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue err = haplo_std_find_error(args, count);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  for (int i = 0; i < strings; ++i, args = args->next)
+    if (args->val.type != HAPLO_VAL_STRING)
+      return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+  return (HaploValue) { .type = HAPLO_VAL_EMPTY };
+}
+
+static bool haplo_std_string_space(char c)
+{
+  return c == ' ' || c == '\t' || c == '\n' || c == '\v'
+    || c == '\f' || c == '\r';
+}
+
+// concat STRING ...
+// Returns: STRING
+HAPLO_STD_FUNC(concat)
+{
+  HaploValue err = haplo_std_find_error(args, INT_MAX);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  // The size is computed first, so the result is allocated once
+  long len = 0;
+  for (HaploValueList *this = args; this; this = this->next)
+  {
+    if (this->val.type != HAPLO_VAL_STRING)
+      return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+    len += haplo_value_text_len(&this->val);
+    if (len > INT_MAX)
+      return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+  }
+
+  HaploValue out;
+  char *bytes = haplo_value_string_alloc(&out, (int) len);
+  if (!bytes) return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+  for (HaploValueList *this = args; this; this = this->next)
+  {
+    int part = haplo_value_text_len(&this->val);
+    memcpy(bytes, haplo_value_text(&this->val), part);
+    bytes += part;
+  }
+  return out;
+}
+
+// substring STRING START
+// substring STRING START END
+// The codepoints from START up to END excluded, by default the end
+// of STRING. Long substrings share the bytes of STRING.
+// Returns: STRING
+HAPLO_STD_FUNC(substring)
+{
+  int arg_count = haplo_value_list_len(args);
+  if (arg_count != 2 && arg_count != 3)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+  HaploValue err = haplo_std_string_check(args, arg_count, 1);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  HaploValue *string = &args->val;
+  int codepoints = haplo_value_text_codepoints(string);
+  long bounds[2] = { 0, codepoints };
+  HaploValueList *this = args->next;
+  for (int i = 0; this; ++i, this = this->next)
+  {
+    if (this->val.type != HAPLO_VAL_INTEGER)
+      return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+    bounds[i] = this->val.value.integer;
+  }
+  if (bounds[0] < 0 || bounds[0] > bounds[1] || bounds[1] > codepoints)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INDEX_OUT_OF_BOUNDS);
+
+  int start = haplo_value_text_offset(string, (int) bounds[0]);
+  int end = haplo_value_text_offset(string, (int) bounds[1]);
+  return haplo_value_string_slice(string, start, end - start);
+}
+
+// char-at STRING INDEX
+// The codepoint INDEX of STRING
+// Returns: STRING
+HAPLO_STD_FUNC_STR(char_at, "char-at")
+{
+  HaploValue err = haplo_std_string_check(args, 2, 1);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+  if (args->next->val.type != HAPLO_VAL_INTEGER)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+
+  HaploValue *string = &args->val;
+  long index = args->next->val.value.integer;
+  if (index < 0 || index >= haplo_value_text_codepoints(string))
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INDEX_OUT_OF_BOUNDS);
+
+  int start = haplo_value_text_offset(string, (int) index);
+  int end = start + 1;
+  const char *bytes = haplo_value_text(string);
+  int len = haplo_value_text_len(string);
+  while (end < len && (bytes[end] & 0xc0) == 0x80) ++end;
+  return haplo_value_string_slice(string, start, end - start);
+}
+
+// split STRING SEPARATOR
+// The parts of STRING between the matches of SEPARATOR, which share
+// the bytes of STRING
+// Returns: LIST
+HAPLO_STD_FUNC(split)
+{
+  HaploValue err = haplo_std_string_check(args, 2, 2);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  HaploValue *string = &args->val;
+  HaploValue *separator = &args->next->val;
+  int separator_len = haplo_value_text_len(separator);
+  if (separator_len == 0)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_EMPTY_PATTERN);
+
+  HaploStringSearch search;
+  haplo_string_search_init(&search, haplo_value_text(separator), separator_len);
+  const char *bytes = haplo_value_text(string);
+  int len = haplo_value_text_len(string);
+
+  // Pushing the parts in order to the front of the chain gives the
+  // list in order
+  HaploValueList *chain = NULL;
+  int start = 0;
+  while (true)
+  {
+    int found = haplo_string_search(&search, bytes + start, len - start);
+    int end = (found < 0) ? len : start + found;
+    HaploValue part = haplo_value_string_slice(string, start, end - start);
+    if (part.type == HAPLO_VAL_ERROR) goto out_of_memory;
+    HaploValueList *new_chain = haplo_value_list_push_front(part, chain);
+    if (new_chain == chain)
+    {
+      haplo_value_free(part);
+      goto out_of_memory;
+    }
+    chain = new_chain;
+    if (found < 0) break;
+    start = end + separator_len;
+  }
+
+  HaploList *list = haplo_list_new(chain);
+  if (!list) goto out_of_memory;
+  return (HaploValue) {
+    .type = HAPLO_VAL_LIST,
+    .value.list = list,
+  };
+
+ out_of_memory:
+  haplo_value_list_free(chain);
+  return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+}
+
+// join SEPARATOR SEQUENCE
+// The strings of a LIST or a VECTOR, with SEPARATOR between them
+// Returns: STRING
+HAPLO_STD_FUNC(join)
+{
+  HaploValue err = haplo_std_string_check(args, 2, 1);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  HaploValue *separator = &args->val;
+  HaploValue sequence = args->next->val;
+  HaploValue *items = NULL;
+  HaploValueList *chain = NULL;
+  bool from_list = sequence.type == HAPLO_VAL_LIST;
+  int count;
+  switch(sequence.type)
+  {
+  case HAPLO_VAL_LIST:
+    count = haplo_list_len(sequence.value.list);
+    chain = (count > 0) ? sequence.value.list->first : NULL;
+    break;
+  case HAPLO_VAL_VECTOR:
+    count = haplo_vector_len(sequence.value.vector);
+    items = sequence.value.vector->items;
+    break;
+  default:
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+  }
+
+  // The size is computed first, so the result is allocated once
+  int separator_len = haplo_value_text_len(separator);
+  long len = (count > 0) ? (long) (count - 1) * separator_len : 0;
+  HaploValueList *this = chain;
+  for (int i = 0; i < count; ++i)
+  {
+    HaploValue *item = from_list ? &this->val : &items[i];
+    if (item->type != HAPLO_VAL_STRING)
+      return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+    len += haplo_value_text_len(item);
+    if (len > INT_MAX)
+      return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+    if (from_list) this = this->next;
+  }
+
+  HaploValue out;
+  char *bytes = haplo_value_string_alloc(&out, (int) len);
+  if (!bytes) return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+
+  // The chain of a list starts from its last value, so the result is
+  // written from its end
+  this = chain;
+  int offset = from_list ? (int) len : 0;
+  for (int i = 0; i < count; ++i)
+  {
+    HaploValue *item = from_list ? &this->val : &items[i];
+    int part = haplo_value_text_len(item);
+    if (!from_list)
+    {
+      if (i > 0)
+      {
+        memcpy(bytes + offset, haplo_value_text(separator), separator_len);
+        offset += separator_len;
+      }
+      memcpy(bytes + offset, haplo_value_text(item), part);
+      offset += part;
+    }
+    else
+    {
+      if (i > 0)
+      {
+        offset -= separator_len;
+        memcpy(bytes + offset, haplo_value_text(separator), separator_len);
+      }
+      offset -= part;
+      memcpy(bytes + offset, haplo_value_text(item), part);
+      this = this->next;
+    }
+  }
+  return out;
+}
+
+// index-of STRING NEEDLE
+// The codepoint index of the first match of NEEDLE in STRING, or -1
+// Returns: INTEGER
+HAPLO_STD_FUNC_STR(index_of, "index-of")
+{
+  HaploValue err = haplo_std_string_check(args, 2, 2);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  HaploValue *string = &args->val;
+  const char *bytes = haplo_value_text(string);
+  HaploStringSearch search;
+  haplo_string_search_init(&search, haplo_value_text(&args->next->val),
+                           haplo_value_text_len(&args->next->val));
+  int found = haplo_string_search(&search, bytes, haplo_value_text_len(string));
+  // The match is found by bytes, its index counts the codepoints
+  // before it unless the string is ASCII
+  if (found > 0
+      && haplo_value_text_codepoints(string) != haplo_value_text_len(string))
+    found = haplo_utf8_count(bytes, found);
+  return (HaploValue) {
+    .type = HAPLO_VAL_INTEGER,
+    .value.integer = found,
+  };
+}
+
+// replace STRING OLD NEW
+// STRING with every match of OLD replaced by NEW, left to right
+// Returns: STRING
+HAPLO_STD_FUNC(replace)
+{
+  HaploValue err = haplo_std_string_check(args, 3, 3);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  HaploValue *string = &args->val;
+  HaploValue *old = &args->next->val;
+  HaploValue *new = &args->next->next->val;
+  int old_len = haplo_value_text_len(old);
+  int new_len = haplo_value_text_len(new);
+  if (old_len == 0)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_EMPTY_PATTERN);
+
+  HaploStringSearch search;
+  haplo_string_search_init(&search, haplo_value_text(old), old_len);
+  const char *bytes = haplo_value_text(string);
+  int len = haplo_value_text_len(string);
+
+  // The matches are counted first, so the result is allocated once
+  long matches = 0;
+  int found;
+  for (int start = 0;
+       (found = haplo_string_search(&search, bytes + start, len - start)) >= 0;
+       start += found + old_len)
+    matches++;
+  if (matches == 0)
+    return haplo_value_deep_copy(*string);
+  long out_len = len + matches * (new_len - old_len);
+  if (out_len > INT_MAX)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+
+  HaploValue out;
+  char *out_bytes = haplo_value_string_alloc(&out, (int) out_len);
+  if (!out_bytes) return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+  int start = 0;
+  while ((found = haplo_string_search(&search, bytes + start, len - start)) >= 0)
+  {
+    memcpy(out_bytes, bytes + start, found);
+    memcpy(out_bytes + found, haplo_value_text(new), new_len);
+    out_bytes += found + new_len;
+    start += found + old_len;
+  }
+  memcpy(out_bytes, bytes + start, len - start);
+  return out;
+}
+
+// trim STRING
+// STRING without the ASCII spaces at its start and its end. A long
+// result shares the bytes of STRING.
+// Returns: STRING
+HAPLO_STD_FUNC(trim)
+{
+  HaploValue err = haplo_std_string_check(args, 1, 1);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  const char *bytes = haplo_value_text(&args->val);
+  int start = 0, end = haplo_value_text_len(&args->val);
+  while (start < end && haplo_std_string_space(bytes[start])) ++start;
+  while (end > start && haplo_std_string_space(bytes[end - 1])) --end;
+  return haplo_value_string_slice(&args->val, start, end - start);
+}
+
+// upcase STRING
+// STRING with its ASCII letters in upper case
+// Returns: STRING
+HAPLO_STD_FUNC(upcase)
+{
+  HaploValue err = haplo_std_string_check(args, 1, 1);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  const char *bytes = haplo_value_text(&args->val);
+  int len = haplo_value_text_len(&args->val);
+  HaploValue out;
+  char *out_bytes = haplo_value_string_alloc(&out, len);
+  if (!out_bytes) return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+  for (int i = 0; i < len; ++i)
+    out_bytes[i] = (bytes[i] >= 'a' && bytes[i] <= 'z')
+      ? bytes[i] - 'a' + 'A' : bytes[i];
+  return out;
+}
+
+// string-length STRING
+// The number of codepoints of STRING, counted once per string
+// Returns: INTEGER
+HAPLO_STD_FUNC_STR(string_length, "string-length")
+{
+  HaploValue err = haplo_std_string_check(args, 1, 1);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  return (HaploValue) {
+    .type = HAPLO_VAL_INTEGER,
+    .value.integer = haplo_value_text_codepoints(&args->val),
+  };
+}
+
+// starts-with? STRING PREFIX
+// Returns: BOOL
+HAPLO_STD_FUNC_STR(starts_with, "starts-with?")
+{
+  HaploValue err = haplo_std_string_check(args, 2, 2);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  int len = haplo_value_text_len(&args->val);
+  int prefix_len = haplo_value_text_len(&args->next->val);
+  return (HaploValue) {
+    .type = HAPLO_VAL_BOOL,
+    .value.boolean = prefix_len <= len
+      && memcmp(haplo_value_text(&args->val),
+                haplo_value_text(&args->next->val), prefix_len) == 0,
+  };
+}
+
+// Appends the directive to builder, with arg if it takes one. Returns
+// 0, or a negative error.
+static int haplo_std_string_format_directive(HaploStringBuilder *builder,
+                                             char directive, HaploValue *arg)
+{
+  switch(directive)
+  {
+  case 'a': case 'A':
+    if (arg->type == HAPLO_VAL_STRING)
+      return haplo_string_builder_append(builder, haplo_value_text(arg),
+                                         haplo_value_text_len(arg));
+    return haplo_string_builder_append_value(builder, *arg);
+  case 's': case 'S':
+    return haplo_string_builder_append_value(builder, *arg);
+  case 'd': case 'D':
+    if (arg->type == HAPLO_VAL_INTEGER)
+      return haplo_string_builder_append_long(builder, arg->value.integer);
+    if (arg->type == HAPLO_VAL_BIGINT)
+      return haplo_string_builder_append_value(builder, *arg);
+    return HAPLO_ERROR_INTERPRETER_INVALID_TYPE;
+  case 'f': case 'F':
+    if (arg->type == HAPLO_VAL_INTEGER)
+      return haplo_string_builder_append_double(builder, (double) arg->value.integer);
+    if (arg->type == HAPLO_VAL_FLOAT)
+      return haplo_string_builder_append_double(builder, arg->value.floating_point);
+    if (arg->type == HAPLO_VAL_BIGINT)
+      return haplo_string_builder_append_double(builder,
+                                                haplo_bigint_to_double(arg->value.bigint));
+    return HAPLO_ERROR_INTERPRETER_INVALID_TYPE;
+  default:
+    break;
+  }
+  return HAPLO_ERROR_FORMAT_DIRECTIVE;
+}
+
+// format CONTROL ARGS...
+// CONTROL with each directive replaced by the next of ARGS: ~a is a
+// value as print shows it but strings without quotes, ~s is a value
+// as print shows it, ~d an integer and ~f a number as a float.
+// ~% is a newline and ~~ a tilde. The result is built in one buffer.
+// Returns: STRING
+HAPLO_STD_FUNC(format)
+{
+  if (haplo_value_list_len(args) < 1)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+  HaploValue err_val = haplo_std_find_error(args, INT_MAX);
+  if (err_val.type == HAPLO_VAL_ERROR) return err_val;
+  if (args->val.type != HAPLO_VAL_STRING)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+
+  const char *control = haplo_value_text(&args->val);
+  int len = haplo_value_text_len(&args->val);
+  HaploValueList *next = args->next;
+  HaploStringBuilder builder = {0};
+  int err = 0;
+  for (int pos = 0; err == 0 && pos < len; )
+  {
+    // The text up to the next directive is copied at once
+    const char *tilde = memchr(control + pos, '~', len - pos);
+    int run = tilde ? (int) (tilde - control) - pos : len - pos;
+    err = haplo_string_builder_append(&builder, control + pos, run);
+    pos += run;
+    if (err < 0 || !tilde) break;
+
+    if (pos + 1 == len)
+    {
+      err = HAPLO_ERROR_FORMAT_DIRECTIVE;
+      break;
+    }
+    char directive = control[pos + 1];
+    pos += 2;
+    if (directive == '%')
+      err = haplo_string_builder_append(&builder, "\n", 1);
+    else if (directive == '~')
+      err = haplo_string_builder_append(&builder, "~", 1);
+    else if (!next)
+      err = HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS;
+    else
+    {
+      err = haplo_std_string_format_directive(&builder, directive, &next->val);
+      next = next->next;
+    }
+  }
+  if (err == 0 && next)
+    err = HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS;
+  if (err < 0)
+  {
+    haplo_string_builder_free(&builder);
+    return HAPLO_STD_ERROR(err);
+  }
+  return haplo_value_string_build(&builder);
+}
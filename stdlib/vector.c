@@ -0,0 +1,189 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "stdlib.h"
+#include "../value.h"
+#include "../vector.h"
+#include "../array.h"
+#include "../errors.h"
+
+// vector VALUE ...
+// Returns: VECTOR
+HAPLO_STD_FUNC(vector)
+{
+  HaploVector *vector = haplo_vector_new(haplo_value_list_len(args));
+  if (!vector)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+
+  for (HaploValueList *this = args; this; this = this->next)
+  {
+    // Capacity is enough, this can not fail
+    haplo_vector_push(vector, haplo_value_deep_copy(this->val));
+  }
+
+  return (HaploValue) {
+    .type = HAPLO_VAL_VECTOR,
+    .value.vector = vector,
+  };
+}
+
+// vector-push VALUE VECTOR
+// Adds VALUE at the end of VECTOR, in place
+// Returns: VECTOR
+HAPLO_STD_FUNC_STR(vector_push, "vector-push")
+{
+  if (haplo_value_list_len(args) != 2)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue err = haplo_std_find_error(args, 2);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  HaploValue val, vector;
+  val = args->val;
+  vector = args->next->val;
+  if (vector.type != HAPLO_VAL_VECTOR)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+  if (haplo_value_contains(val, vector.value.vector))
+    return HAPLO_STD_ERROR(HAPLO_ERROR_VALUE_CYCLE);
+
+  int error = haplo_vector_push(vector.value.vector, haplo_value_deep_copy(val));
+  if (error < 0)
+    return HAPLO_STD_ERROR(error);
+
+  return haplo_value_deep_copy(vector);
+}
+
+// nth INDEX VECTOR|ARRAY
+// Returns: VALUE
+HAPLO_STD_FUNC(nth)
+{
+  if (haplo_value_list_len(args) != 2)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue err = haplo_std_find_error(args, 2);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  HaploValue index, vector;
+  index = args->val;
+  vector = args->next->val;
+  if (index.type != HAPLO_VAL_INTEGER
+      || (vector.type != HAPLO_VAL_VECTOR && vector.type != HAPLO_VAL_ARRAY))
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+
+  int len = (vector.type == HAPLO_VAL_VECTOR)
+    ? haplo_vector_len(vector.value.vector) : haplo_array_len(vector.value.array);
+  if (index.value.integer < 0 || index.value.integer >= len)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INDEX_OUT_OF_BOUNDS);
+
+  if (vector.type == HAPLO_VAL_ARRAY)
+    return haplo_array_nth(vector.value.array, index.value.integer);
+  return haplo_value_deep_copy(haplo_vector_nth(vector.value.vector,
+                                                index.value.integer));
+}
+
+// set-nth INDEX VALUE VECTOR
+// Replaces the value at INDEX of VECTOR, in place
+// Returns: VECTOR
+HAPLO_STD_FUNC_STR(set_nth, "set-nth")
+{
+  if (haplo_value_list_len(args) != 3)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue err = haplo_std_find_error(args, 3);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  HaploValue index, val, vector;
+  index = args->val;
+  val = args->next->val;
+  vector = args->next->next->val;
+  if (index.type != HAPLO_VAL_INTEGER || vector.type != HAPLO_VAL_VECTOR)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+  if (index.value.integer < 0
+      || index.value.integer >= haplo_vector_len(vector.value.vector))
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INDEX_OUT_OF_BOUNDS);
+  if (haplo_value_contains(val, vector.value.vector))
+    return HAPLO_STD_ERROR(HAPLO_ERROR_VALUE_CYCLE);
+
+  haplo_vector_set_nth(vector.value.vector, index.value.integer,
+                       haplo_value_deep_copy(val));
+  return haplo_value_deep_copy(vector);
+}
+
+// slice START END VECTOR
+// Returns: VECTOR with the values from START included to END excluded
+HAPLO_STD_FUNC(slice)
+{
+  if (haplo_value_list_len(args) != 3)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue err = haplo_std_find_error(args, 3);
+  if (err.type == HAPLO_VAL_ERROR) return err;
+
+  HaploValue start, end, vector;
+  start = args->val;
+  end = args->next->val;
+  vector = args->next->next->val;
+  if (start.type != HAPLO_VAL_INTEGER || end.type != HAPLO_VAL_INTEGER
+      || vector.type != HAPLO_VAL_VECTOR)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+  if (start.value.integer < 0 || start.value.integer > end.value.integer
+      || end.value.integer > haplo_vector_len(vector.value.vector))
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INDEX_OUT_OF_BOUNDS);
+
+  HaploVector *new_vector = haplo_vector_slice(vector.value.vector,
+                                               start.value.integer,
+                                               end.value.integer);
+  if (!new_vector)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+
+  return (HaploValue) {
+    .type = HAPLO_VAL_VECTOR,
+    .value.vector = new_vector,
+  };
+}
+
+// list->vector LIST
+// Returns: VECTOR
+HAPLO_STD_FUNC_STR(list_to_vector, "list->vector")
+{
+  if (haplo_value_list_len(args) != 1)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue list = args->val;
+  if (list.type == HAPLO_VAL_ERROR) return list;
+  if (list.type != HAPLO_VAL_LIST)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+
+  HaploVector *vector = haplo_vector_from_list(list.value.list);
+  if (!vector)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+
+  return (HaploValue) {
+    .type = HAPLO_VAL_VECTOR,
+    .value.vector = vector,
+  };
+}
+
+// vector->list VECTOR
+// Returns: LIST
+HAPLO_STD_FUNC_STR(vector_to_list, "vector->list")
+{
+  if (haplo_value_list_len(args) != 1)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS);
+
+  HaploValue vector = args->val;
+  if (vector.type == HAPLO_VAL_ERROR) return vector;
+  if (vector.type != HAPLO_VAL_VECTOR)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_INTERPRETER_INVALID_TYPE);
+
+  HaploList *list = haplo_vector_to_list(vector.value.vector);
+  if (!list)
+    return HAPLO_STD_ERROR(HAPLO_ERROR_OUT_OF_MEMORY);
+
+  return (HaploValue) {
+    .type = HAPLO_VAL_LIST,
+    .value.list = list,
+  };
+}
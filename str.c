@@ -0,0 +1,348 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "str.h"
+#include "alloc.h"
+#include "utils.h"
+#include "errors.h"
+#include "fmt.h"
+#include "utf8.h"
+
+#include <limits.h>
+#include <string.h>
+
+HaploString *haplo_string_new(const char *data, int len)
+{
+  if (UNLIKELY(len < 0 || (size_t) len > INT_MAX - sizeof(HaploString) - 1))
+    return NULL;
+
+  HaploString *string = haplo_alloc(sizeof(HaploString) + len + 1);
+  if (UNLIKELY(!string)) return NULL;
+
+  string->refcount = 1;
+  string->len = len;
+  string->hash = 0;
+  string->data = string->buffer;
+  string->parent = NULL;
+  string->codepoints = -1;
+  string->index = NULL;
+  if (data && len > 0) memcpy(string->buffer, data, len);
+  string->buffer[len] = '\0';
+  return string;
+}
+
+HaploString *haplo_string_from_cstr(const char *cstr)
+{
+  size_t len = strlen(cstr);
+  if (UNLIKELY(len > INT_MAX)) return NULL;
+  return haplo_string_new(cstr, (int) len);
+}
+
+HaploString *haplo_string_ref(HaploString *string)
+{
+  if (string) string->refcount++;
+  return string;
+}
+
+void haplo_string_free(HaploString *string)
+{
+  if (!string || --string->refcount != 0) return;
+  haplo_string_free(string->parent);
+  haplo_free(string->index);
+  haplo_free(string);
+  return;
+}
+
+HaploString *haplo_string_slice(HaploString *string, int start, int len)
+{
+  HaploString *slice = haplo_alloc(sizeof(HaploString));
+  if (UNLIKELY(!slice)) return NULL;
+
+  // A slice of a slice shares the bytes of the first parent
+  slice->refcount = 1;
+  slice->len = len;
+  slice->hash = 0;
+  slice->data = string->data + start;
+  slice->parent = haplo_string_ref(string->parent ? string->parent : string);
+  slice->codepoints = -1;
+  slice->index = NULL;
+  return slice;
+}
+
+int haplo_string_codepoints(HaploString *string)
+{
+  if (string->codepoints < 0)
+    string->codepoints = haplo_utf8_count(string->data, string->len);
+  return string->codepoints;
+}
+
+int haplo_string_codepoint_offset(HaploString *string, int index)
+{
+  int codepoints = haplo_string_codepoints(string);
+  if (codepoints == string->len) return index;
+  if (codepoints <= HAPLO_STRING_INDEX_STEP)
+    return haplo_utf8_advance(string->data, string->len, index);
+
+  if (!string->index)
+  {
+    int entries = codepoints / HAPLO_STRING_INDEX_STEP + 1;
+    int *offsets = haplo_alloc(entries * sizeof(int));
+    // Without the index the offset is still found from the start
+    if (UNLIKELY(!offsets))
+      return haplo_utf8_advance(string->data, string->len, index);
+    offsets[0] = 0;
+    for (int i = 1; i < entries; ++i)
+      offsets[i] = offsets[i - 1]
+        + haplo_utf8_advance(string->data + offsets[i - 1],
+                             string->len - offsets[i - 1], HAPLO_STRING_INDEX_STEP);
+    string->index = offsets;
+  }
+  int start = string->index[index / HAPLO_STRING_INDEX_STEP];
+  return start + haplo_utf8_advance(string->data + start, string->len - start,
+                                    index % HAPLO_STRING_INDEX_STEP);
+}
+
+uint64_t haplo_string_hash_bytes(const char *data, int len)
+{
+  // FNV-1a
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (int i = 0; i < len; ++i)
+  {
+    hash ^= (unsigned char) data[i];
+    hash *= 0x100000001b3ULL;
+  }
+  // 0 is kept to mean not computed
+  return (hash != 0) ? hash : 1;
+}
+
+uint64_t haplo_string_hash(HaploString *string)
+{
+  if (string->hash == 0)
+    string->hash = haplo_string_hash_bytes(string->data, string->len);
+  return string->hash;
+}
+
+bool haplo_string_equal(HaploString *a, HaploString *b)
+{
+  if (a == b) return true;
+  if (a->len != b->len) return false;
+  if (a->hash != 0 && b->hash != 0 && a->hash != b->hash) return false;
+  return memcmp(a->data, b->data, a->len) == 0;
+}
+
+int haplo_string_compare_bytes(const char *a, int a_len,
+                               const char *b, int b_len)
+{
+  int cmp = memcmp(a, b, (a_len < b_len) ? a_len : b_len);
+  if (cmp != 0) return cmp;
+  return (a_len > b_len) - (a_len < b_len);
+}
+
+int haplo_string_compare(const HaploString *a, const HaploString *b)
+{
+  return haplo_string_compare_bytes(a->data, a->len, b->data, b->len);
+}
+
+// Returns the start of the maximal suffix of the len bytes of needle,
+// in the byte order if reverse is false and in the opposite order
+// otherwise, and sets *period to its period
+static int haplo_string_max_suffix(const unsigned char *needle, int len,
+                                   bool reverse, int *period)
+{
+  int suffix = -1, j = 0, k = 1;
+  *period = 1;
+  while (j + k < len)
+  {
+    unsigned char a = needle[j + k];
+    unsigned char b = needle[suffix + k];
+    if (reverse ? a > b : a < b)
+    {
+      j += k;
+      k = 1;
+      *period = j - suffix;
+    }
+    else if (a == b)
+    {
+      if (k != *period)
+      {
+        k++;
+      }
+      else
+      {
+        j += *period;
+        k = 1;
+      }
+    }
+    else
+    {
+      suffix = j++;
+      k = *period = 1;
+    }
+  }
+  return suffix;
+}
+
+void haplo_string_search_init(HaploStringSearch *search,
+                              const char *needle, int len)
+{
+  const unsigned char *bytes = (const unsigned char *) needle;
+  int period, reverse_period;
+  int suffix = haplo_string_max_suffix(bytes, len, false, &period);
+  int reverse_suffix = haplo_string_max_suffix(bytes, len, true, &reverse_period);
+  if (reverse_suffix > suffix)
+  {
+    suffix = reverse_suffix;
+    period = reverse_period;
+  }
+
+  search->needle = needle;
+  search->len = len;
+  search->critical = suffix;
+  // The left part repeats with the period of the right one
+  search->periodic = len > 1 && period < len
+    && memcmp(needle, needle + period, suffix + 1) == 0;
+  search->period = search->periodic ? period
+    : ((suffix + 1 > len - suffix - 1) ? suffix + 1 : len - suffix - 1) + 1;
+}
+
+int haplo_string_search(const HaploStringSearch *search,
+                        const char *haystack, int len)
+{
+  const unsigned char *needle = (const unsigned char *) search->needle;
+  const unsigned char *bytes = (const unsigned char *) haystack;
+  int needle_len = search->len;
+  if (needle_len == 0) return 0;
+  if (needle_len > len) return -1;
+  // memchr is vectorized by the C library
+  if (needle_len == 1)
+  {
+    const char *found = memchr(haystack, needle[0], len);
+    return found ? (int) (found - haystack) : -1;
+  }
+
+  int critical = search->critical;
+  // The bytes of the left part before memory are known to match
+  int memory = -1;
+  for (int j = 0; j <= len - needle_len; )
+  {
+    // The right part is compared first, a mismatch skips all the
+    // bytes that matched
+    int i = ((critical > memory) ? critical : memory) + 1;
+    while (i < needle_len && needle[i] == bytes[i + j]) ++i;
+    if (i < needle_len)
+    {
+      j += i - critical;
+      memory = -1;
+      continue;
+    }
+
+    int stop = search->periodic ? memory : -1;
+    i = critical;
+    while (i > stop && needle[i] == bytes[i + j]) --i;
+    if (i <= stop) return j;
+    j += search->period;
+    memory = search->periodic ? needle_len - search->period - 1 : -1;
+  }
+  return -1;
+}
+
+int haplo_string_builder_reserve(HaploStringBuilder *builder, int extra)
+{
+  int len = builder->string ? builder->string->len : 0;
+  if (UNLIKELY(extra < 0 || extra > INT_MAX - (int) sizeof(HaploString) - 1 - len))
+    return HAPLO_ERROR_OUT_OF_MEMORY;
+  if (builder->string && len + extra <= builder->capacity) return 0;
+
+  // Doubling keeps the cost of the copies linear in the length
+  long capacity = (builder->capacity > 0) ? 2L * builder->capacity : 32;
+  if (capacity < len + extra) capacity = len + extra;
+  if (capacity > INT_MAX - (long) sizeof(HaploString) - 1)
+    capacity = INT_MAX - sizeof(HaploString) - 1;
+
+  HaploString *string = haplo_realloc(builder->string,
+                                      sizeof(HaploString) + capacity + 1);
+  if (UNLIKELY(!string)) return HAPLO_ERROR_OUT_OF_MEMORY;
+  if (!builder->string)
+  {
+    string->refcount = 1;
+    string->len = 0;
+    string->hash = 0;
+    string->parent = NULL;
+    string->codepoints = -1;
+    string->index = NULL;
+  }
+  string->data = string->buffer;
+  builder->string = string;
+  builder->capacity = (int) capacity;
+  return 0;
+}
+
+int haplo_string_builder_append(HaploStringBuilder *builder,
+                                const char *data, int len)
+{
+  int err = haplo_string_builder_reserve(builder, len);
+  if (err < 0) return err;
+  if (len > 0) memcpy(builder->string->buffer + builder->string->len, data, len);
+  builder->string->len += len;
+  return 0;
+}
+
+int haplo_string_builder_append_long(HaploStringBuilder *builder, long value)
+{
+  int err = haplo_string_builder_reserve(builder, HAPLO_FMT_LONG_MAX);
+  if (err < 0) return err;
+  builder->string->len += haplo_fmt_long(builder->string->buffer + builder->string->len,
+                                         value);
+  return 0;
+}
+
+int haplo_string_builder_append_double(HaploStringBuilder *builder, double value)
+{
+  int err = haplo_string_builder_reserve(builder, HAPLO_FMT_DOUBLE_MAX);
+  if (err < 0) return err;
+  builder->string->len += haplo_fmt_double(builder->string->buffer + builder->string->len,
+                                           value);
+  return 0;
+}
+
+int haplo_string_builder_append_value(HaploStringBuilder *builder, HaploValue value)
+{
+  // The printers of collections clamp what they write, so the value
+  // is printed again in twice the space until it fits
+  int extra = 64;
+  while (true)
+  {
+    int err = haplo_string_builder_reserve(builder, extra);
+    if (err < 0) return err;
+    HaploString *string = builder->string;
+    int available = builder->capacity - string->len;
+    int written = haplo_value_string(value, string->buffer + string->len, available + 1);
+    if (written < available)
+    {
+      string->len += (written > 0) ? written : 0;
+      return 0;
+    }
+    if (available >= INT_MAX / 2) return HAPLO_ERROR_OUT_OF_MEMORY;
+    extra = (written > available) ? written + 1 : 2 * available;
+  }
+}
+
+HaploString *haplo_string_builder_finish(HaploStringBuilder *builder)
+{
+  HaploString *string = builder->string;
+  if (!string) return haplo_string_new(NULL, 0);
+  string->buffer[string->len] = '\0';
+  builder->string = NULL;
+  builder->capacity = 0;
+  return string;
+}
+
+void haplo_string_builder_free(HaploStringBuilder *builder)
+{
+  haplo_free(builder->string);
+  builder->string = NULL;
+  builder->capacity = 0;
+  return;
+}
@@ -0,0 +1,153 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#ifndef HAPLO_STR_H
+#define HAPLO_STR_H
+
+#include "value.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//
+// Macros
+//
+
+#ifdef HAPLO_NO_PREFIX
+  #define String HaploString
+  #define string_new haplo_string_new
+  #define string_from_cstr haplo_string_from_cstr
+  #define string_ref haplo_string_ref
+  #define string_free haplo_string_free
+  #define string_hash haplo_string_hash
+  #define string_equal haplo_string_equal
+  #define string_compare haplo_string_compare
+  #define string_hash_bytes haplo_string_hash_bytes
+  #define string_compare_bytes haplo_string_compare_bytes
+  #define string_slice haplo_string_slice
+  #define string_codepoints haplo_string_codepoints
+  #define string_codepoint_offset haplo_string_codepoint_offset
+  #define StringSearch HaploStringSearch
+  #define string_search_init haplo_string_search_init
+  #define string_search haplo_string_search
+  #define StringBuilder HaploStringBuilder
+  #define string_builder_reserve haplo_string_builder_reserve
+  #define string_builder_append haplo_string_builder_append
+  #define string_builder_append_long haplo_string_builder_append_long
+  #define string_builder_append_double haplo_string_builder_append_double
+  #define string_builder_append_value haplo_string_builder_append_value
+  #define string_builder_finish haplo_string_builder_finish
+  #define string_builder_free haplo_string_builder_free
+#endif // HAPLO_NO_PREFIX
+
+// A string keeps the byte offset of every this many codepoints, to
+// find a codepoint without reading the bytes before it
+#define HAPLO_STRING_INDEX_STEP 64
+
+//
+// Types
+//
+
+// An immutable string. It knows its length, so it can hold NUL
+// bytes, and it is shared by reference instead of being copied.
+struct HaploString {
+  unsigned int refcount;
+  int len;
+  // The hash of the bytes, computed the first time it is needed. 0
+  // means not computed yet.
+  uint64_t hash;
+  // The len bytes, in buffer or in the buffer of parent. Only the
+  // bytes in buffer are followed by a NUL.
+  const char *data;
+  // The string whose bytes a slice shares, or NULL
+  HaploString *parent;
+  // The number of codepoints, counted the first time it is needed. -1
+  // means not counted yet, len means the bytes are ASCII and a
+  // codepoint is a byte.
+  int codepoints;
+  // The offsets of the codepoints 0, HAPLO_STRING_INDEX_STEP and so
+  // on, built the first time a codepoint is looked up in a string
+  // that is not ASCII, or NULL
+  int *index;
+  char buffer[];
+};
+
+// A needle prepared for the two-way string matching algorithm, which
+// finds it in linear time and constant space
+typedef struct {
+  const char *needle;
+  int len;
+  // The critical factorization of the needle and its period
+  int critical;
+  int period;
+  bool periodic;
+} HaploStringSearch;
+
+// Builds a string by appending to it. The bytes are written to the
+// buffer of the string it returns, which doubles when it is full. A
+// zero initialized builder is empty.
+struct HaploStringBuilder {
+  // The string being built, its len is the length so far, or NULL
+  HaploString *string;
+  int capacity;
+};
+
+//
+// Functions
+//
+
+// Returns a new string with a copy of the len bytes of data, or NULL
+// if out of memory. If data is NULL the bytes are left to be written
+// to buffer.
+HaploString *haplo_string_new(const char *data, int len);
+HaploString *haplo_string_from_cstr(const char *cstr);
+// Returns a new reference to string
+HaploString *haplo_string_ref(HaploString *string);
+// Drops a reference to string
+void haplo_string_free(HaploString *string);
+// Returns a string of the len bytes of string from start, which
+// shares its bytes, or NULL if out of memory
+HaploString *haplo_string_slice(HaploString *string, int start, int len);
+// Returns the number of codepoints of string, see haplo_utf8_count
+int haplo_string_codepoints(HaploString *string);
+// Returns the byte offset of the codepoint index of string, from 0 to
+// its number of codepoints included. It is index for ASCII strings,
+// the others read at most HAPLO_STRING_INDEX_STEP codepoints.
+int haplo_string_codepoint_offset(HaploString *string, int index);
+uint64_t haplo_string_hash(HaploString *string);
+bool haplo_string_equal(HaploString *a, HaploString *b);
+// Returns a negative number, 0 or a positive number if a is lower,
+// equal or greater than b, comparing bytes as unsigned
+int haplo_string_compare(const HaploString *a, const HaploString *b);
+// The same as haplo_string_hash and haplo_string_compare, for bytes
+// that are not in a HaploString
+uint64_t haplo_string_hash_bytes(const char *data, int len);
+int haplo_string_compare_bytes(const char *a, int a_len,
+                               const char *b, int b_len);
+// Prepares search to find the len bytes of needle, which must outlive
+// it
+void haplo_string_search_init(HaploStringSearch *search,
+                              const char *needle, int len);
+// Returns the index of the first match of search in the len bytes of
+// haystack, or -1
+int haplo_string_search(const HaploStringSearch *search,
+                        const char *haystack, int len);
+
+// Makes room for extra more bytes. Returns 0, or a negative error.
+int haplo_string_builder_reserve(HaploStringBuilder *builder, int extra);
+// The append functions return 0, or a negative error
+int haplo_string_builder_append(HaploStringBuilder *builder,
+                                const char *data, int len);
+int haplo_string_builder_append_long(HaploStringBuilder *builder, long value);
+// Appends value as haplo_fmt_double writes it
+int haplo_string_builder_append_double(HaploStringBuilder *builder, double value);
+// Appends value as haplo_value_string prints it, without truncating
+int haplo_string_builder_append_value(HaploStringBuilder *builder, HaploValue value);
+// Returns the string built, and empties builder, or NULL if out of
+// memory
+HaploString *haplo_string_builder_finish(HaploStringBuilder *builder);
+void haplo_string_builder_free(HaploStringBuilder *builder);
+
+#endif // HAPLO_STR_H
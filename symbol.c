@@ -6,6 +6,7 @@
 #include "symbol.h"
 #include "errors.h"
 #include "utils.h"
+#include "alloc.h"
 
 #include <stddef.h>
 #include <string.h>
@@ -13,7 +14,7 @@
 #include <stdbool.h>
 #include <assert.h>
 
-_Static_assert(_HAPLO_SYMBOL_MAX == 3,
+_Static_assert(_HAPLO_SYMBOL_MAX == 6,
               "Updated HaploSymbolType, should update haplo_symbol_type_string");
 const char* haplo_symbol_type_string(HaploSymbolType type)
 {
@@ -25,6 +26,12 @@ const char* haplo_symbol_type_string(HaploSymbolType type)
     return "FUNCTION";
   case HAPLO_SYMBOL_VARIABLE:
     return "VARIABLE";
+  case HAPLO_SYMBOL_RECORD_NEW:
+    return "RECORD_NEW";
+  case HAPLO_SYMBOL_RECORD_GET:
+    return "RECORD_GET";
+  case HAPLO_SYMBOL_RECORD_SET:
+    return "RECORD_SET";
   default:
     break;
   }
@@ -37,9 +44,9 @@ void haplo_symbol_list_free(HaploSymbolList *list)
 
   HaploSymbolList *next = list->next;
   haplo_symbol_list_free(next);
-  free(list->key);
+  haplo_free(list->key);
   haplo_symbol_free(list->val);
-  free(list);
+  haplo_free(list);
   
   return;
 }
@@ -48,10 +55,15 @@ HaploSymbolList *haplo_symbol_list_deep_copy(HaploSymbolList *list)
 {
   if (!list) return NULL;
 
-  HaploSymbolList *new_list = malloc(sizeof(HaploSymbolList));
+  HaploSymbolList *new_list = haplo_alloc(sizeof(HaploSymbolList));
+  if (!new_list) return NULL;
+  new_list->key = haplo_strdup(list->key);
+  if (!new_list->key)
+  {
+    haplo_free(new_list);
+    return NULL;
+  }
   new_list->val = haplo_symbol_deep_copy(list->val);
-  new_list->key = (HaploSymbolKey) malloc(strlen(list->key)+1);
-  strcpy(new_list->key, list->key);
   new_list->next = haplo_symbol_list_deep_copy(list->next);
   return new_list;
 }
@@ -61,8 +73,8 @@ int haplo_symbol_map_init(HaploSymbolMap *map, int capacity)
   if (!map) return HAPLO_ERROR_SYMBOL_MAP_NULL;
 
   map->capacity = capacity;
-  map->_map = (HaploSymbolList**) calloc(capacity, sizeof(HaploSymbolList*));
-  assert(map->_map != NULL);
+  map->_map = (HaploSymbolList**) haplo_calloc(capacity, sizeof(HaploSymbolList*));
+  if (!map->_map) return HAPLO_ERROR_OUT_OF_MEMORY;
   return 0;
 }
 
@@ -77,14 +89,14 @@ int haplo_symbol_map_destroy(HaploSymbolMap *map)
       haplo_symbol_list_free(map->_map[i]);
       map->_map[i] = NULL;
     }
-    free(map->_map);
+    haplo_free(map->_map);
     map->_map = NULL;
   }
 
   return 0;
 }
 
-_Static_assert(_HAPLO_SYMBOL_MAX == 3,
+_Static_assert(_HAPLO_SYMBOL_MAX == 6,
               "Updated HaploSymbolType, should update haplo_symbol_free");
 void haplo_symbol_free(HaploSymbol symbol)
 {
@@ -96,6 +108,12 @@ void haplo_symbol_free(HaploSymbol symbol)
   case HAPLO_SYMBOL_FUNCTION:
     haplo_expr_free(symbol.func);
     symbol.func = NULL;
+    haplo_shape_free(symbol.shape);
+    break;
+  case HAPLO_SYMBOL_RECORD_NEW:
+  case HAPLO_SYMBOL_RECORD_GET:
+  case HAPLO_SYMBOL_RECORD_SET:
+    haplo_shape_free(symbol.shape);
     break;
   default:
     break;
@@ -106,7 +124,7 @@ void haplo_symbol_free(HaploSymbol symbol)
   return;
 }
 
-_Static_assert(_HAPLO_SYMBOL_MAX == 3,
+_Static_assert(_HAPLO_SYMBOL_MAX == 6,
               "Updated HaploSymbolType, should update haplo_symbol_deep_copy");
 HaploSymbol haplo_symbol_deep_copy(HaploSymbol symbol)
 {
@@ -120,10 +138,18 @@ HaploSymbol haplo_symbol_deep_copy(HaploSymbol symbol)
     break;
   case HAPLO_SYMBOL_FUNCTION:
     new_symbol.func = haplo_expr_deep_copy(symbol.func);
+    new_symbol.shape = haplo_shape_ref(symbol.shape);
     break;
   case HAPLO_SYMBOL_VARIABLE:
     new_symbol.var = haplo_value_deep_copy(symbol.var);
     break;
+  case HAPLO_SYMBOL_RECORD_NEW:
+  case HAPLO_SYMBOL_RECORD_GET:
+  case HAPLO_SYMBOL_RECORD_SET:
+    // Shapes are never modified, every accessor shares the same one
+    new_symbol.shape = haplo_shape_ref(symbol.shape);
+    new_symbol.slot = symbol.slot;
+    break;
   default:
     break;
   }
@@ -134,12 +160,19 @@ HaploSymbolMap* haplo_symbol_map_deep_copy(HaploSymbolMap *map)
 {
   if (!map) return NULL;
   
-  HaploSymbolMap *map_copy = malloc(sizeof(HaploSymbolMap));
+  HaploSymbolMap *map_copy = haplo_alloc(sizeof(HaploSymbolMap));
+  if (!map_copy) return NULL;
 
+  map_copy->capacity = map->capacity;
+  map_copy->_map = NULL;
   if (map->capacity == 0) return map_copy;
 
-  map_copy->capacity = map->capacity;
-  map_copy->_map = (HaploSymbolList**) calloc(map->capacity, sizeof(HaploSymbolList*));
+  map_copy->_map = (HaploSymbolList**) haplo_calloc(map->capacity, sizeof(HaploSymbolList*));
+  if (!map_copy->_map)
+  {
+    haplo_free(map_copy);
+    return NULL;
+  }
   for (int i = 0; i < map->capacity; ++i)
   {
     map_copy->_map[i] = haplo_symbol_list_deep_copy(map->_map[i]);
@@ -149,7 +182,7 @@ HaploSymbolMap* haplo_symbol_map_deep_copy(HaploSymbolMap *map)
 }
 
 int haplo_symbol_map_lookup(HaploSymbolMap *map,
-                            HaploSymbolKey key,
+                            const char *key,
                             HaploSymbol* symbol)
 {
   if (!map) return HAPLO_ERROR_SYMBOL_MAP_NULL;
@@ -181,7 +214,7 @@ int haplo_symbol_map_lookup(HaploSymbolMap *map,
 }
 
 int haplo_symbol_map_update(HaploSymbolMap *map,
-                            HaploSymbolKey key,
+                            const char *key,
                             HaploSymbol symbol)
 {
   if (!map) return HAPLO_ERROR_SYMBOL_MAP_NULL;
@@ -192,11 +225,16 @@ int haplo_symbol_map_update(HaploSymbolMap *map,
   HaploSymbolList *symbol_list = map->_map[hash];
   if (!symbol_list)
   {
-    symbol_list = (HaploSymbolList*) malloc(sizeof(HaploSymbolList));
+    symbol_list = (HaploSymbolList*) haplo_alloc(sizeof(HaploSymbolList));
+    if (!symbol_list) return HAPLO_ERROR_OUT_OF_MEMORY;
+    symbol_list->key = haplo_strdup(key);
+    if (!symbol_list->key)
+    {
+      haplo_free(symbol_list);
+      return HAPLO_ERROR_OUT_OF_MEMORY;
+    }
     symbol_list->next = NULL;
     symbol_list->val = haplo_symbol_deep_copy(symbol);
-    symbol_list->key = malloc(strlen(key)+1);
-    strcpy(symbol_list->key, key);
     map->_map[hash] = symbol_list;
     return 0;
   }
@@ -209,14 +247,15 @@ int haplo_symbol_map_update(HaploSymbolMap *map,
   }
   
   bool found = false;
-  do {
+  while (symbol_list->next != NULL)
+  {
     symbol_list = symbol_list->next;
     if (strcmp(symbol_list->key, key) == 0)
     {
       found = true;
       break;
     }
-  } while (symbol_list->next != NULL);
+  }
 
   if (found)
   {
@@ -225,53 +264,76 @@ int haplo_symbol_map_update(HaploSymbolMap *map,
     return 1;
   }
 
-  HaploSymbolList * new_list = (HaploSymbolList*) malloc(sizeof(HaploSymbolList));
+  HaploSymbolList * new_list = (HaploSymbolList*) haplo_alloc(sizeof(HaploSymbolList));
+  if (!new_list) return HAPLO_ERROR_OUT_OF_MEMORY;
+  new_list->key = haplo_strdup(key);
+  if (!new_list->key)
+  {
+    haplo_free(new_list);
+    return HAPLO_ERROR_OUT_OF_MEMORY;
+  }
   new_list->next = NULL;
   new_list->val = haplo_symbol_deep_copy(symbol);
-  new_list->key = malloc(strlen(key)+1);
-  strcpy(new_list->key, key);
   symbol_list->next = new_list;
   
   return 0;
 }
 
 int haplo_symbol_map_delete(HaploSymbolMap *map,
-                            HaploSymbolKey key)
+                            const char *key)
 {
   if (!map) return HAPLO_ERROR_SYMBOL_MAP_NULL;
   if (!map->_map) return HAPLO_ERROR_SYMBOL_MAP_NOT_INITIALIZED;
 
   unsigned int hash = haplo_symbol_hash(key, map->capacity);
-  
-  HaploSymbolList *symbol_list = map->_map[hash];
-  if (strcmp(symbol_list->key, key) == 0)
+
+  HaploSymbolList **link = &map->_map[hash];
+  while (*link && strcmp((*link)->key, key) != 0)
+    link = &(*link)->next;
+
+  HaploSymbolList *symbol_list = *link;
+  if (symbol_list)
   {
-    map->_map[hash] = symbol_list->next;
-    free(symbol_list->key);
-    free(symbol_list);
-    return 0;
+    *link = symbol_list->next;
+    haplo_symbol_free(symbol_list->val);
+    haplo_free(symbol_list->key);
+    haplo_free(symbol_list);
   }
-  
-  bool found = false;
-  HaploSymbolList *prev;
-  do {
-    prev = symbol_list;
+  return 0;
+}
+
+int haplo_symbol_map_exchange(HaploSymbolMap *map,
+                              const char *key,
+                              HaploSymbol *symbol)
+{
+  if (!map) return HAPLO_ERROR_SYMBOL_MAP_NULL;
+  if (!map->_map) return HAPLO_ERROR_SYMBOL_MAP_NOT_INITIALIZED;
+
+  unsigned int hash = haplo_symbol_hash(key, map->capacity);
+
+  HaploSymbolList *symbol_list = map->_map[hash];
+  while (symbol_list && strcmp(symbol_list->key, key) != 0)
     symbol_list = symbol_list->next;
-    if (strcmp(symbol_list->key, key) == 0)
-    {
-      found = true;
-      break;
-    }
-  } while (symbol_list != NULL);
-  
-  if (found)
+
+  if (symbol_list)
   {
-    prev->next = symbol_list->next;
-    free(symbol_list->key);
-    free(symbol_list);
-    return 0;
+    HaploSymbol previous = symbol_list->val;
+    symbol_list->val = *symbol;
+    *symbol = previous;
+    return 1;
   }
-  
+
+  HaploSymbolList *new_list = (HaploSymbolList*) haplo_alloc(sizeof(HaploSymbolList));
+  if (!new_list) return HAPLO_ERROR_OUT_OF_MEMORY;
+  new_list->key = haplo_strdup(key);
+  if (!new_list->key)
+  {
+    haplo_free(new_list);
+    return HAPLO_ERROR_OUT_OF_MEMORY;
+  }
+  new_list->val = *symbol;
+  new_list->next = map->_map[hash];
+  map->_map[hash] = new_list;
   return 0;
 }
 
@@ -284,7 +346,7 @@ unsigned int djb2(const char *bytes, size_t len)
   return hash;
 }
 
-unsigned int haplo_symbol_hash(HaploSymbolKey key, int max_value)
+unsigned int haplo_symbol_hash(const char *key, int max_value)
 {
   return djb2(key, strlen(key)) % max_value;
 }
@@ -9,6 +9,7 @@
 #include "value.h"
 #include "expr.h"
 #include "function.h"
+#include "record.h"
 
 //
 // Macros
@@ -30,6 +31,7 @@
   #define symbol_map_lookup haplo_symbol_map_lookup
   #define symbol_map_update haplo_symbol_map_update
   #define symbol_map_delete haplo_symbol_map_delete
+  #define symbol_map_exchange haplo_symbol_map_exchange
   #define symbol_hash haplo_symbol_hash
 #endif // HAPLO_NO_PREFIX
 
@@ -41,6 +43,9 @@ typedef enum {
   HAPLO_SYMBOL_C_FUNCTION = 0,   // stdlib
   HAPLO_SYMBOL_FUNCTION,
   HAPLO_SYMBOL_VARIABLE,
+  HAPLO_SYMBOL_RECORD_NEW,       // constructor of a record
+  HAPLO_SYMBOL_RECORD_GET,       // reads a field of a record
+  HAPLO_SYMBOL_RECORD_SET,       // writes a field of a record
   _HAPLO_SYMBOL_MAX,
 } HaploSymbolType;
 
@@ -51,6 +56,9 @@ typedef struct HaploSymbol {
   HaploFunction c_func;    // function implemented in c
   HaploExpr* func;         // function defined as an AST
   HaploValue var;          // a variable
+  HaploShape *shape;       // the shape of a record symbol, or the
+                           // parameters of a function
+  int slot;                // the field of a record accessor
 } HaploSymbol;
 
 struct HaploSymbolList;
@@ -85,18 +93,25 @@ HaploSymbolMap *haplo_symbol_map_deep_copy(HaploSymbolMap *map);
 // symbol is not null, or returns a negative number representing an
 // error
 int haplo_symbol_map_lookup(HaploSymbolMap *map,
-                            HaploSymbolKey key,
+                            const char *key,
                             HaploSymbol *symbol);
 // Inserts or updates key with symbol. Returns 0 for insertions and 1
 // for updates, or a negative number representing an error
 int haplo_symbol_map_update(HaploSymbolMap *map,
-                            HaploSymbolKey key,
+                            const char *key,
                             HaploSymbol symbol);
 // Deletes map entry with key, returns 0 on success or a negative
 // number representing an error
 int haplo_symbol_map_delete(HaploSymbolMap *map,
-                            HaploSymbolKey key);
+                            const char *key);
+// Swaps the symbol of key with *symbol, without copying or freeing
+// them: the map takes ownership of *symbol, and the caller of the
+// previous symbol. Returns 1 if key was in the map, 0 if it was
+// inserted, or a negative number representing an error.
+int haplo_symbol_map_exchange(HaploSymbolMap *map,
+                              const char *key,
+                              HaploSymbol *symbol);
 // Return the hashed key
-unsigned int haplo_symbol_hash(HaploSymbolKey key, int max_value);
+unsigned int haplo_symbol_hash(const char *key, int max_value);
 
 #endif // HAPLO_SYMBOL_H
@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#define HAPLO_NO_PREFIX
+#include "../haplo.h"
+#include "tests.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static Value alloc_test_eval(Interpreter *interpreter, char *input)
+{
+  Parser parser = {0};
+  if (parser_init(&parser, input, strlen(input), NULL) < 0)
+    return (Value) { .type = HAPLO_VAL_ERROR, .value.error = HAPLO_ERROR_PARSER_NULL };
+
+  Expr *expr = parser_parse(&parser);
+  Value val = interpreter_interpret(interpreter, expr);
+  expr_free(expr);
+  return val;
+}
+
+HAPLO_TEST(alloc_test, quota)
+{
+  static char big_list[16384];
+  int offset = snprintf(big_list, sizeof(big_list), "(list");
+  for (int i = 0; i < 2000; ++i)
+    offset += snprintf(big_list + offset, sizeof(big_list) - offset, " %d", i);
+  snprintf(big_list + offset, sizeof(big_list) - offset, ")");
+
+  Allocator allocator = default_allocator;
+  allocator.quota = 64 * 1024;
+
+  Interpreter interpreter = {0};
+  int err = interpreter_init(&interpreter, &allocator);
+  if (err < 0)
+  {
+    fprintf(stderr, "Error %s in interpreter_init\n", error_string(err));
+    goto test_failed;
+  }
+
+  Value val = alloc_test_eval(&interpreter, "(+ 1 2)");
+  if (val.type != HAPLO_VAL_INTEGER || val.value.integer != 3)
+  {
+    fprintf(stderr, "Error expected 3 before exceeding the quota\n");
+    value_free(val);
+    interpreter_destroy(&interpreter);
+    goto test_failed;
+  }
+
+  val = alloc_test_eval(&interpreter, big_list);
+  if (val.type != HAPLO_VAL_ERROR || val.value.error != HAPLO_ERROR_OUT_OF_MEMORY)
+  {
+    fprintf(stderr, "Error expected ERROR_OUT_OF_MEMORY, got %s\n",
+            value_type_string(val.type));
+    value_free(val);
+    interpreter_destroy(&interpreter);
+    goto test_failed;
+  }
+
+  // The interpreter is still usable after an error
+  val = alloc_test_eval(&interpreter, "(+ 1 2)");
+  if (val.type != HAPLO_VAL_INTEGER || val.value.integer != 3)
+  {
+    fprintf(stderr, "Error expected 3 after exceeding the quota\n");
+    value_free(val);
+    interpreter_destroy(&interpreter);
+    goto test_failed;
+  }
+
+  interpreter_destroy(&interpreter);
+  if (allocator.used != 0)
+  {
+    fprintf(stderr, "Error %zu bytes still in use after destroy\n",
+            allocator.used);
+    goto test_failed;
+  }
+
+  HAPLO_TEST_SUCCESS;
+ test_failed:
+  HAPLO_TEST_FAILED;
+}
+
+HAPLO_TEST(alloc_test, parser_quota)
+{
+  char input[] = "(setq 'tree (list 1 \"two\" (list 3.0 'four (list))))";
+  bool failed = false, parsed = false;
+
+  // The quota runs out at every point of the parse, what was parsed
+  // before must be given back
+  for (size_t quota = 64; !parsed; quota += 32)
+  {
+    Allocator allocator = default_allocator;
+    allocator.quota = quota;
+    Parser parser = {0};
+    if (parser_init(&parser, input, strlen(input), &allocator) < 0)
+      goto test_failed;
+
+    Expr *expr = parser_parse(&parser);
+    if (expr) parsed = true;
+    else failed = true;
+    expr_free(expr);
+    if (allocator.used != 0)
+    {
+      fprintf(stderr, "Error %zu bytes still in use with a quota of %zu\n",
+              allocator.used, quota);
+      goto test_failed;
+    }
+  }
+  if (!failed)
+  {
+    fprintf(stderr, "Error the quota never ran out\n");
+    goto test_failed;
+  }
+
+  HAPLO_TEST_SUCCESS;
+ test_failed:
+  HAPLO_TEST_FAILED;
+}
+
+HAPLO_TEST(alloc_test, setq_quota)
+{
+  char *inputs[] = {
+    "((setq 'm (map)) (map-size (m)))",
+    "((setq 'x \"a long string value not inline\") 1)",
+  };
+  bool failed = false;
+
+  // A setq that cannot store its symbol must give back its value
+  for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i)
+  {
+    for (size_t quota = 32 * 1024; quota < 64 * 1024; quota += 64)
+    {
+      Allocator allocator = default_allocator;
+      allocator.quota = quota;
+      Interpreter interpreter = {0};
+      if (interpreter_init(&interpreter, &allocator) < 0)
+        continue;
+
+      Value val = alloc_test_eval(&interpreter, inputs[i]);
+      if (val.type == HAPLO_VAL_ERROR) failed = true;
+      value_free(val);
+      interpreter_destroy(&interpreter);
+      if (allocator.used != 0)
+      {
+        fprintf(stderr, "Error %zu bytes still in use with a quota of %zu\n",
+                allocator.used, quota);
+        goto test_failed;
+      }
+    }
+  }
+  if (!failed)
+  {
+    fprintf(stderr, "Error the quota never ran out\n");
+    goto test_failed;
+  }
+
+  HAPLO_TEST_SUCCESS;
+ test_failed:
+  HAPLO_TEST_FAILED;
+}
@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#define HAPLO_NO_PREFIX
+#include "../haplo.h"
+#include "tests.h"
+
+#include <limits.h>
+#include <stdio.h>
+
+#define INTEGER(x) (Value) { .type = HAPLO_VAL_INTEGER, .value.integer = (x) }
+#define FLOAT(x) (Value) { .type = HAPLO_VAL_FLOAT, .value.floating_point = (x) }
+
+HAPLO_TEST(arith_test, promotion)
+{
+  Value sum = arith_apply(HAPLO_ARITH_ADD, INTEGER(1), FLOAT(0.5));
+  if (sum.type != HAPLO_VAL_FLOAT || sum.value.floating_point != 1.5)
+  {
+    fprintf(stderr, "Error did not promote to a float\n");
+    goto cleanup_failed;
+  }
+
+  Value div = arith_apply(HAPLO_ARITH_DIV, INTEGER(7), INTEGER(2));
+  if (div.type != HAPLO_VAL_INTEGER || div.value.integer != 3)
+  {
+    fprintf(stderr, "Error wrong integer division\n");
+    goto cleanup_failed;
+  }
+
+  Value equal = arith_apply(HAPLO_ARITH_EQ, FLOAT(2.0), INTEGER(2));
+  if (equal.type != HAPLO_VAL_BOOL || !equal.value.boolean)
+  {
+    fprintf(stderr, "Error 2.0 is not 2\n");
+    goto cleanup_failed;
+  }
+
+  Value string = { .type = HAPLO_VAL_BOOL, .value.boolean = true };
+  Value invalid = arith_apply(HAPLO_ARITH_LT, INTEGER(1), string);
+  if (invalid.type != HAPLO_VAL_ERROR
+      || invalid.value.error != HAPLO_ERROR_INTERPRETER_INVALID_TYPE)
+  {
+    fprintf(stderr, "Error compared a number and a bool\n");
+    goto cleanup_failed;
+  }
+
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  HAPLO_TEST_FAILED;
+}
+
+HAPLO_TEST(arith_test, fold)
+{
+  Value args[] = { INTEGER(LONG_MAX), INTEGER(LONG_MAX), INTEGER(-LONG_MAX) };
+  Value sum = arith_fold(HAPLO_ARITH_ADD, args, 3);
+  if (sum.type != HAPLO_VAL_INTEGER || sum.value.integer != LONG_MAX)
+  {
+    fprintf(stderr, "Error the intermediate bigint was lost\n");
+    goto cleanup_failed;
+  }
+
+  Value negated = arith_fold(HAPLO_ARITH_SUB, args, 1);
+  if (negated.type != HAPLO_VAL_INTEGER || negated.value.integer != -LONG_MAX)
+  {
+    fprintf(stderr, "Error wrong negation\n");
+    goto cleanup_failed;
+  }
+
+  Value increasing[] = { INTEGER(1), FLOAT(2.5), INTEGER(3) };
+  Value decreasing[] = { INTEGER(3), INTEGER(1), INTEGER(2) };
+  Value lt = arith_fold(HAPLO_ARITH_LT, increasing, 3);
+  Value not_lt = arith_fold(HAPLO_ARITH_LT, decreasing, 3);
+  if (!lt.value.boolean || not_lt.value.boolean)
+  {
+    fprintf(stderr, "Error wrong chain of comparisons\n");
+    goto cleanup_failed;
+  }
+
+  Value one = arith_fold(HAPLO_ARITH_GT, args, 1);
+  if (one.type != HAPLO_VAL_ERROR)
+  {
+    fprintf(stderr, "Error compared a single value\n");
+    goto cleanup_failed;
+  }
+
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  HAPLO_TEST_FAILED;
+}
@@ -0,0 +1,253 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#define HAPLO_NO_PREFIX
+#include "../haplo.h"
+#include "tests.h"
+
+#include <stdio.h>
+
+// The expected result of op on x and y, computed one element at a time
+static double array_test_expected(ArrayOp op, double x, double y)
+{
+  switch(op)
+  {
+  case HAPLO_ARRAY_OP_ADD: return x + y;
+  case HAPLO_ARRAY_OP_SUB: return x - y;
+  case HAPLO_ARRAY_OP_MUL: return x * y;
+  case HAPLO_ARRAY_OP_DIV: return x / y;
+  case HAPLO_ARRAY_OP_LT:  return x < y;
+  case HAPLO_ARRAY_OP_LE:  return x <= y;
+  case HAPLO_ARRAY_OP_GT:  return x > y;
+  case HAPLO_ARRAY_OP_GE:  return x >= y;
+  case HAPLO_ARRAY_OP_EQ:  return x == y;
+  default: break;
+  }
+  return 0;
+}
+
+// Checks every operation against the expected results, with lengths
+// that leave some elements to the scalar kernels
+HAPLO_TEST(array_test, kernels)
+{
+  Array *a = NULL, *b = NULL, *out = NULL;
+  for (int len = 0; len < 19; ++len)
+  {
+    for (ArrayType type = HAPLO_ARRAY_I64; type < _HAPLO_ARRAY_MAX; ++type)
+    {
+      a = array_new(type, len);
+      b = array_new(type, len);
+      if (!a || !b) goto cleanup_failed;
+      for (int i = 0; i < len; ++i)
+      {
+        // No zeros in b, and some equal elements
+        long x = (i * 7) % 5 - 2, y = (i % 3) + 1;
+        if (type == HAPLO_ARRAY_I64)
+        {
+          a->data.i64[i] = x;
+          b->data.i64[i] = y;
+        } else {
+          a->data.f64[i] = x;
+          b->data.f64[i] = y;
+        }
+      }
+
+      for (ArrayOp op = HAPLO_ARRAY_OP_ADD; op < _HAPLO_ARRAY_OP_MAX; ++op)
+      {
+        for (int broadcast = 0; broadcast < 2; ++broadcast)
+        {
+          int error = 0;
+          Value scalar = (type == HAPLO_ARRAY_I64)
+            ? (Value) { .type = HAPLO_VAL_INTEGER, .value.integer = 2 }
+            : (Value) { .type = HAPLO_VAL_FLOAT, .value.floating_point = 2 };
+          out = broadcast ? array_op_scalar(op, a, scalar, &error)
+                          : array_op(op, a, b, &error);
+          if (!out)
+          {
+            fprintf(stderr, "Error %s in array_op\n", error_string(error));
+            goto cleanup_failed;
+          }
+
+          for (int i = 0; i < len; ++i)
+          {
+            Value x = array_nth(a, i);
+            Value y = broadcast ? scalar : array_nth(b, i);
+            double dx = (type == HAPLO_ARRAY_I64) ? x.value.integer : x.value.floating_point;
+            double dy = (type == HAPLO_ARRAY_I64) ? y.value.integer : y.value.floating_point;
+            double expected = array_test_expected(op, dx, dy);
+            if (type == HAPLO_ARRAY_I64 && op == HAPLO_ARRAY_OP_DIV)
+              expected = x.value.integer / y.value.integer;
+
+            Value got = array_nth(out, i);
+            double dgot = (got.type == HAPLO_VAL_INTEGER)
+              ? got.value.integer : got.value.floating_point;
+            if (dgot != expected)
+            {
+              fprintf(stderr, "Error op %d on element %d of %d: expected %f, got %f\n",
+                      op, i, len, expected, dgot);
+              goto cleanup_failed;
+            }
+          }
+          array_free(out);
+          out = NULL;
+        }
+      }
+
+      Value sum = array_sum(a), dot = array_dot(a, b);
+      Value min = array_min(a), max = array_max(a);
+      double expected_sum = 0, expected_dot = 0, expected_min = 0, expected_max = 0;
+      for (int i = 0; i < len; ++i)
+      {
+        Value x = array_nth(a, i), y = array_nth(b, i);
+        double dx = (type == HAPLO_ARRAY_I64) ? x.value.integer : x.value.floating_point;
+        double dy = (type == HAPLO_ARRAY_I64) ? y.value.integer : y.value.floating_point;
+        expected_sum += dx;
+        expected_dot += dx * dy;
+        if (i == 0 || dx < expected_min) expected_min = dx;
+        if (i == 0 || dx > expected_max) expected_max = dx;
+      }
+      bool is_int = type == HAPLO_ARRAY_I64;
+      if ((is_int ? sum.value.integer : sum.value.floating_point) != expected_sum
+          || (is_int ? dot.value.integer : dot.value.floating_point) != expected_dot)
+      {
+        fprintf(stderr, "Error wrong sum or dot product of %d elements\n", len);
+        goto cleanup_failed;
+      }
+      if (len == 0 ? (min.type != HAPLO_VAL_ERROR || max.type != HAPLO_VAL_ERROR)
+          : ((is_int ? min.value.integer : min.value.floating_point) != expected_min
+             || (is_int ? max.value.integer : max.value.floating_point) != expected_max))
+      {
+        fprintf(stderr, "Error wrong min or max of %d elements\n", len);
+        goto cleanup_failed;
+      }
+
+      array_free(a);
+      array_free(b);
+      a = b = NULL;
+    }
+  }
+
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  array_free(a);
+  array_free(b);
+  array_free(out);
+  HAPLO_TEST_FAILED;
+}
+
+HAPLO_TEST(array_test, errors)
+{
+  int error = 0;
+  Array *a = array_new(HAPLO_ARRAY_I64, 5);
+  Array *b = array_new(HAPLO_ARRAY_I64, 5);
+  Array *c = array_new(HAPLO_ARRAY_F64, 5);
+  if (!a || !b || !c) goto cleanup_failed;
+
+  if (((uintptr_t) a->data.i64) % HAPLO_ARRAY_ALIGNMENT != 0)
+  {
+    fprintf(stderr, "Error array data is not aligned\n");
+    goto cleanup_failed;
+  }
+
+  // b is all zeros
+  if (array_op(HAPLO_ARRAY_OP_DIV, a, b, &error)
+      || error != HAPLO_ERROR_DIVISION_BY_ZERO)
+  {
+    fprintf(stderr, "Error division by zero was not detected\n");
+    goto cleanup_failed;
+  }
+  if (array_op(HAPLO_ARRAY_OP_ADD, a, c, &error)
+      || error != HAPLO_ERROR_INTERPRETER_INVALID_TYPE)
+  {
+    fprintf(stderr, "Error arrays of different types were added\n");
+    goto cleanup_failed;
+  }
+
+  array_free(a);
+  array_free(b);
+  array_free(c);
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  array_free(a);
+  array_free(b);
+  array_free(c);
+  HAPLO_TEST_FAILED;
+}
+
+// Integer results that do not fit in 64 bits are errors, wherever the
+// element is, so both the SIMD and the scalar kernels see it
+HAPLO_TEST(array_test, overflow)
+{
+  Array *a = NULL;
+  struct {
+    ArrayOp op;
+    long x;
+    long scalar;
+  } cases[] = {
+    { HAPLO_ARRAY_OP_ADD, INT64_MAX, 1 },
+    { HAPLO_ARRAY_OP_ADD, INT64_MIN, -1 },
+    { HAPLO_ARRAY_OP_SUB, INT64_MIN, 1 },
+    { HAPLO_ARRAY_OP_SUB, INT64_MAX, -1 },
+    { HAPLO_ARRAY_OP_MUL, INT64_MAX / 2 + 1, 2 },
+    { HAPLO_ARRAY_OP_DIV, INT64_MIN, -1 },
+  };
+  for (int len = 1; len < 11; ++len)
+  {
+    for (int at = 0; at < len; ++at)
+    {
+      for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); ++c)
+      {
+        a = array_new(HAPLO_ARRAY_I64, len);
+        if (!a) goto cleanup_failed;
+        a->data.i64[at] = cases[c].x;
+
+        int error = 0;
+        Value scalar = { .type = HAPLO_VAL_INTEGER, .value.integer = cases[c].scalar };
+        Array *out = array_op_scalar(cases[c].op, a, scalar, &error);
+        if (out || error != HAPLO_ERROR_OUT_OF_RANGE)
+        {
+          fprintf(stderr, "Error op %d on %ld at %d of %d did not overflow\n",
+                  cases[c].op, cases[c].x, at, len);
+          array_free(out);
+          goto cleanup_failed;
+        }
+        array_free(a);
+        a = NULL;
+      }
+
+      // INT64_MAX plus one overflows. With another one and a -1 the
+      // sum is INT64_MAX, whatever order the kernel adds them in.
+      a = array_new(HAPLO_ARRAY_I64, len + 1);
+      if (!a) goto cleanup_failed;
+      a->data.i64[at] = INT64_MAX;
+      a->data.i64[len] = 1;
+      Value sum = array_sum(a);
+      Value dot = array_dot(a, a);
+      Value fits = { .type = HAPLO_VAL_INTEGER, .value.integer = INT64_MAX };
+      if (len > 1)
+      {
+        a->data.i64[(at == 0) ? 1 : 0] = 1;
+        a->data.i64[len] = -1;
+        fits = array_sum(a);
+      }
+      if (sum.type != HAPLO_VAL_ERROR || sum.value.error != HAPLO_ERROR_OUT_OF_RANGE
+          || dot.type != HAPLO_VAL_ERROR || dot.value.error != HAPLO_ERROR_OUT_OF_RANGE
+          || fits.type != HAPLO_VAL_INTEGER || fits.value.integer != INT64_MAX)
+      {
+        fprintf(stderr, "Error wrong sums with INT64_MAX at %d of %d\n", at, len + 1);
+        goto cleanup_failed;
+      }
+      array_free(a);
+      a = NULL;
+    }
+  }
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  array_free(a);
+  HAPLO_TEST_FAILED;
+}
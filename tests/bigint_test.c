@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#define HAPLO_NO_PREFIX
+#include "../haplo.h"
+#include "tests.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#define INTEGER(x) (Value) { .type = HAPLO_VAL_INTEGER, .value.integer = (x) }
+
+HAPLO_TEST(bigint_test, overflow)
+{
+  char buf[64];
+  Value big = bigint_add(INTEGER(LONG_MAX), INTEGER(1));
+  Value back = { .type = HAPLO_VAL_EMPTY };
+  Value min = { .type = HAPLO_VAL_EMPTY };
+  if (big.type != HAPLO_VAL_BIGINT) goto cleanup_failed;
+
+  value_string(big, buf, sizeof(buf));
+  if (strcmp(buf, "9223372036854775808") != 0)
+  {
+    fprintf(stderr, "Error wrong digits: %s\n", buf);
+    goto cleanup_failed;
+  }
+
+  // Results that fit in a long go back to INTEGER
+  back = bigint_sub(big, INTEGER(1));
+  if (back.type != HAPLO_VAL_INTEGER || back.value.integer != LONG_MAX)
+  {
+    fprintf(stderr, "Error did not demote to an integer\n");
+    goto cleanup_failed;
+  }
+
+  min = bigint_div(INTEGER(LONG_MIN), INTEGER(-1));
+  if (!value_equal(min, big) || bigint_compare(INTEGER(LONG_MIN), big) >= 0
+      || bigint_compare(min, INTEGER(LONG_MAX)) <= 0
+      || value_hash(min) != value_hash(big))
+  {
+    fprintf(stderr, "Error wrong LONG_MIN / -1\n");
+    goto cleanup_failed;
+  }
+
+  Value zero = bigint_div(INTEGER(1), INTEGER(0));
+  if (zero.type != HAPLO_VAL_ERROR || zero.value.error != HAPLO_ERROR_DIVISION_BY_ZERO)
+  {
+    fprintf(stderr, "Error divided by zero\n");
+    goto cleanup_failed;
+  }
+
+  value_free(big);
+  value_free(min);
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  value_free(big);
+  value_free(back);
+  value_free(min);
+  HAPLO_TEST_FAILED;
+}
+
+// Returns x^n by repeated multiplication
+static Value bigint_test_pow(long x, int n)
+{
+  Value result = INTEGER(1);
+  for (int i = 0; i < n; ++i)
+  {
+    Value next = bigint_mul(result, INTEGER(x));
+    value_free(result);
+    result = next;
+  }
+  return result;
+}
+
+// Operands above the Karatsuba threshold, with different lengths, a
+// is negative
+HAPLO_TEST(bigint_test, karatsuba)
+{
+  Value a = bigint_test_pow(-1000000007, 3 * HAPLO_BIGINT_KARATSUBA_THRESHOLD + 1);
+  Value b = bigint_test_pow(998244353, 5 * HAPLO_BIGINT_KARATSUBA_THRESHOLD);
+  Value product = { .type = HAPLO_VAL_EMPTY };
+  Value quotient = { .type = HAPLO_VAL_EMPTY };
+  Value other = { .type = HAPLO_VAL_EMPTY };
+  if (a.type != HAPLO_VAL_BIGINT || b.type != HAPLO_VAL_BIGINT)
+    goto cleanup_failed;
+  if (a.value.bigint->len < 2 * HAPLO_BIGINT_KARATSUBA_THRESHOLD)
+    goto cleanup_failed;
+
+  product = bigint_mul(a, b);
+  quotient = bigint_div(product, b);
+  other = bigint_div(product, a);
+  if (!value_equal(quotient, a) || !value_equal(other, b))
+  {
+    fprintf(stderr, "Error (a * b) / b is not a\n");
+    goto cleanup_failed;
+  }
+  if (bigint_compare(a, b) >= 0 || bigint_compare(product, a) >= 0)
+  {
+    fprintf(stderr, "Error wrong comparison\n");
+    goto cleanup_failed;
+  }
+
+  value_free(a);
+  value_free(b);
+  value_free(product);
+  value_free(quotient);
+  value_free(other);
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  value_free(a);
+  value_free(b);
+  value_free(product);
+  value_free(quotient);
+  value_free(other);
+  HAPLO_TEST_FAILED;
+}
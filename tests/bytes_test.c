@@ -0,0 +1,236 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#define HAPLO_NO_PREFIX
+#include "../haplo.h"
+#include "tests.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int bytes_test_releases;
+
+static void bytes_test_release(void *owner, uint8_t *data, long len)
+{
+  bytes_test_releases += *(int *) owner;
+  return;
+}
+
+HAPLO_TEST(bytes_test, scalars)
+{
+  Bytes *bytes = bytes_new(16);
+  if (!bytes) HAPLO_TEST_FAILED;
+
+  struct {
+    const char *name;
+    long offset;
+    Value value;
+    const char *expected;
+    size_t size;
+  } cases[] = {
+    { "u16be", 0, { .type = HAPLO_VAL_INTEGER, .value.integer = 0x1234 }, "\x12\x34", 2 },
+    { "u16le", 0, { .type = HAPLO_VAL_INTEGER, .value.integer = 0x1234 }, "\x34\x12", 2 },
+    { "i32le", 2, { .type = HAPLO_VAL_INTEGER, .value.integer = -2 }, "\xfe\xff\xff\xff", 4 },
+    { "i64be", 8, { .type = HAPLO_VAL_INTEGER, .value.integer = -3 },
+      "\xff\xff\xff\xff\xff\xff\xff\xfd", 8 },
+    { "f32be", 4, { .type = HAPLO_VAL_FLOAT, .value.floating_point = 1.5 }, "\x3f\xc0\x00\x00", 4 },
+    { "f64le", 8, { .type = HAPLO_VAL_FLOAT, .value.floating_point = -2.0 },
+      "\x00\x00\x00\x00\x00\x00\x00\xc0", 8 },
+    { "i8", 15, { .type = HAPLO_VAL_INTEGER, .value.integer = -128 }, "\x80", 1 },
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i)
+  {
+    BytesScalar scalar;
+    bool big_endian;
+    if (!bytes_scalar_parse(cases[i].name, &scalar, &big_endian)
+        || bytes_set(bytes, cases[i].offset, scalar, big_endian, cases[i].value) != 0)
+    {
+      fprintf(stderr, "Error writing %s\n", cases[i].name);
+      goto cleanup_failed;
+    }
+    Value read = bytes_get(bytes, cases[i].offset, scalar, big_endian);
+    if (memcmp(bytes->data + cases[i].offset, cases[i].expected, cases[i].size) != 0
+        || !value_equal(read, cases[i].value))
+    {
+      fprintf(stderr, "Error %s did not read back\n", cases[i].name);
+      goto cleanup_failed;
+    }
+  }
+
+  const char *invalid[] = { "u16", "u8le", "i32xe", "f16le", "" };
+  for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i)
+  {
+    BytesScalar scalar;
+    bool big_endian;
+    if (bytes_scalar_parse(invalid[i], &scalar, &big_endian))
+    {
+      fprintf(stderr, "Error parsed the scalar %s\n", invalid[i]);
+      goto cleanup_failed;
+    }
+  }
+
+  // The u64 values above a long are bigints
+  memset(bytes->data, 0xff, 8);
+  Value max = bytes_get(bytes, 0, HAPLO_BYTES_U64, false);
+  Value expected = bigint_add((Value) { .type = HAPLO_VAL_INTEGER, .value.integer = LONG_MAX },
+                              (Value) { .type = HAPLO_VAL_INTEGER, .value.integer = LONG_MAX });
+  Value one = { .type = HAPLO_VAL_INTEGER, .value.integer = 1 };
+  Value sum = bigint_add(expected, one);
+  bool equal = max.type == HAPLO_VAL_BIGINT && bigint_compare(max, sum) == 0;
+  value_free(expected);
+  value_free(sum);
+  if (!equal)
+  {
+    fprintf(stderr, "Error wrong u64 maximum\n");
+    value_free(max);
+    goto cleanup_failed;
+  }
+
+  // and are written back
+  memset(bytes->data, 0, 8);
+  int err = bytes_set(bytes, 0, HAPLO_BYTES_U64, true, max);
+  value_free(max);
+  if (err != 0 || memcmp(bytes->data, "\xff\xff\xff\xff\xff\xff\xff\xff", 8) != 0)
+  {
+    fprintf(stderr, "Error the u64 maximum was not written back\n");
+    goto cleanup_failed;
+  }
+
+  // Integers out of the range of the scalar are not cut
+  struct {
+    BytesScalar scalar;
+    long value;
+  } out_of_range[] = {
+    { HAPLO_BYTES_U8, 256 },
+    { HAPLO_BYTES_U8, -1 },
+    { HAPLO_BYTES_I8, 128 },
+    { HAPLO_BYTES_U16, -1 },
+    { HAPLO_BYTES_I16, -32769 },
+    { HAPLO_BYTES_U32, 4294967296 },
+    { HAPLO_BYTES_I32, 2147483648 },
+    { HAPLO_BYTES_U64, -1 },
+  };
+  for (size_t i = 0; i < sizeof(out_of_range) / sizeof(out_of_range[0]); ++i)
+  {
+    Value value = { .type = HAPLO_VAL_INTEGER, .value.integer = out_of_range[i].value };
+    if (bytes_set(bytes, 0, out_of_range[i].scalar, false, value) != HAPLO_ERROR_OUT_OF_RANGE)
+    {
+      fprintf(stderr, "Error wrote %ld as scalar %d\n", out_of_range[i].value,
+              out_of_range[i].scalar);
+      goto cleanup_failed;
+    }
+  }
+  Value big = bigint_mul((Value) { .type = HAPLO_VAL_INTEGER, .value.integer = LONG_MAX },
+                         (Value) { .type = HAPLO_VAL_INTEGER, .value.integer = 4 });
+  int u64_err = bytes_set(bytes, 0, HAPLO_BYTES_U64, false, big);
+  int i64_err = bytes_set(bytes, 0, HAPLO_BYTES_I64, false, big);
+  value_free(big);
+  if (u64_err != HAPLO_ERROR_OUT_OF_RANGE || i64_err != HAPLO_ERROR_OUT_OF_RANGE)
+  {
+    fprintf(stderr, "Error wrote a bigint above 64 bits\n");
+    goto cleanup_failed;
+  }
+
+  if (bytes_get(bytes, 9, HAPLO_BYTES_I64, false).type != HAPLO_VAL_ERROR
+      || bytes_set(bytes, -1, HAPLO_BYTES_U8, false, one) != HAPLO_ERROR_INDEX_OUT_OF_BOUNDS)
+  {
+    fprintf(stderr, "Error accessed out of bounds\n");
+    goto cleanup_failed;
+  }
+
+  bytes_free(bytes);
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  bytes_free(bytes);
+  HAPLO_TEST_FAILED;
+}
+
+HAPLO_TEST(bytes_test, shared)
+{
+  static uint8_t memory[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+  int weight = 1;
+  bytes_test_releases = 0;
+  Bytes *bytes = bytes_wrap(memory, 8, false, bytes_test_release, &weight);
+  Bytes *slice = bytes ? bytes_slice(bytes, 2, 4) : NULL;
+  Bytes *inner = slice ? bytes_slice(slice, 1, 2) : NULL;
+  if (!inner) goto cleanup_failed;
+
+  // The memory is released once, by the first buffer
+  if (inner->parent != bytes || inner->data != memory + 3
+      || bytes_read_uint(inner, 0, 2, true) != 0x0405)
+  {
+    fprintf(stderr, "Error the slices do not share the memory\n");
+    goto cleanup_failed;
+  }
+  Value one = { .type = HAPLO_VAL_INTEGER, .value.integer = 1 };
+  if (bytes_set(inner, 0, HAPLO_BYTES_U8, false, one) != HAPLO_ERROR_READ_ONLY)
+  {
+    fprintf(stderr, "Error wrote to read only memory\n");
+    goto cleanup_failed;
+  }
+  bytes_free(bytes);
+  bytes_free(slice);
+  if (bytes_test_releases != 0) goto cleanup_failed;
+  bytes_free(inner);
+  if (bytes_test_releases != 1)
+  {
+    fprintf(stderr, "Error the memory was released %d times\n", bytes_test_releases);
+    HAPLO_TEST_FAILED;
+  }
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  bytes_free(bytes);
+  bytes_free(slice);
+  bytes_free(inner);
+  HAPLO_TEST_FAILED;
+}
+
+HAPLO_TEST(bytes_test, map_file)
+{
+  const char *path = "bytes_test.bin";
+  FILE *file = fopen(path, "wb");
+  if (!file) HAPLO_TEST_FAILED;
+  fwrite("\x01\x00\x00\x00\x02\x00", 1, 6, file);
+  fclose(file);
+
+  int err = 0;
+  Bytes *bytes = bytes_map_file(path, true, &err);
+  if (!bytes || bytes->len != 6 || bytes_read_uint(bytes, 0, 4, false) != 1)
+  {
+    fprintf(stderr, "Error mapping the file: %s\n", error_string(err));
+    goto cleanup_failed;
+  }
+  bytes_write_uint(bytes, 4, 2, false, 0x0303);
+  bytes_free(bytes);
+  bytes = NULL;
+
+  // The write reached the file
+  unsigned char content[6] = {0};
+  file = fopen(path, "rb");
+  if (!file || fread(content, 1, 6, file) != 6 || content[4] != 3 || content[5] != 3)
+  {
+    fprintf(stderr, "Error the file was not written\n");
+    if (file) fclose(file);
+    goto cleanup_failed;
+  }
+  fclose(file);
+
+  if (bytes_map_file("bytes_test_missing.bin", false, &err) || err != HAPLO_ERROR_IO)
+  {
+    fprintf(stderr, "Error mapped a missing file\n");
+    goto cleanup_failed;
+  }
+  remove(path);
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  bytes_free(bytes);
+  remove(path);
+  HAPLO_TEST_FAILED;
+}
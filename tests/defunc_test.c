@@ -17,7 +17,7 @@ HAPLO_TEST(defunc_test, declare_function)
   char* expected = "( defunc ( 'test ( ( + ( 2 ( 3 ) ) ) ) ) )";
   
   Parser parser = {0};
-  err = parser_init(&parser, input, strlen(input));
+  err = parser_init(&parser, input, strlen(input), NULL);
   if (err < 0)
   {
     fprintf(stderr, "Error %d after parser_init\n", err);
@@ -50,7 +50,7 @@ HAPLO_TEST(defunc_test, declare_function)
   }
 
   Interpreter interpreter = {0};
-  interpreter_init(&interpreter);
+  interpreter_init(&interpreter, NULL);
   Value val = interpreter_interpret(&interpreter, expr);
   if (val.type == HAPLO_VAL_ERROR)
   {
@@ -104,7 +104,7 @@ HAPLO_TEST(defunc_test, declare_function)
   // Try to call the new function
   char* input2 = "(test)";
   Parser parser2 = {0};
-  err = parser_init(&parser2, input2, strlen(input2));
+  err = parser_init(&parser2, input2, strlen(input2), NULL);
   if (err < 0)
   {
     fprintf(stderr, "Error %d after parser_init 2\n", err);
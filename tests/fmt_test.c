@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#define HAPLO_NO_PREFIX
+#include "../haplo.h"
+#include "tests.h"
+
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+HAPLO_TEST(fmt_test, long)
+{
+  long values[] = { 0, 9, 10, -1, 99, 100, 12345, -987654321, LONG_MAX, LONG_MIN };
+  for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+  {
+    char buf[HAPLO_FMT_LONG_MAX], expected[32];
+    int len = fmt_long(buf, values[i]);
+    snprintf(expected, sizeof(expected), "%ld", values[i]);
+    if (len != (int) strlen(expected) || strcmp(buf, expected) != 0)
+    {
+      fprintf(stderr, "Error formatted %s as %s\n", expected, buf);
+      HAPLO_TEST_FAILED;
+    }
+  }
+  HAPLO_TEST_SUCCESS;
+}
+
+HAPLO_TEST(fmt_test, double)
+{
+  struct {
+    double value;
+    const char *expected;
+  } cases[] = {
+    { 0.1 + 0.2, "0.30000000000000004" },
+    { 0.1, "0.1" },
+    { 1.5, "1.5" },
+    { 100.0, "100.0" },
+    { -0.0, "-0.0" },
+    { 123456.789, "123456.789" },
+    { 1e15, "1000000000000000.0" },
+    { 1e16, "1e+16" },
+    { 0.0001, "0.0001" },
+    { 0.00001, "1e-05" },
+    { 1.25e-100, "1.25e-100" },
+    { 5e-324, "5e-324" },
+    { DBL_MAX, "1.7976931348623157e+308" },
+    { -INFINITY, "-inf" },
+    { NAN, "nan" },
+  };
+  char buf[HAPLO_FMT_DOUBLE_MAX];
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i)
+  {
+    int len = fmt_double(buf, cases[i].value);
+    if (len != (int) strlen(buf) || strcmp(buf, cases[i].expected) != 0)
+    {
+      fprintf(stderr, "Error formatted %s as %s\n", cases[i].expected, buf);
+      HAPLO_TEST_FAILED;
+    }
+  }
+
+  // Every finite double reads back as itself
+  srand(42);
+  for (int i = 0; i < 200000; ++i)
+  {
+    uint64_t bits = 0;
+    for (int j = 0; j < 4; ++j)
+      bits = (bits << 16) ^ (uint64_t) (rand() & 0xffff);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    if (!isfinite(value)) continue;
+
+    fmt_double(buf, value);
+    if (strtod(buf, NULL) != value)
+    {
+      fprintf(stderr, "Error %.17g was formatted as %s\n", value, buf);
+      HAPLO_TEST_FAILED;
+    }
+  }
+  HAPLO_TEST_SUCCESS;
+}
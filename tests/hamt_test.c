@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#define HAPLO_NO_PREFIX
+#include "../haplo.h"
+#include "tests.h"
+
+#include <stdio.h>
+
+#define HAMT_TEST_KEYS 5000
+
+static Value hamt_test_int(long i)
+{
+  return (Value) { .type = HAPLO_VAL_INTEGER, .value.integer = i };
+}
+
+HAPLO_TEST(hamt_test, versions)
+{
+  Hamt *versions[HAMT_TEST_KEYS + 1] = {0};
+  versions[0] = hamt_new();
+  for (int i = 0; i < HAMT_TEST_KEYS; ++i)
+  {
+    versions[i + 1] = hamt_put(versions[i], hamt_test_int(i), hamt_test_int(-i));
+    if (!versions[i + 1])
+    {
+      fprintf(stderr, "Error hamt_put returned NULL\n");
+      goto cleanup_failed;
+    }
+  }
+
+  // Every version still holds exactly the keys it was built with
+  for (int v = 0; v <= HAMT_TEST_KEYS; v += HAMT_TEST_KEYS / 10)
+  {
+    if (hamt_size(versions[v]) != v)
+    {
+      fprintf(stderr, "Error version %d has size %d\n", v, hamt_size(versions[v]));
+      goto cleanup_failed;
+    }
+    for (int i = 0; i < HAMT_TEST_KEYS; ++i)
+    {
+      Value *val = hamt_get(versions[v], hamt_test_int(i));
+      if ((i < v) != (val != NULL) || (val && val->value.integer != -i))
+      {
+        fprintf(stderr, "Error wrong value for key %d in version %d\n", i, v);
+        goto cleanup_failed;
+      }
+    }
+  }
+
+  // Deleting every key gives back an empty map, the full version is
+  // not changed
+  Hamt *hamt = hamt_ref(versions[HAMT_TEST_KEYS]);
+  for (int i = 0; i < HAMT_TEST_KEYS; ++i)
+  {
+    Hamt *new_hamt = hamt_del(hamt, hamt_test_int(i));
+    hamt_free(hamt);
+    hamt = new_hamt;
+    if (!hamt || hamt_size(hamt) != HAMT_TEST_KEYS - i - 1
+        || hamt_get(hamt, hamt_test_int(i)))
+    {
+      fprintf(stderr, "Error wrong map after deleting key %d\n", i);
+      hamt_free(hamt);
+      goto cleanup_failed;
+    }
+  }
+  if (hamt->root != NULL)
+  {
+    fprintf(stderr, "Error empty map still has a root\n");
+    hamt_free(hamt);
+    goto cleanup_failed;
+  }
+  hamt_free(hamt);
+
+  if (hamt_size(versions[HAMT_TEST_KEYS]) != HAMT_TEST_KEYS
+      || !hamt_get(versions[HAMT_TEST_KEYS], hamt_test_int(0)))
+  {
+    fprintf(stderr, "Error deleting changed an old version\n");
+    goto cleanup_failed;
+  }
+
+  for (int v = 0; v <= HAMT_TEST_KEYS; ++v)
+    hamt_free(versions[v]);
+  HAPLO_TEST_SUCCESS;
+ cleanup_failed:
+  for (int v = 0; v <= HAMT_TEST_KEYS; ++v)
+    hamt_free(versions[v]);
+  HAPLO_TEST_FAILED;
+}
@@ -18,7 +18,7 @@ HAPLO_TEST(interpreter_test, simple_math)
   long expected_result = 3;
   
   Parser parser = {0};
-  err = parser_init(&parser, input, strlen(input));
+  err = parser_init(&parser, input, strlen(input), NULL);
   if (err < 0)
   {
     fprintf(stderr, "Error %d after parser_init\n", err);
@@ -51,7 +51,7 @@ HAPLO_TEST(interpreter_test, simple_math)
   }
 
   Interpreter interpreter = {0};
-  interpreter_init(&interpreter);
+  interpreter_init(&interpreter, NULL);
   Value val = interpreter_interpret(&interpreter, expr);
   if (val.type == HAPLO_VAL_ERROR)
   {
@@ -94,7 +94,7 @@ HAPLO_TEST(interpreter_test, should_eval_head)
   long expected_result = 9;
   
   Parser parser = {0};
-  err = parser_init(&parser, input, strlen(input));
+  err = parser_init(&parser, input, strlen(input), NULL);
   if (err < 0)
   {
     fprintf(stderr, "Error %d after parser_init\n", err);
@@ -127,7 +127,7 @@ HAPLO_TEST(interpreter_test, should_eval_head)
   }
 
   Interpreter interpreter = {0};
-  interpreter_init(&interpreter);
+  interpreter_init(&interpreter, NULL);
   Value val = interpreter_interpret(&interpreter, expr);
   if (val.type == HAPLO_VAL_ERROR)
   {
@@ -170,7 +170,7 @@ HAPLO_TEST(interpreter_test, simple_integer_val)
   long expected_result = 123;
   
   Parser parser = {0};
-  err = parser_init(&parser, input, strlen(input));
+  err = parser_init(&parser, input, strlen(input), NULL);
   if (err < 0)
   {
     fprintf(stderr, "Error %d after parser_init\n", err);
@@ -203,7 +203,7 @@ HAPLO_TEST(interpreter_test, simple_integer_val)
   }
 
   Interpreter interpreter = {0};
-  interpreter_init(&interpreter);
+  interpreter_init(&interpreter, NULL);
   Value val = interpreter_interpret(&interpreter, expr);
   if (val.type == HAPLO_VAL_ERROR)
   {
@@ -246,7 +246,7 @@ HAPLO_TEST(interpreter_test, simple_string_val)
   char* expected_result = "Hello!";
   
   Parser parser = {0};
-  err = parser_init(&parser, input, strlen(input));
+  err = parser_init(&parser, input, strlen(input), NULL);
   if (err < 0)
   {
     fprintf(stderr, "Error %d after parser_init\n", err);
@@ -279,7 +279,7 @@ HAPLO_TEST(interpreter_test, simple_string_val)
   }
 
   Interpreter interpreter = {0};
-  interpreter_init(&interpreter);
+  interpreter_init(&interpreter, NULL);
   Value val = interpreter_interpret(&interpreter, expr);
   if (val.type == HAPLO_VAL_ERROR)
   {
@@ -297,10 +297,10 @@ HAPLO_TEST(interpreter_test, simple_string_val)
     expr_free(expr);
     goto test_failed;
   }
-  if (strcmp(val.value.string, expected_result) != 0)
+  if (strcmp(value_text(&val), expected_result) != 0)
   {
     fprintf(stderr, "Error in interpreter_interpret, expected result %s, got %s\n",
-            expected_result, val.value.string);
+            expected_result, value_text(&val));
     haplo_interpreter_destroy(&interpreter);
     value_free(val);
     expr_free(expr);
@@ -325,7 +325,7 @@ HAPLO_TEST(interpreter_test, math)
   long expected_result = 10;
   
   Parser parser = {0};
-  err = parser_init(&parser, input, strlen(input));
+  err = parser_init(&parser, input, strlen(input), NULL);
   if (err < 0)
   {
     fprintf(stderr, "Error %d after parser_init\n", err);
@@ -358,7 +358,7 @@ HAPLO_TEST(interpreter_test, math)
   }
 
   Interpreter interpreter = {0};
-  interpreter_init(&interpreter);
+  interpreter_init(&interpreter, NULL);
   Value val = interpreter_interpret(&interpreter, expr);
   if (val.type == HAPLO_VAL_ERROR)
   {
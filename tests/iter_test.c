@@ -0,0 +1,271 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#define HAPLO_NO_PREFIX
+#include "../haplo.h"
+#include "tests.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+// Parses and interprets input
+static Value iter_test_eval(Interpreter *interpreter, char *input)
+{
+  Parser parser = {0};
+  if (parser_init(&parser, input, strlen(input), NULL) < 0)
+    return (Value) { .type = HAPLO_VAL_ERROR, .value.error = HAPLO_ERROR_PARSER_NULL };
+
+  Expr *expr = parser_parse(&parser);
+  Value val = interpreter_interpret(interpreter, expr);
+  expr_free(expr);
+  return val;
+}
+
+// Walks iter and writes its integers to out, returns their number or
+// a negative error
+static int iter_test_walk(Iter *iter, Interpreter *interpreter,
+                          long *out, int out_len)
+{
+  IterCursor cursors[HAPLO_ITER_STACK_DEPTH];
+  iter_begin(iter, cursors);
+
+  Value val;
+  int count = 0, found;
+  while ((found = iter_next(cursors, interpreter, &val)) > 0)
+  {
+    if (val.type != HAPLO_VAL_INTEGER || count == out_len)
+    {
+      value_free(val);
+      return HAPLO_ERROR_INTERPRETER_INVALID_TYPE;
+    }
+    out[count++] = val.value.integer;
+  }
+  return (found < 0) ? found : count;
+}
+
+HAPLO_TEST(iter_test, range)
+{
+  long values[8];
+  int err = 0;
+  Iter *down = iter_range(10, 0, -4, &err);
+  int count = iter_test_walk(down, NULL, values, 8);
+  if (count != 3 || values[0] != 10 || values[1] != 6 || values[2] != 2)
+  {
+    fprintf(stderr, "Error wrong descending range, got %d values\n", count);
+    iter_free(down);
+    goto cleanup_failed;
+  }
+
+  // An iterator can be walked again
+  count = iter_test_walk(down, NULL, values, 8);
+  iter_free(down);
+  if (count != 3)
+  {
+    fprintf(stderr, "Error the second walk got %d values\n", count);
+    goto cleanup_failed;
+  }
+
+  Iter *last = iter_range(LONG_MAX - 1, LONG_MAX, 2, &err);
+  count = iter_test_walk(last, NULL, values, 8);
+  iter_free(last);
+  if (count != 1 || values[0] != LONG_MAX - 1)
+  {
+    fprintf(stderr, "Error the range did not stop before overflowing\n");
+    goto cleanup_failed;
+  }
+
+  Iter *empty = iter_range(0, 5, -1, &err);
+  count = iter_test_walk(empty, NULL, values, 8);
+  iter_free(empty);
+  if (count != 0)
+  {
+    fprintf(stderr, "Error a range going away from its end has values\n");
+    goto cleanup_failed;
+  }
+
+  Iter *still = iter_range(0, 5, 0, &err);
+  if (still || err != HAPLO_ERROR_INVALID_ARGUMENT)
+  {
+    fprintf(stderr, "Error a range with a step of 0 was created\n");
+    iter_free(still);
+    goto cleanup_failed;
+  }
+
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  HAPLO_TEST_FAILED;
+}
+
+HAPLO_TEST(iter_test, stages)
+{
+  Interpreter interpreter = {0};
+  Value val = {0};
+  interpreter_init(&interpreter, NULL);
+
+  val = iter_test_eval(&interpreter, "(defunc 'small 'n (< (n) 4))");
+  if (val.type != HAPLO_VAL_EMPTY)
+  {
+    fprintf(stderr, "Error in defunc with a parameter\n");
+    goto cleanup_failed;
+  }
+
+  // The range is never materialized
+  val = iter_test_eval(&interpreter,
+                       "(iter-take 2 (iter-map '- (iter-filter 'small (range 1000000))))");
+  if (val.type != HAPLO_VAL_ITER || val.value.iter->depth != 4)
+  {
+    fprintf(stderr, "Error expected an iterator of 4 stages, got %s\n",
+            value_type_string(val.type));
+    goto cleanup_failed;
+  }
+
+  long values[8];
+  int count = iter_test_walk(val.value.iter, &interpreter, values, 8);
+  if (count != 2 || values[0] != 0 || values[1] != -1)
+  {
+    fprintf(stderr, "Error wrong values of the iterator, got %d values\n", count);
+    goto cleanup_failed;
+  }
+  value_free(val);
+
+  val = iter_test_eval(&interpreter, "(iter-filter '+ (list 1 2))");
+  count = iter_test_walk(val.value.iter, &interpreter, values, 8);
+  if (count != HAPLO_ERROR_INTERPRETER_INVALID_TYPE)
+  {
+    fprintf(stderr, "Error filter accepted a function that does not return a bool\n");
+    goto cleanup_failed;
+  }
+  value_free(val);
+
+  val = iter_test_eval(&interpreter, "(range 1 2 0)");
+  if (val.type != HAPLO_VAL_ERROR || val.value.error != HAPLO_ERROR_INVALID_ARGUMENT)
+  {
+    fprintf(stderr, "Error range accepted a step of 0\n");
+    goto cleanup_failed;
+  }
+
+  interpreter_destroy(&interpreter);
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  value_free(val);
+  interpreter_destroy(&interpreter);
+  HAPLO_TEST_FAILED;
+}
+
+HAPLO_TEST(iter_test, for_each)
+{
+  Interpreter interpreter = {0};
+  Value val = {0};
+  interpreter_init(&interpreter, NULL);
+
+  val = iter_test_eval(&interpreter, "(setq 'total 0)");
+  value_free(val);
+  val = iter_test_eval(&interpreter, "(setq 'i \"outer\")");
+  value_free(val);
+
+  val = iter_test_eval(&interpreter,
+                       "(for-each 'i (range 1 5) (setq 'total (+ (total) (i))))");
+  if (val.type != HAPLO_VAL_EMPTY)
+  {
+    fprintf(stderr, "Error in for-each, got %s\n", value_type_string(val.type));
+    goto cleanup_failed;
+  }
+
+  val = iter_test_eval(&interpreter, "(total)");
+  if (val.type != HAPLO_VAL_INTEGER || val.value.integer != 10)
+  {
+    fprintf(stderr, "Error wrong sum of the range\n");
+    goto cleanup_failed;
+  }
+
+  // The variable shadowed by the loop is restored
+  val = iter_test_eval(&interpreter, "(i)");
+  if (val.type != HAPLO_VAL_STRING || strcmp(value_text(&val), "outer") != 0)
+  {
+    fprintf(stderr, "Error the loop variable was not restored\n");
+    goto cleanup_failed;
+  }
+  value_free(val);
+
+  val = iter_test_eval(&interpreter, "(for-each 'i 3 (i))");
+  if (val.type != HAPLO_VAL_ERROR
+      || val.value.error != HAPLO_ERROR_INTERPRETER_INVALID_TYPE)
+  {
+    fprintf(stderr, "Error for-each walked an integer\n");
+    goto cleanup_failed;
+  }
+
+  interpreter_destroy(&interpreter);
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  value_free(val);
+  interpreter_destroy(&interpreter);
+  HAPLO_TEST_FAILED;
+}
+
+HAPLO_TEST(iter_test, higher_order)
+{
+  Interpreter interpreter = {0};
+  Value val = {0};
+  interpreter_init(&interpreter, NULL);
+
+  val = iter_test_eval(&interpreter, "(defunc 'odd 'n (= (- (n) (* (/ (n) 2) 2)) 1))");
+  value_free(val);
+  val = iter_test_eval(&interpreter, "(setq 'xs (vector 1 2 3 4 5))");
+  value_free(val);
+
+  // The filter runs in the same pass as the reduce
+  val = iter_test_eval(&interpreter, "(reduce '+ (filter 'odd (xs)))");
+  if (val.type != HAPLO_VAL_INTEGER || val.value.integer != 9)
+  {
+    fprintf(stderr, "Error in a fused reduce, got %s\n", value_type_string(val.type));
+    goto cleanup_failed;
+  }
+
+  val = iter_test_eval(&interpreter, "(fold '- 0 (mapcar '- (filter 'odd (xs))))");
+  if (val.type != HAPLO_VAL_INTEGER || val.value.integer != 9)
+  {
+    fprintf(stderr, "Error in a fused fold\n");
+    goto cleanup_failed;
+  }
+
+  // The result has the type of the sequence that feeds it
+  char buf[64] = {0};
+  val = iter_test_eval(&interpreter, "(mapcar '- (filter 'odd (list 1 2 3)))");
+  value_string(val, buf, sizeof(buf));
+  if (val.type != HAPLO_VAL_LIST || strcmp(buf, "list: -1 -3 ") != 0)
+  {
+    fprintf(stderr, "Error expected a list, got %s\n", buf);
+    goto cleanup_failed;
+  }
+  value_free(val);
+
+  val = iter_test_eval(&interpreter, "(filter 'odd (range 10))");
+  if (val.type != HAPLO_VAL_ITER)
+  {
+    fprintf(stderr, "Error filter did not stay lazy over an iterator\n");
+    goto cleanup_failed;
+  }
+  value_free(val);
+
+  val = iter_test_eval(&interpreter, "(reduce '+ (filter 'odd (list 2 4)))");
+  if (val.type != HAPLO_VAL_ERROR || val.value.error != HAPLO_ERROR_LIST_EMPTY)
+  {
+    fprintf(stderr, "Error reduced an empty sequence\n");
+    goto cleanup_failed;
+  }
+
+  interpreter_destroy(&interpreter);
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  value_free(val);
+  interpreter_destroy(&interpreter);
+  HAPLO_TEST_FAILED;
+}
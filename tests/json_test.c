@@ -0,0 +1,313 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#define HAPLO_NO_PREFIX
+#include "../haplo.h"
+#include "tests.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Parses text and writes it back into builder, returns 0 or an error
+static int json_test_round_trip(const char *text, int len, StringBuilder *builder)
+{
+  HaploValue value = json_parse(text, len, NULL);
+  if (value.type == HAPLO_VAL_ERROR) return value.value.error;
+  int err = json_stringify(builder, value);
+  value_free(value);
+  return err;
+}
+
+HAPLO_TEST(json_test, parse)
+{
+  struct {
+    const char *text;
+    const char *expected;
+  } cases[] = {
+    { "0", "0" },
+    { " -12 ", "-12" },
+    { "9223372036854775807", "9223372036854775807" },
+    { "-9223372036854775808", "-9223372036854775808" },
+    { "9223372036854775808", "9223372036854775808" },
+    { "-123456789012345678901234567890", "-123456789012345678901234567890" },
+    { "1e-400", "0.0" },
+    { "1.5", "1.5" },
+    { "-2.5e3", "-2500.0" },
+    { "true", "true" },
+    { "false", "false" },
+    { "null", "null" },
+    { "\"\"", "\"\"" },
+    { "\"plain\"", "\"plain\"" },
+    { "\"a\\\"b\\\\c\\/d\\n\"", "\"a\\\"b\\\\c/d\\n\"" },
+    { "\"\\u00e9\\u20ac\\ud83d\\ude00\"", "\"\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\"" },
+    { "\"\\u0001\"", "\"\\u0001\"" },
+    { "[]", "[]" },
+    { "{}", "{}" },
+    { "[1, [2, [3, []]], \"x\"]", "[1,[2,[3,[]]],\"x\"]" },
+    { "{\"a\": [true, null]}", "{\"a\":[true,null]}" },
+    { "{\"a\": 1, \"a\": 2}", "{\"a\":2}" },
+    { " [ 1 ,\n\t2\r] ", "[1,2]" },
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i)
+  {
+    StringBuilder builder = {0};
+    int err = json_test_round_trip(cases[i].text, strlen(cases[i].text), &builder);
+    int len = (err == 0 && builder.string) ? builder.string->len : 0;
+    const char *got = (len > 0) ? builder.string->buffer : "";
+    if (err < 0 || len != (int) strlen(cases[i].expected)
+        || memcmp(got, cases[i].expected, len) != 0)
+    {
+      fprintf(stderr, "Error parsing %s, got %.*s (%s)\n", cases[i].text, len, got,
+              error_string(err));
+      string_builder_free(&builder);
+      HAPLO_TEST_FAILED;
+    }
+    string_builder_free(&builder);
+  }
+  HAPLO_TEST_SUCCESS;
+}
+
+HAPLO_TEST(json_test, invalid)
+{
+  const char *cases[] = {
+    "",
+    "   ",
+    "[",
+    "[1,]",
+    "[1 2]",
+    "{\"a\" 1}",
+    "{\"a\": 1,}",
+    "{1: 2}",
+    "\"open",
+    "\"a\\x\"",
+    "\"\\ud83d\"",
+    "\"\\ude00\"",
+    "\"\\u12\"",
+    "\"tab\there\"",
+    "01",
+    "1.",
+    ".5",
+    "-",
+    "1e",
+    "+1",
+    "tru",
+    "truex",
+    "nul",
+    "1 2",
+    "[] []",
+    "{\"a\": 1}}",
+    "]",
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i)
+  {
+    HaploValue value = json_parse(cases[i], strlen(cases[i]), NULL);
+    if (value.type != HAPLO_VAL_ERROR || value.value.error != HAPLO_ERROR_JSON_SYNTAX)
+    {
+      fprintf(stderr, "Error parsed invalid %s\n", cases[i]);
+      value_free(value);
+      HAPLO_TEST_FAILED;
+    }
+  }
+
+  // Numbers JSON could not write back
+  const char *out_of_range[] = { "1e400", "[-1.5e309]" };
+  for (size_t i = 0; i < sizeof(out_of_range) / sizeof(out_of_range[0]); ++i)
+  {
+    HaploValue value = json_parse(out_of_range[i], strlen(out_of_range[i]), NULL);
+    if (value.type != HAPLO_VAL_ERROR || value.value.error != HAPLO_ERROR_OUT_OF_RANGE)
+    {
+      fprintf(stderr, "Error parsed %s, out of the range of a double\n", out_of_range[i]);
+      value_free(value);
+      HAPLO_TEST_FAILED;
+    }
+  }
+
+  HaploValue value = json_parse("\"\xff\"", 3, NULL);
+  if (value.type != HAPLO_VAL_ERROR || value.value.error != HAPLO_ERROR_INVALID_UTF8)
+  {
+    fprintf(stderr, "Error parsed invalid UTF-8\n");
+    value_free(value);
+    HAPLO_TEST_FAILED;
+  }
+
+  // Too deep
+  char deep[2 * (HAPLO_JSON_DEPTH_MAX + 1)];
+  memset(deep, '[', HAPLO_JSON_DEPTH_MAX + 1);
+  memset(deep + HAPLO_JSON_DEPTH_MAX + 1, ']', HAPLO_JSON_DEPTH_MAX + 1);
+  value = json_parse(deep, sizeof(deep), NULL);
+  if (value.type != HAPLO_VAL_ERROR)
+  {
+    fprintf(stderr, "Error parsed a document too deep\n");
+    value_free(value);
+    HAPLO_TEST_FAILED;
+  }
+  value = json_parse(deep + 1, sizeof(deep) - 2, NULL);
+  if (value.type == HAPLO_VAL_ERROR)
+  {
+    fprintf(stderr, "Error parsing a document %d deep\n", HAPLO_JSON_DEPTH_MAX);
+    HAPLO_TEST_FAILED;
+  }
+  value_free(value);
+  HAPLO_TEST_SUCCESS;
+}
+
+// Random strings of quotes, backslashes and letters, escaped and
+// unescaped, at every offset in the 64 byte blocks of the scan
+HAPLO_TEST(json_test, strings)
+{
+  const char letters[] = { 'a', '"', '\\', '/', '\n', ' ', ',', '[', '{', ':' };
+  char raw[200];
+  char text[512];
+  srand(7);
+  for (int round = 0; round < 20000; ++round)
+  {
+    int pad = rand() % 64;
+    int raw_len = rand() % 150;
+    for (int i = 0; i < raw_len; ++i)
+      raw[i] = letters[rand() % sizeof(letters)];
+
+    // ["<pad spaces>", "<raw escaped>"]
+    StringBuilder expected = {0};
+    int len = 0;
+    text[len++] = '[';
+    for (int i = 0; i < pad; ++i) text[len++] = ' ';
+    text[len++] = '"';
+    for (int i = 0; i < raw_len; ++i)
+    {
+      if (raw[i] == '"' || raw[i] == '\\') text[len++] = '\\';
+      if (raw[i] == '\n')
+      {
+        text[len++] = '\\';
+        text[len++] = 'n';
+        continue;
+      }
+      text[len++] = raw[i];
+    }
+    text[len++] = '"';
+    text[len++] = ']';
+
+    StringBuilder got = {0};
+    int err = json_test_round_trip(text, len, &got);
+    if (err == 0)
+    {
+      err = string_builder_append(&expected, "[", 1);
+      if (err == 0) err = string_builder_append(&expected, text + 1 + pad, len - 1 - pad);
+    }
+    if (err < 0 || got.string->len != expected.string->len
+        || memcmp(got.string->buffer, expected.string->buffer, got.string->len) != 0)
+    {
+      fprintf(stderr, "Error round %d parsing %.*s (%s)\n", round, len, text,
+              error_string(err));
+      string_builder_free(&got);
+      string_builder_free(&expected);
+      HAPLO_TEST_FAILED;
+    }
+    string_builder_free(&got);
+    string_builder_free(&expected);
+
+    // Without its closing quote the string never ends
+    text[len - 2] = ' ';
+    HaploValue value = json_parse(text, len, NULL);
+    if (value.type != HAPLO_VAL_ERROR)
+    {
+      fprintf(stderr, "Error round %d parsed an open string\n", round);
+      value_free(value);
+      HAPLO_TEST_FAILED;
+    }
+  }
+  HAPLO_TEST_SUCCESS;
+}
+
+HAPLO_TEST(json_test, shared)
+{
+  // Long strings without escapes share the bytes of the source
+  const char *text = "{\"key\": \"a string longer than the inline bytes of a value\"}";
+  HaploValue source = value_text_new(HAPLO_VAL_STRING, text, strlen(text));
+  HaploValue value = json_parse(value_text(&source), value_text_len(&source), &source);
+  value_free(source);
+  if (value.type != HAPLO_VAL_MAP)
+  {
+    fprintf(stderr, "Error parsing %s\n", text);
+    value_free(value);
+    HAPLO_TEST_FAILED;
+  }
+  HaploValue key = value_text_new(HAPLO_VAL_STRING, "key", 3);
+  HaploValue *got = map_get(value.value.map, key);
+  value_free(key);
+  if (!got || got->type != HAPLO_VAL_STRING
+      || !got->value.string->parent || value_text_len(got) != 48
+      || memcmp(value_text(got), "a string longer than the inline bytes of a value", 48) != 0)
+  {
+    fprintf(stderr, "Error the value of key is wrong\n");
+    value_free(value);
+    HAPLO_TEST_FAILED;
+  }
+  value_free(value);
+  HAPLO_TEST_SUCCESS;
+}
+
+HAPLO_TEST(json_test, write)
+{
+  // Written to a file in chunks, bigger than one
+  HaploVector *vector = vector_new(0);
+  if (!vector) HAPLO_TEST_FAILED;
+  HaploValue value = { .type = HAPLO_VAL_VECTOR, .value.vector = vector };
+  for (int i = 0; i < 20000; ++i)
+  {
+    HaploValue item = { .type = HAPLO_VAL_INTEGER, .value.integer = 1000000 + i };
+    if (vector_push(vector, item) < 0) goto cleanup_failed;
+  }
+
+  FILE *file = tmpfile();
+  if (!file) goto cleanup_failed;
+  StringBuilder builder = {0};
+  int err = json_write(file, value);
+  if (err == 0) err = json_stringify(&builder, value);
+  long size = ftell(file);
+  if (err < 0 || size != builder.string->len)
+  {
+    fprintf(stderr, "Error wrote %ld bytes and not %d (%s)\n", size,
+            builder.string ? builder.string->len : 0, error_string(err));
+    fclose(file);
+    string_builder_free(&builder);
+    goto cleanup_failed;
+  }
+  char *written = malloc(size);
+  rewind(file);
+  bool same = written && fread(written, 1, size, file) == (size_t) size
+    && memcmp(written, builder.string->buffer, size) == 0;
+  free(written);
+  fclose(file);
+  string_builder_free(&builder);
+  if (!same)
+  {
+    fprintf(stderr, "Error the file and the string differ\n");
+    goto cleanup_failed;
+  }
+
+  // Keys must be text
+  HaploMap *map = map_new();
+  if (!map) goto cleanup_failed;
+  HaploValue object = { .type = HAPLO_VAL_MAP, .value.map = map };
+  map_put(map, (HaploValue) { .type = HAPLO_VAL_INTEGER, .value.integer = 1 },
+          (HaploValue) { .type = HAPLO_VAL_EMPTY });
+  err = json_stringify(&builder, object);
+  string_builder_free(&builder);
+  value_free(object);
+  if (err != HAPLO_ERROR_INTERPRETER_INVALID_TYPE)
+  {
+    fprintf(stderr, "Error wrote a map with an integer key\n");
+    goto cleanup_failed;
+  }
+
+  value_free(value);
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  value_free(value);
+  HAPLO_TEST_FAILED;
+}
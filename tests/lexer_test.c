@@ -196,6 +196,23 @@ HAPLO_TEST(lexer_test, next)
     }
   }
 
+  {
+    // A cut UTF-8 sequence
+    char *input = "\"caf\xc3\"";
+    Lexer l;
+    lexer_init(&l, input, strlen(input), &haplo_default_token_char);
+
+    Token token;
+    Atom atom;
+    int ret = lexer_next(&l, &token, &atom);
+    if (ret != HAPLO_ERROR_INVALID_UTF8)
+    {
+      fprintf(stderr, "Error lexer_next_token on \"%s\", expected error %d, got %d\n",
+              input, HAPLO_ERROR_INVALID_UTF8, ret);
+      goto test_failed;
+    }
+  }
+
   HAPLO_TEST_SUCCESS;
 
  test_failed:
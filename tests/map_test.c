@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#define HAPLO_NO_PREFIX
+#include "../haplo.h"
+#include "tests.h"
+
+#include <stdio.h>
+
+HAPLO_TEST(map_test, put_get_del)
+{
+  Map *map = map_new();
+  if (!map)
+  {
+    fprintf(stderr, "Error map_new returned NULL\n");
+    goto test_failed;
+  }
+
+  // Enough keys to resize the table a few times
+  int count = 16 * HAPLO_MAP_MIN_CAPACITY;
+  for (int i = 0; i < count; ++i)
+  {
+    int err = map_put(map, (Value) { .type = HAPLO_VAL_INTEGER, .value.integer = i },
+                      (Value) { .type = HAPLO_VAL_INTEGER, .value.integer = i * 2 });
+    if (err < 0)
+    {
+      fprintf(stderr, "Error %s in map_put\n", error_string(err));
+      map_free(map);
+      goto test_failed;
+    }
+  }
+
+  // Deleting every other key leaves deleted slots behind
+  for (int i = 0; i < count; i += 2)
+    map_del(map, (Value) { .type = HAPLO_VAL_INTEGER, .value.integer = i });
+
+  if (map_size(map) != count / 2)
+  {
+    fprintf(stderr, "Error wrong map size %d\n", map_size(map));
+    map_free(map);
+    goto test_failed;
+  }
+
+  for (int i = 0; i < count; ++i)
+  {
+    Value *val = map_get(map, (Value) { .type = HAPLO_VAL_INTEGER, .value.integer = i });
+    if ((i % 2 == 0 && val) || (i % 2 == 1 && (!val || val->value.integer != i * 2)))
+    {
+      fprintf(stderr, "Error wrong value for key %d\n", i);
+      map_free(map);
+      goto test_failed;
+    }
+  }
+
+  map_free(map);
+  HAPLO_TEST_SUCCESS;
+ test_failed:
+  HAPLO_TEST_FAILED;
+}
+
+HAPLO_TEST(map_test, structural_keys)
+{
+  Value a = { .type = HAPLO_VAL_STRING, .value.string = string_from_cstr("key") };
+  Value b = { .type = HAPLO_VAL_STRING, .value.string = string_from_cstr("key") };
+  Value quote = { .type = HAPLO_VAL_QUOTE, .value.quote = "key" };
+  Value zero = { .type = HAPLO_VAL_FLOAT, .value.floating_point = 0.0 };
+  Value negative_zero = { .type = HAPLO_VAL_FLOAT, .value.floating_point = -0.0 };
+
+  if (!value_equal(a, b) || value_hash(a) != value_hash(b))
+  {
+    fprintf(stderr, "Error equal strings must have the same hash\n");
+    goto test_failed;
+  }
+  if (value_equal(a, quote))
+  {
+    fprintf(stderr, "Error a string and a quote must differ\n");
+    goto test_failed;
+  }
+  if (!value_equal(zero, negative_zero)
+      || value_hash(zero) != value_hash(negative_zero))
+  {
+    fprintf(stderr, "Error 0.0 and -0.0 must be the same key\n");
+    goto test_failed;
+  }
+
+  value_free(a);
+  value_free(b);
+  HAPLO_TEST_SUCCESS;
+ test_failed:
+  value_free(a);
+  value_free(b);
+  HAPLO_TEST_FAILED;
+}
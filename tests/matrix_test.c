@@ -0,0 +1,137 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#define HAPLO_NO_PREFIX
+#include "../haplo.h"
+#include "tests.h"
+
+#include <stdio.h>
+
+// Sizes that are not multiples of the block, so that the product
+// goes through partial blocks
+HAPLO_TEST(matrix_test, mul)
+{
+  int error = 0;
+  Matrix *a = matrix_new(70, HAPLO_MATRIX_BLOCK + 3);
+  Matrix *b = matrix_new(HAPLO_MATRIX_BLOCK + 3, 33);
+  Matrix *c = NULL, *t = NULL;
+  if (!a || !b) goto cleanup_failed;
+
+  // Small integers, so the sums are exact in any order
+  for (int i = 0; i < a->rows; ++i)
+    for (int j = 0; j < a->cols; ++j)
+      matrix_at(a, i, j) = (i + 2 * j) % 7 - 3;
+  for (int i = 0; i < b->rows; ++i)
+    for (int j = 0; j < b->cols; ++j)
+      matrix_at(b, i, j) = (3 * i + j) % 5 - 2;
+
+  c = matrix_mul(a, b, &error);
+  t = matrix_transpose(a, &error);
+  if (!c || !t) goto cleanup_failed;
+
+  for (int i = 0; i < a->rows; ++i)
+  {
+    for (int j = 0; j < b->cols; ++j)
+    {
+      double expected = 0;
+      for (int k = 0; k < a->cols; ++k)
+        expected += matrix_at(a, i, k) * matrix_at(b, k, j);
+      if (matrix_at(c, i, j) != expected)
+      {
+        fprintf(stderr, "Error wrong product at %d %d: expected %f, got %f\n",
+                i, j, expected, matrix_at(c, i, j));
+        goto cleanup_failed;
+      }
+    }
+    for (int j = 0; j < a->cols; ++j)
+    {
+      if (matrix_at(t, j, i) != matrix_at(a, i, j))
+      {
+        fprintf(stderr, "Error wrong transpose at %d %d\n", i, j);
+        goto cleanup_failed;
+      }
+    }
+  }
+
+  Matrix *wrong = matrix_mul(a, a, &error);
+  if (wrong || error != HAPLO_ERROR_LENGTH_MISMATCH)
+  {
+    fprintf(stderr, "Error multiplied matrices of the wrong sizes\n");
+    matrix_free(wrong);
+    goto cleanup_failed;
+  }
+
+  matrix_free(a);
+  matrix_free(b);
+  matrix_free(c);
+  matrix_free(t);
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  matrix_free(a);
+  matrix_free(b);
+  matrix_free(c);
+  matrix_free(t);
+  HAPLO_TEST_FAILED;
+}
+
+HAPLO_TEST(matrix_test, views)
+{
+  int error = 0;
+  Matrix *m = matrix_new(4, 5);
+  Matrix *rows = NULL, *view = NULL, *sums[2] = {0};
+  if (!m) goto cleanup_failed;
+
+  for (int i = 0; i < m->rows; ++i)
+    for (int j = 0; j < m->cols; ++j)
+      matrix_at(m, i, j) = i * 10 + j;
+
+  // Rows 1 and 2, columns 2 to 4
+  rows = matrix_slice_rows(m, 1, 3, &error);
+  if (!rows) goto cleanup_failed;
+  view = matrix_slice_cols(rows, 2, 5, &error);
+  if (!view) goto cleanup_failed;
+  if (view->rows != 2 || view->cols != 3 || view->storage != m->storage
+      || matrix_at(view, 1, 0) != 22)
+  {
+    fprintf(stderr, "Error wrong view\n");
+    goto cleanup_failed;
+  }
+
+  // The views keep the elements alive
+  matrix_free(m);
+  matrix_free(rows);
+  m = rows = NULL;
+
+  sums[0] = matrix_sum(view, 0, &error);
+  sums[1] = matrix_sum(view, 1, &error);
+  if (!sums[0] || !sums[1]) goto cleanup_failed;
+  if (sums[0]->cols != 3 || matrix_at(sums[0], 0, 2) != 14 + 24
+      || sums[1]->rows != 2 || matrix_at(sums[1], 1, 0) != 22 + 23 + 24)
+  {
+    fprintf(stderr, "Error wrong sums of a view\n");
+    goto cleanup_failed;
+  }
+
+  if (matrix_slice_cols(view, 2, 4, &error)
+      || error != HAPLO_ERROR_INDEX_OUT_OF_BOUNDS)
+  {
+    fprintf(stderr, "Error sliced out of bounds\n");
+    goto cleanup_failed;
+  }
+
+  matrix_free(view);
+  matrix_free(sums[0]);
+  matrix_free(sums[1]);
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  matrix_free(m);
+  matrix_free(rows);
+  matrix_free(view);
+  matrix_free(sums[0]);
+  matrix_free(sums[1]);
+  HAPLO_TEST_FAILED;
+}
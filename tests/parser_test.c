@@ -17,7 +17,7 @@ HAPLO_TEST(parser_test, simple1)
   char* expected = "( c ( ( a ( ( b ) ) ) ) )";
   
   Parser parser = {0};
-  err = parser_init(&parser, input, strlen(input));
+  err = parser_init(&parser, input, strlen(input), NULL);
   if (err < 0)
   {
     fprintf(stderr, "Error %d after parser_init\n", err);
@@ -62,7 +62,7 @@ HAPLO_TEST(parser_test, no_parenthesis)
   char* expected = "( + ( 1 ( * ( 2 ( 3 ) ) ) ) )";
   
   Parser parser = {0};
-  err = parser_init(&parser, input, strlen(input));
+  err = parser_init(&parser, input, strlen(input), NULL);
   if (err < 0)
   {
     fprintf(stderr, "Error %d after parser_init\n", err);
@@ -111,7 +111,7 @@ HAPLO_TEST(parser_test, malformed_parenthesis)
   }
   
   Parser parser = {0};
-  err = parser_init(&parser, input, strlen(input));
+  err = parser_init(&parser, input, strlen(input), NULL);
   if (err < 0)
   {
     fprintf(stderr, "Error %d after parser_init\n", err);
@@ -138,7 +138,7 @@ HAPLO_TEST(parser_test, simple2)
   char* expected_ast = "( + ( 2 ( 3 ) ) )";
 
   Parser parser = {0};
-  err = parser_init(&parser, input, strlen(input));
+  err = parser_init(&parser, input, strlen(input), NULL);
   if (err < 0)
   {
     fprintf(stderr, "Error %d after parser_init\n", err);
@@ -186,7 +186,7 @@ HAPLO_TEST(parser_test, hello_world)
   char* input = "( print \"Hello, World! )";
 
   Parser parser = {0};
-  err = parser_init(&parser, input, strlen(input));
+  err = parser_init(&parser, input, strlen(input), NULL);
   if (err < 0)
   {
     fprintf(stderr, "Error %d after parser_init\n", err);
@@ -219,7 +219,7 @@ HAPLO_TEST(parser_test, hello_world_no_parenthesis)
   char* expected_ast = "( print ( \"Hello, World!\" ) )";
   
   Parser parser = {0};
-  err = parser_init(&parser, input, strlen(input));
+  err = parser_init(&parser, input, strlen(input), NULL);
   if (err < 0)
   {
     fprintf(stderr, "Error %d after parser_init\n", err);
@@ -268,7 +268,7 @@ HAPLO_TEST(parser_test, comment)
   }
   
   Parser parser = {0};
-  err = parser_init(&parser, input, strlen(input));
+  err = parser_init(&parser, input, strlen(input), NULL);
   if (err < 0)
   {
     fprintf(stderr, "Error %d after parser_init\n", err);
@@ -296,7 +296,7 @@ HAPLO_TEST(parser_test, nested_expr)
   char* expected_ast = "( * ( ( ( + ( 1 ( 2 ) ) ) ( 3 ) ) ) )";
   
   Parser parser = {0};
-  err = parser_init(&parser, input, strlen(input));
+  err = parser_init(&parser, input, strlen(input), NULL);
   if (err < 0)
   {
     fprintf(stderr, "Error %d after parser_init\n", err);
@@ -345,7 +345,7 @@ HAPLO_TEST(parser_test, nested_head_expr)
   char* expected_ast = "( * ( ( + ( 1 ( 2 ) ) ) ( 3 ) ) )";
   
   Parser parser = {0};
-  err = parser_init(&parser, input, strlen(input));
+  err = parser_init(&parser, input, strlen(input), NULL);
   if (err < 0)
   {
     fprintf(stderr, "Error %d after parser_init\n", err);
@@ -395,7 +395,7 @@ HAPLO_TEST(parser_test, quote)
   char* expected_ast = "( 'a )";
   
   Parser parser = {0};
-  err = parser_init(&parser, input, strlen(input));
+  err = parser_init(&parser, input, strlen(input), NULL);
   if (err < 0)
   {
     fprintf(stderr, "Error %d after parser_init\n", err);
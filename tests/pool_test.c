@@ -0,0 +1,164 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#define HAPLO_NO_PREFIX
+#include "../haplo.h"
+#include "../pool.h"
+#include "tests.h"
+
+#include <stdio.h>
+
+HAPLO_TEST(pool_test, alloc_free_reuse)
+{
+  Pool pool;
+  int err = pool_init(&pool, sizeof(ValueList), NULL);
+  if (err < 0)
+  {
+    fprintf(stderr, "Pool init returned error %s\n", error_string(err));
+    goto test_failed;
+  }
+
+  void *first = pool_alloc(&pool);
+  void *second = pool_alloc(&pool);
+  if (!first || !second || first == second)
+  {
+    fprintf(stderr, "Error pool_alloc returned invalid cells\n");
+    pool_destroy(&pool);
+    goto test_failed;
+  }
+
+  pool_free(first);
+  void *third = pool_alloc(&pool);
+  if (third != first)
+  {
+    fprintf(stderr, "Error freed cell was not reused\n");
+    pool_destroy(&pool);
+    goto test_failed;
+  }
+
+  pool_destroy(&pool);
+  if (pool.slabs || pool.free_list)
+  {
+    fprintf(stderr, "Error destroy did not release the slabs\n");
+    goto test_failed;
+  }
+
+  HAPLO_TEST_SUCCESS;
+ test_failed:
+  HAPLO_TEST_FAILED;
+}
+
+HAPLO_TEST(pool_test, free_to_owner)
+{
+  Pool a, b;
+  pool_init(&a, sizeof(ValueList), NULL);
+  pool_init(&b, sizeof(ValueList), NULL);
+
+  // Allocate more cells than a single slab holds
+  int count = 2 * HAPLO_POOL_SLAB_SIZE / (int) a.cell_size;
+  ValueList *list = NULL;
+  Pool *prev = value_list_pool_bind(&a);
+  for (int i = 0; i < count; ++i)
+  {
+    list = value_list_push_front((Value) {
+        .type = HAPLO_VAL_INTEGER,
+        .value.integer = i,
+      }, list);
+  }
+
+  // Cells must go back to a even if b is bound
+  value_list_pool_bind(&b);
+  if (value_list_len(list) != count)
+  {
+    fprintf(stderr, "Error list length is %d instead of %d\n",
+            value_list_len(list), count);
+    value_list_pool_bind(prev);
+    pool_destroy(&a);
+    pool_destroy(&b);
+    goto test_failed;
+  }
+  value_list_free(list);
+  if (b.free_list != NULL || a.free_list == NULL)
+  {
+    fprintf(stderr, "Error cells were not returned to their pool\n");
+    value_list_pool_bind(prev);
+    pool_destroy(&a);
+    pool_destroy(&b);
+    goto test_failed;
+  }
+
+  value_list_pool_bind(prev);
+  pool_destroy(&a);
+  pool_destroy(&b);
+  HAPLO_TEST_SUCCESS;
+ test_failed:
+  HAPLO_TEST_FAILED;
+}
+
+HAPLO_TEST(pool_test, release_default)
+{
+  // Cells allocated with no pool bound come from the default pool of
+  // the thread, which can be released and used again
+  Pool *prev = value_list_pool_bind(NULL);
+  for (int round = 0; round < 2; ++round)
+  {
+    ValueList *list = NULL;
+    for (int i = 0; i < 100; ++i)
+      list = value_list_push_front((Value) { .type = HAPLO_VAL_INTEGER,
+                                             .value.integer = i }, list);
+    if (value_list_len(list) != 100)
+    {
+      fprintf(stderr, "Error round %d list length is %d\n", round,
+              value_list_len(list));
+      value_list_free(list);
+      value_list_pool_release();
+      value_list_pool_bind(prev);
+      goto test_failed;
+    }
+    value_list_free(list);
+    value_list_pool_release();
+  }
+
+  value_list_pool_bind(prev);
+  HAPLO_TEST_SUCCESS;
+ test_failed:
+  HAPLO_TEST_FAILED;
+}
+
+HAPLO_TEST(pool_test, destroy_keeps_default)
+{
+  // Destroying an interpreter must not release the default pool, the
+  // lists made outside of it may still be used by another interpreter
+  Interpreter a = {0}, b = {0};
+  if (interpreter_init(&a, NULL) < 0)
+    goto test_failed;
+  if (interpreter_init(&b, NULL) < 0)
+  {
+    interpreter_destroy(&a);
+    goto test_failed;
+  }
+
+  ValueList *args = NULL;
+  for (int i = 0; i < 100; ++i)
+    args = value_list_push_front((Value) { .type = HAPLO_VAL_INTEGER,
+                                           .value.integer = i }, args);
+  interpreter_destroy(&a);
+
+  int sum = 0;
+  for (ValueList *it = args; it; it = it->next)
+    sum += (int) it->val.value.integer;
+  value_list_free(args);
+  interpreter_destroy(&b);
+  value_list_pool_release();
+  if (sum != 99 * 100 / 2)
+  {
+    fprintf(stderr, "Error list sum is %d after destroy\n", sum);
+    goto test_failed;
+  }
+
+  HAPLO_TEST_SUCCESS;
+ test_failed:
+  HAPLO_TEST_FAILED;
+}
@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#define HAPLO_NO_PREFIX
+#include "../haplo.h"
+#include "tests.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Parses and interprets input
+static Value record_test_eval(Interpreter *interpreter, char *input)
+{
+  Parser parser = {0};
+  if (parser_init(&parser, input, strlen(input), NULL) < 0)
+    return (Value) { .type = HAPLO_VAL_ERROR, .value.error = HAPLO_ERROR_PARSER_NULL };
+
+  Expr *expr = parser_parse(&parser);
+  Value val = interpreter_interpret(interpreter, expr);
+  expr_free(expr);
+  return val;
+}
+
+HAPLO_TEST(record_test, fields)
+{
+  Interpreter interpreter = {0};
+  Value val = {0};
+  interpreter_init(&interpreter, NULL);
+
+  val = record_test_eval(&interpreter, "(defrecord 'point 'x 'y)");
+  if (val.type != HAPLO_VAL_EMPTY)
+  {
+    fprintf(stderr, "Error in defrecord, got %s\n", value_type_string(val.type));
+    goto cleanup_failed;
+  }
+
+  Symbol symbol;
+  if (symbol_map_lookup(interpreter.symbol_map, "set-point-y", &symbol) < 0
+      || symbol.type != HAPLO_SYMBOL_RECORD_SET || symbol.slot != 1)
+  {
+    fprintf(stderr, "Error set-point-y is not the setter of slot 1\n");
+    goto cleanup_failed;
+  }
+
+  val = record_test_eval(&interpreter, "(setq 'p (point 1 2))");
+  value_free(val);
+  val = record_test_eval(&interpreter, "(set-point-y 5 p)");
+  if (val.type != HAPLO_VAL_RECORD || val.value.record->shape != symbol.shape)
+  {
+    fprintf(stderr, "Error in set-point-y, got %s\n", value_type_string(val.type));
+    goto cleanup_failed;
+  }
+  value_free(val);
+
+  // Records are shared by reference, p sees the new field
+  val = record_test_eval(&interpreter, "(point-y p)");
+  if (val.type != HAPLO_VAL_INTEGER || val.value.integer != 5)
+  {
+    fprintf(stderr, "Error in point-y, expected 5\n");
+    goto cleanup_failed;
+  }
+
+  char buf[64] = {0};
+  val = record_test_eval(&interpreter, "(point 3 \"a\")");
+  value_string(val, buf, sizeof(buf));
+  if (strcmp(buf, "point: x=3 y=\"a\" ") != 0)
+  {
+    fprintf(stderr, "Error in value_string, got %s\n", buf);
+    goto cleanup_failed;
+  }
+  value_free(val);
+
+  val = record_test_eval(&interpreter, "(point 1)");
+  if (val.type != HAPLO_VAL_ERROR
+      || val.value.error != HAPLO_ERROR_INTERPRETER_WRONG_NUMBER_OF_ARGS)
+  {
+    fprintf(stderr, "Error constructor accepted a missing field\n");
+    goto cleanup_failed;
+  }
+
+  // A record of another shape is rejected, even with the same fields
+  record_test_eval(&interpreter, "(defrecord 'other 'x 'y)");
+  val = record_test_eval(&interpreter, "(point-x (other 1 2))");
+  if (val.type != HAPLO_VAL_ERROR
+      || val.value.error != HAPLO_ERROR_INTERPRETER_INVALID_TYPE)
+  {
+    fprintf(stderr, "Error point-x accepted a record of another shape\n");
+    goto cleanup_failed;
+  }
+
+  interpreter_destroy(&interpreter);
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  value_free(val);
+  interpreter_destroy(&interpreter);
+  HAPLO_TEST_FAILED;
+}
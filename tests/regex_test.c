@@ -0,0 +1,371 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#define HAPLO_NO_PREFIX
+#include "../haplo.h"
+#include "tests.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REGEX_TEST_TEXT_MAX 24
+
+// A random pattern, kept as a tree for the reference matcher
+typedef struct RegexTestNode {
+  char op;    // a byte, '.', '&' for concat, '|', '*', '+' or '?'
+  struct RegexTestNode *left;
+  struct RegexTestNode *right;
+} RegexTestNode;
+
+static RegexTestNode regex_test_nodes[256];
+static int regex_test_node_count;
+
+// Writes a random pattern of depth at most depth to buf
+static RegexTestNode *regex_test_generate(int depth, char *buf, int *len)
+{
+  RegexTestNode *node = &regex_test_nodes[regex_test_node_count++];
+  int kind = (depth == 0) ? 0 : rand() % 6;
+  static const char ops[] = "&|*+?";
+  if (kind == 0)
+  {
+    node->op = "ab."[rand() % 3];
+    buf[(*len)++] = node->op;
+    return node;
+  }
+
+  node->op = ops[kind - 1];
+  buf[(*len)++] = '(';
+  node->left = regex_test_generate(depth - 1, buf, len);
+  if (node->op == '&' || node->op == '|')
+  {
+    if (node->op == '|') buf[(*len)++] = '|';
+    node->right = regex_test_generate(depth - 1, buf, len);
+    buf[(*len)++] = ')';
+  }
+  else
+  {
+    buf[(*len)++] = ')';
+    buf[(*len)++] = node->op;
+  }
+  return node;
+}
+
+// Returns the set of the ends of the matches of node starting at the
+// positions in starts
+static uint32_t regex_test_ends(RegexTestNode *node, const char *text, int len,
+                                uint32_t starts)
+{
+  uint32_t ends = 0, reached;
+  switch(node->op)
+  {
+  case '&':
+    return regex_test_ends(node->right, text, len,
+                           regex_test_ends(node->left, text, len, starts));
+  case '|':
+    return regex_test_ends(node->left, text, len, starts)
+      | regex_test_ends(node->right, text, len, starts);
+  case '?':
+    return starts | regex_test_ends(node->left, text, len, starts);
+  case '*':
+  case '+':
+    reached = (node->op == '*') ? starts : 0;
+    for (uint32_t next = regex_test_ends(node->left, text, len, starts);
+         (next | reached) != reached;
+         next = regex_test_ends(node->left, text, len, next))
+      reached |= next;
+    return reached;
+  default:
+    for (int i = 0; i < len; ++i)
+      if (((starts >> i) & 1) && (node->op == '.' || text[i] == node->op))
+        ends |= 1u << (i + 1);
+    return ends;
+  }
+}
+
+HAPLO_TEST(regex_test, search)
+{
+  struct {
+    const char *pattern;
+    const char *text;
+    int start;
+    int end;
+  } cases[] = {
+    { "b+", "aabbbc", 2, 5 },
+    { "a|ab|abc", "xabcd", 1, 4 },
+    { "(?:ab)*c", "ababcab", 0, 5 },
+    { "[0-9]{2,3}", "a1b123456", 3, 6 },
+    { "\\d+\\.\\d*", "pi 3.14!", 3, 7 },
+    { "[^a-c]+", "abcxyzab", 3, 6 },
+    { "hello\\s\\w+", "say hello world", 4, 15 },
+    { "^ab", "abab", 0, 2 },
+    { "ab$", "abab", 2, 4 },
+    { "^$", "", 0, 0 },
+    { "x*", "abc", 0, 0 },
+    { "[]a]+", "x]a]", 1, 4 },
+    { "a\\$", "a$", 0, 2 },
+    { "^ab", "xab", -1, -1 },
+    { "needle", "haystack without it", -1, -1 },
+  };
+
+  Regex *regex = NULL;
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i)
+  {
+    int err = 0;
+    regex = regex_compile(cases[i].pattern, strlen(cases[i].pattern), &err);
+    if (!regex)
+    {
+      fprintf(stderr, "Error %s compiling %s\n", error_string(err), cases[i].pattern);
+      goto cleanup_failed;
+    }
+
+    int start = -1, end = -1;
+    int len = strlen(cases[i].text);
+    int found = regex_search(regex, cases[i].text, len, 0, &start, &end);
+    if (found < 0 || start != cases[i].start || end != cases[i].end
+        || regex_match(regex, cases[i].text, len) != (cases[i].start >= 0))
+    {
+      fprintf(stderr, "Error %s in \"%s\" gave %d..%d\n",
+              cases[i].pattern, cases[i].text, start, end);
+      goto cleanup_failed;
+    }
+    regex_free(regex);
+    regex = NULL;
+  }
+
+  const char *invalid[] = { "(ab", "ab)", "*a", "a|?", "[ab", "a{3,2}",
+                            "a{1001}", "a^b", "a$b", "\\q" };
+  for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i)
+  {
+    int err = 0;
+    regex = regex_compile(invalid[i], strlen(invalid[i]), &err);
+    if (regex || err != HAPLO_ERROR_REGEX_SYNTAX)
+    {
+      fprintf(stderr, "Error compiled the invalid pattern %s\n", invalid[i]);
+      goto cleanup_failed;
+    }
+  }
+
+  int err = 0;
+  regex = regex_compile("(((a{1000}){1000}))", 19, &err);
+  if (regex || err != HAPLO_ERROR_REGEX_TOO_LARGE)
+  {
+    fprintf(stderr, "Error compiled a pattern too large\n");
+    goto cleanup_failed;
+  }
+
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  regex_free(regex);
+  HAPLO_TEST_FAILED;
+}
+
+// Non-ASCII patterns and texts, where ., sets and repeats read whole
+// codepoints
+HAPLO_TEST(regex_test, utf8)
+{
+  struct {
+    const char *pattern;
+    const char *text;
+    int start;
+    int end;
+  } cases[] = {
+    // \xc3\xa9 is U+E9, \xe6\x97\xa5 is U+65E5, \xf0\x9f\x98\x80 is U+1F600
+    { ".", "\xe6\x97\xa5\xe6\x9c\xac", 0, 3 },
+    { "\xc3\xa9+", "a\xc3\xa9\xc3\xa9" "b", 1, 5 },
+    { "[^a]+", "a\xc3\xa9\xe6\x97\xa5" "b", 1, 7 },
+    { "[\xc3\xa0-\xc3\xbc]+", "x\xc3\xa9\xc3\xbc!", 1, 5 },
+    { "[^\xc3\xa0-\xc3\xbc]", "\xc3\xa9\xc3\xbc\xe2\x82\xac", 4, 7 },
+    { "\\W", "a\xc3\xa9", 1, 3 },
+    { "a.c", "a\xf0\x9f\x98\x80" "c", 0, 6 },
+    { "[\xf0\x9f\x98\x80-\xf0\x9f\x98\x82]", "x\xf0\x9f\x98\x83\xf0\x9f\x98\x81", 5, 9 },
+    { "(\xe6\x97\xa5|\xc3\xa9){2}", "\xc3\xa9" "a\xe6\x97\xa5\xc3\xa9", 3, 8 },
+    { ".{3}$", "\xc3\xa9\xe6\x97\xa5\xf0\x9f\x98\x80" "a", 2, 10 },
+    { "\\\xc3\xa9", "a\xc3\xa9", 1, 3 },
+    { "[^\\w\xc3\xa9]", "a\xc3\xa9\xc3\xa8", 3, 5 },
+    { "\xc3\xa9", "\xc3\xa8", -1, -1 },
+  };
+
+  Regex *regex = NULL;
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i)
+  {
+    int err = 0;
+    regex = regex_compile(cases[i].pattern, strlen(cases[i].pattern), &err);
+    if (!regex)
+    {
+      fprintf(stderr, "Error %s compiling %s\n", error_string(err), cases[i].pattern);
+      goto cleanup_failed;
+    }
+
+    int start = -1, end = -1;
+    int len = strlen(cases[i].text);
+    int found = regex_search(regex, cases[i].text, len, 0, &start, &end);
+    if (found < 0 || start != cases[i].start || end != cases[i].end
+        || regex_match(regex, cases[i].text, len) != (cases[i].start >= 0))
+    {
+      fprintf(stderr, "Error %s in \"%s\" gave %d..%d\n",
+              cases[i].pattern, cases[i].text, start, end);
+      goto cleanup_failed;
+    }
+    regex_free(regex);
+    regex = NULL;
+  }
+
+  int err = 0;
+  regex = regex_compile("a\xc3", 2, &err);
+  if (regex || err != HAPLO_ERROR_INVALID_UTF8)
+  {
+    fprintf(stderr, "Error compiled a pattern that is not UTF-8\n");
+    goto cleanup_failed;
+  }
+
+  // Empty matches are stepped over with a whole codepoint
+  if (regex_next("a\xe6\x97\xa5", 4, 1, 1) != 4 || regex_next("a\xe6\x97\xa5", 4, 0, 1) != 1
+      || regex_next("a\xe6\x97\xa5", 4, 4, 4) != 5)
+  {
+    fprintf(stderr, "Error wrong position after a match\n");
+    goto cleanup_failed;
+  }
+
+  // Every match of these starts and ends between codepoints
+  const char *patterns[] = { ".", "[^a]", "\\W+", "\xc3\xa9+", ".{2}", "[^\xc3\xa9]*",
+                             "[\xc3\xa0-\xe6\x97\xa5]+", "(\xe6\x97\xa5|.)a?" };
+  const char *codepoints[] = { "a", "\n", "\xc3\xa9", "\xe6\x97\xa5", "\xf0\x9f\x98\x80" };
+  char text[4 * REGEX_TEST_TEXT_MAX];
+  srand(11);
+  for (size_t p = 0; p < sizeof(patterns) / sizeof(patterns[0]); ++p)
+  {
+    regex = regex_compile(patterns[p], strlen(patterns[p]), &err);
+    if (!regex) goto cleanup_failed;
+    for (int round = 0; round < 200; ++round)
+    {
+      int len = 0;
+      for (int i = rand() % REGEX_TEST_TEXT_MAX; i > 0; --i)
+      {
+        const char *codepoint = codepoints[rand() % 5];
+        memcpy(text + len, codepoint, strlen(codepoint));
+        len += strlen(codepoint);
+      }
+
+      int start, end;
+      for (int pos = 0; regex_search(regex, text, len, pos, &start, &end) > 0;
+           pos = regex_next(text, len, start, end))
+      {
+        if (!utf8_valid(text + start, end - start)
+            || (start < len && (text[start] & 0xc0) == 0x80)
+            || (end < len && (text[end] & 0xc0) == 0x80))
+        {
+          fprintf(stderr, "Error %s in \"%.*s\" matched %d..%d\n",
+                  patterns[p], len, text, start, end);
+          goto cleanup_failed;
+        }
+      }
+    }
+    regex_free(regex);
+    regex = NULL;
+  }
+
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  regex_free(regex);
+  HAPLO_TEST_FAILED;
+}
+
+HAPLO_TEST(regex_test, random)
+{
+  Regex *regex = NULL;
+  char pattern[512];
+  char text[REGEX_TEST_TEXT_MAX];
+  srand(42);
+
+  for (int round = 0; round < 3000; ++round)
+  {
+    int pattern_len = 0;
+    regex_test_node_count = 0;
+    RegexTestNode *root = regex_test_generate(rand() % 5, pattern, &pattern_len);
+    int err = 0;
+    regex = regex_compile(pattern, pattern_len, &err);
+    if (!regex)
+    {
+      fprintf(stderr, "Error %s compiling %.*s\n", error_string(err), pattern_len, pattern);
+      goto cleanup_failed;
+    }
+
+    for (int t = 0; t < 10; ++t)
+    {
+      int len = rand() % REGEX_TEST_TEXT_MAX;
+      for (int i = 0; i < len; ++i) text[i] = "abc"[rand() % 3];
+
+      // The leftmost start with a match, and its last end
+      int expected_start = -1, expected_end = -1;
+      for (int start = 0; start <= len && expected_start < 0; ++start)
+      {
+        uint32_t ends = regex_test_ends(root, text, len, 1u << start);
+        if (ends == 0) continue;
+        expected_start = start;
+        while (ends >> (expected_end + 1)) expected_end++;
+      }
+
+      int start = -1, end = -1;
+      int found = regex_search(regex, text, len, 0, &start, &end);
+      if (found < 0 || start != expected_start || end != expected_end
+          || regex_match(regex, text, len) != (expected_start >= 0))
+      {
+        fprintf(stderr, "Error %.*s in \"%.*s\" gave %d..%d instead of %d..%d\n",
+                pattern_len, pattern, len, text, start, end,
+                expected_start, expected_end);
+        goto cleanup_failed;
+      }
+    }
+    regex_free(regex);
+    regex = NULL;
+  }
+
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  regex_free(regex);
+  HAPLO_TEST_FAILED;
+}
+
+HAPLO_TEST(regex_test, flush)
+{
+  // The DFA of this pattern tracks the a among the last 12 bytes, it
+  // needs more states than it caches
+  const char *pattern = "a[ab]{11}$";
+  static char text[20000];
+  int err = 0;
+  Regex *regex = regex_compile(pattern, strlen(pattern), &err);
+  if (!regex) goto cleanup_failed;
+  srand(7);
+
+  for (int round = 0; round < 4; ++round)
+  {
+    int len = sizeof(text) - round;
+    for (int i = 0; i < len; ++i) text[i] = "ab"[rand() % 2];
+    if (round % 2) text[len - 12] = 'b';
+    bool expected = text[len - 12] == 'a';
+    if (regex_match(regex, text, len) != expected)
+    {
+      fprintf(stderr, "Error wrong match after flushing the DFA\n");
+      goto cleanup_failed;
+    }
+  }
+  if (regex->dfa_flushes == 0)
+  {
+    fprintf(stderr, "Error the DFA was never flushed\n");
+    goto cleanup_failed;
+  }
+
+  regex_free(regex);
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  regex_free(regex);
+  HAPLO_TEST_FAILED;
+}
@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#define HAPLO_NO_PREFIX
+#include "../haplo.h"
+#include "tests.h"
+
+#include <stdio.h>
+
+static Value set_test_int(long i)
+{
+  return (Value) { .type = HAPLO_VAL_INTEGER, .value.integer = i };
+}
+
+HAPLO_TEST(set_test, algebra)
+{
+  Set *a = set_new();
+  Set *b = set_new();
+  Set *sets[3] = {0};
+  Value only_a = {0};
+  if (!a || !b) goto cleanup_failed;
+
+  // Multiples of 2 and of 3, with some values outside the bitmaps
+  for (long i = -10; i < 20000; ++i)
+  {
+    if (i % 2 == 0) set_add(a, set_test_int(i));
+    if (i % 3 == 0) set_add(b, set_test_int(i));
+  }
+  set_add(a, set_test_int(HAPLO_SET_DENSE_LIMIT * 6));
+  set_add(b, set_test_int(HAPLO_SET_DENSE_LIMIT * 6));
+  // set_add takes ownership of the string
+  set_add(a, (Value) { .type = HAPLO_VAL_STRING,
+                       .value.string = string_from_cstr("only a") });
+
+  sets[0] = set_union(a, b);
+  sets[1] = set_intersection(a, b);
+  sets[2] = set_difference(a, b);
+  if (!sets[0] || !sets[1] || !sets[2]) goto cleanup_failed;
+
+  for (long i = -10; i < 20000; ++i)
+  {
+    bool in_a = i % 2 == 0, in_b = i % 3 == 0;
+    if (set_has(sets[0], set_test_int(i)) != (in_a || in_b)
+        || set_has(sets[1], set_test_int(i)) != (in_a && in_b)
+        || set_has(sets[2], set_test_int(i)) != (in_a && !in_b))
+    {
+      fprintf(stderr, "Error wrong membership of %ld\n", i);
+      goto cleanup_failed;
+    }
+  }
+
+  Value big = set_test_int(HAPLO_SET_DENSE_LIMIT * 6);
+  // An equal string in another allocation
+  only_a = (Value) { .type = HAPLO_VAL_STRING,
+                     .value.string = string_from_cstr("only a") };
+  if (!set_has(sets[1], big) || set_has(sets[2], big)
+      || !set_has(sets[2], only_a) || set_has(sets[1], only_a))
+  {
+    fprintf(stderr, "Error wrong membership of values outside the bitmaps\n");
+    goto cleanup_failed;
+  }
+
+  // -10..19999 has 10005 even and 6670 multiples of 3, 3335 in both
+  if (set_size(sets[0]) != 10005 + 6670 - 3335 + 2
+      || set_size(sets[1]) != 3335 + 1
+      || set_size(sets[2]) != 10005 - 3335 + 1)
+  {
+    fprintf(stderr, "Error wrong sizes %d %d %d\n", set_size(sets[0]),
+            set_size(sets[1]), set_size(sets[2]));
+    goto cleanup_failed;
+  }
+
+  for (int i = 0; i < 3; ++i) set_free(sets[i]);
+  set_free(a);
+  set_free(b);
+  value_free(only_a);
+  HAPLO_TEST_SUCCESS;
+ cleanup_failed:
+  value_free(only_a);
+  for (int i = 0; i < 3; ++i) set_free(sets[i]);
+  set_free(a);
+  set_free(b);
+  HAPLO_TEST_FAILED;
+}
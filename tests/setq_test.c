@@ -18,7 +18,7 @@ HAPLO_TEST(setq_test, declare_variable)
   long expected_result = 123;
   
   Parser parser = {0};
-  err = parser_init(&parser, input, strlen(input));
+  err = parser_init(&parser, input, strlen(input), NULL);
   if (err < 0)
   {
     fprintf(stderr, "Error %d after parser_init\n", err);
@@ -51,7 +51,7 @@ HAPLO_TEST(setq_test, declare_variable)
   }
 
   Interpreter interpreter = {0};
-  interpreter_init(&interpreter);
+  interpreter_init(&interpreter, NULL);
   Value val = interpreter_interpret(&interpreter, expr);
   if (val.type == HAPLO_VAL_ERROR)
   {
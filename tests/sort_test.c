@@ -0,0 +1,184 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#define HAPLO_NO_PREFIX
+#include "../haplo.h"
+#include "tests.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INTEGER(x) (Value) { .type = HAPLO_VAL_INTEGER, .value.integer = (x) }
+#define FLOAT(x) (Value) { .type = HAPLO_VAL_FLOAT, .value.floating_point = (x) }
+#define STRING(x) (Value) { .type = HAPLO_VAL_STRING, .value.string = (x) }
+
+#define SORT_TEST_LEN 1000
+
+// Returns true if order sorts keys, and keeps equal keys in their
+// original order
+static bool sort_test_check(Value *keys, int *order, int count)
+{
+  for (int i = 1; i < count; ++i)
+  {
+    int cmp = sort_compare(keys[order[i - 1]], keys[order[i]]);
+    if (cmp > 0 || (cmp == 0 && order[i - 1] > order[i]))
+      return false;
+  }
+  return true;
+}
+
+HAPLO_TEST(sort_test, order)
+{
+  static Value keys[SORT_TEST_LEN];
+  static int order[SORT_TEST_LEN];
+  static String *strings[SORT_TEST_LEN];
+  String *mixed = string_from_cstr("mixed");
+  srand(42);
+
+  // Short inputs go through pdqsort, long ones through the radix sorts
+  int lengths[] = { 0, 1, 10, 63, 64, SORT_TEST_LEN };
+  for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); ++l)
+  {
+    int count = lengths[l];
+    for (int kind = 0; kind < 4; ++kind)
+    {
+      for (int i = 0; i < count; ++i)
+      {
+        long r = rand() % 200 - 100;
+        switch(kind)
+        {
+        case 0:
+          keys[i] = INTEGER(r * 1000000000000L);
+          break;
+        case 1:
+          keys[i] = FLOAT((r % 7 == 0) ? NAN : (r == 0) ? -0.0 : r / 3.0);
+          break;
+        case 2: ;
+          char digits[8];
+          snprintf(digits, sizeof(digits), "%ld", r);
+          string_free(strings[i]);
+          strings[i] = string_from_cstr(digits);
+          keys[i] = STRING(strings[i]);
+          break;
+        default:
+          keys[i] = (r % 2) ? INTEGER(r) : FLOAT(r / 4.0);
+          break;
+        }
+      }
+
+      int err = sort_order(keys, count, order);
+      if (err < 0 || !sort_test_check(keys, order, count))
+      {
+        fprintf(stderr, "Error wrong order of %d keys of kind %d\n", count, kind);
+        goto cleanup_failed;
+      }
+    }
+  }
+
+  // Sorted and reversed inputs are the usual bad cases of quicksort
+  for (int i = 0; i < SORT_TEST_LEN; ++i)
+    keys[i] = (i % 2) ? INTEGER(i) : FLOAT(SORT_TEST_LEN - i);
+  if (sort_order(keys, SORT_TEST_LEN, order) < 0
+      || !sort_test_check(keys, order, SORT_TEST_LEN))
+  {
+    fprintf(stderr, "Error wrong order of a sawtooth\n");
+    goto cleanup_failed;
+  }
+
+  keys[0] = STRING(mixed);
+  if (sort_order(keys, SORT_TEST_LEN, order) != HAPLO_ERROR_INTERPRETER_INVALID_TYPE)
+  {
+    fprintf(stderr, "Error sorted a string with numbers\n");
+    goto cleanup_failed;
+  }
+
+  for (int i = 0; i < SORT_TEST_LEN; ++i)
+    string_free(strings[i]);
+  string_free(mixed);
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  for (int i = 0; i < SORT_TEST_LEN; ++i)
+    string_free(strings[i]);
+  string_free(mixed);
+  HAPLO_TEST_FAILED;
+}
+
+HAPLO_TEST(sort_test, list)
+{
+  Interpreter interpreter = {0};
+  interpreter_init(&interpreter, NULL);
+  List *list = NULL, *sorted = NULL;
+
+  // The floats and the integers are equal, their order must be kept
+  Value values[] = { FLOAT(2.0), INTEGER(1), INTEGER(2), FLOAT(1.0), INTEGER(0) };
+  ValueList *chain = NULL;
+  for (int i = 0; i < 5; ++i)
+    chain = value_list_push_front(values[i], chain);
+  list = list_new(chain);
+
+  int err = 0;
+  sorted = sort_list(list, &err);
+  if (!sorted)
+  {
+    fprintf(stderr, "Error %s in sort_list\n", error_string(err));
+    goto cleanup_failed;
+  }
+
+  char buf[64] = {0};
+  value_string((Value) { .type = HAPLO_VAL_LIST, .value.list = sorted },
+               buf, sizeof(buf));
+  if (strcmp(buf, "list: 0 1 1.0 2.0 2 ") != 0 || sorted->len != 5)
+  {
+    fprintf(stderr, "Error expected a stable sort, got %s\n", buf);
+    goto cleanup_failed;
+  }
+
+  // The original list is not changed
+  value_string((Value) { .type = HAPLO_VAL_LIST, .value.list = list },
+               buf, sizeof(buf));
+  if (strcmp(buf, "list: 2.0 1 2 1.0 0 ") != 0)
+  {
+    fprintf(stderr, "Error the list was changed to %s\n", buf);
+    goto cleanup_failed;
+  }
+
+  // A list whose chain push-back grew for another list sorts only
+  // its own cells
+  List *longer = list_push_back(list, INTEGER(-1));
+  if (!longer)
+  {
+    fprintf(stderr, "Error out of memory in list_push_back\n");
+    goto cleanup_failed;
+  }
+  list_free(sorted);
+  sorted = sort_list(list, &err);
+  list_free(longer);
+  if (!sorted)
+  {
+    fprintf(stderr, "Error %s in sort_list\n", error_string(err));
+    goto cleanup_failed;
+  }
+  value_string((Value) { .type = HAPLO_VAL_LIST, .value.list = sorted },
+               buf, sizeof(buf));
+  if (strcmp(buf, "list: 0 1 1.0 2.0 2 ") != 0 || sorted->len != 5)
+  {
+    fprintf(stderr, "Error sorted the cells after the list, got %s\n", buf);
+    goto cleanup_failed;
+  }
+
+  list_free(sorted);
+  list_free(list);
+  interpreter_destroy(&interpreter);
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  list_free(sorted);
+  list_free(list);
+  interpreter_destroy(&interpreter);
+  HAPLO_TEST_FAILED;
+}
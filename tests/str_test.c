@@ -0,0 +1,310 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#define HAPLO_NO_PREFIX
+#include "../haplo.h"
+#include "tests.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Returns the index of the first match of needle in haystack, or -1
+static int str_test_naive_search(const char *haystack, int len,
+                                 const char *needle, int needle_len)
+{
+  for (int i = 0; i + needle_len <= len; ++i)
+    if (memcmp(haystack + i, needle, needle_len) == 0)
+      return i;
+  return -1;
+}
+
+HAPLO_TEST(str_test, bytes)
+{
+  // The length is stored, so a string can hold NUL bytes
+  String *a = string_new("a\0b", 3);
+  String *b = string_new("a\0c", 3);
+  String *prefix = string_from_cstr("a");
+  if (!a || !b || !prefix) goto cleanup_failed;
+
+  if (a->len != 3 || a->data[3] != '\0' || prefix->len != 1)
+  {
+    fprintf(stderr, "Error wrong lengths %d and %d\n", a->len, prefix->len);
+    goto cleanup_failed;
+  }
+  if (string_equal(a, b) || string_compare(a, b) >= 0
+      || string_compare(prefix, a) >= 0 || string_compare(a, a) != 0)
+  {
+    fprintf(stderr, "Error compared the bytes after a NUL wrong\n");
+    goto cleanup_failed;
+  }
+
+  string_free(a);
+  string_free(b);
+  string_free(prefix);
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  string_free(a);
+  string_free(b);
+  string_free(prefix);
+  HAPLO_TEST_FAILED;
+}
+
+HAPLO_TEST(str_test, shared)
+{
+  Value a = { .type = HAPLO_VAL_STRING, .value.string = string_from_cstr("shared") };
+  Value b = { .type = HAPLO_VAL_STRING, .value.string = string_from_cstr("shared") };
+  Value copy = value_deep_copy(a);
+
+  // A copy is a new reference to the same bytes
+  if (copy.value.string != a.value.string || a.value.string->refcount != 2)
+  {
+    fprintf(stderr, "Error the copy did not share the string\n");
+    goto cleanup_failed;
+  }
+
+  // The hash is computed once and kept by the string
+  uint64_t hash = value_hash(a);
+  if (a.value.string->hash == 0 || value_hash(copy) != hash
+      || !value_equal(a, b) || value_hash(b) != hash)
+  {
+    fprintf(stderr, "Error equal strings must have the same hash\n");
+    goto cleanup_failed;
+  }
+
+  value_free(copy);
+  copy = (Value) {0};
+  if (a.value.string->refcount != 1)
+  {
+    fprintf(stderr, "Error freeing the copy freed the string\n");
+    goto cleanup_failed;
+  }
+
+  value_free(a);
+  value_free(b);
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  value_free(copy);
+  value_free(a);
+  value_free(b);
+  HAPLO_TEST_FAILED;
+}
+
+HAPLO_TEST(str_test, inline)
+{
+  Value small = value_text_new(HAPLO_VAL_STRING, "ok", 2);
+  Value full = value_text_new(HAPLO_VAL_QUOTE, "fifteen-bytes-q", 15);
+  Value heap = { .type = HAPLO_VAL_STRING, .value.string = string_from_cstr("ok") };
+  Value large = value_text_new(HAPLO_VAL_SYMBOL, "sixteen-bytes-sy", 16);
+
+  if (small.inline_size == 0 || full.inline_size == 0 || large.inline_size != 0
+      || strcmp(value_text(&full), "fifteen-bytes-q") != 0
+      || value_text_len(&large) != 16)
+  {
+    fprintf(stderr, "Error wrong inline and heap representations\n");
+    goto cleanup_failed;
+  }
+
+  // The representation does not change the value
+  if (!value_equal(small, heap) || value_hash(small) != value_hash(heap))
+  {
+    fprintf(stderr, "Error an inline and a heap string differ\n");
+    goto cleanup_failed;
+  }
+
+  // A copy of an inline value is the value itself
+  Value copy = value_deep_copy(small);
+  if (copy.inline_size != small.inline_size || !value_equal(copy, small))
+  {
+    fprintf(stderr, "Error in the copy of an inline string\n");
+    goto cleanup_failed;
+  }
+
+  value_free(small);
+  value_free(full);
+  value_free(heap);
+  value_free(large);
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  value_free(small);
+  value_free(full);
+  value_free(heap);
+  value_free(large);
+  HAPLO_TEST_FAILED;
+}
+
+HAPLO_TEST(str_test, search)
+{
+  char haystack[64], needle[8];
+  srand(42);
+
+  // A small alphabet gives many periodic needles and partial matches
+  for (int round = 0; round < 20000; ++round)
+  {
+    int len = rand() % 64, needle_len = rand() % 8;
+    for (int i = 0; i < len; ++i) haystack[i] = 'a' + rand() % 2;
+    for (int i = 0; i < needle_len; ++i) needle[i] = 'a' + rand() % 2;
+
+    StringSearch search;
+    string_search_init(&search, needle, needle_len);
+    int found = string_search(&search, haystack, len);
+    int expected = str_test_naive_search(haystack, len, needle, needle_len);
+    if (found != expected)
+    {
+      fprintf(stderr, "Error found %.*s at %d in %.*s, expected %d\n",
+              needle_len, needle, found, len, haystack, expected);
+      goto cleanup_failed;
+    }
+  }
+
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  HAPLO_TEST_FAILED;
+}
+
+HAPLO_TEST(str_test, slice)
+{
+  String *string = string_from_cstr("a string longer than a value");
+  String *slice = string_slice(string, 2, 20);
+  String *inner = string_slice(slice, 7, 6);
+  if (!string || !slice || !inner) goto cleanup_failed;
+
+  // A slice of a slice shares the bytes of the first string
+  if (inner->parent != string || string->refcount != 3
+      || inner->len != 6 || memcmp(inner->data, "longer", 6) != 0)
+  {
+    fprintf(stderr, "Error the slices do not share the string\n");
+    goto cleanup_failed;
+  }
+
+  Value value = { .type = HAPLO_VAL_STRING, .value.string = slice };
+  Value sub = value_string_slice(&value, 0, 6);
+  if (sub.inline_size == 0 || strcmp(value_text(&sub), "string") != 0)
+  {
+    fprintf(stderr, "Error a short slice is not inline\n");
+    goto cleanup_failed;
+  }
+
+  string_free(string);
+  string_free(slice);
+  string_free(inner);
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  string_free(string);
+  string_free(slice);
+  string_free(inner);
+  HAPLO_TEST_FAILED;
+}
+
+HAPLO_TEST(str_test, builder)
+{
+  StringBuilder builder = {0};
+  String *string = NULL;
+  Vector *vector = vector_new(0);
+  if (!vector) goto cleanup_failed;
+
+  long numbers[] = { 0, 7, -42, 1234567, LONG_MAX, LONG_MIN };
+  char expected[512] = {0};
+  int offset = 0;
+  for (size_t i = 0; i < sizeof(numbers) / sizeof(numbers[0]); ++i)
+  {
+    if (string_builder_append_long(&builder, numbers[i]) < 0
+        || string_builder_append(&builder, ",", 1) < 0)
+      goto cleanup_failed;
+    offset += snprintf(expected + offset, sizeof(expected) - offset, "%ld,", numbers[i]);
+  }
+  if (string_builder_append_double(&builder, -2.5) < 0
+      || string_builder_append_double(&builder, 1e300) < 0)
+    goto cleanup_failed;
+  offset += snprintf(expected + offset, sizeof(expected) - offset, "-2.51e+300");
+
+  string = string_builder_finish(&builder);
+  if (!string || string->len != offset || strcmp(string->data, expected) != 0
+      || builder.string != NULL)
+  {
+    fprintf(stderr, "Error built %s instead of %s\n", string ? string->data : "", expected);
+    goto cleanup_failed;
+  }
+
+  // Values longer than the first try of the printer are not truncated
+  for (int i = 0; i < 1000; ++i)
+    if (vector_push(vector, (Value) { .type = HAPLO_VAL_INTEGER, .value.integer = i }) < 0)
+      goto cleanup_failed;
+  Value value = { .type = HAPLO_VAL_VECTOR, .value.vector = vector };
+  if (string_builder_append_value(&builder, value) < 0) goto cleanup_failed;
+  int len = builder.string->len;
+  const char *end = builder.string->buffer + len - 5;
+  if (len != (int) strlen("vector: ") + 3890 || strncmp(end, " 999 ", 5) != 0)
+  {
+    fprintf(stderr, "Error the vector was printed in %d bytes\n", len);
+    goto cleanup_failed;
+  }
+
+  string_builder_free(&builder);
+  string_free(string);
+  vector_free(vector);
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  string_builder_free(&builder);
+  string_free(string);
+  vector_free(vector);
+  HAPLO_TEST_FAILED;
+}
+
+HAPLO_TEST(str_test, codepoints)
+{
+  // A euro sign every 3 codepoints, past a few index steps
+  String *string = string_new(NULL, 1000 * 5);
+  if (!string) HAPLO_TEST_FAILED;
+  for (int i = 0; i < 1000; ++i) memcpy(string->buffer + 5 * i, "ab\xe2\x82\xac", 5);
+  String *ascii = string_from_cstr("only ascii bytes, indexed directly");
+  if (!ascii) goto cleanup_failed;
+
+  if (string_codepoints(string) != 3000 || string->codepoints != 3000
+      || string_codepoints(ascii) != ascii->len)
+  {
+    fprintf(stderr, "Error wrong number of codepoints\n");
+    goto cleanup_failed;
+  }
+  for (int i = 0; i <= 3000; ++i)
+  {
+    int expected = 5 * (i / 3) + i % 3;
+    if (string_codepoint_offset(string, i) != expected)
+    {
+      fprintf(stderr, "Error codepoint %d is at %d and not %d\n",
+              i, string_codepoint_offset(string, i), expected);
+      goto cleanup_failed;
+    }
+  }
+  if (!string->index || string_codepoint_offset(ascii, 7) != 7 || ascii->index)
+  {
+    fprintf(stderr, "Error the index is not built only when needed\n");
+    goto cleanup_failed;
+  }
+
+  // Short values are counted from their bytes
+  Value value = value_text_new(HAPLO_VAL_STRING, "\xc3\xa9t\xc3\xa9", 5);
+  if (value_text_codepoints(&value) != 3 || value_text_offset(&value, 2) != 3)
+  {
+    fprintf(stderr, "Error wrong codepoints of an inline string\n");
+    goto cleanup_failed;
+  }
+
+  string_free(string);
+  string_free(ascii);
+  HAPLO_TEST_SUCCESS;
+
+ cleanup_failed:
+  string_free(string);
+  string_free(ascii);
+  HAPLO_TEST_FAILED;
+}
@@ -0,0 +1,164 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#define HAPLO_NO_PREFIX
+#include "../haplo.h"
+#include "tests.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Decodes the codepoints one by one, the way the standard defines
+// them
+static bool utf8_test_reference(const unsigned char *bytes, int len)
+{
+  for (int i = 0; i < len; )
+  {
+    unsigned int byte = bytes[i], codepoint, min;
+    int continuations;
+    if (byte < 0x80) { i++; continue; }
+    else if ((byte & 0xe0) == 0xc0) { continuations = 1; codepoint = byte & 0x1f; min = 0x80; }
+    else if ((byte & 0xf0) == 0xe0) { continuations = 2; codepoint = byte & 0x0f; min = 0x800; }
+    else if ((byte & 0xf8) == 0xf0) { continuations = 3; codepoint = byte & 0x07; min = 0x10000; }
+    else return false;
+
+    if (i + continuations >= len) return false;
+    for (int j = 1; j <= continuations; ++j)
+    {
+      if ((bytes[i + j] & 0xc0) != 0x80) return false;
+      codepoint = (codepoint << 6) | (bytes[i + j] & 0x3f);
+    }
+    if (codepoint < min || codepoint > 0x10ffff
+        || (codepoint >= 0xd800 && codepoint <= 0xdfff))
+      return false;
+    i += continuations + 1;
+  }
+  return true;
+}
+
+HAPLO_TEST(utf8_test, valid)
+{
+  struct {
+    const char *bytes;
+    bool valid;
+  } cases[] = {
+    { "", true },
+    { "plain ascii", true },
+    { "caf\xc3\xa9", true },
+    { "\xe2\x82\xac and \xf0\x9f\x98\x80", true },
+    { "\xf4\x8f\xbf\xbf", true },              // U+10FFFF
+    { "\xc3", false },                         // cut
+    { "\xe2\x82", false },
+    { "\x80", false },                         // lone continuation
+    { "\xc0\xaf", false },                     // overlong
+    { "\xe0\x80\xaf", false },
+    { "\xf0\x80\x80\xaf", false },
+    { "\xed\xa0\x80", false },                 // surrogate
+    { "\xf4\x90\x80\x80", false },             // above U+10FFFF
+    { "\xf8\x88\x80\x80\x80", false },
+    { "\xff", false },
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i)
+  {
+    if (utf8_valid(cases[i].bytes, strlen(cases[i].bytes)) != cases[i].valid)
+    {
+      fprintf(stderr, "Error case %zu is not %s\n", i,
+              cases[i].valid ? "valid" : "invalid");
+      HAPLO_TEST_FAILED;
+    }
+  }
+
+  // Random bytes and random codepoints, some with a byte flipped, at
+  // every position in the blocks of the SIMD kernels
+  unsigned char bytes[160];
+  const unsigned char interesting[] = { 'a', 0x7f, 0x80, 0x8f, 0x90, 0x9f, 0xa0, 0xbf,
+                                        0xc0, 0xc2, 0xdf, 0xe0, 0xed, 0xef, 0xf0,
+                                        0xf4, 0xf5, 0xff };
+  srand(42);
+  for (int round = 0; round < 200000; ++round)
+  {
+    int len = 0;
+    if (round % 2)
+    {
+      len = rand() % 100;
+      for (int i = 0; i < len; ++i)
+        bytes[i] = interesting[rand() % sizeof(interesting)];
+    }
+    else
+    {
+      int target = rand() % 100;
+      while (len < target)
+      {
+        unsigned int codepoint = (rand() % 2) ? (unsigned int) rand() % 0x80
+          : (unsigned int) rand() % 0x110000;
+        if (codepoint >= 0xd800 && codepoint <= 0xdfff) codepoint = 'x';
+        if (codepoint < 0x80) {
+          bytes[len++] = codepoint;
+        } else if (codepoint < 0x800) {
+          bytes[len++] = 0xc0 | (codepoint >> 6);
+          bytes[len++] = 0x80 | (codepoint & 0x3f);
+        } else if (codepoint < 0x10000) {
+          bytes[len++] = 0xe0 | (codepoint >> 12);
+          bytes[len++] = 0x80 | ((codepoint >> 6) & 0x3f);
+          bytes[len++] = 0x80 | (codepoint & 0x3f);
+        } else {
+          bytes[len++] = 0xf0 | (codepoint >> 18);
+          bytes[len++] = 0x80 | ((codepoint >> 12) & 0x3f);
+          bytes[len++] = 0x80 | ((codepoint >> 6) & 0x3f);
+          bytes[len++] = 0x80 | (codepoint & 0x3f);
+        }
+      }
+      if (len > 0 && round % 4 == 0) bytes[rand() % len] ^= 1 << (rand() % 8);
+    }
+
+    if (utf8_valid((const char *) bytes, len) != utf8_test_reference(bytes, len))
+    {
+      fprintf(stderr, "Error validating round %d:", round);
+      for (int i = 0; i < len; ++i) fprintf(stderr, " %02x", bytes[i]);
+      fprintf(stderr, "\n");
+      HAPLO_TEST_FAILED;
+    }
+  }
+  HAPLO_TEST_SUCCESS;
+}
+
+HAPLO_TEST(utf8_test, count)
+{
+  // 6 codepoints in 10 bytes, repeated past the SIMD blocks
+  static char bytes[1000];
+  for (int i = 0; i < 1000; ++i) bytes[i] = "a\xc3\xa9\xf0\x9f\x98\x80xyz"[i % 10];
+
+  for (int len = 0; len <= 1000; len += 10)
+  {
+    int expected = 6 * len / 10;
+    if (utf8_count(bytes, len) != expected)
+    {
+      fprintf(stderr, "Error counted %d codepoints in %d bytes\n",
+              utf8_count(bytes, len), len);
+      HAPLO_TEST_FAILED;
+    }
+  }
+
+  // The codepoints of a repetition start at 0, 1, 3, 7, 8 and 9
+  const int starts[] = { 0, 1, 3, 7, 8, 9 };
+  for (int i = 0; i < 600; ++i)
+  {
+    int expected = 10 * (i / 6) + starts[i % 6];
+    if (utf8_advance(bytes, 1000, i) != expected)
+    {
+      fprintf(stderr, "Error codepoint %d is at %d and not %d\n",
+              i, utf8_advance(bytes, 1000, i), expected);
+      HAPLO_TEST_FAILED;
+    }
+  }
+  if (utf8_advance(bytes, 1000, 600) != 1000 || utf8_advance(bytes, 1000, 700) != 1000)
+  {
+    fprintf(stderr, "Error advanced past the end\n");
+    HAPLO_TEST_FAILED;
+  }
+  HAPLO_TEST_SUCCESS;
+}
@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#define HAPLO_NO_PREFIX
+#include "../haplo.h"
+#include "tests.h"
+
+#include <stdio.h>
+
+HAPLO_TEST(vector_test, push_nth)
+{
+  Vector *vector = vector_new(0);
+  if (!vector)
+  {
+    fprintf(stderr, "Error vector_new returned NULL\n");
+    goto test_failed;
+  }
+
+  // Grow past the initial capacity a few times
+  for (int i = 0; i < 10 * HAPLO_VECTOR_MIN_CAPACITY; ++i)
+  {
+    int err = vector_push(vector, (Value) { .type = HAPLO_VAL_INTEGER,
+                                            .value.integer = i });
+    if (err < 0)
+    {
+      fprintf(stderr, "Error %s in vector_push\n", error_string(err));
+      vector_free(vector);
+      goto test_failed;
+    }
+  }
+
+  if (vector_len(vector) != 10 * HAPLO_VECTOR_MIN_CAPACITY)
+  {
+    fprintf(stderr, "Error wrong vector length %d\n", vector_len(vector));
+    vector_free(vector);
+    goto test_failed;
+  }
+
+  for (int i = 0; i < vector_len(vector); ++i)
+  {
+    Value val = vector_nth(vector, i);
+    if (val.type != HAPLO_VAL_INTEGER || val.value.integer != i)
+    {
+      fprintf(stderr, "Error wrong value at index %d\n", i);
+      vector_free(vector);
+      goto test_failed;
+    }
+  }
+
+  vector_free(vector);
+  HAPLO_TEST_SUCCESS;
+ test_failed:
+  HAPLO_TEST_FAILED;
+}
+
+HAPLO_TEST(vector_test, list_round_trip)
+{
+  ValueList *chain = NULL;
+  for (int i = 0; i < 5; ++i)
+    chain = value_list_push_front((Value) { .type = HAPLO_VAL_INTEGER,
+                                            .value.integer = i }, chain);
+  List *list = list_new(chain);
+
+  // The first value pushed is the first value of the vector
+  Vector *vector = vector_from_list(list);
+  if (!vector || vector_len(vector) != 5
+      || vector_nth(vector, 0).value.integer != 0
+      || vector_nth(vector, 4).value.integer != 4)
+  {
+    fprintf(stderr, "Error wrong vector from list\n");
+    vector_free(vector);
+    list_free(list);
+    goto test_failed;
+  }
+
+  List *new_list = vector_to_list(vector);
+  if (!new_list || list_len(new_list) != 5
+      || new_list->first->val.value.integer != 4)
+  {
+    fprintf(stderr, "Error wrong list from vector\n");
+    list_free(new_list);
+    vector_free(vector);
+    list_free(list);
+    goto test_failed;
+  }
+
+  list_free(new_list);
+  vector_free(vector);
+  list_free(list);
+  HAPLO_TEST_SUCCESS;
+ test_failed:
+  HAPLO_TEST_FAILED;
+}
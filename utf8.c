@@ -0,0 +1,469 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "utf8.h"
+#include "utils.h"
+#include "cpu.h"
+
+#include <stdint.h>
+#include <string.h>
+
+// Validation comes in three flavours: plain C, SSSE3 and AVX2, the
+// SIMD ones check a block of bytes at once with the lookup tables of
+// Keiser and Lemire. Counting codepoints uses SSE2, which is always
+// there on x86_64, or AVX2.
+#if !defined(HAPLO_UTF8_NO_SIMD) && defined(__GNUC__) && defined(__x86_64__)
+  #define HAPLO_UTF8_X86
+  #include <immintrin.h>
+  #define HAPLO_UTF8_SSSE3 __attribute__((target("ssse3")))
+  #define HAPLO_UTF8_AVX2 __attribute__((target("avx2")))
+#endif
+
+typedef enum {
+  HAPLO_UTF8_ISA_SCALAR = 0,
+  HAPLO_UTF8_ISA_SSE2,
+  HAPLO_UTF8_ISA_SSSE3,
+  HAPLO_UTF8_ISA_AVX2,
+} HaploUtf8Isa;
+
+// Returns the best instruction set supported by the cpu
+static HaploUtf8Isa haplo_utf8_isa(void)
+{
+#ifdef HAPLO_UTF8_X86
+  return haplo_cpu_has_avx2() ? HAPLO_UTF8_ISA_AVX2
+    : haplo_cpu_has_ssse3() ? HAPLO_UTF8_ISA_SSSE3
+    : HAPLO_UTF8_ISA_SSE2;
+#else
+  return HAPLO_UTF8_ISA_SCALAR;
+#endif
+}
+
+// A continuation byte is 10xxxxxx
+static inline bool haplo_utf8_lead(unsigned char byte)
+{
+  return (byte & 0xc0) != 0x80;
+}
+
+//
+// Scalar kernels
+//
+
+static bool haplo_utf8_valid_scalar(const unsigned char *bytes, int len)
+{
+  int i = 0;
+  while (i < len)
+  {
+    // Eight ASCII bytes at a time
+    uint64_t word;
+    if (i + 8 <= len)
+    {
+      memcpy(&word, bytes + i, sizeof(word));
+      if ((word & 0x8080808080808080ULL) == 0)
+      {
+        i += 8;
+        continue;
+      }
+    }
+
+    unsigned char byte = bytes[i];
+    if (byte < 0x80)
+    {
+      i++;
+      continue;
+    }
+    // The second byte has a narrower range after the leads that could
+    // start an overlong encoding, a surrogate or a codepoint too large
+    int continuations;
+    unsigned char low = 0x80, high = 0xbf;
+    if (byte >= 0xc2 && byte <= 0xdf)
+    {
+      continuations = 1;
+    }
+    else if (byte >= 0xe0 && byte <= 0xef)
+    {
+      continuations = 2;
+      if (byte == 0xe0) low = 0xa0;
+      if (byte == 0xed) high = 0x9f;
+    }
+    else if (byte >= 0xf0 && byte <= 0xf4)
+    {
+      continuations = 3;
+      if (byte == 0xf0) low = 0x90;
+      if (byte == 0xf4) high = 0x8f;
+    }
+    else
+    {
+      return false;
+    }
+
+    if (len - i - 1 < continuations) return false;
+    if (bytes[i + 1] < low || bytes[i + 1] > high) return false;
+    for (int j = 2; j <= continuations; ++j)
+      if (haplo_utf8_lead(bytes[i + j])) return false;
+    i += continuations + 1;
+  }
+  return true;
+}
+
+static int haplo_utf8_count_scalar(const unsigned char *bytes, int len)
+{
+  int count = 0, i = 0;
+  for (; i + 8 <= len; i += 8)
+  {
+    // The continuation bytes have the high bit set and the next clear
+    uint64_t word;
+    memcpy(&word, bytes + i, sizeof(word));
+    uint64_t continuations = word & ~(word << 1) & 0x8080808080808080ULL;
+    count += 8 - HAPLO_POPCOUNT64(continuations);
+  }
+  for (; i < len; ++i)
+    count += haplo_utf8_lead(bytes[i]);
+  return count;
+}
+
+#ifdef HAPLO_UTF8_X86
+
+//
+// SIMD kernels
+//
+
+// The error bits of the pairs of bytes. A pair is looked up by the
+// high and low nibble of its first byte and the high nibble of the
+// second, and it is invalid if the three lookups share a bit. The
+// sequences too short or too long for their lead are found by
+// comparing the pairs of continuations with the bytes 2 and 3
+// positions back.
+#define HAPLO_UTF8_TOO_SHORT   (1 << 0) // 11______ 0_______, 11______ 11______
+#define HAPLO_UTF8_TOO_LONG    (1 << 1) // 0_______ 10______
+#define HAPLO_UTF8_OVERLONG_3  (1 << 2) // 11100000 100_____
+#define HAPLO_UTF8_TOO_LARGE   (1 << 3) // 11110100 1001____, 11110100 101_____
+#define HAPLO_UTF8_SURROGATE   (1 << 4) // 11101101 101_____
+#define HAPLO_UTF8_OVERLONG_2  (1 << 5) // 1100000_ 10______
+#define HAPLO_UTF8_TOO_LARGE_1000 (1 << 6) // 11110101 1000____, 11111___ 1000____
+#define HAPLO_UTF8_OVERLONG_4  (1 << 6) // 11110000 1000____
+#define HAPLO_UTF8_TWO_CONTS   (1 << 7) // 10______ 10______
+#define HAPLO_UTF8_CARRY \
+  (HAPLO_UTF8_TOO_SHORT | HAPLO_UTF8_TOO_LONG | HAPLO_UTF8_TWO_CONTS)
+
+static const unsigned char haplo_utf8_byte_1_high[16] = {
+  // 0_______ ________
+  HAPLO_UTF8_TOO_LONG, HAPLO_UTF8_TOO_LONG, HAPLO_UTF8_TOO_LONG, HAPLO_UTF8_TOO_LONG,
+  HAPLO_UTF8_TOO_LONG, HAPLO_UTF8_TOO_LONG, HAPLO_UTF8_TOO_LONG, HAPLO_UTF8_TOO_LONG,
+  // 10______ ________
+  HAPLO_UTF8_TWO_CONTS, HAPLO_UTF8_TWO_CONTS, HAPLO_UTF8_TWO_CONTS, HAPLO_UTF8_TWO_CONTS,
+  // 1100____ ________
+  HAPLO_UTF8_TOO_SHORT | HAPLO_UTF8_OVERLONG_2,
+  // 1101____ ________
+  HAPLO_UTF8_TOO_SHORT,
+  // 1110____ ________
+  HAPLO_UTF8_TOO_SHORT | HAPLO_UTF8_OVERLONG_3 | HAPLO_UTF8_SURROGATE,
+  // 1111____ ________
+  HAPLO_UTF8_TOO_SHORT | HAPLO_UTF8_TOO_LARGE | HAPLO_UTF8_TOO_LARGE_1000
+  | HAPLO_UTF8_OVERLONG_4,
+};
+
+static const unsigned char haplo_utf8_byte_1_low[16] = {
+  // ____0000 ________
+  HAPLO_UTF8_CARRY | HAPLO_UTF8_OVERLONG_3 | HAPLO_UTF8_OVERLONG_2 | HAPLO_UTF8_OVERLONG_4,
+  // ____0001 ________
+  HAPLO_UTF8_CARRY | HAPLO_UTF8_OVERLONG_2,
+  // ____001_ ________
+  HAPLO_UTF8_CARRY,
+  HAPLO_UTF8_CARRY,
+  // ____0100 ________
+  HAPLO_UTF8_CARRY | HAPLO_UTF8_TOO_LARGE,
+  // ____0101 ________ to ____1100 ________
+  HAPLO_UTF8_CARRY | HAPLO_UTF8_TOO_LARGE | HAPLO_UTF8_TOO_LARGE_1000,
+  HAPLO_UTF8_CARRY | HAPLO_UTF8_TOO_LARGE | HAPLO_UTF8_TOO_LARGE_1000,
+  HAPLO_UTF8_CARRY | HAPLO_UTF8_TOO_LARGE | HAPLO_UTF8_TOO_LARGE_1000,
+  HAPLO_UTF8_CARRY | HAPLO_UTF8_TOO_LARGE | HAPLO_UTF8_TOO_LARGE_1000,
+  HAPLO_UTF8_CARRY | HAPLO_UTF8_TOO_LARGE | HAPLO_UTF8_TOO_LARGE_1000,
+  HAPLO_UTF8_CARRY | HAPLO_UTF8_TOO_LARGE | HAPLO_UTF8_TOO_LARGE_1000,
+  HAPLO_UTF8_CARRY | HAPLO_UTF8_TOO_LARGE | HAPLO_UTF8_TOO_LARGE_1000,
+  HAPLO_UTF8_CARRY | HAPLO_UTF8_TOO_LARGE | HAPLO_UTF8_TOO_LARGE_1000,
+  // ____1101 ________
+  HAPLO_UTF8_CARRY | HAPLO_UTF8_TOO_LARGE | HAPLO_UTF8_TOO_LARGE_1000 | HAPLO_UTF8_SURROGATE,
+  // ____111_ ________
+  HAPLO_UTF8_CARRY | HAPLO_UTF8_TOO_LARGE | HAPLO_UTF8_TOO_LARGE_1000,
+  HAPLO_UTF8_CARRY | HAPLO_UTF8_TOO_LARGE | HAPLO_UTF8_TOO_LARGE_1000,
+};
+
+static const unsigned char haplo_utf8_byte_2_high[16] = {
+  // ________ 0_______
+  HAPLO_UTF8_TOO_SHORT, HAPLO_UTF8_TOO_SHORT, HAPLO_UTF8_TOO_SHORT, HAPLO_UTF8_TOO_SHORT,
+  HAPLO_UTF8_TOO_SHORT, HAPLO_UTF8_TOO_SHORT, HAPLO_UTF8_TOO_SHORT, HAPLO_UTF8_TOO_SHORT,
+  // ________ 1000____
+  HAPLO_UTF8_TOO_LONG | HAPLO_UTF8_OVERLONG_2 | HAPLO_UTF8_TWO_CONTS | HAPLO_UTF8_OVERLONG_3
+  | HAPLO_UTF8_TOO_LARGE_1000 | HAPLO_UTF8_OVERLONG_4,
+  // ________ 1001____
+  HAPLO_UTF8_TOO_LONG | HAPLO_UTF8_OVERLONG_2 | HAPLO_UTF8_TWO_CONTS | HAPLO_UTF8_OVERLONG_3
+  | HAPLO_UTF8_TOO_LARGE,
+  // ________ 101_____
+  HAPLO_UTF8_TOO_LONG | HAPLO_UTF8_OVERLONG_2 | HAPLO_UTF8_TWO_CONTS | HAPLO_UTF8_SURROGATE
+  | HAPLO_UTF8_TOO_LARGE,
+  HAPLO_UTF8_TOO_LONG | HAPLO_UTF8_OVERLONG_2 | HAPLO_UTF8_TWO_CONTS | HAPLO_UTF8_SURROGATE
+  | HAPLO_UTF8_TOO_LARGE,
+  // ________ 11______
+  HAPLO_UTF8_TOO_SHORT, HAPLO_UTF8_TOO_SHORT, HAPLO_UTF8_TOO_SHORT, HAPLO_UTF8_TOO_SHORT,
+};
+
+// A lead byte in one of the last 3 bytes of a block needs the next
+// block, the bytes at or above these have their sequence cut
+static const unsigned char haplo_utf8_incomplete[32] = {
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 0xef, 0xdf, 0xbf,
+};
+
+// The validation state between blocks
+typedef struct {
+  __m128i prev;
+  __m128i prev_incomplete;
+  __m128i error;
+} HaploUtf8Sse;
+
+HAPLO_UTF8_SSSE3
+static inline __m128i haplo_utf8_high_nibble_sse(__m128i v)
+{
+  return _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0f));
+}
+
+HAPLO_UTF8_SSSE3
+static inline __m128i haplo_utf8_lookup_sse(const unsigned char table[16], __m128i index)
+{
+  return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) table), index);
+}
+
+HAPLO_UTF8_SSSE3
+static inline void haplo_utf8_block_ssse3(HaploUtf8Sse *state, __m128i input)
+{
+  if (_mm_movemask_epi8(input) == 0)
+  {
+    // An ASCII block can only be wrong by cutting the one before
+    state->error = _mm_or_si128(state->error, state->prev_incomplete);
+    state->prev = input;
+    return;
+  }
+
+  __m128i prev1 = _mm_alignr_epi8(input, state->prev, 15);
+  __m128i special = _mm_and_si128(
+    _mm_and_si128(haplo_utf8_lookup_sse(haplo_utf8_byte_1_high,
+                                        haplo_utf8_high_nibble_sse(prev1)),
+                  haplo_utf8_lookup_sse(haplo_utf8_byte_1_low,
+                                        _mm_and_si128(prev1, _mm_set1_epi8(0x0f)))),
+    haplo_utf8_lookup_sse(haplo_utf8_byte_2_high, haplo_utf8_high_nibble_sse(input)));
+
+  // The high bit is set after a lead of 3 bytes 2 positions back or
+  // of 4 bytes 3 positions back, where there must be two continuations
+  __m128i prev2 = _mm_alignr_epi8(input, state->prev, 14);
+  __m128i prev3 = _mm_alignr_epi8(input, state->prev, 13);
+  __m128i must_23 = _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8(0xe0 - 0x80)),
+                                 _mm_subs_epu8(prev3, _mm_set1_epi8(0xf0 - 0x80)));
+  __m128i must_23_80 = _mm_and_si128(must_23, _mm_set1_epi8((char) 0x80));
+  state->error = _mm_or_si128(state->error, _mm_xor_si128(must_23_80, special));
+
+  state->prev_incomplete = _mm_subs_epu8(
+    input, _mm_loadu_si128((const __m128i*) (haplo_utf8_incomplete + 16)));
+  state->prev = input;
+}
+
+HAPLO_UTF8_SSSE3
+static bool haplo_utf8_valid_ssse3(const unsigned char *bytes, int len)
+{
+  HaploUtf8Sse state = {
+    .prev = _mm_setzero_si128(),
+    .prev_incomplete = _mm_setzero_si128(),
+    .error = _mm_setzero_si128(),
+  };
+  int i = 0;
+  for (; i + 16 <= len; i += 16)
+    haplo_utf8_block_ssse3(&state, _mm_loadu_si128((const __m128i*) (bytes + i)));
+  // The last bytes are padded with ASCII
+  if (i < len)
+  {
+    unsigned char tail[16] = {0};
+    memcpy(tail, bytes + i, len - i);
+    haplo_utf8_block_ssse3(&state, _mm_loadu_si128((const __m128i*) tail));
+  }
+  __m128i error = _mm_or_si128(state.error, state.prev_incomplete);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xffff;
+}
+
+// The validation state between blocks
+typedef struct {
+  __m256i prev;
+  __m256i prev_incomplete;
+  __m256i error;
+} HaploUtf8Avx;
+
+HAPLO_UTF8_AVX2
+static inline __m256i haplo_utf8_high_nibble_avx(__m256i v)
+{
+  return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0f));
+}
+
+// The shuffle looks up each 128 bit lane on its own, so the table is
+// in both
+HAPLO_UTF8_AVX2
+static inline __m256i haplo_utf8_lookup_avx(const unsigned char table[16], __m256i index)
+{
+  __m256i lanes = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) table));
+  return _mm256_shuffle_epi8(lanes, index);
+}
+
+// The bytes of input shifted by n, the last n of prev coming in. The
+// alignr works per lane, the permute gives it the lane before.
+#define HAPLO_UTF8_PREV_AVX(input, prev, n)                            \
+  _mm256_alignr_epi8((input), _mm256_permute2x128_si256((prev), (input), 0x21), 16 - (n))
+
+HAPLO_UTF8_AVX2
+static inline void haplo_utf8_block_avx2(HaploUtf8Avx *state, __m256i input)
+{
+  if (_mm256_movemask_epi8(input) == 0)
+  {
+    state->error = _mm256_or_si256(state->error, state->prev_incomplete);
+    state->prev = input;
+    return;
+  }
+
+  __m256i prev1 = HAPLO_UTF8_PREV_AVX(input, state->prev, 1);
+  __m256i special = _mm256_and_si256(
+    _mm256_and_si256(haplo_utf8_lookup_avx(haplo_utf8_byte_1_high,
+                                           haplo_utf8_high_nibble_avx(prev1)),
+                     haplo_utf8_lookup_avx(haplo_utf8_byte_1_low,
+                                           _mm256_and_si256(prev1, _mm256_set1_epi8(0x0f)))),
+    haplo_utf8_lookup_avx(haplo_utf8_byte_2_high, haplo_utf8_high_nibble_avx(input)));
+
+  __m256i prev2 = HAPLO_UTF8_PREV_AVX(input, state->prev, 2);
+  __m256i prev3 = HAPLO_UTF8_PREV_AVX(input, state->prev, 3);
+  __m256i must_23 = _mm256_or_si256(_mm256_subs_epu8(prev2, _mm256_set1_epi8(0xe0 - 0x80)),
+                                    _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xf0 - 0x80)));
+  __m256i must_23_80 = _mm256_and_si256(must_23, _mm256_set1_epi8((char) 0x80));
+  state->error = _mm256_or_si256(state->error, _mm256_xor_si256(must_23_80, special));
+
+  state->prev_incomplete = _mm256_subs_epu8(
+    input, _mm256_loadu_si256((const __m256i*) haplo_utf8_incomplete));
+  state->prev = input;
+}
+
+HAPLO_UTF8_AVX2
+static bool haplo_utf8_valid_avx2(const unsigned char *bytes, int len)
+{
+  HaploUtf8Avx state = {
+    .prev = _mm256_setzero_si256(),
+    .prev_incomplete = _mm256_setzero_si256(),
+    .error = _mm256_setzero_si256(),
+  };
+  int i = 0;
+  for (; i + 32 <= len; i += 32)
+    haplo_utf8_block_avx2(&state, _mm256_loadu_si256((const __m256i*) (bytes + i)));
+  if (i < len)
+  {
+    unsigned char tail[32] = {0};
+    memcpy(tail, bytes + i, len - i);
+    haplo_utf8_block_avx2(&state, _mm256_loadu_si256((const __m256i*) tail));
+  }
+  __m256i error = _mm256_or_si256(state.error, state.prev_incomplete);
+  return _mm256_testz_si256(error, error);
+}
+
+// The bytes that are not continuations are the ones above -65 as
+// signed bytes, counting stops before a block where the count would
+// pass max
+static int haplo_utf8_count_sse2(const unsigned char *bytes, int len,
+                                 int max, int *count)
+{
+  int i = 0;
+  __m128i above = _mm_set1_epi8(-65);
+  for (; i + 16 <= len; i += 16)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i*) (bytes + i));
+    int leads = HAPLO_POPCOUNT64(_mm_movemask_epi8(_mm_cmpgt_epi8(v, above)));
+    if (*count + leads > max) break;
+    *count += leads;
+  }
+  return i;
+}
+
+HAPLO_UTF8_AVX2
+static int haplo_utf8_count_avx2(const unsigned char *bytes, int len,
+                                 int max, int *count)
+{
+  int i = 0;
+  __m256i above = _mm256_set1_epi8(-65);
+  for (; i + 32 <= len; i += 32)
+  {
+    __m256i v = _mm256_loadu_si256((const __m256i*) (bytes + i));
+    int leads = HAPLO_POPCOUNT64((uint32_t) _mm256_movemask_epi8(_mm256_cmpgt_epi8(v, above)));
+    if (*count + leads > max) break;
+    *count += leads;
+  }
+  return i;
+}
+
+#endif // HAPLO_UTF8_X86
+
+// Counts the leads in the blocks of bytes as long as the count stays
+// at most max, and returns how many bytes it counted
+static int haplo_utf8_count_blocks(const unsigned char *bytes, int len,
+                                   int max, int *count)
+{
+  switch(haplo_utf8_isa())
+  {
+#ifdef HAPLO_UTF8_X86
+  case HAPLO_UTF8_ISA_AVX2:
+    return haplo_utf8_count_avx2(bytes, len, max, count);
+  case HAPLO_UTF8_ISA_SSSE3:
+  case HAPLO_UTF8_ISA_SSE2:
+    return haplo_utf8_count_sse2(bytes, len, max, count);
+#endif // HAPLO_UTF8_X86
+  default:
+    return 0;
+  }
+}
+
+//
+// Functions
+//
+
+bool haplo_utf8_valid(const char *data, int len)
+{
+  const unsigned char *bytes = (const unsigned char *) data;
+  switch(haplo_utf8_isa())
+  {
+#ifdef HAPLO_UTF8_X86
+  case HAPLO_UTF8_ISA_AVX2:
+    return haplo_utf8_valid_avx2(bytes, len);
+  case HAPLO_UTF8_ISA_SSSE3:
+    return haplo_utf8_valid_ssse3(bytes, len);
+#endif // HAPLO_UTF8_X86
+  default:
+    return haplo_utf8_valid_scalar(bytes, len);
+  }
+}
+
+int haplo_utf8_count(const char *data, int len)
+{
+  const unsigned char *bytes = (const unsigned char *) data;
+  int count = 0;
+  int i = haplo_utf8_count_blocks(bytes, len, INT_MAX, &count);
+  return count + haplo_utf8_count_scalar(bytes + i, len - i);
+}
+
+int haplo_utf8_advance(const char *data, int len, int count)
+{
+  const unsigned char *bytes = (const unsigned char *) data;
+  // The blocks with at most count leads are skipped whole, the target
+  // is in the next one
+  int skipped = 0;
+  int i = haplo_utf8_count_blocks(bytes, len, count, &skipped);
+  count -= skipped;
+  for (; i < len; ++i)
+  {
+    if (!haplo_utf8_lead(bytes[i])) continue;
+    if (count == 0) return i;
+    count--;
+  }
+  return len;
+}
@@ -0,0 +1,36 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#ifndef HAPLO_UTF8_H
+#define HAPLO_UTF8_H
+
+#include <stdbool.h>
+
+//
+// Macros
+//
+
+#ifdef HAPLO_NO_PREFIX
+  #define utf8_valid haplo_utf8_valid
+  #define utf8_count haplo_utf8_count
+  #define utf8_advance haplo_utf8_advance
+#endif // HAPLO_NO_PREFIX
+
+//
+// Functions
+//
+
+// Returns true if the len bytes of data are valid UTF-8: no overlong
+// encodings, surrogates, codepoints above U+10FFFF or cut sequences
+bool haplo_utf8_valid(const char *data, int len);
+// Returns the number of codepoints in the len bytes of data, which is
+// the number of bytes that are not continuation bytes. It is len
+// only if the bytes are ASCII, when they are valid.
+int haplo_utf8_count(const char *data, int len);
+// Returns the offset of the byte that starts the codepoint count
+// codepoints after the start of data, or len if there are not enough
+int haplo_utf8_advance(const char *data, int len, int count);
+
+#endif // HAPLO_UTF8_H
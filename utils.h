@@ -6,6 +6,9 @@
 #ifndef HAPLO_UTILS_H
 #define HAPLO_UTILS_H
 
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -27,6 +30,26 @@
  #define UNLIKELY(x)   (x)
 #endif
 
+#ifdef __GNUC__
+  #define HAPLO_POPCOUNT64(x) __builtin_popcountll(x)
+  // x must not be 0
+  #define HAPLO_CTZ64(x)      __builtin_ctzll(x)
+#else
+  #define HAPLO_POPCOUNT64(x) haplo_popcount64(x)
+  #define HAPLO_CTZ64(x)      haplo_popcount64(((x) & -(x)) - 1)
+#endif
+
+// Store a op b in *result and evaluate to true if it overflowed a long
+#ifdef __GNUC__
+  #define HAPLO_ADD_OVERFLOW(a, b, result) __builtin_add_overflow(a, b, result)
+  #define HAPLO_SUB_OVERFLOW(a, b, result) __builtin_sub_overflow(a, b, result)
+  #define HAPLO_MUL_OVERFLOW(a, b, result) __builtin_mul_overflow(a, b, result)
+#else
+  #define HAPLO_ADD_OVERFLOW(a, b, result) haplo_add_overflow(a, b, result)
+  #define HAPLO_SUB_OVERFLOW(a, b, result) haplo_sub_overflow(a, b, result)
+  #define HAPLO_MUL_OVERFLOW(a, b, result) haplo_mul_overflow(a, b, result)
+#endif
+
 //
 // Functions
 //
@@ -35,4 +58,46 @@ static inline void cleanup_freep(void *p) {
     free(*(void **)p);
 }
 
+// Returns the number of bits set in x
+static inline int haplo_popcount64(uint64_t x)
+{
+  x = x - ((x >> 1) & 0x5555555555555555ULL);
+  x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+  x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+  return (int) ((x * 0x0101010101010101ULL) >> 56);
+}
+
+static inline bool haplo_add_overflow(long a, long b, long *result)
+{
+  if ((b > 0 && a > LONG_MAX - b) || (b < 0 && a < LONG_MIN - b))
+    return true;
+  *result = a + b;
+  return false;
+}
+
+static inline bool haplo_sub_overflow(long a, long b, long *result)
+{
+  if ((b < 0 && a > LONG_MAX + b) || (b > 0 && a < LONG_MIN + b))
+    return true;
+  *result = a - b;
+  return false;
+}
+
+static inline bool haplo_mul_overflow(long a, long b, long *result)
+{
+  if (a > 0 ? (b > 0 ? a > LONG_MAX / b : b < LONG_MIN / a)
+            : (b > 0 ? a < LONG_MIN / b : (a != 0 && b < LONG_MAX / a)))
+    return true;
+  *result = a * b;
+  return false;
+}
+
+// Turns the return value of snprintf into the number of bytes that
+// were actually written to a buffer of buf_len bytes
+static inline int haplo_snprintf_clamp(int written, int buf_len)
+{
+  if (written < 0 || buf_len <= 0) return 0;
+  return (written < buf_len) ? written : buf_len - 1;
+}
+
 #endif // HAPLO_UTILS_H
@@ -5,87 +5,334 @@
 
 #include "errors.h"
 #include "value.h"
+#include "utils.h"
+#include "alloc.h"
+#include "vector.h"
+#include "map.h"
+#include "hamt.h"
+#include "set.h"
+#include "record.h"
+#include "array.h"
+#include "matrix.h"
+#include "bigint.h"
+#include "str.h"
+#include "iter.h"
+#include "regex.h"
+#include "bytes.h"
+#include "fmt.h"
+#include "utf8.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 
+// Pool bound by the interpreter running on this thread. Cells are
+// always given back to the pool that allocated them, so values can
+// be freed while a different pool is bound.
+static __thread HaploPool *haplo_value_list_pool = NULL;
+static __thread HaploPool haplo_value_list_default_pool = {0};
+
+static HaploPool *haplo_value_list_pool_current(void)
+{
+  if (LIKELY(haplo_value_list_pool != NULL))
+    return haplo_value_list_pool;
+
+  if (haplo_value_list_default_pool.cell_size == 0)
+    haplo_pool_init(&haplo_value_list_default_pool,
+                    HAPLO_VALUE_LIST_POOL_CELL_SIZE, NULL);
+  return &haplo_value_list_default_pool;
+}
+
+void haplo_value_list_pool_release(void)
+{
+  // The next cell allocated from the default pool initializes it again
+  haplo_pool_destroy(&haplo_value_list_default_pool);
+  haplo_value_list_default_pool.cell_size = 0;
+  return;
+}
+
+HaploPool *haplo_value_list_pool_bind(HaploPool *pool)
+{
+  HaploPool *prev = haplo_value_list_pool;
+  haplo_value_list_pool = pool;
+  return prev;
+}
+
 HaploValueList *haplo_value_list_push_front(HaploValue value,
                                               HaploValueList *list)
 {
   HaploValueList *new_list =
-    (HaploValueList*) malloc(sizeof(HaploValueList));
-  new_list->val = value;
-    
-  if (list == NULL)
+    (HaploValueList*) haplo_pool_alloc(haplo_value_list_pool_current());
+  if (UNLIKELY(!new_list))
   {
-    new_list->next = NULL;
-    return new_list;
+    // Out of memory, the allocator remembers it
+    haplo_value_free(value);
+    return list;
   }
-
+  new_list->val = value;
   new_list->next = list;
+  new_list->refcount = 1;
   return new_list;
 }
 
+HaploValueList *haplo_value_list_ref(HaploValueList *list)
+{
+  if (list) list->refcount++;
+  return list;
+}
+
 int haplo_value_list_len(HaploValueList *list)
 {
-  if (!list) return 0;
-  return haplo_value_list_len(list->next) + 1;
+  int len = 0;
+  while (list)
+  {
+    len++;
+    list = list->next;
+  }
+  return len;
 }
 
 void haplo_value_list_print(HaploValueList *list)
 {
-  if (!list)
-    return;
-
   char buf[1024] = {0};
-  haplo_value_string(list->val, &buf[0], 1024);
-  printf("  %s: %s\n", haplo_value_type_string(list->val.type), buf);
-  
-  haplo_value_list_print(list->next);
+  while (list)
+  {
+    haplo_value_string(list->val, &buf[0], 1024);
+    printf("  %s: %s\n", haplo_value_type_string(list->val.type), buf);
+    list = list->next;
+  }
   return;
 }
 
 HaploValueList *haplo_value_list_deep_copy(HaploValueList *list)
 {
-  if (!list) return NULL;
-
-  HaploValueList *new_list = malloc(sizeof(HaploValueList));
-  new_list->val = haplo_value_deep_copy(list->val);
-  new_list->next = haplo_value_list_deep_copy(list->next);
+  HaploPool *pool = haplo_value_list_pool_current();
+  HaploValueList *new_list = NULL;
+  HaploValueList **last = &new_list;
+  while (list)
+  {
+    HaploValueList *cell = (HaploValueList*) haplo_pool_alloc(pool);
+    if (UNLIKELY(!cell)) break;
+    cell->val = haplo_value_deep_copy(list->val);
+    cell->next = NULL;
+    cell->refcount = 1;
+    *last = cell;
+    last = &cell->next;
+    list = list->next;
+  }
   return new_list;
 }
 
 void haplo_value_list_free(HaploValueList *list)
 {
-  if (!list)
-    return;
+  while (list && --list->refcount == 0)
+  {
+    HaploValueList *next = list->next;
+    haplo_value_free(list->val);
+    haplo_pool_free(list);
+    list = next;
+  }
+  return;
+}
 
-  haplo_value_free(list->val);
+HaploList *haplo_list_new(HaploValueList *first)
+{
+  HaploList *list = (HaploList*) haplo_pool_alloc(haplo_value_list_pool_current());
+  if (UNLIKELY(!list))
+  {
+    haplo_value_list_free(first);
+    return NULL;
+  }
+
+  list->first = first;
+  list->last = first;
+  list->len = 0;
+  list->refcount = 1;
+  for (HaploValueList *cell = first; cell; cell = cell->next)
+  {
+    list->last = cell;
+    list->len++;
+  }
+  return list;
+}
 
-  haplo_value_list_free(list->next);
-  free(list);
+HaploList *haplo_list_ref(HaploList *list)
+{
+  if (list) list->refcount++;
+  return list;
+}
+
+void haplo_list_free(HaploList *list)
+{
+  if (!list || --list->refcount != 0) return;
+
+  haplo_value_list_free(list->first);
+  haplo_pool_free(list);
   return;
 }
 
-_Static_assert(_HAPLO_VAL_MAX == 9,
+int haplo_list_len(HaploList *list)
+{
+  return list ? list->len : 0;
+}
+
+HaploList *haplo_list_push_front(HaploList *list, HaploValue value)
+{
+  HaploPool *pool = haplo_value_list_pool_current();
+  HaploList *new_list = (HaploList*) haplo_pool_alloc(pool);
+  HaploValueList *cell = (HaploValueList*) haplo_pool_alloc(pool);
+  if (UNLIKELY(!new_list || !cell))
+  {
+    haplo_pool_free(new_list);
+    haplo_pool_free(cell);
+    haplo_value_free(value);
+    return NULL;
+  }
+
+  int len = haplo_list_len(list);
+  cell->val = value;
+  cell->next = (len > 0) ? haplo_value_list_ref(list->first) : NULL;
+  cell->refcount = 1;
+
+  new_list->first = cell;
+  new_list->last = (len > 0) ? list->last : cell;
+  new_list->len = len + 1;
+  new_list->refcount = 1;
+  return new_list;
+}
+
+HaploList *haplo_list_push_back(HaploList *list, HaploValue value)
+{
+  int len = haplo_list_len(list);
+  if (len == 0)
+    return haplo_list_push_front(list, value);
+
+  HaploPool *pool = haplo_value_list_pool_current();
+  HaploList *new_list = (HaploList*) haplo_pool_alloc(pool);
+  HaploValueList *cell = (HaploValueList*) haplo_pool_alloc(pool);
+  if (UNLIKELY(!new_list || !cell))
+  {
+    haplo_pool_free(new_list);
+    haplo_pool_free(cell);
+    haplo_value_free(value);
+    return NULL;
+  }
+  cell->val = value;
+  cell->next = NULL;
+  cell->refcount = 1;
+
+  if (list->last->next == NULL)
+  {
+    // Nobody grew the chain yet, the new cell is linked in place.
+    // The other lists over the chain do not see it, they stop after
+    // their len cells.
+    list->last->next = cell;
+    new_list->first = haplo_value_list_ref(list->first);
+  }
+  else
+  {
+    // The back is taken by another list, copy our cells
+    HaploValueList *copy = NULL;
+    HaploValueList **next = &copy;
+    HaploValueList *this = list->first;
+    for (int i = 0; i < len; ++i)
+    {
+      HaploValueList *copy_cell = (HaploValueList*) haplo_pool_alloc(pool);
+      if (UNLIKELY(!copy_cell))
+      {
+        haplo_value_list_free(copy);
+        haplo_pool_free(new_list);
+        haplo_value_list_free(cell);
+        return NULL;
+      }
+      copy_cell->val = haplo_value_deep_copy(this->val);
+      copy_cell->next = NULL;
+      copy_cell->refcount = 1;
+      *next = copy_cell;
+      next = &copy_cell->next;
+      this = this->next;
+    }
+    *next = cell;
+    new_list->first = copy;
+  }
+
+  new_list->last = cell;
+  new_list->len = len + 1;
+  new_list->refcount = 1;
+  return new_list;
+}
+
+HaploList *haplo_list_tail(HaploList *list)
+{
+  assert(haplo_list_len(list) > 0);
+
+  HaploList *new_list = (HaploList*) haplo_pool_alloc(haplo_value_list_pool_current());
+  if (UNLIKELY(!new_list)) return NULL;
+
+  new_list->len = list->len - 1;
+  new_list->refcount = 1;
+  if (new_list->len == 0)
+  {
+    new_list->first = NULL;
+    new_list->last = NULL;
+    return new_list;
+  }
+  new_list->first = haplo_value_list_ref(list->first->next);
+  new_list->last = list->last;
+  return new_list;
+}
+
+_Static_assert(_HAPLO_VAL_MAX == 20,
               "Added a new value type, maybe update haplo_value_free");
 void haplo_value_free(HaploValue value)
 {
   switch(value.type)
   {
   case HAPLO_VAL_STRING:
-    if (value.value.string) free(value.value.string);
+    if (value.inline_size == 0) haplo_string_free(value.value.string);
     break;
   case HAPLO_VAL_QUOTE:
-    if (value.value.quote) free(value.value.quote);
+    if (value.inline_size == 0) haplo_free(value.value.quote);
     break;
   case HAPLO_VAL_SYMBOL:
-    if (value.value.symbol) free(value.value.symbol);
+    if (value.inline_size == 0) haplo_free(value.value.symbol);
     break;
   case HAPLO_VAL_LIST:
-    if (value.value.list) haplo_value_list_free(value.value.list);
+    haplo_list_free(value.value.list);
+    break;
+  case HAPLO_VAL_VECTOR:
+    haplo_vector_free(value.value.vector);
+    break;
+  case HAPLO_VAL_MAP:
+    haplo_map_free(value.value.map);
+    break;
+  case HAPLO_VAL_PMAP:
+    haplo_hamt_free(value.value.hamt);
+    break;
+  case HAPLO_VAL_SET:
+    haplo_set_free(value.value.set);
+    break;
+  case HAPLO_VAL_RECORD:
+    haplo_record_free(value.value.record);
+    break;
+  case HAPLO_VAL_ARRAY:
+    haplo_array_free(value.value.array);
+    break;
+  case HAPLO_VAL_MATRIX:
+    haplo_matrix_free(value.value.matrix);
+    break;
+  case HAPLO_VAL_BIGINT:
+    haplo_bigint_free(value.value.bigint);
+    break;
+  case HAPLO_VAL_ITER:
+    haplo_iter_free(value.value.iter);
+    break;
+  case HAPLO_VAL_REGEX:
+    haplo_regex_free(value.value.regex);
+    break;
+  case HAPLO_VAL_BYTES:
+    haplo_bytes_free(value.value.bytes);
     break;
   default:
     break;
@@ -93,7 +340,270 @@ void haplo_value_free(HaploValue value)
   return;
 }
 
-_Static_assert(_HAPLO_VAL_MAX == 9,
+bool haplo_value_hashable(HaploValue value)
+{
+  switch(value.type)
+  {
+  case HAPLO_VAL_INTEGER:
+  case HAPLO_VAL_FLOAT:
+  case HAPLO_VAL_STRING:
+  case HAPLO_VAL_BOOL:
+  case HAPLO_VAL_SYMBOL:
+  case HAPLO_VAL_QUOTE:
+  case HAPLO_VAL_BIGINT:
+    return true;
+  default:
+    break;
+  }
+  return false;
+}
+
+// Finalizer of splitmix64, spreads the bits of x over the whole hash
+static uint64_t haplo_value_hash_mix(uint64_t x)
+{
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+// FNV-1a
+uint64_t haplo_value_hash(HaploValue value)
+{
+  // The type is mixed in so that equal bits of different types, like
+  // a string and a quote, don't collide
+  uint64_t hash = 0;
+  switch(value.type)
+  {
+  case HAPLO_VAL_INTEGER:
+    hash = (uint64_t) value.value.integer;
+    break;
+  case HAPLO_VAL_FLOAT: ;
+    // 0.0 and -0.0 are equal, they need the same hash
+    double floating_point = value.value.floating_point;
+    if (floating_point == 0.0) floating_point = 0.0;
+    memcpy(&hash, &floating_point, sizeof(hash));
+    break;
+  case HAPLO_VAL_STRING:
+    // Only heap strings cache their hash, inline and heap strings with
+    // the same bytes must hash the same
+    hash = (value.inline_size == 0)
+      ? haplo_string_hash(value.value.string)
+      : haplo_string_hash_bytes(value.value.inline_bytes, value.inline_size - 1);
+    break;
+  case HAPLO_VAL_BOOL:
+    hash = value.value.boolean;
+    break;
+  case HAPLO_VAL_SYMBOL:
+  case HAPLO_VAL_QUOTE:
+    hash = haplo_string_hash_bytes(haplo_value_text(&value),
+                                   haplo_value_text_len(&value));
+    break;
+  case HAPLO_VAL_BIGINT:
+    hash = haplo_bigint_hash(value.value.bigint);
+    break;
+  default:
+    return 0;
+  }
+  return haplo_value_hash_mix(hash ^ ((uint64_t) value.type << 56));
+}
+
+static bool haplo_value_list_equal(HaploList *a, HaploList *b)
+{
+  if (a == b) return true;
+  if (haplo_list_len(a) != haplo_list_len(b)) return false;
+
+  HaploValueList *this_a = (haplo_list_len(a) > 0) ? a->first : NULL;
+  HaploValueList *this_b = (haplo_list_len(b) > 0) ? b->first : NULL;
+  for (int i = 0; i < haplo_list_len(a); ++i)
+  {
+    if (!haplo_value_equal(this_a->val, this_b->val)) return false;
+    this_a = this_a->next;
+    this_b = this_b->next;
+  }
+  return true;
+}
+
+static bool haplo_value_map_equal(HaploMap *a, HaploMap *b)
+{
+  if (a == b) return true;
+  if (haplo_map_size(a) != haplo_map_size(b)) return false;
+
+  for (int i = 0; i < a->capacity; ++i)
+  {
+    HaploMapEntry *entry = &a->entries[i];
+    if (entry->hash <= HAPLO_MAP_SLOT_DELETED) continue;
+
+    HaploValue *value = haplo_map_get(b, entry->key);
+    if (!value || !haplo_value_equal(entry->value, *value)) return false;
+  }
+  return true;
+}
+
+static bool haplo_value_hamt_equal_entry(HaploHamtEntry *entry, void *ctx)
+{
+  HaploValue *value = haplo_hamt_get((HaploHamt*) ctx, entry->key);
+  return value && haplo_value_equal(entry->value, *value);
+}
+
+static bool haplo_value_hamt_equal(HaploHamt *a, HaploHamt *b)
+{
+  if (a == b || a->root == b->root) return true;
+  if (haplo_hamt_size(a) != haplo_hamt_size(b)) return false;
+  return haplo_hamt_foreach(a, haplo_value_hamt_equal_entry, b);
+}
+
+static bool haplo_value_set_equal_value(HaploValue value, void *ctx)
+{
+  return haplo_set_has((HaploSet*) ctx, value);
+}
+
+static bool haplo_value_set_equal(HaploSet *a, HaploSet *b)
+{
+  if (a == b) return true;
+  if (haplo_set_size(a) != haplo_set_size(b)) return false;
+  return haplo_set_foreach(a, haplo_value_set_equal_value, b);
+}
+
+_Static_assert(_HAPLO_VAL_MAX == 20,
+              "Added a new value type, update haplo_value_equal");
+bool haplo_value_equal(HaploValue a, HaploValue b)
+{
+  if (a.type != b.type) return false;
+
+  switch(a.type)
+  {
+  case HAPLO_VAL_INTEGER:
+    return a.value.integer == b.value.integer;
+  case HAPLO_VAL_FLOAT:
+    return a.value.floating_point == b.value.floating_point;
+  case HAPLO_VAL_STRING:
+    if (a.inline_size == 0 && b.inline_size == 0)
+      return haplo_string_equal(a.value.string, b.value.string);
+    return haplo_value_text_len(&a) == haplo_value_text_len(&b)
+      && memcmp(haplo_value_text(&a), haplo_value_text(&b),
+                haplo_value_text_len(&a)) == 0;
+  case HAPLO_VAL_BOOL:
+    return a.value.boolean == b.value.boolean;
+  case HAPLO_VAL_SYMBOL:
+    return strcmp(haplo_value_text(&a), haplo_value_text(&b)) == 0;
+  case HAPLO_VAL_LIST:
+    return haplo_value_list_equal(a.value.list, b.value.list);
+  case HAPLO_VAL_QUOTE:
+    return strcmp(haplo_value_text(&a), haplo_value_text(&b)) == 0;
+  case HAPLO_VAL_EMPTY:
+    return true;
+  case HAPLO_VAL_ERROR:
+    return a.value.error == b.value.error;
+  case HAPLO_VAL_VECTOR:
+    if (a.value.vector == b.value.vector) return true;
+    if (a.value.vector->len != b.value.vector->len) return false;
+    for (int i = 0; i < a.value.vector->len; ++i)
+      if (!haplo_value_equal(a.value.vector->items[i], b.value.vector->items[i]))
+        return false;
+    return true;
+  case HAPLO_VAL_MAP:
+    return haplo_value_map_equal(a.value.map, b.value.map);
+  case HAPLO_VAL_PMAP:
+    return haplo_value_hamt_equal(a.value.hamt, b.value.hamt);
+  case HAPLO_VAL_SET:
+    return haplo_value_set_equal(a.value.set, b.value.set);
+  case HAPLO_VAL_RECORD:
+    if (a.value.record == b.value.record) return true;
+    if (a.value.record->shape != b.value.record->shape) return false;
+    for (int i = 0; i < a.value.record->shape->field_count; ++i)
+      if (!haplo_value_equal(a.value.record->slots[i], b.value.record->slots[i]))
+        return false;
+    return true;
+  case HAPLO_VAL_ARRAY:
+    if (a.value.array->type != b.value.array->type
+        || a.value.array->len != b.value.array->len) return false;
+    for (int i = 0; i < a.value.array->len; ++i)
+      if (!haplo_value_equal(haplo_array_nth(a.value.array, i),
+                             haplo_array_nth(b.value.array, i)))
+        return false;
+    return true;
+  case HAPLO_VAL_MATRIX: ;
+    HaploMatrix *ma = a.value.matrix, *mb = b.value.matrix;
+    if (ma->rows != mb->rows || ma->cols != mb->cols) return false;
+    for (int i = 0; i < ma->rows; ++i)
+      for (int j = 0; j < ma->cols; ++j)
+        if (haplo_matrix_at(ma, i, j) != haplo_matrix_at(mb, i, j))
+          return false;
+    return true;
+  case HAPLO_VAL_BIGINT:
+    return haplo_bigint_equal(a.value.bigint, b.value.bigint);
+  case HAPLO_VAL_ITER:
+    // Iterators may call functions, they are equal only to themselves
+    return a.value.iter == b.value.iter;
+  case HAPLO_VAL_REGEX:
+    return haplo_string_equal(a.value.regex->pattern, b.value.regex->pattern);
+  case HAPLO_VAL_BYTES:
+    return a.value.bytes->len == b.value.bytes->len
+      && (a.value.bytes->data == b.value.bytes->data
+          || memcmp(a.value.bytes->data, b.value.bytes->data, a.value.bytes->len) == 0);
+  default:
+    break;
+  }
+  return false;
+}
+
+static bool haplo_value_hamt_not_contains(HaploHamtEntry *entry, void *object)
+{
+  return !haplo_value_contains(entry->value, object);
+}
+
+_Static_assert(_HAPLO_VAL_MAX == 20,
+              "Added a new value type, maybe update haplo_value_contains");
+bool haplo_value_contains(HaploValue value, const void *object)
+{
+  switch(value.type)
+  {
+  case HAPLO_VAL_LIST: ;
+    HaploList *list = value.value.list;
+    HaploValueList *this = (haplo_list_len(list) > 0) ? list->first : NULL;
+    for (int i = 0; i < haplo_list_len(list); ++i, this = this->next)
+      if (haplo_value_contains(this->val, object)) return true;
+    return false;
+  case HAPLO_VAL_VECTOR: ;
+    HaploVector *vector = value.value.vector;
+    if (vector == object) return true;
+    for (int i = 0; i < vector->len; ++i)
+      if (haplo_value_contains(vector->items[i], object)) return true;
+    return false;
+  case HAPLO_VAL_MAP: ;
+    HaploMap *map = value.value.map;
+    if (map == object) return true;
+    // Keys are hashable, they can't hold other values
+    for (int i = 0; i < map->capacity; ++i)
+      if (map->entries[i].hash > HAPLO_MAP_SLOT_DELETED
+          && haplo_value_contains(map->entries[i].value, object))
+        return true;
+    return false;
+  case HAPLO_VAL_PMAP:
+    // A persistent map can't be updated to hold itself, but it can
+    // hold a vector or a map that is being updated
+    return !haplo_hamt_foreach(value.value.hamt,
+                               haplo_value_hamt_not_contains, (void*) object);
+  case HAPLO_VAL_RECORD: ;
+    HaploRecord *record = value.value.record;
+    if (record == object) return true;
+    for (int i = 0; i < record->shape->field_count; ++i)
+      if (haplo_value_contains(record->slots[i], object)) return true;
+    return false;
+  case HAPLO_VAL_ITER:
+    for (HaploIter *iter = value.value.iter; iter; iter = iter->source)
+      if (haplo_value_contains(iter->value, object)) return true;
+    return false;
+  default:
+    break;
+  }
+  return false;
+}
+
+_Static_assert(_HAPLO_VAL_MAX == 20,
               "Added a new value type, update haplo_value_type_string");
 const char* haplo_value_type_string(HaploValueType type)
 {
@@ -117,13 +627,35 @@ const char* haplo_value_type_string(HaploValueType type)
     return "HAPLO_VAL_EMPTY";
   case HAPLO_VAL_ERROR:
     return "HAPLO_VAL_ERROR";
+  case HAPLO_VAL_VECTOR:
+    return "HAPLO_VAL_VECTOR";
+  case HAPLO_VAL_MAP:
+    return "HAPLO_VAL_MAP";
+  case HAPLO_VAL_PMAP:
+    return "HAPLO_VAL_PMAP";
+  case HAPLO_VAL_SET:
+    return "HAPLO_VAL_SET";
+  case HAPLO_VAL_RECORD:
+    return "HAPLO_VAL_RECORD";
+  case HAPLO_VAL_ARRAY:
+    return "HAPLO_VAL_ARRAY";
+  case HAPLO_VAL_MATRIX:
+    return "HAPLO_VAL_MATRIX";
+  case HAPLO_VAL_BIGINT:
+    return "HAPLO_VAL_BIGINT";
+  case HAPLO_VAL_ITER:
+    return "HAPLO_VAL_ITER";
+  case HAPLO_VAL_REGEX:
+    return "HAPLO_VAL_REGEX";
+  case HAPLO_VAL_BYTES:
+    return "HAPLO_VAL_BYTES";
   default:
     break;
   }
   return "HAPLO_VAL_UNKNOWN_VALUE";
 }
 
-_Static_assert(_HAPLO_VAL_MAX == 9,
+_Static_assert(_HAPLO_VAL_MAX == 20,
               "Added a new value type, update haplo_value_deep_copy");
 HaploValue haplo_value_deep_copy(HaploValue value)
 {
@@ -134,85 +666,338 @@ HaploValue haplo_value_deep_copy(HaploValue value)
     return value;
   case HAPLO_VAL_FLOAT:
     return value;
-  case HAPLO_VAL_STRING: ;
-    char* new_string = (char*) malloc(strlen(value.value.string)+1);
-    strcpy(new_string, value.value.string);
+  case HAPLO_VAL_STRING:
+    if (value.inline_size != 0) return value;
+    // Strings are immutable, a copy shares them
     new_value.type = HAPLO_VAL_STRING;
-    new_value.value.string = new_string;
+    new_value.value.string = haplo_string_ref(value.value.string);
     break;
   case HAPLO_VAL_BOOL:
     return value;
   case HAPLO_VAL_SYMBOL: ;
-    char* new_symbol = (char*) malloc(strlen(value.value.symbol)+1);
-    strcpy(new_symbol, value.value.symbol);
+    if (value.inline_size != 0) return value;
+    char* new_symbol = haplo_strdup(value.value.symbol);
+    if (!new_symbol) goto out_of_memory;
     new_value.type = HAPLO_VAL_SYMBOL;
     new_value.value.symbol = new_symbol;
     break;
   case HAPLO_VAL_LIST:
     new_value.type = HAPLO_VAL_LIST;
-    new_value.value.list = haplo_value_list_deep_copy(value.value.list);
+    new_value.value.list = haplo_list_ref(value.value.list);
     break;
   case HAPLO_VAL_QUOTE: ;
-    char* new_quote = (char*) malloc(strlen(value.value.quote)+1);
-    strcpy(new_quote, value.value.quote);
+    if (value.inline_size != 0) return value;
+    char* new_quote = haplo_strdup(value.value.quote);
+    if (!new_quote) goto out_of_memory;
     new_value.type = HAPLO_VAL_QUOTE;
-    new_value.value.string = new_quote;
+    new_value.value.quote = new_quote;
     break;
   case HAPLO_VAL_EMPTY:
     return value;
   case HAPLO_VAL_ERROR:
     return value;
+  case HAPLO_VAL_VECTOR:
+    new_value.type = HAPLO_VAL_VECTOR;
+    new_value.value.vector = haplo_vector_ref(value.value.vector);
+    break;
+  case HAPLO_VAL_MAP:
+    new_value.type = HAPLO_VAL_MAP;
+    new_value.value.map = haplo_map_ref(value.value.map);
+    break;
+  case HAPLO_VAL_PMAP:
+    new_value.type = HAPLO_VAL_PMAP;
+    new_value.value.hamt = haplo_hamt_ref(value.value.hamt);
+    break;
+  case HAPLO_VAL_SET:
+    new_value.type = HAPLO_VAL_SET;
+    new_value.value.set = haplo_set_ref(value.value.set);
+    break;
+  case HAPLO_VAL_RECORD:
+    new_value.type = HAPLO_VAL_RECORD;
+    new_value.value.record = haplo_record_ref(value.value.record);
+    break;
+  case HAPLO_VAL_ARRAY:
+    new_value.type = HAPLO_VAL_ARRAY;
+    new_value.value.array = haplo_array_ref(value.value.array);
+    break;
+  case HAPLO_VAL_MATRIX:
+    new_value.type = HAPLO_VAL_MATRIX;
+    new_value.value.matrix = haplo_matrix_ref(value.value.matrix);
+    break;
+  case HAPLO_VAL_BIGINT:
+    new_value.type = HAPLO_VAL_BIGINT;
+    new_value.value.bigint = haplo_bigint_ref(value.value.bigint);
+    break;
+  case HAPLO_VAL_ITER:
+    new_value.type = HAPLO_VAL_ITER;
+    new_value.value.iter = haplo_iter_ref(value.value.iter);
+    break;
+  case HAPLO_VAL_REGEX:
+    new_value.type = HAPLO_VAL_REGEX;
+    new_value.value.regex = haplo_regex_ref(value.value.regex);
+    break;
+  case HAPLO_VAL_BYTES:
+    new_value.type = HAPLO_VAL_BYTES;
+    new_value.value.bytes = haplo_bytes_ref(value.value.bytes);
+    break;
   default:
     new_value.type = HAPLO_VAL_ERROR;
     new_value.value.error = HAPLO_ERROR_VALUE_TYPE_UNRECOGNIZED;
     break;
   }
   return new_value;
+
+ out_of_memory:
+  return (HaploValue) {
+    .type = HAPLO_VAL_ERROR,
+    .value.error = HAPLO_ERROR_OUT_OF_MEMORY,
+  };
 }
 
-int haplo_value_list_string_rec(HaploValueList *this, char* buf, int buf_len, int offset)
+// The first cell of the chain is the last value to be printed, the
+// cells are collected first so that the list is printed in a loop
+static int haplo_value_list_string(HaploList *list, char* buf, int buf_len)
 {
-  if (!this) return offset;
-  
-  offset = haplo_value_list_string_rec(this->next, buf, buf_len, offset);
-  
-  offset += haplo_value_string(this->val, buf + offset, buf_len - offset);
-  offset += snprintf(buf + offset, buf_len - offset, " ");
+  int offset = haplo_snprintf_clamp(snprintf(buf, buf_len, "list: "),
+                                          buf_len);
+  int len = haplo_list_len(list);
+  if (len == 0) return offset;
+
+  HaploValueList *stack_cells[64];
+  HaploValueList **cells = stack_cells;
+  if (len > 64)
+  {
+    cells = haplo_alloc(len * sizeof(HaploValueList*));
+    if (!cells)
+      return offset + haplo_snprintf_clamp(snprintf(buf + offset, buf_len - offset, "..."),
+                                                 buf_len - offset);
+  }
+
+  HaploValueList *this = list->first;
+  for (int i = len - 1; i >= 0; --i)
+  {
+    cells[i] = this;
+    this = this->next;
+  }
+
+  for (int i = 0; i < len && offset < buf_len - 1; ++i)
+  {
+    offset += haplo_snprintf_clamp(haplo_value_string(cells[i]->val, buf + offset,
+                                                      buf_len - offset),
+                                   buf_len - offset);
+    offset += haplo_snprintf_clamp(snprintf(buf + offset, buf_len - offset, " "),
+                                         buf_len - offset);
+  }
+
+  if (cells != stack_cells) haplo_free(cells);
   return offset;
 }
 
-_Static_assert(_HAPLO_VAL_MAX == 9,
+// Copies the len bytes of text to buf as snprintf would
+static int haplo_value_string_copy(const char *text, int len, char *buf, int buf_len)
+{
+  int copied = (len < buf_len) ? len : buf_len - 1;
+  memcpy(buf, text, copied);
+  buf[copied] = '\0';
+  return len;
+}
+
+_Static_assert(_HAPLO_VAL_MAX == 20,
               "Added a new value type, update haplo_value_string");
 int haplo_value_string(HaploValue value, char* buf, int buf_len)
 {
   if (buf_len <= 0) return 0;
+  char number[HAPLO_FMT_DOUBLE_MAX];
+  int len;
   
   switch(value.type)
   {
   case HAPLO_VAL_INTEGER:
-    return snprintf(buf, buf_len, "%ld", value.value.integer);
+    len = haplo_fmt_long(number, value.value.integer);
+    return haplo_value_string_copy(number, len, buf, buf_len);
   case HAPLO_VAL_FLOAT:
-    return snprintf(buf, buf_len, "%f", value.value.floating_point);
+    len = haplo_fmt_double(number, value.value.floating_point);
+    return haplo_value_string_copy(number, len, buf, buf_len);
   case HAPLO_VAL_STRING:
-    return snprintf(buf, buf_len, "\"%s\"", value.value.string);
+    return snprintf(buf, buf_len, "\"%.*s\"",
+                    haplo_value_text_len(&value), haplo_value_text(&value));
   case HAPLO_VAL_BOOL:
     return snprintf(buf, buf_len, "%s", value.value.boolean ? "true" : "false");
   case HAPLO_VAL_SYMBOL:
-    return snprintf(buf, buf_len, "%s", value.value.symbol);
-  case HAPLO_VAL_LIST: ;
-    HaploValueList *this = value.value.list;
-    int offset = 0;
-    offset += snprintf(buf, buf_len, "list: ");
-    offset = haplo_value_list_string_rec(this, buf, buf_len, offset);
-    return offset;
+    return snprintf(buf, buf_len, "%s", haplo_value_text(&value));
+  case HAPLO_VAL_LIST:
+    return haplo_value_list_string(value.value.list, buf, buf_len);
   case HAPLO_VAL_QUOTE:
-    return snprintf(buf, buf_len, "'%s", value.value.quote);
+    return snprintf(buf, buf_len, "'%s", haplo_value_text(&value));
   case HAPLO_VAL_EMPTY:
     return snprintf(buf, buf_len, "empty");
   case HAPLO_VAL_ERROR:
     return snprintf(buf, buf_len, "Error: %s", haplo_error_string(value.value.error));
+  case HAPLO_VAL_VECTOR:
+    return haplo_vector_string(value.value.vector, buf, buf_len);
+  case HAPLO_VAL_MAP:
+    return haplo_map_string(value.value.map, buf, buf_len);
+  case HAPLO_VAL_PMAP:
+    return haplo_hamt_string(value.value.hamt, buf, buf_len);
+  case HAPLO_VAL_SET:
+    return haplo_set_string(value.value.set, buf, buf_len);
+  case HAPLO_VAL_RECORD:
+    return haplo_record_string(value.value.record, buf, buf_len);
+  case HAPLO_VAL_ARRAY:
+    return haplo_array_string(value.value.array, buf, buf_len);
+  case HAPLO_VAL_MATRIX:
+    return haplo_matrix_string(value.value.matrix, buf, buf_len);
+  case HAPLO_VAL_BIGINT:
+    return haplo_bigint_string(value.value.bigint, buf, buf_len);
+  case HAPLO_VAL_ITER:
+    return haplo_iter_string(value.value.iter, buf, buf_len);
+  case HAPLO_VAL_REGEX:
+    return snprintf(buf, buf_len, "regex: %.*s", value.value.regex->pattern->len,
+                    value.value.regex->pattern->data);
+  case HAPLO_VAL_BYTES:
+    return haplo_bytes_string(value.value.bytes, buf, buf_len);
   default:
     break;
   }
   return 0;
 }
+
+HaploValue haplo_value_text_new(HaploValueType type, const char *data, int len)
+{
+  HaploValue value = { .type = type };
+  if (len <= HAPLO_VALUE_INLINE_MAX)
+  {
+    memcpy(value.value.inline_bytes, data, len);
+    value.value.inline_bytes[len] = '\0';
+    value.inline_size = len + 1;
+    return value;
+  }
+
+  switch(type)
+  {
+  case HAPLO_VAL_STRING:
+    value.value.string = haplo_string_new(data, len);
+    if (!value.value.string) goto out_of_memory;
+    break;
+  case HAPLO_VAL_SYMBOL:
+    value.value.symbol = haplo_strndup(data, len);
+    if (!value.value.symbol) goto out_of_memory;
+    break;
+  case HAPLO_VAL_QUOTE:
+    value.value.quote = haplo_strndup(data, len);
+    if (!value.value.quote) goto out_of_memory;
+    break;
+  default:
+    return (HaploValue) {
+      .type = HAPLO_VAL_ERROR,
+      .value.error = HAPLO_ERROR_INTERPRETER_INVALID_TYPE,
+    };
+  }
+  return value;
+
+ out_of_memory:
+  return (HaploValue) {
+    .type = HAPLO_VAL_ERROR,
+    .value.error = HAPLO_ERROR_OUT_OF_MEMORY,
+  };
+}
+
+const char *haplo_value_text(const HaploValue *value)
+{
+  if (value->inline_size != 0) return value->value.inline_bytes;
+  switch(value->type)
+  {
+  case HAPLO_VAL_STRING:
+    return value->value.string->data;
+  case HAPLO_VAL_SYMBOL:
+    return value->value.symbol;
+  case HAPLO_VAL_QUOTE:
+    return value->value.quote;
+  default:
+    return NULL;
+  }
+}
+
+int haplo_value_text_len(const HaploValue *value)
+{
+  if (value->inline_size != 0) return value->inline_size - 1;
+  switch(value->type)
+  {
+  case HAPLO_VAL_STRING:
+    return value->value.string->len;
+  case HAPLO_VAL_SYMBOL:
+    return (int) strlen(value->value.symbol);
+  case HAPLO_VAL_QUOTE:
+    return (int) strlen(value->value.quote);
+  default:
+    return 0;
+  }
+}
+
+int haplo_value_text_codepoints(const HaploValue *value)
+{
+  if (value->inline_size == 0 && value->type == HAPLO_VAL_STRING)
+    return haplo_string_codepoints(value->value.string);
+  return haplo_utf8_count(haplo_value_text(value), haplo_value_text_len(value));
+}
+
+int haplo_value_text_offset(const HaploValue *value, int index)
+{
+  if (value->inline_size == 0 && value->type == HAPLO_VAL_STRING)
+    return haplo_string_codepoint_offset(value->value.string, index);
+  return haplo_utf8_advance(haplo_value_text(value), haplo_value_text_len(value), index);
+}
+
+char *haplo_value_string_alloc(HaploValue *value, int len)
+{
+  *value = (HaploValue) { .type = HAPLO_VAL_STRING };
+  if (len <= HAPLO_VALUE_INLINE_MAX)
+  {
+    value->inline_size = len + 1;
+    value->value.inline_bytes[len] = '\0';
+    return value->value.inline_bytes;
+  }
+
+  HaploString *string = haplo_string_new(NULL, len);
+  if (!string) return NULL;
+  value->value.string = string;
+  return string->buffer;
+}
+
+HaploValue haplo_value_string_slice(const HaploValue *value, int start, int len)
+{
+  if (len <= HAPLO_VALUE_INLINE_MAX)
+    return haplo_value_text_new(HAPLO_VAL_STRING, haplo_value_text(value) + start, len);
+
+  HaploString *slice = haplo_string_slice(value->value.string, start, len);
+  if (!slice)
+  {
+    return (HaploValue) {
+      .type = HAPLO_VAL_ERROR,
+      .value.error = HAPLO_ERROR_OUT_OF_MEMORY,
+    };
+  }
+  return (HaploValue) {
+    .type = HAPLO_VAL_STRING,
+    .value.string = slice,
+  };
+}
+
+HaploValue haplo_value_string_build(HaploStringBuilder *builder)
+{
+  HaploString *string = builder->string;
+  if (string && string->len <= HAPLO_VALUE_INLINE_MAX)
+  {
+    HaploValue value = haplo_value_text_new(HAPLO_VAL_STRING, string->buffer,
+                                            string->len);
+    haplo_string_builder_free(builder);
+    return value;
+  }
+  if (!string)
+    return haplo_value_text_new(HAPLO_VAL_STRING, "", 0);
+
+  return (HaploValue) {
+    .type = HAPLO_VAL_STRING,
+    .value.string = haplo_string_builder_finish(builder),
+  };
+}
@@ -6,7 +6,10 @@
 #ifndef HAPLO_VALUE_H
 #define HAPLO_VALUE_H
 
+#include "pool.h"
+
 #include <stdbool.h>
+#include <stdint.h>
 
 //
 // Macros
@@ -16,14 +19,38 @@
   #define ValueType HaploValueType
   #define Value HaploValue
   #define ValueList HaploValueList
+  #define List HaploList
   #define value_string haplo_value_string
+  #define value_text_new haplo_value_text_new
+  #define value_text haplo_value_text
+  #define value_text_len haplo_value_text_len
+  #define value_text_codepoints haplo_value_text_codepoints
+  #define value_text_offset haplo_value_text_offset
+  #define value_string_alloc haplo_value_string_alloc
+  #define value_string_slice haplo_value_string_slice
+  #define value_string_build haplo_value_string_build
+  #define value_list_push_front haplo_value_list_push_front
+  #define value_list_ref haplo_value_list_ref
   #define value_list_len haplo_value_list_len
   #define value_list_print haplo_value_list_print
   #define value_list_free haplo_value_list_free
   #define value_list_deep_copy haplo_value_list_deep_copy
+  #define value_list_pool_bind haplo_value_list_pool_bind
+  #define value_list_pool_release haplo_value_list_pool_release
+  #define list_new haplo_list_new
+  #define list_ref haplo_list_ref
+  #define list_free haplo_list_free
+  #define list_len haplo_list_len
+  #define list_push_front haplo_list_push_front
+  #define list_push_back haplo_list_push_back
+  #define list_tail haplo_list_tail
   #define value_free haplo_value_free
   #define value_deep_copy haplo_value_deep_copy
   #define value_type_string haplo_value_type_string
+  #define value_hashable haplo_value_hashable
+  #define value_hash haplo_value_hash
+  #define value_equal haplo_value_equal
+  #define value_contains haplo_value_contains
 #endif
 
 //
@@ -40,49 +67,208 @@ typedef enum {
   HAPLO_VAL_QUOTE,
   HAPLO_VAL_EMPTY,
   HAPLO_VAL_ERROR,
+  HAPLO_VAL_VECTOR,
+  HAPLO_VAL_MAP,
+  HAPLO_VAL_PMAP,
+  HAPLO_VAL_SET,
+  HAPLO_VAL_RECORD,
+  HAPLO_VAL_ARRAY,
+  HAPLO_VAL_MATRIX,
+  HAPLO_VAL_BIGINT,
+  HAPLO_VAL_ITER,
+  HAPLO_VAL_REGEX,
+  HAPLO_VAL_BYTES,
   _HAPLO_VAL_MAX,
 } HaploValueType;
 
 struct HaploValueList;
 typedef struct HaploValueList HaploValueList;
 
+struct HaploList;
+typedef struct HaploList HaploList;
+
+struct HaploVector;
+typedef struct HaploVector HaploVector;
+
+struct HaploMap;
+typedef struct HaploMap HaploMap;
+
+struct HaploHamt;
+typedef struct HaploHamt HaploHamt;
+
+struct HaploSet;
+typedef struct HaploSet HaploSet;
+
+struct HaploRecord;
+typedef struct HaploRecord HaploRecord;
+
+struct HaploArray;
+typedef struct HaploArray HaploArray;
+
+struct HaploMatrix;
+typedef struct HaploMatrix HaploMatrix;
+
+struct HaploBigint;
+typedef struct HaploBigint HaploBigint;
+struct HaploString;
+typedef struct HaploString HaploString;
+struct HaploStringBuilder;
+typedef struct HaploStringBuilder HaploStringBuilder;
+
+struct HaploIter;
+typedef struct HaploIter HaploIter;
+struct HaploRegex;
+typedef struct HaploRegex HaploRegex;
+
+struct HaploBytes;
+typedef struct HaploBytes HaploBytes;
+
+// Strings, quotes and symbols of up to this many bytes are stored in
+// the value instead of on the heap
+#define HAPLO_VALUE_INLINE_MAX 15
+
 typedef struct {
   HaploValueType type;
+  // The length plus one of a string, quote or symbol stored in
+  // value.inline_bytes, or 0 if it is stored on the heap
+  unsigned char inline_size;
   union {
     long integer;
     double floating_point;
-    char* string;
+    HaploString *string;
     bool boolean;
     char* symbol;
     char* quote;
-    HaploValueList *list;
+    HaploList *list;
     int error;
+    HaploVector *vector;
+    HaploMap *map;
+    HaploHamt *hamt;
+    HaploSet *set;
+    HaploRecord *record;
+    HaploArray *array;
+    HaploMatrix *matrix;
+    HaploBigint *bigint;
+    HaploIter *iter;
+    HaploRegex *regex;
+    HaploBytes *bytes;
+    // Up to HAPLO_VALUE_INLINE_MAX bytes and a NUL
+    char inline_bytes[HAPLO_VALUE_INLINE_MAX + 1];
   } value;
 } HaploValue;
 
+// A cell of a chain. Chains share their cells: a cell can be the
+// next of many other cells, refcount counts the references to it.
 struct HaploValueList {
   HaploValueList *next;
   HaploValue val;
+  unsigned int refcount;
+};
+
+// A list value is an immutable header over a chain of cells. Only
+// the first len cells of the chain belong to the list, so a chain can
+// grow at its back without changing the lists that share it.
+struct HaploList {
+  HaploValueList *first;
+  HaploValueList *last;
+  int len;
+  unsigned int refcount;
 };
 
+// List cells and list headers come from the same pool
+#define HAPLO_VALUE_LIST_POOL_CELL_SIZE \
+  (sizeof(HaploValueList) > sizeof(HaploList) ? \
+   sizeof(HaploValueList) : sizeof(HaploList))
+
 //
 // Functions
 //
 
+// List cells are allocated from the pool bound to the calling
+// thread. Binds pool and returns the previously bound one, a NULL
+// pool selects the default pool of the thread.
+HaploPool *haplo_value_list_pool_bind(HaploPool *pool);
+// Releases the slabs of the default pool of the calling thread, which
+// are not released when the thread exits. The cells allocated from it
+// become invalid, even those used by a live interpreter, so it should
+// be called only when the thread is done with lists, before it exits.
+void haplo_value_list_pool_release(void);
+// Returns a new list with value in front of list. Takes ownership of
+// value and of the reference to list.
 HaploValueList *haplo_value_list_push_front(HaploValue value,
                                             HaploValueList *list);
+// Returns a new reference to list, the cells are shared
+HaploValueList *haplo_value_list_ref(HaploValueList *list);
 // Returns the length of the list
 int haplo_value_list_len(HaploValueList *list);
+// Drops a reference to list, cells are freed when they are not
+// referenced anymore
 void haplo_value_list_free(HaploValueList *list);
 void haplo_value_list_print(HaploValueList *list);
-// Returns a deep copy of the argument list
+// Returns a deep copy of the argument list, the cells of the copy
+// are not shared with anyone
 HaploValueList *haplo_value_list_deep_copy(HaploValueList *list);
+// Returns a list over the chain starting at first, taking ownership
+// of the reference to first. Returns NULL if out of memory.
+HaploList *haplo_list_new(HaploValueList *first);
+// Returns a new reference to list
+HaploList *haplo_list_ref(HaploList *list);
+void haplo_list_free(HaploList *list);
+// Returns the number of values in list, in O(1)
+int haplo_list_len(HaploList *list);
+// The following functions return a new list sharing the cells of
+// list, or NULL if out of memory. They take ownership of value.
+HaploList *haplo_list_push_front(HaploList *list, HaploValue value);
+HaploList *haplo_list_push_back(HaploList *list, HaploValue value);
+// Returns list without its first value, list must not be empty
+HaploList *haplo_list_tail(HaploList *list);
 const char* haplo_value_type_string(HaploValueType type);
-// Returns a deep copy of the argument value
+// Returns a deep copy of the argument value. Lists and persistent
+// maps are immutable, vectors, maps and sets are shared by reference,
+// so their copy is the same object.
 HaploValue haplo_value_deep_copy(HaploValue value);
 void haplo_value_free(HaploValue value);
+// Returns true if value can be the key of a map: integers, floats,
+// strings, bools, symbols and quotes
+bool haplo_value_hashable(HaploValue value);
+// Returns the hash of a hashable value, equal values have the same
+// hash
+uint64_t haplo_value_hash(HaploValue value);
+// Returns true if a and b are structurally equal. Vectors and maps
+// are compared by their content.
+bool haplo_value_equal(HaploValue a, HaploValue b);
+// Returns true if value is object, a vector or map, or holds it in
+// one of its nested values. Storing such a value in object would
+// create a cycle that refcounting can't free.
+bool haplo_value_contains(HaploValue value, const void *object);
 // Returns the number of bytes written to buf. At most buf_len bytes
 // will be written.
 int haplo_value_string(HaploValue value, char* buf, int buf_len);
+// Returns a STRING, QUOTE or SYMBOL value of type with a copy of the
+// len bytes of data, which are stored inline when they fit. Returns an
+// ERROR value if out of memory.
+HaploValue haplo_value_text_new(HaploValueType type, const char *data, int len);
+// Returns the bytes of a STRING, QUOTE or SYMBOL value. Quotes and
+// symbols are NUL terminated, strings have haplo_value_text_len bytes
+// and may be slices that are not. Inline bytes live in *value, they
+// are valid as long as it is.
+const char *haplo_value_text(const HaploValue *value);
+int haplo_value_text_len(const HaploValue *value);
+// The same as haplo_string_codepoints and
+// haplo_string_codepoint_offset, for the bytes of a STRING, QUOTE or
+// SYMBOL value
+int haplo_value_text_codepoints(const HaploValue *value);
+int haplo_value_text_offset(const HaploValue *value, int index);
+// Makes *value a STRING of len bytes, inline when they fit, and
+// returns the bytes for the caller to write. Returns NULL if out of
+// memory.
+char *haplo_value_string_alloc(HaploValue *value, int len);
+// Returns a STRING of the len bytes of the STRING value from start.
+// Long ones share the bytes of value. Returns an ERROR value if out of
+// memory.
+HaploValue haplo_value_string_slice(const HaploValue *value, int start, int len);
+// Returns a STRING of the bytes of builder, inline when they fit, and
+// empties builder. Returns an ERROR value if out of memory.
+HaploValue haplo_value_string_build(HaploStringBuilder *builder);
 
 #endif // HAPLO_VALUE_H
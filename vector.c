@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#include "vector.h"
+#include "errors.h"
+#include "utils.h"
+#include "alloc.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+
+HaploVector *haplo_vector_new(int capacity)
+{
+  HaploVector *vector = haplo_alloc(sizeof(HaploVector));
+  if (UNLIKELY(!vector)) return NULL;
+
+  vector->items = NULL;
+  vector->len = 0;
+  vector->capacity = 0;
+  vector->refcount = 1;
+  if (capacity > 0)
+  {
+    vector->items = haplo_alloc(capacity * sizeof(HaploValue));
+    if (UNLIKELY(!vector->items))
+    {
+      haplo_free(vector);
+      return NULL;
+    }
+    vector->capacity = capacity;
+  }
+  return vector;
+}
+
+HaploVector *haplo_vector_ref(HaploVector *vector)
+{
+  if (vector) vector->refcount++;
+  return vector;
+}
+
+void haplo_vector_free(HaploVector *vector)
+{
+  if (!vector || --vector->refcount != 0) return;
+
+  for (int i = 0; i < vector->len; ++i)
+    haplo_value_free(vector->items[i]);
+  haplo_free(vector->items);
+  haplo_free(vector);
+  return;
+}
+
+int haplo_vector_len(HaploVector *vector)
+{
+  return vector ? vector->len : 0;
+}
+
+int haplo_vector_push(HaploVector *vector, HaploValue value)
+{
+  assert(vector);
+
+  if (vector->len == vector->capacity)
+  {
+    if (UNLIKELY(vector->capacity > INT_MAX / 2))
+      goto out_of_memory;
+
+    int capacity = (vector->capacity == 0) ?
+      HAPLO_VECTOR_MIN_CAPACITY : vector->capacity * 2;
+    HaploValue *items = haplo_realloc(vector->items,
+                                      capacity * sizeof(HaploValue));
+    if (UNLIKELY(!items)) goto out_of_memory;
+
+    vector->items = items;
+    vector->capacity = capacity;
+  }
+
+  vector->items[vector->len++] = value;
+  return 0;
+
+ out_of_memory:
+  haplo_value_free(value);
+  return HAPLO_ERROR_OUT_OF_MEMORY;
+}
+
+HaploValue haplo_vector_nth(HaploVector *vector, int index)
+{
+  assert(vector && index >= 0 && index < vector->len);
+  return vector->items[index];
+}
+
+int haplo_vector_set_nth(HaploVector *vector, int index, HaploValue value)
+{
+  assert(vector && index >= 0 && index < vector->len);
+
+  haplo_value_free(vector->items[index]);
+  vector->items[index] = value;
+  return 0;
+}
+
+HaploVector *haplo_vector_slice(HaploVector *vector, int start, int end)
+{
+  assert(vector && start >= 0 && start <= end && end <= vector->len);
+
+  HaploVector *new_vector = haplo_vector_new(end - start);
+  if (UNLIKELY(!new_vector)) return NULL;
+
+  for (int i = start; i < end; ++i)
+    new_vector->items[new_vector->len++] =
+      haplo_value_deep_copy(vector->items[i]);
+  return new_vector;
+}
+
+HaploVector *haplo_vector_from_list(HaploList *list)
+{
+  int len = haplo_list_len(list);
+  HaploVector *vector = haplo_vector_new(len);
+  if (UNLIKELY(!vector)) return NULL;
+
+  // The first cell of the chain is the last value of the list
+  HaploValueList *this = (len > 0) ? list->first : NULL;
+  for (int i = len - 1; i >= 0; --i)
+  {
+    vector->items[i] = haplo_value_deep_copy(this->val);
+    this = this->next;
+  }
+  vector->len = len;
+  return vector;
+}
+
+HaploList *haplo_vector_to_list(HaploVector *vector)
+{
+  HaploValueList *chain = NULL;
+  for (int i = 0; i < haplo_vector_len(vector); ++i)
+  {
+    HaploValueList *new_chain =
+      haplo_value_list_push_front(haplo_value_deep_copy(vector->items[i]),
+                                  chain);
+    if (UNLIKELY(new_chain == chain))
+    {
+      haplo_value_list_free(chain);
+      return NULL;
+    }
+    chain = new_chain;
+  }
+  return haplo_list_new(chain);
+}
+
+int haplo_vector_string(HaploVector *vector, char *buf, int buf_len)
+{
+  int offset = haplo_snprintf_clamp(snprintf(buf, buf_len, "vector: "),
+                                    buf_len);
+  for (int i = 0; i < haplo_vector_len(vector) && offset < buf_len - 1; ++i)
+  {
+    offset += haplo_snprintf_clamp(haplo_value_string(vector->items[i],
+                                                      buf + offset,
+                                                      buf_len - offset),
+                                   buf_len - offset);
+    offset += haplo_snprintf_clamp(snprintf(buf + offset, buf_len - offset, " "),
+                                   buf_len - offset);
+  }
+  return offset;
+}
@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: MIT
+// Author:  Giovanni Santini
+// Mail:    giovanni.santini@proton.me
+// Github:  @San7o
+
+#ifndef HAPLO_VECTOR_H
+#define HAPLO_VECTOR_H
+
+#include "value.h"
+
+#include <stdbool.h>
+
+//
+// Macros
+//
+
+#ifdef HAPLO_NO_PREFIX
+  #define Vector HaploVector
+  #define vector_new haplo_vector_new
+  #define vector_ref haplo_vector_ref
+  #define vector_free haplo_vector_free
+  #define vector_len haplo_vector_len
+  #define vector_push haplo_vector_push
+  #define vector_nth haplo_vector_nth
+  #define vector_set_nth haplo_vector_set_nth
+  #define vector_slice haplo_vector_slice
+  #define vector_from_list haplo_vector_from_list
+  #define vector_to_list haplo_vector_to_list
+  #define vector_string haplo_vector_string
+#endif // HAPLO_NO_PREFIX
+
+// Capacity of a vector the first time it grows
+#ifndef HAPLO_VECTOR_MIN_CAPACITY
+#define HAPLO_VECTOR_MIN_CAPACITY 8
+#endif // HAPLO_VECTOR_MIN_CAPACITY
+
+//
+// Types
+//
+
+// A growable array of values. Unlike lists, vectors are mutable and
+// shared by reference: copying a vector value returns the same
+// vector, so updates are seen through every copy.
+struct HaploVector {
+  HaploValue *items;
+  int len;
+  int capacity;
+  unsigned int refcount;
+};
+
+//
+// Functions
+//
+
+// Returns an empty vector with room for capacity values, or NULL if
+// out of memory
+HaploVector *haplo_vector_new(int capacity);
+// Returns a new reference to vector
+HaploVector *haplo_vector_ref(HaploVector *vector);
+// Drops a reference to vector, its values are freed with the last one
+void haplo_vector_free(HaploVector *vector);
+int haplo_vector_len(HaploVector *vector);
+// Adds value at the end of vector, in amortized O(1). Takes ownership
+// of value. Returns 0 on success, or a negative error.
+int haplo_vector_push(HaploVector *vector, HaploValue value);
+// Returns the value at index without copying it, index must be in
+// bounds
+HaploValue haplo_vector_nth(HaploVector *vector, int index);
+// Replaces the value at index, freeing the old one. Takes ownership
+// of value. Returns 0 on success, or a negative error.
+int haplo_vector_set_nth(HaploVector *vector, int index, HaploValue value);
+// Returns a new vector with a copy of the values in [start, end), or
+// NULL if out of memory. The range must be in bounds.
+HaploVector *haplo_vector_slice(HaploVector *vector, int start, int end);
+// Returns a vector with a copy of the values of list in print order,
+// or NULL if out of memory
+HaploVector *haplo_vector_from_list(HaploList *list);
+// Returns a list with a copy of the values of vector, or NULL if out
+// of memory
+HaploList *haplo_vector_to_list(HaploVector *vector);
+// Returns the number of bytes written to buf. At most buf_len bytes
+// will be written.
+int haplo_vector_string(HaploVector *vector, char *buf, int buf_len);
+
+#endif // HAPLO_VECTOR_H